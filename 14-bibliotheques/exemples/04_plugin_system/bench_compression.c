@@ -0,0 +1,327 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Banc d'essai du plugin de compression v2 sur un corpus
+                 de journaux et de metriques (corpus/)
+                 - debit (Mo/s) et taux de compression par codec
+                 - blocs compresses en parallele : 1 / 2 / 4 threads
+                 - acces direct : lecture de 4 Kio sans tout decompresser
+                 - aller-retour, lectures directes et detection d'un
+                   octet corrompu controles
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "plugin_host.h"
+#include "trame.h"
+
+#define REPETITIONS   5             /* meilleur temps retenu */
+#define NB_LECTURES   2000
+#define TAILLE_LECTURE 4096
+
+static const char *corpus_defaut[] = { "corpus/acces.log", "corpus/metriques.lp", "corpus/applicatif.jsonl" };
+
+typedef struct {
+    const char *nom;
+    uint8_t *data;
+    size_t taille;
+} fichier_t;
+
+typedef struct {
+    const char *nom;            /* nom affiche */
+    const char *codec;
+    const char *niveau;         /* NULL : niveau par defaut du codec */
+} config_t;
+
+static const config_t configs[] = {
+    { "lz", "lz", NULL },
+    { "zlib -1", "zlib", "1" },
+    { "zlib -6", "zlib", "6" },
+    { "zstd -3", "zstd", "3" },
+};
+
+#define NB_CONFIGS (sizeof(configs) / sizeof(configs[0]))
+
+typedef struct {
+    plugin_host_t *h;
+    plugin_worker_t *w;
+    int id;
+    uint8_t *trame;
+    size_t capacite;
+    uint8_t *retour;
+} banc_t;
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int charger(fichier_t *f, const char *chemin) {
+    FILE *fp = fopen(chemin, "rb");
+    if (!fp) return -1;
+    fseek(fp, 0, SEEK_END);
+    long n = ftell(fp);
+    rewind(fp);
+    f->nom = strrchr(chemin, '/') ? strrchr(chemin, '/') + 1 : chemin;
+    f->taille = n > 0 ? (size_t)n : 0;
+    f->data = malloc(f->taille + 1);
+    bool ok = f->data && fread(f->data, 1, f->taille, fp) == f->taille;
+    fclose(fp);
+    return ok ? 0 : -1;
+}
+
+static int regler(banc_t *b, const char *cle, const char *valeur) {
+    return plugin_host_configure(b->h, b->id, cle, valeur);
+}
+
+static int appliquer(banc_t *b, const config_t *c) {
+    if (regler(b, "codec", c->codec) != 0) return -1;
+    return c->niveau ? regler(b, "niveau", c->niveau) : 0;
+}
+
+/* Une trame par appel (un enregistrement) ; renvoie sa taille, 0 si echec */
+static size_t compresser(banc_t *b, const fichier_t *f) {
+    PluginBuffer in = { f->data, f->taille };
+    PluginOutput out = { b->trame, b->capacite, 0 };
+    long r = plugin_host_process(b->w, b->id, &in, &out, 1);
+    if (r == 0 && out.len > b->capacite) {
+        /* Reglages changes : agrandir a la taille demandee et recommencer */
+        uint8_t *t = realloc(b->trame, out.len);
+        if (!t) return 0;
+        b->trame = t;
+        b->capacite = out.len;
+        out.data = t;
+        out.capacity = out.len;
+        r = plugin_host_process(b->w, b->id, &in, &out, 1);
+    }
+    return r == 1 ? out.len : 0;
+}
+
+typedef struct {
+    size_t taille;
+    double t_compr;
+    double t_decompr;
+    bool identique;
+} mesure_t;
+
+static bool mesurer(banc_t *b, const fichier_t *f, mesure_t *m) {
+    m->t_compr = m->t_decompr = 1e9;
+    m->identique = false;
+    for (int r = 0; r < REPETITIONS; r++) {
+        double debut = secondes();
+        m->taille = compresser(b, f);
+        double t = secondes() - debut;
+        if (m->taille == 0) return false;
+        if (t < m->t_compr) m->t_compr = t;
+    }
+    trame_t tr;
+    if (trame_ouvrir(&tr, b->trame, m->taille) != 0) return false;
+    for (int r = 0; r < REPETITIONS; r++) {
+        double debut = secondes();
+        long n = trame_tout(&tr, b->retour, f->taille);
+        double t = secondes() - debut;
+        if (n != (long)f->taille) return false;
+        if (t < m->t_decompr) m->t_decompr = t;
+    }
+    m->identique = memcmp(b->retour, f->data, f->taille) == 0;
+    return m->identique;
+}
+
+/* Lectures de 4 Kio a des positions pseudo-aleatoires, comparees a
+   l'original ; renvoie la duree moyenne d'une lecture (s), -1 si erreur */
+static double lectures_directes(const banc_t *b, size_t taille_trame, const fichier_t *f) {
+    trame_t tr;
+    if (trame_ouvrir(&tr, b->trame, taille_trame) != 0) return -1;
+    uint8_t *tampon = malloc(tr.taille_bloc), lu[TAILLE_LECTURE];
+    if (!tampon) return -1;
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    double debut = secondes();
+    for (int i = 0; i < NB_LECTURES; i++) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        size_t off = x % (f->taille - TAILLE_LECTURE);
+        if (trame_lire(&tr, off, lu, TAILLE_LECTURE, tampon) != 0 || memcmp(lu, f->data + off, TAILLE_LECTURE) != 0) {
+            free(tampon);
+            return -1;
+        }
+    }
+    double t = (secondes() - debut) / NB_LECTURES;
+    free(tampon);
+    return t;
+}
+
+/* Un octet modifie au milieu d'un bloc doit etre signale, un index
+   forge refuse a l'ouverture */
+static bool detecte_corruption(banc_t *b, size_t taille_trame) {
+    trame_t tr;
+    if (trame_ouvrir(&tr, b->trame, taille_trame) != 0 || tr.nblocs < 2) return false;
+    uint8_t *bloc = b->trame + trame_lire64(tr.index + TRAME_ENTREE_INDEX);
+    size_t taille_c = trame_lire32(bloc) & ~TRAME_BRUT;
+    bloc[TRAME_ENTETE_BLOC + taille_c / 2] ^= 0x20;
+    bool bloc0 = trame_bloc(&tr, 0, b->retour, tr.taille_bloc) >= 0;
+    bool bloc1 = trame_bloc(&tr, 1, b->retour, tr.taille_bloc) >= 0;
+    bloc[TRAME_ENTETE_BLOC + taille_c / 2] ^= 0x20;
+
+    /* Index forge : offset proche de 2^64, l'addition bornee deborderait */
+    uint8_t *entree = (uint8_t *)tr.index, sauvegarde[TRAME_ENTREE_INDEX];
+    memcpy(sauvegarde, entree, sizeof(sauvegarde));
+    trame_ecrire64(entree, 0xFFFFFFFFFFFFFFF0u);
+    trame_ecrire32(entree + 8, 0);
+    trame_t forgee;
+    bool index_refuse = trame_ouvrir(&forgee, b->trame, taille_trame) != 0;
+    memcpy(entree, sauvegarde, sizeof(sauvegarde));
+    return bloc0 && !bloc1 && index_refuse;
+}
+
+static double mo_s(size_t octets, double t) {
+    return (double)octets / t / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <plugin_compression.so> [fichiers...]\n", argv[0]);
+        return 1;
+    }
+    int nfichiers = argc > 2 ? argc - 2 : (int)(sizeof(corpus_defaut) / sizeof(corpus_defaut[0]));
+    fichier_t *fichiers = calloc((size_t)nfichiers + 1, sizeof(fichier_t));
+    fichier_t *tout = &fichiers[nfichiers];
+    if (!fichiers) return 1;
+    for (int i = 0; i < nfichiers; i++) {
+        const char *chemin = argc > 2 ? argv[2 + i] : corpus_defaut[i];
+        if (charger(&fichiers[i], chemin) != 0) {
+            perror(chemin);
+            return 1;
+        }
+        tout->taille += fichiers[i].taille;
+    }
+    /* Corpus concatene : assez de blocs pour occuper plusieurs threads */
+    tout->nom = "(ensemble)";
+    tout->data = malloc(tout->taille);
+    if (!tout->data || tout->taille < 2 * TAILLE_LECTURE) {
+        fprintf(stderr, "Erreur: corpus trop petit\n");
+        return 1;
+    }
+    for (size_t i = 0, pos = 0; i < (size_t)nfichiers; pos += fichiers[i].taille, i++)
+        memcpy(tout->data + pos, fichiers[i].data, fichiers[i].taille);
+
+    banc_t b = { 0 };
+    b.h = plugin_host_create(0);
+    b.id = b.h ? plugin_host_load(b.h, argv[1]) : -1;
+    b.w = b.id >= 0 ? plugin_host_worker_create(b.h) : NULL;
+    b.retour = malloc(tout->taille);
+    if (!b.w || !b.retour) {
+        fprintf(stderr, "Erreur: %s\n", b.h ? plugin_host_error(b.h) : "memoire");
+        return 1;
+    }
+    const PluginV2 *p = plugin_host_plugin(b.h, b.id);
+    printf("Plugin chargé : %s v%s (ABI %u)\n", p->name, p->version, p->abi_version);
+
+    bool disponible[NB_CONFIGS];
+    for (size_t c = 0; c < NB_CONFIGS; c++) {
+        disponible[c] = appliquer(&b, &configs[c]) == 0;
+        if (!disponible[c]) printf("Codec %-8s non compile (voir COMPILER.md)\n", configs[c].nom);
+    }
+
+    bool ok = true;
+    mesure_t m;
+
+    printf("\n=== Par fichier : blocs de 64 Kio, 1 thread ===\n");
+    printf("%-18s %-8s %10s %10s %7s %12s %12s  %s\n", "Fichier", "Codec", "Octets", "Trame", "Taux",
+           "Compr Mo/s", "Decomp Mo/s", "Controle");
+    regler(&b, "threads", "1");
+    for (int i = 0; i <= nfichiers; i++) {
+        for (size_t c = 0; c < NB_CONFIGS; c++) {
+            if (!disponible[c]) continue;
+            appliquer(&b, &configs[c]);
+            bool bon = mesurer(&b, &fichiers[i], &m);
+            ok = ok && bon;
+            printf("%-18s %-8s %10zu %10zu %6.2fx %12.1f %12.1f  %s\n", fichiers[i].nom, configs[c].nom,
+                   fichiers[i].taille, m.taille, (double)fichiers[i].taille / (double)m.taille,
+                   mo_s(fichiers[i].taille, m.t_compr), mo_s(fichiers[i].taille, m.t_decompr),
+                   bon ? "identique" : "DIFFERENT");
+        }
+    }
+
+    printf("\n=== Blocs en parallele : %s, %zu blocs de 64 Kio ===\n", tout->nom, trame_nblocs(tout->taille, 64u << 10));
+    printf("%-8s %8s %12s %10s  %s\n", "Codec", "Threads", "Compr Mo/s", "Gain", "Controle");
+    static const char *threads[] = { "1", "2", "4" };
+    for (size_t c = 0; c < NB_CONFIGS; c++) {
+        if (!disponible[c]) continue;
+        appliquer(&b, &configs[c]);
+        double base = 0;
+        for (size_t k = 0; k < sizeof(threads) / sizeof(threads[0]); k++) {
+            regler(&b, "threads", threads[k]);
+            bool bon = mesurer(&b, tout, &m);
+            ok = ok && bon;
+            if (k == 0) base = m.t_compr;
+            printf("%-8s %8s %12.1f %9.2fx  %s\n", configs[c].nom, threads[k], mo_s(tout->taille, m.t_compr),
+                   base / m.t_compr, bon ? "identique" : "DIFFERENT");
+        }
+    }
+
+    printf("\n=== Acces direct : lecture de %d octets a une position quelconque ===\n", TAILLE_LECTURE);
+    printf("%-8s %8s %7s %14s %14s  %s\n", "Codec", "Bloc", "Taux", "Lecture (us)", "Tout (us)", "Controle");
+    static const char *blocs[] = { "16384", "65536", "262144" };
+    regler(&b, "threads", "1");
+    for (size_t c = 0; c < NB_CONFIGS; c++) {
+        if (!disponible[c]) continue;
+        appliquer(&b, &configs[c]);
+        for (size_t k = 0; k < sizeof(blocs) / sizeof(blocs[0]); k++) {
+            regler(&b, "bloc", blocs[k]);
+            bool bon = mesurer(&b, tout, &m);
+            double t = bon ? lectures_directes(&b, m.taille, tout) : -1;
+            bon = bon && t >= 0 && detecte_corruption(&b, m.taille);
+            ok = ok && bon;
+            printf("%-8s %8s %6.2fx %14.2f %14.1f  %s\n", configs[c].nom, blocs[k],
+                   (double)tout->taille / (double)m.taille, t * 1e6, m.t_decompr * 1e6,
+                   bon ? "identique, corruption detectee" : "ECHEC");
+        }
+    }
+    regler(&b, "bloc", "65536");
+
+    /* Un niveau hors de la plage du codec est refuse, pas ignore */
+    const config_t *cfg = &configs[0];
+    for (size_t c = 1; c < NB_CONFIGS && cfg == &configs[0]; c++)
+        if (disponible[c]) cfg = &configs[c];
+    appliquer(&b, cfg);
+    const codec_t *codec = codec_par_nom(cfg->codec);
+    char niveau[16];
+    snprintf(niveau, sizeof(niveau), "%d", codec->niveau_max + 1);
+    bool refuse = regler(&b, "niveau", niveau) != 0;
+    printf("\nNiveau %s pour %s : %s\n", niveau, codec->nom, refuse ? "refuse" : "ACCEPTE");
+    ok = ok && refuse;
+
+    /* Les reglages survivent au rechargement : l'hote les rejoue. Codec,
+       niveau et bloc differents des valeurs initiales du plugin (lz, 64 Kio),
+       trame identique octet pour octet avant et apres */
+    regler(&b, "bloc", "16384");
+    size_t avant = compresser(&b, tout);
+    uint8_t *reference = avant ? malloc(avant) : NULL;
+    if (reference) memcpy(reference, b.trame, avant);
+    bool recharge = reference && plugin_host_reload(b.h, b.id, NULL) == 0;
+    size_t n = recharge ? compresser(&b, tout) : 0;
+    trame_t tr;
+    recharge = n == avant && memcmp(b.trame, reference, n) == 0 && trame_ouvrir(&tr, b.trame, n) == 0
+               && tr.codec == codec && tr.taille_bloc == 16384;
+    printf("Rechargement a chaud : ");
+    if (recharge) printf("reglages rejoues (%s, bloc 16384)\n", cfg->nom);
+    else printf("ECHEC\n");
+    ok = ok && recharge;
+    free(reference);
+
+    plugin_host_destroy(b.h);
+    for (int i = 0; i <= nfichiers; i++) free(fichiers[i].data);
+    free(fichiers);
+    free(b.trame);
+    free(b.retour);
+    printf("\nVerification : %s\n", ok ? "allers-retours et lectures directes identiques, blocs corrompus detectes"
+                                     : "ECHEC");
+    return ok ? 0 : 1;
+}
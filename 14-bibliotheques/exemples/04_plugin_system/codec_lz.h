@@ -0,0 +1,184 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Codec LZ rapide integre au plugin de compression
+                 - famille LZ77 a la LZ4 : sequences (litteraux, copie)
+                 - table de hachage des 4 octets suivants, pas de chaine
+                 - saut accelere dans les zones incompressibles
+                 - decodeur borne : une entree corrompue ne deborde jamais
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#ifndef CODEC_LZ_H
+#define CODEC_LZ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Format d'une sequence :
+     jeton      : 4 bits longueur des litteraux | 4 bits longueur de copie - 4
+                  (15 : la longueur continue sur des octets 255, 255, ..., < 255)
+     litteraux
+     distance   : 2 octets petit-boutiste (1..65535)
+     suite de la longueur de copie
+   La derniere sequence n'a que des litteraux : le decodeur s'arrete quand
+   l'entree est consommee juste apres eux. */
+
+#define LZ_MIN 4                /* plus courte copie codee */
+#define LZ_HASH_BITS 14
+#define LZ_DISTANCE_MAX 65535
+#define LZ_FIN_LITTERAUX 5      /* les derniers octets restent des litteraux */
+#define LZ_MARGE 12             /* aucune copie ne commence apres fin - 12 */
+
+/* Table de hachage d'un thread (64 Kio) : reutilisee d'un bloc a l'autre */
+typedef struct {
+    uint32_t table[1u << LZ_HASH_BITS];
+} lz_contexte_t;
+
+static inline size_t lz_borne(size_t n) {
+    return n + n / 255 + 16;
+}
+
+static inline uint32_t lz_lire32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t lz_hacher(uint32_t v) {
+    return (v * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+static inline uint8_t *lz_ecrire_longueur(uint8_t *op, size_t n) {
+    while (n >= 255) {
+        *op++ = 255;
+        n -= 255;
+    }
+    *op++ = (uint8_t)n;
+    return op;
+}
+
+/* Nombre d'octets egaux a partir de a et b, sans depasser fin */
+static inline const uint8_t *lz_etendre(const uint8_t *a, const uint8_t *b, const uint8_t *fin) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (a + 8 <= fin) {
+        uint64_t x, y;
+        memcpy(&x, a, 8);
+        memcpy(&y, b, 8);
+        if (x != y) return a + (__builtin_ctzll(x ^ y) >> 3);
+        a += 8;
+        b += 8;
+    }
+#endif
+    while (a < fin && *a == *b) {
+        a++;
+        b++;
+    }
+    return a;
+}
+
+/* Compresse n octets (n < 4 Gio). Renvoie la taille produite, 0 si dst
+   (cap octets) ne suffit pas ; cap >= lz_borne(n) suffit toujours. */
+static size_t lz_compresser(lz_contexte_t *ctx, const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    const uint8_t *ip = src, *ancre = src, *fin = src + n;
+    const uint8_t *limite = n > LZ_MARGE ? fin - LZ_MARGE : src;
+    const uint8_t *fin_copie = fin - (n > LZ_FIN_LITTERAUX ? LZ_FIN_LITTERAUX : n);
+    uint8_t *op = dst, *op_fin = dst + cap;
+
+    memset(ctx->table, 0, sizeof(ctx->table));
+    while (ip < limite) {
+        uint32_t h = lz_hacher(lz_lire32(ip));
+        const uint8_t *ref = src + ctx->table[h];
+        ctx->table[h] = (uint32_t)(ip - src);
+        if (ref >= ip || ip - ref > LZ_DISTANCE_MAX || lz_lire32(ref) != lz_lire32(ip)) {
+            /* Plus la derniere copie est loin, plus on saute : les zones
+               incompressibles sont traversees vite */
+            ip += 1 + ((size_t)(ip - ancre) >> 6);
+            continue;
+        }
+        while (ip > ancre && ref > src && ip[-1] == ref[-1]) {
+            ip--;
+            ref--;
+        }
+        const uint8_t *m = lz_etendre(ip + LZ_MIN, ref + LZ_MIN, fin_copie);
+
+        size_t lit = (size_t)(ip - ancre), ml = (size_t)(m - ip) - LZ_MIN;
+        if ((size_t)(op_fin - op) < 1 + lit / 255 + 1 + lit + 2 + ml / 255 + 1) return 0;
+        uint8_t *jeton = op++;
+        *jeton = (uint8_t)((lit >= 15 ? 15 : lit) << 4);
+        if (lit >= 15) op = lz_ecrire_longueur(op, lit - 15);
+        memcpy(op, ancre, lit);
+        op += lit;
+        size_t distance = (size_t)(ip - ref);
+        *op++ = (uint8_t)(distance & 0xff);
+        *op++ = (uint8_t)(distance >> 8);
+        *jeton |= (uint8_t)(ml >= 15 ? 15 : ml);
+        if (ml >= 15) op = lz_ecrire_longueur(op, ml - 15);
+
+        /* Referencer aussi la fin de la copie : les repetitions voisines
+           sont retrouvees sans revenir en arriere */
+        ctx->table[lz_hacher(lz_lire32(m - 2))] = (uint32_t)(m - 2 - src);
+        ip = ancre = m;
+    }
+
+    size_t lit = (size_t)(fin - ancre);
+    if ((size_t)(op_fin - op) < 1 + lit / 255 + 1 + lit) return 0;
+    *op++ = (uint8_t)((lit >= 15 ? 15 : lit) << 4);
+    if (lit >= 15) op = lz_ecrire_longueur(op, lit - 15);
+    memcpy(op, ancre, lit);
+    op += lit;
+    return (size_t)(op - dst);
+}
+
+/* Lit une suite de longueur (octets 255 ...) ; -1 si l'entree s'arrete avant */
+static inline int lz_lire_longueur(const uint8_t **ip, const uint8_t *fin, size_t *n) {
+    unsigned b;
+    do {
+        if (*ip >= fin) return -1;
+        b = *(*ip)++;
+        *n += b;
+    } while (b == 255);
+    return 0;
+}
+
+/* Decompresse n octets dans dst (cap octets). Renvoie la taille produite,
+   -1 si l'entree est invalide ou si dst est trop petit. */
+static long lz_decompresser(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    const uint8_t *ip = src, *fin = src + n;
+    uint8_t *op = dst, *op_fin = dst + cap;
+
+    for (;;) {
+        if (ip >= fin) return -1;
+        unsigned jeton = *ip++;
+        size_t lit = jeton >> 4;
+        if (lit == 15 && lz_lire_longueur(&ip, fin, &lit) != 0) return -1;
+        if ((size_t)(fin - ip) < lit || (size_t)(op_fin - op) < lit) return -1;
+        memcpy(op, ip, lit);
+        op += lit;
+        ip += lit;
+        if (ip == fin) break;
+
+        if (fin - ip < 2) return -1;
+        size_t distance = (size_t)ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        if (distance == 0 || distance > (size_t)(op - dst)) return -1;
+        size_t ml = jeton & 15;
+        if (ml == 15 && lz_lire_longueur(&ip, fin, &ml) != 0) return -1;
+        ml += LZ_MIN;
+        if ((size_t)(op_fin - op) < ml) return -1;
+
+        /* Copie qui se recouvre (distance < longueur) : le motif deja
+           ecrit double a chaque memcpy */
+        const uint8_t *ref = op - distance;
+        while (ml > 0) {
+            size_t d = (size_t)(op - ref);
+            size_t c = ml < d ? ml : d;
+            memcpy(op, ref, c);
+            op += c;
+            ml -= c;
+        }
+    }
+    return (long)(op - dst);
+}
+
+#endif /* CODEC_LZ_H */
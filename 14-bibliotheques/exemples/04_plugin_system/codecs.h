@@ -0,0 +1,185 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Codecs interchangeables du plugin de compression
+                 - brut (copie) et LZ rapide, toujours disponibles
+                 - zlib avec -DAVEC_ZLIB (-lz), zstd avec -DAVEC_ZSTD (-lzstd)
+                 - contexte par thread reutilise d'un bloc a l'autre
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#ifndef CODECS_H
+#define CODECS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "codec_lz.h"
+
+#ifdef AVEC_ZLIB
+#define ZLIB_CONST
+#include <zlib.h>
+#endif
+#ifdef AVEC_ZSTD
+#include <zstd.h>
+#endif
+
+/* Identifiant stocke dans la trame : ne jamais renumeroter */
+typedef enum {
+    CODEC_BRUT = 0,
+    CODEC_LZ = 1,
+    CODEC_ZLIB = 2,
+    CODEC_ZSTD = 3
+} codec_id_t;
+
+/* Etat de compression d'un thread */
+typedef struct {
+    lz_contexte_t lz;
+#ifdef AVEC_ZLIB
+    z_stream z;
+    int z_niveau;
+    bool z_pret;
+#endif
+#ifdef AVEC_ZSTD
+    ZSTD_CCtx *zstd;
+#endif
+} codec_contexte_t;
+
+typedef struct {
+    codec_id_t id;
+    const char *nom;
+    int niveau_defaut;
+    int niveau_min, niveau_max;         /* niveaux acceptes par compresser */
+    size_t (*borne)(size_t n);
+    /* Taille produite, 0 si echec ou si dst ne suffit pas */
+    size_t (*compresser)(codec_contexte_t *ctx, int niveau, const uint8_t *src, size_t n,
+                         uint8_t *dst, size_t cap);
+    /* Taille produite, -1 si l'entree est invalide */
+    long (*decompresser)(const uint8_t *src, size_t n, uint8_t *dst, size_t cap);
+} codec_t;
+
+static inline codec_contexte_t *codec_contexte_creer(void) {
+    return calloc(1, sizeof(codec_contexte_t));
+}
+
+static inline void codec_contexte_detruire(codec_contexte_t *ctx) {
+    if (!ctx) return;
+#ifdef AVEC_ZLIB
+    if (ctx->z_pret) deflateEnd(&ctx->z);
+#endif
+#ifdef AVEC_ZSTD
+    ZSTD_freeCCtx(ctx->zstd);
+#endif
+    free(ctx);
+}
+
+/* --- brut --- */
+
+static size_t codec_brut_borne(size_t n) {
+    return n;
+}
+
+static size_t codec_brut_compresser(codec_contexte_t *ctx, int niveau, const uint8_t *src, size_t n,
+                                    uint8_t *dst, size_t cap) {
+    (void)ctx;
+    (void)niveau;
+    if (cap < n) return 0;
+    if (n) memcpy(dst, src, n);
+    return n;
+}
+
+static long codec_brut_decompresser(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    if (cap < n) return -1;
+    if (n) memcpy(dst, src, n);
+    return (long)n;
+}
+
+/* --- LZ integre --- */
+
+static size_t codec_lz_compresser(codec_contexte_t *ctx, int niveau, const uint8_t *src, size_t n,
+                                  uint8_t *dst, size_t cap) {
+    (void)niveau;
+    return lz_compresser(&ctx->lz, src, n, dst, cap);
+}
+
+/* --- zlib : un flux deflate par bloc, reinitialise sans reallocation --- */
+
+#ifdef AVEC_ZLIB
+static size_t codec_zlib_borne(size_t n) {
+    return compressBound((uLong)n);
+}
+
+static size_t codec_zlib_compresser(codec_contexte_t *ctx, int niveau, const uint8_t *src, size_t n,
+                                    uint8_t *dst, size_t cap) {
+    if (!ctx->z_pret || ctx->z_niveau != niveau) {
+        if (ctx->z_pret) deflateEnd(&ctx->z);
+        memset(&ctx->z, 0, sizeof(ctx->z));
+        ctx->z_pret = deflateInit(&ctx->z, niveau) == Z_OK;
+        if (!ctx->z_pret) return 0;
+        ctx->z_niveau = niveau;
+    } else if (deflateReset(&ctx->z) != Z_OK) {
+        return 0;
+    }
+    ctx->z.next_in = src;
+    ctx->z.avail_in = (uInt)n;
+    ctx->z.next_out = dst;
+    ctx->z.avail_out = (uInt)cap;
+    if (deflate(&ctx->z, Z_FINISH) != Z_STREAM_END) return 0;
+    return (size_t)ctx->z.total_out;
+}
+
+static long codec_zlib_decompresser(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    uLongf taille = (uLongf)cap;
+    if (uncompress(dst, &taille, src, (uLong)n) != Z_OK) return -1;
+    return (long)taille;
+}
+#endif
+
+/* --- zstd --- */
+
+#ifdef AVEC_ZSTD
+static size_t codec_zstd_borne(size_t n) {
+    return ZSTD_compressBound(n);
+}
+
+static size_t codec_zstd_compresser(codec_contexte_t *ctx, int niveau, const uint8_t *src, size_t n,
+                                    uint8_t *dst, size_t cap) {
+    if (!ctx->zstd && !(ctx->zstd = ZSTD_createCCtx())) return 0;
+    size_t r = ZSTD_compressCCtx(ctx->zstd, dst, cap, src, n, niveau);
+    return ZSTD_isError(r) ? 0 : r;
+}
+
+static long codec_zstd_decompresser(const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    size_t r = ZSTD_decompress(dst, cap, src, n);
+    return ZSTD_isError(r) ? -1 : (long)r;
+}
+#endif
+
+static const codec_t codecs[] = {
+    { CODEC_BRUT, "brut", 0, 0, 0, codec_brut_borne, codec_brut_compresser, codec_brut_decompresser },
+    { CODEC_LZ, "lz", 0, 0, 0, lz_borne, codec_lz_compresser, lz_decompresser },
+#ifdef AVEC_ZLIB
+    { CODEC_ZLIB, "zlib", 6, 0, 9, codec_zlib_borne, codec_zlib_compresser, codec_zlib_decompresser },
+#endif
+#ifdef AVEC_ZSTD
+    { CODEC_ZSTD, "zstd", 3, 1, 22, codec_zstd_borne, codec_zstd_compresser, codec_zstd_decompresser },
+#endif
+};
+
+#define NB_CODECS (sizeof(codecs) / sizeof(codecs[0]))
+
+/* NULL si le codec n'a pas ete compile */
+static inline const codec_t *codec_par_nom(const char *nom) {
+    for (size_t i = 0; i < NB_CODECS; i++)
+        if (strcmp(codecs[i].nom, nom) == 0) return &codecs[i];
+    return NULL;
+}
+
+static inline const codec_t *codec_par_id(unsigned id) {
+    for (size_t i = 0; i < NB_CODECS; i++)
+        if ((unsigned)codecs[i].id == id) return &codecs[i];
+    return NULL;
+}
+
+#endif /* CODECS_H */
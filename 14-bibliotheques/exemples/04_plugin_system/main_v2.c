@@ -0,0 +1,375 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Chargeur de plugins v2 et banc d'essai des deux ABI
+                 - v1 : dlopen/dlclose a chaque usage, puis plugin resident
+                   appele une fois par chaine
+                 - v2 : hote resident, lots de 1 / 16 / 256 enregistrements
+                 - sorties v2 controlees hors chronometre contre une
+                   reference calculee par le banc
+                 - rechargement a chaud pendant que deux threads traitent
+                   des lots : aucune perte, empreintes identiques
+                 - latence par plugin relevee par l'hote
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <dlfcn.h>
+#include "plugin_interface.h"
+#include "plugin_host.h"
+
+#define NB_ENREGISTREMENTS 1000000
+#define NB_DLOPEN          2000
+#define NB_RECHARGEMENTS   30
+#define ENREG_PAR_PASSE    100000
+#define REPETITIONS        3            /* meilleur temps retenu */
+
+typedef struct {
+    char *arena;                /* chaines terminees par NUL, pour v1 */
+    PluginBuffer *in;
+    PluginOutput *out;
+    uint8_t *sortie;
+    size_t n;
+    size_t octets;
+} donnees_t;
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t fnv(uint64_t h, const uint8_t *p, size_t n) {
+    for (size_t i = 0; i < n; i++) h = (h ^ p[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+/* Enregistrements de 8 a 64 octets faits de mots, graine fixe */
+static int preparer(donnees_t *d, size_t n) {
+    static const char *mots[] = { "requete", "GET", "/api/v2/objets", "statut", "ok", "utilisateur",
+                                  "session", "latence", "cache", "miss", "hit", "json", "id", "trace" };
+    uint64_t etat = 0x2545F4914F6CDD1DULL;
+    d->n = n;
+    d->arena = malloc(n * 66);
+    d->in = malloc(n * sizeof(PluginBuffer));
+    d->out = malloc(n * sizeof(PluginOutput));
+    if (!d->arena || !d->in || !d->out) return -1;
+    char *p = d->arena;
+    d->octets = 0;
+    for (size_t i = 0; i < n; i++) {
+        etat ^= etat << 13;
+        etat ^= etat >> 7;
+        etat ^= etat << 17;
+        size_t cible = 8 + etat % 57, len = 0;
+        uint64_t x = etat;
+        while (len < cible) {
+            const char *m = mots[x % (sizeof(mots) / sizeof(mots[0]))];
+            x = x / 7 + 0x9E37;
+            for (size_t k = 0; m[k] && len < cible; k++) p[len++] = m[k];
+            if (len < cible) p[len++] = ' ';
+        }
+        p[len] = '\0';
+        d->in[i].data = (const uint8_t *)p;
+        d->in[i].len = len;
+        d->octets += len;
+        p += len + 1;
+    }
+    d->sortie = malloc(d->octets);
+    if (!d->sortie) return -1;
+    size_t off = 0;
+    for (size_t i = 0; i < n; i++) {
+        d->out[i].data = d->sortie + off;
+        d->out[i].capacity = d->in[i].len;
+        d->out[i].len = 0;
+        off += d->in[i].len;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+   ABI v1
+   --------------------------------------------------------------------------- */
+
+/* Comme load_plugin() de main.c, sans les printf : un cycle complet par chaine */
+static double v1_dlopen_par_appel(const char *path, const donnees_t *d, size_t n) {
+    double debut = secondes();
+    for (size_t i = 0; i < n; i++) {
+        Plugin *(*get_plugin_func)(void);
+        void *handle = dlopen(path, RTLD_LAZY);
+        if (!handle) return -1;
+        *(void **)(&get_plugin_func) = dlsym(handle, "get_plugin");
+        if (!get_plugin_func) {
+            dlclose(handle);
+            return -1;
+        }
+        Plugin *plugin = get_plugin_func();
+        plugin->init();
+        plugin->process((const char *)d->in[i].data);
+        plugin->cleanup();
+        dlclose(handle);
+    }
+    return secondes() - debut;
+}
+
+static double v1_resident(const char *path, const donnees_t *d, uint64_t *somme) {
+    Plugin *(*get_plugin_func)(void);
+    uint64_t (*somme_func)(void);
+    void *handle = dlopen(path, RTLD_NOW);
+    if (!handle) return -1;
+    *(void **)(&get_plugin_func) = dlsym(handle, "get_plugin");
+    *(void **)(&somme_func) = dlsym(handle, "majuscules_somme_v1");
+    if (!get_plugin_func || !somme_func) {
+        dlclose(handle);
+        return -1;
+    }
+    Plugin *plugin = get_plugin_func();
+    double duree = 0;
+    for (int r = 0; r < REPETITIONS; r++) {
+        plugin->init();
+        double debut = secondes();
+        for (size_t i = 0; i < d->n; i++) plugin->process((const char *)d->in[i].data);
+        double t = secondes() - debut;
+        if (r == 0 || t < duree) duree = t;
+    }
+    *somme = somme_func();
+    plugin->cleanup();
+    dlclose(handle);
+    return duree;
+}
+
+/* ---------------------------------------------------------------------------
+   ABI v2
+   --------------------------------------------------------------------------- */
+
+static uint64_t empreinte_sorties(const donnees_t *d, size_t debut, size_t fin) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t j = debut; j < fin; j++) h = fnv(h, d->out[j].data, d->out[j].len);
+    return h;
+}
+
+/* Reference calculee sans plugin : empreinte et somme des octets attendus */
+static uint64_t reference(const donnees_t *d, size_t debut, size_t fin, uint64_t *somme) {
+    uint64_t h = 0xcbf29ce484222325ULL, s = 0;
+    for (size_t j = debut; j < fin; j++) {
+        for (size_t i = 0; i < d->in[j].len; i++) {
+            uint8_t c = d->in[j].data[i];
+            if (c >= 'a' && c <= 'z') c = (uint8_t)(c - ('a' - 'A'));
+            h = (h ^ c) * 0x100000001b3ULL;
+            s += c;
+        }
+    }
+    if (somme) *somme = s;
+    return h;
+}
+
+/* Traite [debut, fin) par lots ; faux si un lot est incomplet */
+static bool v2_passe(plugin_worker_t *w, int id, donnees_t *d, size_t debut, size_t fin, size_t lot) {
+    for (size_t i = debut; i < fin; i += lot) {
+        size_t k = fin - i < lot ? fin - i : lot;
+        if (plugin_host_process(w, id, &d->in[i], &d->out[i], k) != (long)k) return false;
+    }
+    return true;
+}
+
+static double v2_executer(const char *path, int options, donnees_t *d, size_t lot, uint64_t *empreinte,
+                          plugin_stats_t *stats) {
+    plugin_host_t *h = plugin_host_create(options);
+    int id = h ? plugin_host_load(h, path) : -1;
+    if (id < 0) {
+        if (h) fprintf(stderr, "Erreur: %s\n", plugin_host_error(h));
+        plugin_host_destroy(h);
+        return -1;
+    }
+    plugin_worker_t *w = plugin_host_worker_create(h);
+    double duree = 0;
+    bool complet = true;
+    for (int r = 0; r < REPETITIONS; r++) {
+        memset(d->sortie, 0, d->octets);
+        double debut = secondes();
+        complet = v2_passe(w, id, d, 0, d->n, lot) && complet;
+        double t = secondes() - debut;
+        if (r == 0 || t < duree) duree = t;
+    }
+    *empreinte = complet ? empreinte_sorties(d, 0, d->n) : 0;
+    plugin_host_stats(h, id, stats);
+    plugin_host_worker_destroy(w);
+    plugin_host_destroy(h);
+    return duree;
+}
+
+/* ---------------------------------------------------------------------------
+   Rechargement a chaud sous charge
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    plugin_host_t *h;
+    int id;
+    donnees_t *d;
+    size_t debut;
+    uint64_t reference;
+    atomic_bool *arret;
+    uint64_t passes;
+    uint64_t erreurs;
+} travailleur_t;
+
+static void *travailler(void *arg) {
+    travailleur_t *t = arg;
+    plugin_worker_t *w = plugin_host_worker_create(t->h);
+    while (!atomic_load(t->arret)) {
+        if (!v2_passe(w, t->id, t->d, t->debut, t->debut + ENREG_PAR_PASSE, 256)
+            || empreinte_sorties(t->d, t->debut, t->debut + ENREG_PAR_PASSE) != t->reference)
+            t->erreurs++;
+        t->passes++;
+    }
+    plugin_host_worker_destroy(w);
+    return NULL;
+}
+
+static bool rechargement_sous_charge(const char *path, donnees_t *d) {
+    plugin_host_t *h = plugin_host_create(PLUGIN_HOST_LATENCE);
+    int id = h ? plugin_host_load(h, path) : -1;
+    if (id < 0) return false;
+
+    /* Deux tranches disjointes : chaque thread ecrit ses propres sorties */
+    travailleur_t t[2];
+    atomic_bool arret = false;
+    for (int i = 0; i < 2; i++) {
+        size_t debut = (size_t)i * ENREG_PAR_PASSE;
+        t[i] = (travailleur_t){ h, id, d, debut, reference(d, debut, debut + ENREG_PAR_PASSE, NULL),
+                                &arret, 0, 0 };
+    }
+
+    pthread_t th[2];
+    for (int i = 0; i < 2; i++) pthread_create(&th[i], NULL, travailler, &t[i]);
+    int echecs = 0;
+    double swap_max = 0, drain_max = 0;
+    for (int r = 0; r < NB_RECHARGEMENTS; r++) {
+        struct timespec pause = { 0, 10 * 1000 * 1000 };
+        nanosleep(&pause, NULL);
+        if (plugin_host_reload(h, id, NULL) != 0) {
+            fprintf(stderr, "Rechargement : %s\n", plugin_host_error(h));
+            echecs++;
+            continue;
+        }
+        plugin_stats_t s;
+        plugin_host_stats(h, id, &s);
+        if ((double)s.last_swap_ns > swap_max) swap_max = (double)s.last_swap_ns;
+        if ((double)s.last_drain_ns > drain_max) drain_max = (double)s.last_drain_ns;
+    }
+    atomic_store(&arret, true);
+    for (int i = 0; i < 2; i++) pthread_join(th[i], NULL);
+
+    plugin_stats_t s;
+    plugin_host_stats(h, id, &s);
+    uint64_t passes = t[0].passes + t[1].passes, erreurs = t[0].erreurs + t[1].erreurs;
+    printf("\n=== Rechargement a chaud sous charge (2 threads, lots de 256) ===\n");
+    printf("Rechargements      : %llu reussis, %d echecs, generation %llu\n", (unsigned long long)s.reloads,
+           echecs, (unsigned long long)s.generation);
+    printf("Echange max        : %.0f us (copie + dlopen + init + publication)\n", swap_max / 1e3);
+    printf("Vidange max        : %.0f us (fin des lots sur l'ancienne version)\n", drain_max / 1e3);
+    printf("Passes             : %llu, enregistrements %llu, empreintes fausses %llu\n",
+           (unsigned long long)passes, (unsigned long long)s.records, (unsigned long long)erreurs);
+    printf("Latence par lot    : p50 %.1f us, p99 %.1f us, max %.1f us (%s v%s, %llu lots)\n",
+           (double)s.p50_ns / 1e3, (double)s.p99_ns / 1e3, (double)s.max_ns / 1e3, s.name, s.version,
+           (unsigned long long)s.batches);
+    bool ok = echecs == 0 && s.reloads == NB_RECHARGEMENTS && erreurs == 0 && s.errors == 0
+           && s.records == passes * ENREG_PAR_PASSE;
+    plugin_host_destroy(h);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <plugin.so>\n", argv[0]);
+        return 1;
+    }
+    const char *path = argv[1];
+
+    plugin_host_t *h = plugin_host_create(0);
+    int id = h ? plugin_host_load(h, path) : -1;
+    if (id < 0) {
+        fprintf(stderr, "Erreur: %s\n", h ? plugin_host_error(h) : "memoire");
+        plugin_host_destroy(h);
+        return 1;
+    }
+    const PluginV2 *p = plugin_host_plugin(h, id);
+    printf("Plugin chargé : %s v%s (ABI %u), capacites :%s%s%s%s\n", p->name, p->version, p->abi_version,
+           p->capabilities & PLUGIN_CAP_THREAD_SAFE ? " thread-safe" : "",
+           p->capabilities & PLUGIN_CAP_ETAT_THREAD ? " etat-par-thread" : "",
+           p->capabilities & PLUGIN_CAP_EN_PLACE ? " en-place" : "",
+           p->capabilities & PLUGIN_CAP_RECHARGEABLE ? " rechargeable" : "");
+    plugin_host_destroy(h);
+
+    donnees_t d;
+    if (preparer(&d, NB_ENREGISTREMENTS) == -1) {
+        fprintf(stderr, "Erreur: memoire\n");
+        return 1;
+    }
+    printf("\n=== %d enregistrements de 8 a 64 octets (%.1f Mo) ===\n", NB_ENREGISTREMENTS, (double)d.octets / 1e6);
+    printf("%-30s %12s %10s  %s\n", "ABI", "ns/enreg.", "Menreg/s", "Controle");
+
+    bool ok = true;
+    double t = v1_dlopen_par_appel(path, &d, NB_DLOPEN);
+    if (t < 0) {
+        printf("%-30s impossible : %s\n", "v1 dlopen/dlclose par appel", dlerror());
+        ok = false;
+    } else {
+        printf("%-30s %12.1f %10.3f  -\n", "v1 dlopen/dlclose par appel", t * 1e9 / NB_DLOPEN, NB_DLOPEN / t / 1e6);
+    }
+
+    uint64_t somme_attendue, somme_v1 = 0;
+    uint64_t attendue = reference(&d, 0, d.n, &somme_attendue);
+    t = v1_resident(path, &d, &somme_v1);
+    if (t < 0) {
+        printf("%-30s impossible (majuscules_somme_v1 absent)\n", "v1 process(char *) resident");
+        return 1;
+    }
+    ok = ok && somme_v1 == somme_attendue;
+    printf("%-30s %12.1f %10.1f  %s\n", "v1 process(char *) resident", t * 1e9 / (double)d.n,
+           (double)d.n / t / 1e6, somme_v1 == somme_attendue ? "somme ok" : "DIFFERENTE");
+
+    static const struct {
+        const char *nom;
+        size_t lot;
+        int options;
+    } cas[] = {
+        { "v2 lot de 1", 1, 0 },
+        { "v2 lot de 16", 16, 0 },
+        { "v2 lot de 256", 256, 0 },
+        { "v2 lot de 1 + latence", 1, PLUGIN_HOST_LATENCE },
+        { "v2 lot de 256 + latence", 256, PLUGIN_HOST_LATENCE },
+    };
+    for (size_t c = 0; c < sizeof(cas) / sizeof(cas[0]); c++) {
+        uint64_t e = 0;
+        plugin_stats_t s;
+        t = v2_executer(path, cas[c].options, &d, cas[c].lot, &e, &s);
+        if (t < 0) {
+            ok = false;
+            continue;
+        }
+        bool egal = e == attendue && s.records == REPETITIONS * d.n;
+        ok = ok && egal;
+        printf("%-30s %12.1f %10.1f  %s", cas[c].nom, t * 1e9 / (double)d.n, (double)d.n / t / 1e6,
+               egal ? "identique" : "DIFFERENTE");
+        if (cas[c].options & PLUGIN_HOST_LATENCE)
+            printf("  (lot p50 %llu ns, p99 %llu ns)", (unsigned long long)s.p50_ns, (unsigned long long)s.p99_ns);
+        printf("\n");
+    }
+
+    ok = rechargement_sous_charge(path, &d) && ok;
+
+    free(d.arena);
+    free(d.in);
+    free(d.out);
+    free(d.sortie);
+    printf("\nVerification : %s\n", ok ? "sorties v1 et v2 conformes a la reference, aucun lot perdu pendant les rechargements"
+                                     : "ECHEC");
+    return ok ? 0 : 1;
+}
@@ -1,11 +1,239 @@
 /* ============================================================================
    Section 02.3 : Resolution de symboles au runtime
    Description : Plugin de compression (exemple de plugin dynamique)
+                 - v1 : compresse la chaine recue et affiche le gain
+                 - v2 : chaque enregistrement devient une trame de blocs
+                   independants (trame.h), compresses en parallele par un
+                   groupe de threads ; codec et taille de bloc reglables
    Fichier source : 02.3-resolution-symboles.md
    ============================================================================ */
 
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdatomic.h>
+#include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "plugin_interface.h"
+#include "plugin_interface_v2.h"
+#include "trame.h"
+
+#define MAX_THREADS 16
+#define BLOC_MIN 4096u
+#define BLOC_MAX (16u << 20)
+
+typedef struct {
+    const codec_t *codec;
+    int niveau;
+    uint32_t taille_bloc;
+} reglages_t;
+
+static pthread_mutex_t verrou_reglages = PTHREAD_MUTEX_INITIALIZER;
+static reglages_t reglages = { &codecs[1], 0, 64u << 10 };
+
+/* ---------------------------------------------------------------------------
+   Groupe de threads : l'appelant compresse aussi ; chacun prend le bloc
+   suivant par un compteur atomique jusqu'a epuisement
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    reglages_t r;
+    const uint8_t *src;
+    size_t n;
+    size_t nblocs;
+    uint8_t *zone;              /* bloc k ecrit en zone + k * pas */
+    size_t pas;
+    size_t *tailles;
+    atomic_size_t suivant;
+} travail_t;
+
+static struct {
+    pthread_mutex_t m;
+    pthread_cond_t reveil;
+    pthread_cond_t termine;
+    pthread_mutex_t usage;      /* une trame a la fois sur le groupe */
+    pthread_t threads[MAX_THREADS];
+    int nthreads;
+    travail_t *travail;
+    uint64_t generation;
+    int occupes;
+    bool arret;
+} groupe = {
+    .m = PTHREAD_MUTEX_INITIALIZER,
+    .reveil = PTHREAD_COND_INITIALIZER,
+    .termine = PTHREAD_COND_INITIALIZER,
+    .usage = PTHREAD_MUTEX_INITIALIZER
+};
+
+static void travailler(travail_t *t, codec_contexte_t *ctx) {
+    for (;;) {
+        size_t k = atomic_fetch_add_explicit(&t->suivant, 1, memory_order_relaxed);
+        if (k >= t->nblocs) return;
+        size_t debut = k * t->r.taille_bloc;
+        size_t n = t->n - debut < t->r.taille_bloc ? t->n - debut : t->r.taille_bloc;
+        t->tailles[k] = trame_compresser_bloc(t->r.codec, ctx, t->r.niveau, t->src + debut, n,
+                                              t->zone + k * t->pas, t->pas);
+    }
+}
+
+static void *thread_groupe(void *arg) {
+    (void)arg;
+    codec_contexte_t *ctx = codec_contexte_creer();
+    uint64_t vue = 0;
+    pthread_mutex_lock(&groupe.m);
+    for (;;) {
+        while (!groupe.arret && groupe.generation == vue) pthread_cond_wait(&groupe.reveil, &groupe.m);
+        if (groupe.arret) break;
+        vue = groupe.generation;
+        /* Reveille trop tard : la trame est deja terminee */
+        travail_t *t = groupe.travail;
+        if (!t || !ctx) continue;
+        groupe.occupes++;
+        pthread_mutex_unlock(&groupe.m);
+        travailler(t, ctx);
+        pthread_mutex_lock(&groupe.m);
+        if (--groupe.occupes == 0) pthread_cond_signal(&groupe.termine);
+    }
+    pthread_mutex_unlock(&groupe.m);
+    codec_contexte_detruire(ctx);
+    return NULL;
+}
+
+/* Appele sous groupe.usage */
+static void groupe_arreter(void) {
+    pthread_mutex_lock(&groupe.m);
+    groupe.arret = true;
+    pthread_cond_broadcast(&groupe.reveil);
+    pthread_mutex_unlock(&groupe.m);
+    for (int i = 0; i < groupe.nthreads; i++) pthread_join(groupe.threads[i], NULL);
+    groupe.nthreads = 0;
+    groupe.arret = false;
+}
+
+/* Appele sous groupe.usage ; n threads au total, appelant compris */
+static int groupe_demarrer(int n) {
+    groupe_arreter();
+    for (int i = 0; i < n - 1 && i < MAX_THREADS; i++) {
+        if (pthread_create(&groupe.threads[i], NULL, thread_groupe, NULL) != 0) return -1;
+        groupe.nthreads++;
+    }
+    return 0;
+}
+
+static void compresser_blocs(travail_t *t, codec_contexte_t *ctx) {
+    /* Un seul bloc, pas de thread, ou groupe deja pris par un autre
+       appelant : l'appelant compresse seul */
+    if (t->nblocs < 2 || pthread_mutex_trylock(&groupe.usage) != 0) {
+        travailler(t, ctx);
+        return;
+    }
+    if (groupe.nthreads == 0) {
+        pthread_mutex_unlock(&groupe.usage);
+        travailler(t, ctx);
+        return;
+    }
+    pthread_mutex_lock(&groupe.m);
+    groupe.travail = t;
+    groupe.generation++;
+    pthread_cond_broadcast(&groupe.reveil);
+    pthread_mutex_unlock(&groupe.m);
+
+    travailler(t, ctx);
+
+    pthread_mutex_lock(&groupe.m);
+    while (groupe.occupes > 0) pthread_cond_wait(&groupe.termine, &groupe.m);
+    groupe.travail = NULL;
+    pthread_mutex_unlock(&groupe.m);
+    pthread_mutex_unlock(&groupe.usage);
+}
+
+/* ---------------------------------------------------------------------------
+   Construction d'une trame
+   --------------------------------------------------------------------------- */
+
+/* Etat d'un thread appelant : contexte de codec, tailles des blocs */
+typedef struct {
+    codec_contexte_t *ctx;
+    size_t *tailles;
+    size_t capacite;
+} etat_t;
+
+static reglages_t lire_reglages(void) {
+    pthread_mutex_lock(&verrou_reglages);
+    reglages_t r = reglages;
+    pthread_mutex_unlock(&verrou_reglages);
+    return r;
+}
+
+/* Ecrit la trame de src dans dst (>= trame_borne()) ; renvoie sa taille, 0
+   en cas d'echec d'allocation. Les blocs sont compresses a leur place dans
+   le pire cas puis resserres vers l'avant : pas de tampon intermediaire. */
+static size_t compresser_trame(etat_t *e, const reglages_t *r, const uint8_t *src, size_t n, uint8_t *dst) {
+    size_t nblocs = trame_nblocs(n, r->taille_bloc);
+    if (nblocs > e->capacite) {
+        size_t *t = realloc(e->tailles, nblocs * sizeof(*t));
+        if (!t) return 0;
+        e->tailles = t;
+        e->capacite = nblocs;
+    }
+    travail_t t = {
+        .r = *r,
+        .src = src,
+        .n = n,
+        .nblocs = nblocs,
+        .zone = dst + TRAME_ENTETE,
+        .pas = trame_pas_bloc(r->codec, r->taille_bloc),
+        .tailles = e->tailles
+    };
+    atomic_init(&t.suivant, 0);
+    compresser_blocs(&t, e->ctx);
+
+    trame_ecrire_entete(dst, r->codec, r->taille_bloc);
+    size_t pos = TRAME_ENTETE;
+    for (size_t k = 0; k < nblocs; k++) {
+        uint8_t *bloc = t.zone + k * t.pas;
+        if (bloc != dst + pos) memmove(dst + pos, bloc, e->tailles[k]);
+        /* La taille devient l'offset : l'index se construit apres coup */
+        size_t taille = e->tailles[k];
+        e->tailles[k] = pos;
+        pos += taille;
+    }
+    size_t off_index = pos;
+    for (size_t k = 0; k < nblocs; k++) {
+        /* taille_c (drapeau compris) et taille : recopies de l'en-tete du bloc */
+        trame_ecrire64(dst + pos, e->tailles[k]);
+        memcpy(dst + pos + 8, dst + e->tailles[k], 8);
+        pos += TRAME_ENTREE_INDEX;
+    }
+    trame_ecrire64(dst + pos, off_index);
+    trame_ecrire32(dst + pos + 8, (uint32_t)nblocs);
+    memcpy(dst + pos + 12, "PCZI", 4);
+    return pos + TRAME_PIED;
+}
+
+static void *compression_thread_init(void) {
+    etat_t *e = calloc(1, sizeof(*e));
+    if (e && !(e->ctx = codec_contexte_creer())) {
+        free(e);
+        e = NULL;
+    }
+    return e;
+}
+
+static void compression_thread_fini(void *state) {
+    etat_t *e = state;
+    if (!e) return;
+    codec_contexte_detruire(e->ctx);
+    free(e->tailles);
+    free(e);
+}
+
+/* ---------------------------------------------------------------------------
+   ABI v1
+   --------------------------------------------------------------------------- */
 
 static int compression_init(void) {
     printf("Plugin Compression initialisé\n");
@@ -13,7 +241,15 @@ static int compression_init(void) {
 }
 
 static void compression_process(const char *data) {
-    printf("Compression de : %s\n", data);
+    reglages_t r = lire_reglages();
+    size_t n = strlen(data);
+    etat_t *e = compression_thread_init();
+    uint8_t *trame = e ? malloc(trame_borne(r.codec, n, r.taille_bloc)) : NULL;
+    size_t taille = trame ? compresser_trame(e, &r, (const uint8_t *)data, n, trame) : 0;
+    if (taille) printf("Compression de : %s (%zu octets -> trame %s de %zu octets)\n", data, n, r.codec->nom, taille);
+    else printf("Compression de : %s (mémoire insuffisante)\n", data);
+    free(trame);
+    compression_thread_fini(e);
 }
 
 static void compression_cleanup(void) {
@@ -31,3 +267,96 @@ static Plugin compression_plugin = {
 Plugin *get_plugin(void) {
     return &compression_plugin;
 }
+
+/* ---------------------------------------------------------------------------
+   ABI v2
+   --------------------------------------------------------------------------- */
+
+static int compression_init_v2(void) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    pthread_mutex_lock(&groupe.usage);
+    int r = groupe_demarrer(cpus < 1 ? 1 : cpus > MAX_THREADS ? MAX_THREADS : (int)cpus);
+    pthread_mutex_unlock(&groupe.usage);
+    return r;
+}
+
+static void compression_cleanup_v2(void) {
+    pthread_mutex_lock(&groupe.usage);
+    groupe_arreter();
+    pthread_mutex_unlock(&groupe.usage);
+}
+
+static size_t compression_output_bound(size_t len) {
+    reglages_t r = lire_reglages();
+    return trame_borne(r.codec, len, r.taille_bloc);
+}
+
+static long compression_process_v2(void *state, const PluginBuffer *in, PluginOutput *out, size_t n) {
+    etat_t *e = state;
+    if (!e) return -1;
+    reglages_t r = lire_reglages();
+    for (size_t k = 0; k < n; k++) {
+        size_t borne = trame_borne(r.codec, in[k].len, r.taille_bloc);
+        if (out[k].capacity < borne) {
+            out[k].len = borne;
+            return (long)k;
+        }
+        out[k].len = compresser_trame(e, &r, in[k].data, in[k].len, out[k].data);
+        if (out[k].len == 0) return -1;
+    }
+    return (long)n;
+}
+
+/* Reglages : codec=brut|lz|zlib|zstd, niveau=N, bloc=octets, threads=N */
+static int compression_configure(const char *key, const char *value) {
+    char *fin;
+    long v = strtol(value, &fin, 10);
+    bool entier = *value && !*fin;
+
+    if (strcmp(key, "threads") == 0) {
+        if (!entier || v < 1 || v > MAX_THREADS) return -1;
+        pthread_mutex_lock(&groupe.usage);
+        int r = groupe_demarrer((int)v);
+        pthread_mutex_unlock(&groupe.usage);
+        return r;
+    }
+    int r = 0;
+    pthread_mutex_lock(&verrou_reglages);
+    if (strcmp(key, "codec") == 0) {
+        const codec_t *c = codec_par_nom(value);
+        if (c) {
+            reglages.codec = c;
+            reglages.niveau = c->niveau_defaut;
+        } else {
+            r = -1;     /* inconnu ou non compile */
+        }
+    } else if (strcmp(key, "niveau") == 0 && entier && v >= reglages.codec->niveau_min
+               && v <= reglages.codec->niveau_max) {
+        reglages.niveau = (int)v;       /* hors plage du codec courant : refuse */
+    } else if (strcmp(key, "bloc") == 0 && entier && v >= (long)BLOC_MIN && v <= (long)BLOC_MAX) {
+        reglages.taille_bloc = (uint32_t)v;
+    } else {
+        r = -1;
+    }
+    pthread_mutex_unlock(&verrou_reglages);
+    return r;
+}
+
+static const PluginV2 compression_plugin_v2 = {
+    .abi_version = PLUGIN_ABI_VERSION,
+    .struct_size = sizeof(PluginV2),
+    .name = "Compression",
+    .version = "2.0",
+    .capabilities = PLUGIN_CAP_THREAD_SAFE | PLUGIN_CAP_ETAT_THREAD | PLUGIN_CAP_RECHARGEABLE,
+    .init = compression_init_v2,
+    .cleanup = compression_cleanup_v2,
+    .thread_init = compression_thread_init,
+    .thread_fini = compression_thread_fini,
+    .output_bound = compression_output_bound,
+    .process = compression_process_v2,
+    .configure = compression_configure
+};
+
+const PluginV2 *get_plugin_v2(void) {
+    return &compression_plugin_v2;
+}
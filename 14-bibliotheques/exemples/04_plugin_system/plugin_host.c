@@ -0,0 +1,569 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Implementation privee de l'hote de plugins v2
+                 - chaque version chargee est un module ; le slot publie le
+                   module courant par un pointeur atomique
+                 - un lot epingle son module (compteur en vol) : le
+                   rechargement echange le pointeur puis attend que
+                   l'ancienne version n'ait plus de lot en cours
+                 - copie du .so avant dlopen : deux versions du meme
+                   fichier coexistent le temps de la transition
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "plugin_host.h"
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <dlfcn.h>
+
+#define SLOTS_LATENCE 40
+#define MAX_REGLAGES 16
+
+/* Une version chargee d'un plugin. La structure survit a dlclose() (liste
+   des modules retires, liberee avec l'hote) : un thread qui vient de lire
+   l'ancien pointeur peut encore toucher son compteur en vol sans risque. */
+typedef struct module {
+    void *handle;
+    const PluginV2 *p;
+    uint64_t generation;
+    atomic_long inflight;
+    pthread_mutex_t lock;           /* etats par thread */
+    pthread_mutex_t appel;          /* process() d'un plugin non THREAD_SAFE */
+    void **states;
+    size_t nstates;
+    size_t capacite;
+    struct module *suivant_retire;
+} module_t;
+
+/* Compteurs d'un worker pour un slot : ecrits par leur seul proprietaire
+   (chargement + stockage relaxes, sans instruction atomique verrouillee),
+   lus par plugin_host_stats() */
+typedef struct {
+    _Atomic uint64_t batches;
+    _Atomic uint64_t records;
+    _Atomic uint64_t errors;
+    _Atomic uint64_t ns_total;
+    _Atomic uint64_t max_ns;
+    _Atomic uint64_t hist[SLOTS_LATENCE];
+} compteurs_t;
+
+/* Reglage accepte par le plugin, rejoue sur chaque nouvelle version */
+typedef struct {
+    char cle[32];
+    char valeur[96];
+} reglage_t;
+
+typedef struct {
+    char path[PATH_MAX];
+    _Atomic(module_t *) current;
+    pthread_mutex_t reload;         /* aussi : reglages */
+    reglage_t reglages[MAX_REGLAGES];
+    int nreglages;
+    uint64_t reloads;
+    uint64_t last_swap_ns;
+    uint64_t last_drain_ns;
+    compteurs_t retires;            /* compteurs des workers detruits */
+} slot_t;
+
+struct plugin_worker {
+    plugin_host_t *h;
+    struct {
+        uint64_t generation;
+        void *state;
+    } etats[PLUGIN_HOST_MAX];
+    compteurs_t c[PLUGIN_HOST_MAX];
+    plugin_worker_t *suivant;
+};
+
+struct plugin_host {
+    int options;
+    pthread_mutex_t lock;           /* chargement, workers, modules retires, erreur */
+    slot_t slots[PLUGIN_HOST_MAX];
+    atomic_int nslots;
+    plugin_worker_t *workers;
+    module_t *retires;
+    uint64_t generation;
+    char erreur[256];
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void ajouter(_Atomic uint64_t *x, uint64_t v) {
+    atomic_store_explicit(x, atomic_load_explicit(x, memory_order_relaxed) + v, memory_order_relaxed);
+}
+
+static unsigned log2_u64(uint64_t v) {
+    unsigned s = 0;
+    while (v > 1) {
+        v >>= 1;
+        s++;
+    }
+    return s < SLOTS_LATENCE ? s : SLOTS_LATENCE - 1;
+}
+
+static void erreur(plugin_host_t *h, const char *format, const char *detail) {
+    snprintf(h->erreur, sizeof(h->erreur), format, detail ? detail : "");
+}
+
+/* ---------------------------------------------------------------------------
+   Chargement d'une version
+   --------------------------------------------------------------------------- */
+
+/* dlopen() renvoie la meme instance pour un fichier deja charge : on ouvre
+   une copie privee, effacee aussitot (le mapping reste valide) */
+static void *ouvrir_copie(plugin_host_t *h, const char *path) {
+    char dir[] = "/tmp/plugin-XXXXXX";
+    char copie[PATH_MAX + 32];
+    char tampon[65536];
+    void *handle = NULL;
+    if (!mkdtemp(dir)) {
+        erreur(h, "mkdtemp : %s", strerror(errno));
+        return NULL;
+    }
+    const char *base = strrchr(path, '/');
+    snprintf(copie, sizeof(copie), "%s/%s", dir, base ? base + 1 : path);
+    int src = open(path, O_RDONLY);
+    int dst = src == -1 ? -1 : open(copie, O_WRONLY | O_CREAT | O_EXCL, 0700);
+    if (src == -1 || dst == -1) {
+        erreur(h, "%s", strerror(errno));
+        goto fin;
+    }
+    ssize_t n;
+    while ((n = read(src, tampon, sizeof(tampon))) > 0) {
+        if (write(dst, tampon, (size_t)n) != n) {
+            erreur(h, "copie : %s", strerror(errno));
+            goto fin;
+        }
+    }
+    if (close(dst) == -1 || n < 0) {
+        dst = -1;
+        erreur(h, "copie : %s", strerror(errno));
+        goto fin;
+    }
+    dst = -1;
+    handle = dlopen(copie, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) erreur(h, "%s", dlerror());
+fin:
+    if (src != -1) close(src);
+    if (dst != -1) close(dst);
+    unlink(copie);
+    rmdir(dir);
+    return handle;
+}
+
+static bool valider(plugin_host_t *h, const PluginV2 *p) {
+    if (!p || p->abi_version != PLUGIN_ABI_VERSION) {
+        erreur(h, "version d'ABI incompatible%s", NULL);
+        return false;
+    }
+    if (p->struct_size < PLUGIN_V2_TAILLE_MIN || !p->process || !p->output_bound) {
+        erreur(h, "interface v2 incomplete%s", NULL);
+        return false;
+    }
+    if ((p->capabilities & PLUGIN_CAP_ETAT_THREAD) && (!p->thread_init || !p->thread_fini)) {
+        erreur(h, "PLUGIN_CAP_ETAT_THREAD sans thread_init/thread_fini%s", NULL);
+        return false;
+    }
+    return true;
+}
+
+/* Champ ajoute apres la premiere version : absent si struct_size ne le
+   couvre pas */
+static int (*fonction_configure(const PluginV2 *p))(const char *, const char *) {
+    if (p->struct_size < offsetof(PluginV2, configure) + sizeof(p->configure)) return NULL;
+    return p->configure;
+}
+
+static module_t *charger_module(plugin_host_t *h, const char *path) {
+    const PluginV2 *(*get_plugin_v2_func)(void);
+    void *handle = ouvrir_copie(h, path);
+    if (!handle) return NULL;
+
+    *(void **)(&get_plugin_v2_func) = dlsym(handle, "get_plugin_v2");
+    if (!get_plugin_v2_func) {
+        erreur(h, "Symbole get_plugin_v2 non trouvé%s", NULL);
+        dlclose(handle);
+        return NULL;
+    }
+    const PluginV2 *p = get_plugin_v2_func();
+    if (!valider(h, p) || (p->init && p->init() != 0)) {
+        if (!h->erreur[0]) erreur(h, "init() a échoué%s", NULL);
+        dlclose(handle);
+        return NULL;
+    }
+    module_t *m = calloc(1, sizeof(*m));
+    if (!m) {
+        if (p->cleanup) p->cleanup();
+        dlclose(handle);
+        erreur(h, "%s", strerror(ENOMEM));
+        return NULL;
+    }
+    m->handle = handle;
+    m->p = p;
+    atomic_init(&m->inflight, 0);
+    pthread_mutex_init(&m->lock, NULL);
+    pthread_mutex_init(&m->appel, NULL);
+    pthread_mutex_lock(&h->lock);
+    m->generation = ++h->generation;
+    pthread_mutex_unlock(&h->lock);
+    return m;
+}
+
+/* Plus aucun lot ne peut entrer dans m : liberer les etats par thread, le
+   plugin et son code ; la structure rejoint la liste des retires */
+static void retirer_module(plugin_host_t *h, module_t *m) {
+    for (size_t i = 0; i < m->nstates; i++) m->p->thread_fini(m->states[i]);
+    free(m->states);
+    m->states = NULL;
+    m->nstates = 0;
+    if (m->p->cleanup) m->p->cleanup();
+    dlclose(m->handle);
+    m->handle = NULL;
+    m->p = NULL;
+    pthread_mutex_lock(&h->lock);
+    m->suivant_retire = h->retires;
+    h->retires = m;
+    pthread_mutex_unlock(&h->lock);
+}
+
+/* Epingle la version courante : apres l'increment, on verifie qu'elle est
+   toujours publiee, sinon le rechargement a pu commencer son attente */
+static module_t *acquerir(slot_t *s) {
+    for (;;) {
+        module_t *m = atomic_load(&s->current);
+        atomic_fetch_add(&m->inflight, 1);
+        if (atomic_load(&s->current) == m) return m;
+        atomic_fetch_sub(&m->inflight, 1);
+    }
+}
+
+static void relacher(module_t *m) {
+    atomic_fetch_sub_explicit(&m->inflight, 1, memory_order_release);
+}
+
+/* ---------------------------------------------------------------------------
+   API publique
+   --------------------------------------------------------------------------- */
+
+plugin_host_t *plugin_host_create(int options) {
+    plugin_host_t *h = calloc(1, sizeof(*h));
+    if (!h) return NULL;
+    h->options = options;
+    pthread_mutex_init(&h->lock, NULL);
+    atomic_init(&h->nslots, 0);
+    for (int i = 0; i < PLUGIN_HOST_MAX; i++) pthread_mutex_init(&h->slots[i].reload, NULL);
+    return h;
+}
+
+const char *plugin_host_error(const plugin_host_t *h) {
+    return h->erreur;
+}
+
+int plugin_host_load(plugin_host_t *h, const char *path) {
+    h->erreur[0] = '\0';
+    module_t *m = charger_module(h, path);
+    if (!m) return -1;
+    pthread_mutex_lock(&h->lock);
+    int id = atomic_load(&h->nslots);
+    if (id == PLUGIN_HOST_MAX) {
+        pthread_mutex_unlock(&h->lock);
+        erreur(h, "trop de plugins%s", NULL);
+        retirer_module(h, m);
+        return -1;
+    }
+    slot_t *s = &h->slots[id];
+    snprintf(s->path, sizeof(s->path), "%s", path);
+    atomic_init(&s->current, m);
+    atomic_store(&h->nslots, id + 1);
+    pthread_mutex_unlock(&h->lock);
+    return id;
+}
+
+int plugin_host_reload(plugin_host_t *h, int id, const char *path) {
+    if (id < 0 || id >= atomic_load(&h->nslots)) {
+        errno = EINVAL;
+        return -1;
+    }
+    slot_t *s = &h->slots[id];
+    pthread_mutex_lock(&s->reload);
+    h->erreur[0] = '\0';
+    uint64_t t0 = now_ns();
+    module_t *ancien = atomic_load(&s->current);
+    if (!(ancien->p->capabilities & PLUGIN_CAP_RECHARGEABLE)) {
+        erreur(h, "%s ne declare pas PLUGIN_CAP_RECHARGEABLE", ancien->p->name);
+        pthread_mutex_unlock(&s->reload);
+        return -1;
+    }
+    module_t *nouveau = charger_module(h, path ? path : s->path);
+    if (!nouveau) {
+        pthread_mutex_unlock(&s->reload);
+        return -1;
+    }
+    if (!(nouveau->p->capabilities & PLUGIN_CAP_RECHARGEABLE)) {
+        erreur(h, "%s ne declare pas PLUGIN_CAP_RECHARGEABLE", nouveau->p->name);
+        retirer_module(h, nouveau);
+        pthread_mutex_unlock(&s->reload);
+        return -1;
+    }
+    int (*configure)(const char *, const char *) = fonction_configure(nouveau->p);
+    for (int i = 0; i < s->nreglages; i++) {
+        if (!configure || configure(s->reglages[i].cle, s->reglages[i].valeur) != 0) {
+            erreur(h, "la nouvelle version refuse le reglage %s", s->reglages[i].cle);
+            retirer_module(h, nouveau);
+            pthread_mutex_unlock(&s->reload);
+            return -1;
+        }
+    }
+
+    /* Les nouveaux lots prennent la nouvelle version des l'echange ; les
+       lots deja commences finissent sur l'ancienne, qui reste chargee */
+    atomic_store(&s->current, nouveau);
+    uint64_t t1 = now_ns();
+    while (atomic_load(&ancien->inflight) > 0) {
+        struct timespec attente = { 0, 20000 };
+        nanosleep(&attente, NULL);
+    }
+    uint64_t t2 = now_ns();
+    retirer_module(h, ancien);
+
+    if (path) snprintf(s->path, sizeof(s->path), "%s", path);
+    s->reloads++;
+    s->last_swap_ns = t1 - t0;
+    s->last_drain_ns = t2 - t1;
+    pthread_mutex_unlock(&s->reload);
+    return 0;
+}
+
+int plugin_host_configure(plugin_host_t *h, int id, const char *key, const char *value) {
+    if (id < 0 || id >= atomic_load(&h->nslots)) {
+        errno = EINVAL;
+        return -1;
+    }
+    slot_t *s = &h->slots[id];
+    pthread_mutex_lock(&s->reload);
+    h->erreur[0] = '\0';
+    const PluginV2 *p = atomic_load(&s->current)->p;
+    int (*configure)(const char *, const char *) = fonction_configure(p);
+    int i = 0;
+    while (i < s->nreglages && strcmp(s->reglages[i].cle, key) != 0) i++;
+    int r = -1;
+    if (!configure) {
+        erreur(h, "%s n'accepte aucun reglage", p->name);
+    } else if (strlen(key) >= sizeof(s->reglages[0].cle) || strlen(value) >= sizeof(s->reglages[0].valeur)) {
+        erreur(h, "reglage trop long : %s", key);
+    } else if (i == MAX_REGLAGES) {
+        erreur(h, "trop de reglages%s", NULL);
+    } else if (configure(key, value) != 0) {
+        erreur(h, "reglage refuse : %s", key);
+    } else {
+        snprintf(s->reglages[i].cle, sizeof(s->reglages[i].cle), "%s", key);
+        snprintf(s->reglages[i].valeur, sizeof(s->reglages[i].valeur), "%s", value);
+        if (i == s->nreglages) s->nreglages++;
+        r = 0;
+    }
+    pthread_mutex_unlock(&s->reload);
+    return r;
+}
+
+const PluginV2 *plugin_host_plugin(plugin_host_t *h, int id) {
+    if (id < 0 || id >= atomic_load(&h->nslots)) return NULL;
+    return atomic_load(&h->slots[id].current)->p;
+}
+
+plugin_worker_t *plugin_host_worker_create(plugin_host_t *h) {
+    plugin_worker_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    w->h = h;
+    pthread_mutex_lock(&h->lock);
+    w->suivant = h->workers;
+    h->workers = w;
+    pthread_mutex_unlock(&h->lock);
+    return w;
+}
+
+static void cumuler(compteurs_t *dst, compteurs_t *src) {
+    ajouter(&dst->batches, atomic_load_explicit(&src->batches, memory_order_relaxed));
+    ajouter(&dst->records, atomic_load_explicit(&src->records, memory_order_relaxed));
+    ajouter(&dst->errors, atomic_load_explicit(&src->errors, memory_order_relaxed));
+    ajouter(&dst->ns_total, atomic_load_explicit(&src->ns_total, memory_order_relaxed));
+    uint64_t max = atomic_load_explicit(&src->max_ns, memory_order_relaxed);
+    if (max > atomic_load_explicit(&dst->max_ns, memory_order_relaxed))
+        atomic_store_explicit(&dst->max_ns, max, memory_order_relaxed);
+    for (int i = 0; i < SLOTS_LATENCE; i++)
+        ajouter(&dst->hist[i], atomic_load_explicit(&src->hist[i], memory_order_relaxed));
+}
+
+void plugin_host_worker_destroy(plugin_worker_t *w) {
+    if (!w) return;
+    plugin_host_t *h = w->h;
+    int n = atomic_load(&h->nslots);
+    for (int id = 0; id < n; id++) {
+        if (!w->etats[id].state) continue;
+        module_t *m = acquerir(&h->slots[id]);
+        if (m->generation == w->etats[id].generation) {
+            pthread_mutex_lock(&m->lock);
+            for (size_t i = 0; i < m->nstates; i++) {
+                if (m->states[i] != w->etats[id].state) continue;
+                m->states[i] = m->states[--m->nstates];
+                m->p->thread_fini(w->etats[id].state);
+                break;
+            }
+            pthread_mutex_unlock(&m->lock);
+        }
+        relacher(m);
+    }
+    pthread_mutex_lock(&h->lock);
+    for (int id = 0; id < n; id++) cumuler(&h->slots[id].retires, &w->c[id]);
+    for (plugin_worker_t **p = &h->workers; *p; p = &(*p)->suivant) {
+        if (*p == w) {
+            *p = w->suivant;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&h->lock);
+    free(w);
+}
+
+static void *etat_thread(plugin_worker_t *w, int id, module_t *m) {
+    if (!(m->p->capabilities & PLUGIN_CAP_ETAT_THREAD)) return NULL;
+    if (w->etats[id].generation == m->generation) return w->etats[id].state;
+    /* Premiere utilisation de cette version : l'etat precedent appartient
+       a une version retiree, qui l'a deja libere (ou le liberera) */
+    void *state = m->p->thread_init();
+    pthread_mutex_lock(&m->lock);
+    if (m->nstates == m->capacite) {
+        size_t c = m->capacite ? m->capacite * 2 : 8;
+        void **t = realloc(m->states, c * sizeof(void *));
+        if (!t) {
+            pthread_mutex_unlock(&m->lock);
+            m->p->thread_fini(state);
+            return NULL;
+        }
+        m->states = t;
+        m->capacite = c;
+    }
+    m->states[m->nstates++] = state;
+    pthread_mutex_unlock(&m->lock);
+    w->etats[id].generation = m->generation;
+    w->etats[id].state = state;
+    return state;
+}
+
+long plugin_host_process(plugin_worker_t *w, int id, const PluginBuffer *in, PluginOutput *out, size_t n) {
+    plugin_host_t *h = w->h;
+    if (id < 0 || id >= atomic_load_explicit(&h->nslots, memory_order_acquire)) {
+        errno = EINVAL;
+        return -1;
+    }
+    module_t *m = acquerir(&h->slots[id]);
+    const PluginV2 *p = m->p;
+    compteurs_t *c = &w->c[id];
+    void *state = etat_thread(w, id, m);
+    long r;
+    uint64_t t0 = (h->options & PLUGIN_HOST_LATENCE) ? now_ns() : 0;
+    if (p->capabilities & PLUGIN_CAP_THREAD_SAFE) {
+        r = p->process(state, in, out, n);
+    } else {
+        pthread_mutex_lock(&m->appel);
+        r = p->process(state, in, out, n);
+        pthread_mutex_unlock(&m->appel);
+    }
+    if (h->options & PLUGIN_HOST_LATENCE) {
+        uint64_t d = now_ns() - t0;
+        ajouter(&c->ns_total, d);
+        ajouter(&c->hist[log2_u64(d)], 1);
+        if (d > atomic_load_explicit(&c->max_ns, memory_order_relaxed))
+            atomic_store_explicit(&c->max_ns, d, memory_order_relaxed);
+    }
+    relacher(m);
+    ajouter(&c->batches, 1);
+    if (r < 0) ajouter(&c->errors, 1);
+    else ajouter(&c->records, (uint64_t)r);
+    return r;
+}
+
+static uint64_t percentile(const compteurs_t *c, double p) {
+    uint64_t total = 0, cumul = 0;
+    for (int i = 0; i < SLOTS_LATENCE; i++) total += atomic_load_explicit(&c->hist[i], memory_order_relaxed);
+    if (!total) return 0;
+    uint64_t rang = (uint64_t)(p * (double)total);
+    if (rang < 1) rang = 1;
+    for (int i = 0; i < SLOTS_LATENCE; i++) {
+        uint64_t k = atomic_load_explicit(&c->hist[i], memory_order_relaxed);
+        if (cumul + k >= rang) {
+            /* interpolation lineaire dans [2^i, 2^(i+1)) */
+            uint64_t bas = i ? (uint64_t)1 << i : 0, haut = (uint64_t)2 << i;
+            return bas + (uint64_t)((double)(rang - cumul) / (double)k * (double)(haut - bas));
+        }
+        cumul += k;
+    }
+    return 0;
+}
+
+int plugin_host_stats(plugin_host_t *h, int id, plugin_stats_t *s) {
+    if (id < 0 || id >= atomic_load(&h->nslots)) {
+        errno = EINVAL;
+        return -1;
+    }
+    slot_t *sl = &h->slots[id];
+    compteurs_t total;
+    memset(s, 0, sizeof(*s));
+    memset(&total, 0, sizeof(total));
+
+    pthread_mutex_lock(&sl->reload);
+    const PluginV2 *p = atomic_load(&sl->current)->p;
+    snprintf(s->name, sizeof(s->name), "%s", p->name);
+    snprintf(s->version, sizeof(s->version), "%s", p->version);
+    s->capabilities = p->capabilities;
+    s->generation = atomic_load(&sl->current)->generation;
+    s->reloads = sl->reloads;
+    s->last_swap_ns = sl->last_swap_ns;
+    s->last_drain_ns = sl->last_drain_ns;
+    pthread_mutex_unlock(&sl->reload);
+
+    pthread_mutex_lock(&h->lock);
+    cumuler(&total, &sl->retires);
+    for (plugin_worker_t *w = h->workers; w; w = w->suivant) cumuler(&total, &w->c[id]);
+    pthread_mutex_unlock(&h->lock);
+
+    s->batches = total.batches;
+    s->records = total.records;
+    s->errors = total.errors;
+    s->ns_total = total.ns_total;
+    s->max_ns = total.max_ns;
+    s->p50_ns = percentile(&total, 0.50);
+    s->p99_ns = percentile(&total, 0.99);
+    return 0;
+}
+
+void plugin_host_destroy(plugin_host_t *h) {
+    if (!h) return;
+    while (h->workers) plugin_host_worker_destroy(h->workers);
+    int n = atomic_load(&h->nslots);
+    for (int id = 0; id < n; id++) retirer_module(h, atomic_load(&h->slots[id].current));
+    while (h->retires) {
+        module_t *m = h->retires;
+        h->retires = m->suivant_retire;
+        pthread_mutex_destroy(&m->lock);
+        pthread_mutex_destroy(&m->appel);
+        free(m);
+    }
+    for (int i = 0; i < PLUGIN_HOST_MAX; i++) pthread_mutex_destroy(&h->slots[i].reload);
+    pthread_mutex_destroy(&h->lock);
+    free(h);
+}
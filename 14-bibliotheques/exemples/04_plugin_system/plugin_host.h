@@ -0,0 +1,66 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Hote de plugins v2 (interface publique, types opaques)
+                 - plugins residents, appeles par lots
+                 - rechargement a chaud atomique sans perte de lot en cours
+                 - latence par plugin (histogramme log2 des lots)
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#ifndef PLUGIN_HOST_H
+#define PLUGIN_HOST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "plugin_interface_v2.h"
+
+#define PLUGIN_HOST_MAX 8
+
+/* Options de plugin_host_create */
+#define PLUGIN_HOST_LATENCE (1 << 0)    /* chronometrer chaque lot */
+
+/* Types opaques : l'hote, et un contexte par thread appelant */
+typedef struct plugin_host plugin_host_t;
+typedef struct plugin_worker plugin_worker_t;
+
+typedef struct {
+    char name[32];
+    char version[16];
+    uint32_t capabilities;
+    uint64_t generation;        /* incrementee a chaque rechargement */
+    uint64_t reloads;
+    uint64_t batches;
+    uint64_t records;
+    uint64_t errors;
+    uint64_t ns_total;          /* somme des durees de lot (PLUGIN_HOST_LATENCE) */
+    uint64_t p50_ns;            /* percentiles de la duree d'un lot */
+    uint64_t p99_ns;
+    uint64_t max_ns;
+    uint64_t last_swap_ns;      /* dernier rechargement : chargement + echange */
+    uint64_t last_drain_ns;     /* attente de la fin des lots de l'ancienne version */
+} plugin_stats_t;
+
+/* Creation et destruction */
+plugin_host_t *plugin_host_create(int options);
+void plugin_host_destroy(plugin_host_t *h);
+const char *plugin_host_error(const plugin_host_t *h);
+
+/* Chargement (renvoie l'identifiant >= 0) et rechargement a chaud ;
+   path NULL : recharger le meme fichier */
+int plugin_host_load(plugin_host_t *h, const char *path);
+int plugin_host_reload(plugin_host_t *h, int id, const char *path);
+/* Transmet un reglage au plugin (champ configure) ; l'hote le memorise
+   et le rejoue sur chaque version rechargee */
+int plugin_host_configure(plugin_host_t *h, int id, const char *key, const char *value);
+const PluginV2 *plugin_host_plugin(plugin_host_t *h, int id);
+
+/* Un contexte par thread : porte l'etat par thread des plugins et ses
+   compteurs (aucune ecriture partagee sur le chemin chaud) */
+plugin_worker_t *plugin_host_worker_create(plugin_host_t *h);
+void plugin_host_worker_destroy(plugin_worker_t *w);
+
+long plugin_host_process(plugin_worker_t *w, int id, const PluginBuffer *in, PluginOutput *out, size_t n);
+
+int plugin_host_stats(plugin_host_t *h, int id, plugin_stats_t *s);
+
+#endif /* PLUGIN_HOST_H */
@@ -0,0 +1,72 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Interface de plugin v2 (ABI versionnee, traitement par lots)
+                 - lots de tampons delimites par leur longueur (pas de NUL)
+                 - tampons de sortie fournis par l'appelant
+                 - drapeaux de capacites et etat par thread
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#ifndef PLUGIN_INTERFACE_V2_H
+#define PLUGIN_INTERFACE_V2_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Un hote v2 refuse un plugin dont abi_version differe ; struct_size
+   permet d'ajouter des champs en fin de structure sans casser l'ABI */
+#define PLUGIN_ABI_VERSION 2
+
+/* Capacites declarees par le plugin */
+#define PLUGIN_CAP_THREAD_SAFE  (1u << 0)   /* process() appelable en parallele */
+#define PLUGIN_CAP_ETAT_THREAD  (1u << 1)   /* thread_init/thread_fini fournis */
+#define PLUGIN_CAP_EN_PLACE     (1u << 2)   /* la sortie peut etre l'entree */
+#define PLUGIN_CAP_RECHARGEABLE (1u << 3)   /* remplacable a chaud */
+
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+} PluginBuffer;
+
+typedef struct {
+    uint8_t *data;
+    size_t capacity;            /* fourni par l'appelant */
+    size_t len;                 /* ecrit par le plugin */
+} PluginOutput;
+
+typedef struct {
+    uint32_t abi_version;       /* PLUGIN_ABI_VERSION */
+    uint32_t struct_size;       /* sizeof(PluginV2) a la compilation du plugin */
+    const char *name;
+    const char *version;
+    uint32_t capabilities;      /* PLUGIN_CAP_* */
+
+    int (*init)(void);
+    void (*cleanup)(void);
+
+    /* Etat prive d'un thread de l'hote (PLUGIN_CAP_ETAT_THREAD) */
+    void *(*thread_init)(void);
+    void (*thread_fini)(void *state);
+
+    /* Taille de sortie suffisante pour une entree de len octets */
+    size_t (*output_bound)(size_t len);
+
+    /* Traite n enregistrements. Renvoie le nombre traite depuis le debut
+       (< n si out[k].capacity est insuffisante : out[k].len recoit alors
+       la taille necessaire), ou une valeur negative en cas d'erreur. */
+    long (*process)(void *state, const PluginBuffer *in, PluginOutput *out, size_t n);
+
+    /* --- Ajouts compatibles : presents si struct_size les couvre --- */
+
+    /* Reglage cle/valeur ; 0 si accepte. L'hote le rejoue apres un
+       rechargement a chaud. NULL : plugin sans reglage. */
+    int (*configure)(const char *key, const char *value);
+} PluginV2;
+
+/* Taille de la premiere version de PluginV2 : minimum accepte par l'hote */
+#define PLUGIN_V2_TAILLE_MIN (offsetof(PluginV2, configure))
+
+/* Fonction que chaque plugin v2 doit exporter */
+const PluginV2 *get_plugin_v2(void);
+
+#endif
@@ -0,0 +1,118 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Plugin de mise en majuscules exportant les deux ABI
+                 - v1 : process(const char *) une chaine par appel
+                 - v2 : lots de tampons, sortie fournie par l'appelant,
+                   etat par thread, rechargeable a chaud
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "plugin_interface.h"
+#include "plugin_interface_v2.h"
+
+/* Meme transformation pour les deux ABI */
+static uint8_t majuscule(uint8_t c) {
+    return (c >= 'a' && c <= 'z') ? (uint8_t)(c - ('a' - 'A')) : c;
+}
+
+/* ---------------------------------------------------------------------------
+   ABI v1 : pas de sortie, le resultat reste dans le plugin
+   --------------------------------------------------------------------------- */
+
+static char v1_sortie[4096];
+static uint64_t v1_somme;
+
+static int majuscules_init(void) {
+    v1_somme = 0;
+    return 0;
+}
+
+static void majuscules_process(const char *data) {
+    size_t n = strlen(data);
+    if (n >= sizeof(v1_sortie)) n = sizeof(v1_sortie) - 1;
+    for (size_t i = 0; i < n; i++) {
+        v1_sortie[i] = (char)majuscule((uint8_t)data[i]);
+        v1_somme += (uint8_t)v1_sortie[i];
+    }
+    v1_sortie[n] = '\0';
+}
+
+static void majuscules_cleanup(void) {
+}
+
+static Plugin majuscules_plugin = {
+    .name = "Majuscules",
+    .version = "1.0",
+    .init = majuscules_init,
+    .process = majuscules_process,
+    .cleanup = majuscules_cleanup
+};
+
+Plugin *get_plugin(void) {
+    return &majuscules_plugin;
+}
+
+/* Seul moyen de controler le resultat v1 : un symbole supplementaire
+   (somme des octets produits, calculee dans la meme boucle) */
+uint64_t majuscules_somme_v1(void) {
+    return v1_somme;
+}
+
+/* ---------------------------------------------------------------------------
+   ABI v2
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    uint64_t records;
+} etat_t;
+
+static void *majuscules_thread_init(void) {
+    return calloc(1, sizeof(etat_t));
+}
+
+static void majuscules_thread_fini(void *state) {
+    free(state);
+}
+
+static size_t majuscules_output_bound(size_t len) {
+    return len;
+}
+
+static long majuscules_process_v2(void *state, const PluginBuffer *in, PluginOutput *out, size_t n) {
+    etat_t *etat = state;
+    for (size_t k = 0; k < n; k++) {
+        size_t len = in[k].len;
+        if (out[k].capacity < len) {
+            out[k].len = len;
+            if (etat) etat->records += k;
+            return (long)k;
+        }
+        const uint8_t *src = in[k].data;
+        uint8_t *dst = out[k].data;
+        for (size_t i = 0; i < len; i++) dst[i] = majuscule(src[i]);
+        out[k].len = len;
+    }
+    if (etat) etat->records += n;
+    return (long)n;
+}
+
+static const PluginV2 majuscules_plugin_v2 = {
+    .abi_version = PLUGIN_ABI_VERSION,
+    .struct_size = sizeof(PluginV2),
+    .name = "Majuscules",
+    .version = "2.0",
+    .capabilities = PLUGIN_CAP_THREAD_SAFE | PLUGIN_CAP_ETAT_THREAD | PLUGIN_CAP_EN_PLACE
+                  | PLUGIN_CAP_RECHARGEABLE,
+    .init = NULL,
+    .cleanup = NULL,
+    .thread_init = majuscules_thread_init,
+    .thread_fini = majuscules_thread_fini,
+    .output_bound = majuscules_output_bound,
+    .process = majuscules_process_v2
+};
+
+const PluginV2 *get_plugin_v2(void) {
+    return &majuscules_plugin_v2;
+}
@@ -0,0 +1,210 @@
+/* ============================================================================
+   Section 02.3 : Resolution de symboles au runtime
+   Description : Format de trame du plugin de compression
+                 - blocs independants de taille fixe (sauf le dernier)
+                 - index en fin de trame : acces direct a n'importe quel
+                   octet en ne decompressant que son bloc
+                 - somme de controle par bloc, entiers petit-boutistes
+   Fichier source : 02.3-resolution-symboles.md
+   ============================================================================ */
+
+#ifndef TRAME_H
+#define TRAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "codecs.h"
+
+/* Disposition :
+     en-tete    16 o  "PCZ1" | version u8 | codec u8 | 0 u16 | taille_bloc u32 | 0 u32
+     bloc k     16 o  taille_c u32 (bit 31 : stocke brut) | taille u32 | somme u32 | 0 u32
+                      + taille_c octets
+     index      nblocs x 16 o  offset du bloc u64 | taille_c u32 (bit 31 compris) | taille u32
+     pied       16 o  offset de l'index u64 | nblocs u32 | "PCZI"
+   Les blocs se lisent aussi en sequence sans l'index (flux). */
+
+#define TRAME_VERSION 1
+#define TRAME_ENTETE 16
+#define TRAME_ENTETE_BLOC 16
+#define TRAME_ENTREE_INDEX 16
+#define TRAME_PIED 16
+#define TRAME_BRUT 0x80000000u
+
+static inline void trame_ecrire32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void trame_ecrire64(uint8_t *p, uint64_t v) {
+    trame_ecrire32(p, (uint32_t)v);
+    trame_ecrire32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint32_t trame_lire32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t trame_lire64(const uint8_t *p) {
+    return (uint64_t)trame_lire32(p) | (uint64_t)trame_lire32(p + 4) << 32;
+}
+
+/* Somme de controle rapide (mots de 8 octets, multiplication-rotation) :
+   detecte la corruption, pas la falsification */
+static inline uint32_t trame_somme(const uint8_t *p, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15u ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t v;
+        memcpy(&v, p + i, 8);
+        h = (h ^ v) * 0xFF51AFD7ED558CCDu;
+        h = (h << 31) | (h >> 33);
+    }
+    for (; i < n; i++) h = (h ^ p[i]) * 0x100000001B3u;
+    h ^= h >> 29;
+    h *= 0xC4CEB9FE1A85EC53u;
+    return (uint32_t)(h ^ (h >> 32));
+}
+
+static inline size_t trame_nblocs(size_t n, uint32_t taille_bloc) {
+    return (n + taille_bloc - 1) / taille_bloc;
+}
+
+/* Place reservee a un bloc compresse (en-tete compris) : le repli en
+   stockage brut garantit qu'un bloc ne depasse jamais sa taille d'origine */
+static inline size_t trame_pas_bloc(const codec_t *c, uint32_t taille_bloc) {
+    size_t b = c->borne(taille_bloc);
+    return TRAME_ENTETE_BLOC + (b > taille_bloc ? b : taille_bloc);
+}
+
+/* Taille maximale d'une trame pour n octets */
+static inline size_t trame_borne(const codec_t *c, size_t n, uint32_t taille_bloc) {
+    size_t nb = trame_nblocs(n, taille_bloc);
+    return TRAME_ENTETE + nb * (trame_pas_bloc(c, taille_bloc) + TRAME_ENTREE_INDEX) + TRAME_PIED;
+}
+
+/* Compresse un bloc dans dst (trame_pas_bloc() octets) ; renvoie la taille
+   ecrite, en-tete compris */
+static inline size_t trame_compresser_bloc(const codec_t *c, codec_contexte_t *ctx, int niveau,
+                                           const uint8_t *src, size_t n, uint8_t *dst, size_t cap) {
+    uint8_t *donnees = dst + TRAME_ENTETE_BLOC;
+    size_t taille_c = c->compresser(ctx, niveau, src, n, donnees, cap - TRAME_ENTETE_BLOC);
+    uint32_t drapeau = 0;
+    if (taille_c == 0 || taille_c >= n) {
+        /* Incompressible (ou echec du codec) : stocke tel quel */
+        if (n) memcpy(donnees, src, n);
+        taille_c = n;
+        drapeau = TRAME_BRUT;
+    }
+    trame_ecrire32(dst, (uint32_t)taille_c | drapeau);
+    trame_ecrire32(dst + 4, (uint32_t)n);
+    trame_ecrire32(dst + 8, trame_somme(src, n));
+    trame_ecrire32(dst + 12, 0);
+    return TRAME_ENTETE_BLOC + taille_c;
+}
+
+static inline void trame_ecrire_entete(uint8_t *dst, const codec_t *c, uint32_t taille_bloc) {
+    memcpy(dst, "PCZ1", 4);
+    dst[4] = TRAME_VERSION;
+    dst[5] = (uint8_t)c->id;
+    dst[6] = dst[7] = 0;
+    trame_ecrire32(dst + 8, taille_bloc);
+    trame_ecrire32(dst + 12, 0);
+}
+
+/* ---------------------------------------------------------------------------
+   Lecture
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    const uint8_t *base;
+    size_t taille;
+    const codec_t *codec;
+    uint32_t taille_bloc;
+    uint32_t nblocs;
+    const uint8_t *index;
+    uint64_t taille_originale;
+} trame_t;
+
+/* Valide l'en-tete, le pied et l'index ; 0 si la trame est exploitable */
+static inline int trame_ouvrir(trame_t *t, const uint8_t *data, size_t len) {
+    memset(t, 0, sizeof(*t));
+    if (len < TRAME_ENTETE + TRAME_PIED || memcmp(data, "PCZ1", 4) != 0 || data[4] != TRAME_VERSION)
+        return -1;
+    const uint8_t *pied = data + len - TRAME_PIED;
+    if (memcmp(pied + 12, "PCZI", 4) != 0) return -1;
+    t->codec = codec_par_id(data[5]);
+    t->taille_bloc = trame_lire32(data + 8);
+    t->nblocs = trame_lire32(pied + 8);
+    uint64_t off_index = trame_lire64(pied);
+    if (!t->codec || t->taille_bloc == 0 || off_index < TRAME_ENTETE ||
+        off_index > len - TRAME_PIED ||
+        (len - TRAME_PIED - off_index) % TRAME_ENTREE_INDEX != 0 ||
+        (len - TRAME_PIED - off_index) / TRAME_ENTREE_INDEX != t->nblocs)
+        return -1;
+    t->base = data;
+    t->taille = len;
+    t->index = data + off_index;
+    for (uint32_t k = 0; k < t->nblocs; k++) {
+        const uint8_t *e = t->index + (size_t)k * TRAME_ENTREE_INDEX;
+        uint64_t off = trame_lire64(e);
+        uint32_t taille_c = trame_lire32(e + 8) & ~TRAME_BRUT, taille = trame_lire32(e + 12);
+        /* Sans addition sur off : un offset forge ne doit pas deborder */
+        if (off < TRAME_ENTETE || off > off_index || TRAME_ENTETE_BLOC + (uint64_t)taille_c > off_index - off)
+            return -1;
+        /* Seul le dernier bloc peut etre plus court */
+        if (taille > t->taille_bloc || (k + 1 < t->nblocs && taille != t->taille_bloc)) return -1;
+        t->taille_originale += taille;
+    }
+    return 0;
+}
+
+/* Decompresse le bloc k dans dst (>= taille_bloc octets) et verifie sa
+   somme ; renvoie sa taille, -1 si le bloc est corrompu */
+static inline long trame_bloc(const trame_t *t, uint32_t k, uint8_t *dst, size_t cap) {
+    if (k >= t->nblocs) return -1;
+    const uint8_t *e = t->index + (size_t)k * TRAME_ENTREE_INDEX;
+    const uint8_t *b = t->base + trame_lire64(e);
+    uint32_t mot = trame_lire32(b), taille = trame_lire32(b + 4);
+    uint32_t taille_c = mot & ~TRAME_BRUT;
+    if (mot != trame_lire32(e + 8) || taille != trame_lire32(e + 12) || cap < taille) return -1;
+    long n = (mot & TRAME_BRUT)
+        ? codec_brut_decompresser(b + TRAME_ENTETE_BLOC, taille_c, dst, cap)
+        : t->codec->decompresser(b + TRAME_ENTETE_BLOC, taille_c, dst, taille);
+    if (n != (long)taille || trame_somme(dst, taille) != trame_lire32(b + 8)) return -1;
+    return n;
+}
+
+/* Lit len octets a partir de offset (donnees d'origine) en ne decompressant
+   que les blocs concernes ; tampon : taille_bloc octets de travail */
+static inline int trame_lire(const trame_t *t, uint64_t offset, uint8_t *dst, size_t len, uint8_t *tampon) {
+    if (offset > t->taille_originale || len > t->taille_originale - offset) return -1;
+    while (len > 0) {
+        uint32_t k = (uint32_t)(offset / t->taille_bloc);
+        size_t debut = (size_t)(offset % t->taille_bloc);
+        long n = trame_bloc(t, k, tampon, t->taille_bloc);
+        if (n < 0) return -1;
+        size_t c = (size_t)n - debut < len ? (size_t)n - debut : len;
+        memcpy(dst, tampon + debut, c);
+        dst += c;
+        offset += c;
+        len -= c;
+    }
+    return 0;
+}
+
+/* Decompresse toute la trame ; renvoie la taille d'origine ou -1 */
+static inline long trame_tout(const trame_t *t, uint8_t *dst, size_t cap) {
+    if (cap < t->taille_originale) return -1;
+    size_t pos = 0;
+    for (uint32_t k = 0; k < t->nblocs; k++) {
+        long n = trame_bloc(t, k, dst + pos, cap - pos);
+        if (n < 0) return -1;
+        pos += (size_t)n;
+    }
+    return (long)pos;
+}
+
+#endif /* TRAME_H */
@@ -0,0 +1,881 @@
+/* ============================================================================
+   Section 16.3 : Difference appels systeme vs bibliotheque
+   Description : Moteur de copie remplacant la boucle read/write de
+                 10_copie_fichier.c
+                 - strategies par ordre de preference : copy_file_range
+                   (reflink ou copie dans le noyau), splice via un pipe,
+                   pipeline io_uring (optionnel), pread/pwrite 1 Mo
+                 - repli automatique quand le systeme de fichiers refuse
+                   une strategie (EXDEV, EINVAL, EOPNOTSUPP...)
+                 - conserve les trous des fichiers creux (SEEK_DATA/SEEK_HOLE)
+                 - posix_fadvise : lecture sequentielle, puis liberation du
+                   cache de page de la source
+                 - copie d'arborescences : un thread parcourt, N threads copient
+                 Benchmark contre les boucles de 10 (read/write 8 Ko, stdio)
+   Fichier source : 03-systeme-vs-bibliotheque.md
+   ============================================================================ */
+
+/* Compiler avec : gcc ... -pthread
+   Pipeline io_uring : ajouter -DAVEC_LIBURING ... -luring (liburing-dev) */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <ftw.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#ifdef AVEC_LIBURING
+#include <liburing.h>
+#endif
+
+#define TAILLE_BLOC_RW (1024 * 1024)
+#define TAILLE_SEGMENT ((size_t)1 << 30)   /* par appel copy_file_range/splice */
+#define FILE_TACHES 1024
+#define MAX_THREADS 64
+
+/* ---------------------------------------------------------------------------
+   API
+   --------------------------------------------------------------------------- */
+
+typedef enum {
+    COPIE_AUTO,          /* range -> splice -> io_uring -> rw */
+    COPIE_RANGE,
+    COPIE_SPLICE,
+    COPIE_URING,
+    COPIE_RW,
+    NB_STRATEGIES
+} strategie_t;
+
+static const char *noms_strategies[NB_STRATEGIES] = {
+    "auto", "copy_file_range", "splice", "io_uring", "pread/pwrite"
+};
+
+typedef struct {
+    strategie_t strategie;
+    int threads;                        /* copie d'arborescence */
+    bool preserver_trous;
+
+    /* Appris a l'execution, partage par les threads */
+    atomic_bool sans_range;
+    atomic_bool sans_splice;
+    atomic_bool sans_uring;
+
+    /* Statistiques */
+    atomic_ulong fichiers;
+    atomic_ulong octets;
+    atomic_ulong trous;
+    atomic_ulong par_strategie[NB_STRATEGIES];
+    atomic_int erreurs;
+} copieur_t;
+
+void copieur_init(copieur_t *c, strategie_t strategie, int threads) {
+    memset(c, 0, sizeof(*c));
+    c->strategie = strategie;
+    c->threads = threads < 1 ? 1 : threads > MAX_THREADS ? MAX_THREADS : threads;
+    c->preserver_trous = true;
+#ifndef AVEC_LIBURING
+    atomic_store(&c->sans_uring, true);
+#endif
+}
+
+/* Erreurs signifiant « strategie non supportee ici », pas un echec d'E/S */
+static bool non_supporte(int err) {
+    return err == EXDEV || err == EINVAL || err == ENOSYS || err == EOPNOTSUPP
+        || err == EBADF || err == EPERM;
+}
+
+/* Chaque copier_* copie [debut, fin) a la meme position dans out.
+   Retourne 0, ou -1 avec errno. En cas de non-support sans octet copie,
+   *copie reste a debut et l'appelant passe a la strategie suivante. */
+
+static int copier_range(int in, int out, off_t debut, off_t fin, off_t *copie) {
+    loff_t off_in = debut, off_out = debut;
+    while (off_in < fin) {
+        size_t n = (size_t)(fin - off_in) < TAILLE_SEGMENT ? (size_t)(fin - off_in) : TAILLE_SEGMENT;
+        ssize_t r = copy_file_range(in, &off_in, out, &off_out, n, 0);
+        if (r < 0) {
+            if (errno == EINTR) continue;
+            *copie = off_in;
+            return -1;
+        }
+        if (r == 0) break;                /* source raccourcie */
+    }
+    *copie = off_in;
+    return 0;
+}
+
+static int copier_splice(int in, int out, off_t debut, off_t fin, off_t *copie) {
+    int tube[2];
+    if (pipe2(tube, O_CLOEXEC) == -1) return -1;
+    fcntl(tube[1], F_SETPIPE_SZ, 1024 * 1024);   /* moins d'allers-retours */
+
+    loff_t off_in = debut, off_out = debut;
+    int ret = 0;
+    while (off_in < fin) {
+        size_t n = (size_t)(fin - off_in) < TAILLE_SEGMENT ? (size_t)(fin - off_in) : TAILLE_SEGMENT;
+        ssize_t entres = splice(in, &off_in, tube[1], NULL, n, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (entres < 0) {
+            if (errno == EINTR) continue;
+            ret = -1;
+            break;
+        }
+        if (entres == 0) break;
+        while (entres > 0) {
+            ssize_t sortis = splice(tube[0], NULL, out, &off_out, (size_t)entres, SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (sortis < 0) {
+                if (errno == EINTR) continue;
+                ret = -1;
+                goto fin;
+            }
+            entres -= sortis;
+        }
+    }
+fin:
+    *copie = off_out;
+    int err = errno;
+    close(tube[0]);
+    close(tube[1]);
+    errno = err;
+    return ret;
+}
+
+#ifdef AVEC_LIBURING
+#define URING_PROFONDEUR 8
+#define URING_BLOC (256 * 1024)
+
+typedef struct {
+    char *buf;
+    off_t off;                          /* debut du morceau courant */
+    size_t len;                         /* reste a copier dans ce morceau */
+    size_t lu, ecrit;                   /* progression dans buf */
+    bool ecriture;
+} uring_slot_t;
+
+/* Pipeline : jusqu'a URING_PROFONDEUR morceaux en vol, chacun lu puis ecrit
+   depuis son propre tampon ; les lectures et ecritures se recouvrent */
+static int copier_uring(int in, int out, off_t debut, off_t fin, off_t *copie) {
+    struct io_uring ring;
+    int r = io_uring_queue_init(URING_PROFONDEUR, &ring, 0);
+    if (r < 0) {
+        errno = -r;
+        return -1;
+    }
+    char *memoire = aligned_alloc(4096, (size_t)URING_PROFONDEUR * URING_BLOC);
+    if (!memoire) {
+        io_uring_queue_exit(&ring);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    uring_slot_t slots[URING_PROFONDEUR];
+    off_t prochain = debut;
+    int actifs = 0, erreur = 0;
+
+    for (int i = 0; i < URING_PROFONDEUR && prochain < fin; i++) {
+        uring_slot_t *s = &slots[i];
+        s->buf = memoire + (size_t)i * URING_BLOC;
+        s->off = prochain;
+        s->len = (size_t)(fin - prochain) < URING_BLOC ? (size_t)(fin - prochain) : URING_BLOC;
+        s->ecriture = false;
+        prochain += (off_t)s->len;
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ring);
+        io_uring_prep_read(sqe, in, s->buf, (unsigned)s->len, (__u64)s->off);
+        io_uring_sqe_set_data(sqe, s);
+        actifs++;
+    }
+
+    while (actifs > 0) {
+        struct io_uring_cqe *cqe;
+        io_uring_submit(&ring);
+        r = io_uring_wait_cqe(&ring, &cqe);
+        if (r < 0) {
+            if (r == -EINTR) continue;
+            erreur = -r;
+            break;
+        }
+        uring_slot_t *s = io_uring_cqe_get_data(cqe);
+        int res = cqe->res;
+        io_uring_cqe_seen(&ring, cqe);
+        actifs--;
+
+        if (res < 0 || erreur) {
+            if (!erreur) erreur = -res;
+            continue;                   /* vider les operations en vol */
+        }
+        struct io_uring_sqe *sqe;
+        if (!s->ecriture) {
+            if (res == 0) continue;     /* source raccourcie */
+            s->lu = (size_t)res;
+            s->ecrit = 0;
+            s->ecriture = true;
+            sqe = io_uring_get_sqe(&ring);
+            io_uring_prep_write(sqe, out, s->buf, (unsigned)s->lu, (__u64)s->off);
+        } else {
+            if (res == 0) {             /* aucun progres : ne pas resoumettre */
+                erreur = EIO;
+                continue;
+            }
+            s->ecrit += (size_t)res;
+            if (s->ecrit < s->lu) {
+                sqe = io_uring_get_sqe(&ring);
+                io_uring_prep_write(sqe, out, s->buf + s->ecrit, (unsigned)(s->lu - s->ecrit),
+                                    (__u64)(s->off + (off_t)s->ecrit));
+            } else {
+                /* Lecture courte : relire la suite, sinon morceau suivant */
+                s->off += (off_t)s->lu;
+                s->len -= s->lu;
+                if (s->len == 0) {
+                    if (prochain >= fin) continue;
+                    s->off = prochain;
+                    s->len = (size_t)(fin - prochain) < URING_BLOC ? (size_t)(fin - prochain) : URING_BLOC;
+                    prochain += (off_t)s->len;
+                }
+                s->ecriture = false;
+                sqe = io_uring_get_sqe(&ring);
+                io_uring_prep_read(sqe, in, s->buf, (unsigned)s->len, (__u64)s->off);
+            }
+        }
+        io_uring_sqe_set_data(sqe, s);
+        actifs++;
+    }
+
+    free(memoire);
+    io_uring_queue_exit(&ring);
+    if (erreur) {
+        *copie = debut;                 /* progression non contigue : tout refaire */
+        errno = erreur;
+        return -1;
+    }
+    *copie = fin;
+    return 0;
+}
+#endif
+
+static int copier_rw(int in, int out, off_t debut, off_t fin, off_t *copie) {
+    char *buf = malloc(TAILLE_BLOC_RW);
+    if (!buf) return -1;
+    off_t off = debut;
+    int ret = 0;
+    while (off < fin) {
+        size_t n = (size_t)(fin - off) < TAILLE_BLOC_RW ? (size_t)(fin - off) : TAILLE_BLOC_RW;
+        ssize_t lus = pread(in, buf, n, off);
+        if (lus < 0) {
+            if (errno == EINTR) continue;
+            ret = -1;
+            break;
+        }
+        if (lus == 0) break;
+        for (ssize_t ecrits = 0; ecrits < lus;) {
+            ssize_t w = pwrite(out, buf + ecrits, (size_t)(lus - ecrits), off + ecrits);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                ret = -1;
+                goto fin;
+            }
+            ecrits += w;
+        }
+        off += lus;
+    }
+fin:
+    *copie = off;
+    free(buf);
+    return ret;
+}
+
+/* Copie un extent en descendant la chaine de strategies */
+static int copier_extent(copieur_t *c, int in, int out, off_t debut, off_t fin) {
+    strategie_t s = c->strategie;
+    off_t copie = debut;
+
+    if ((s == COPIE_AUTO && !atomic_load_explicit(&c->sans_range, memory_order_relaxed))
+        || s == COPIE_RANGE) {
+        if (copier_range(in, out, debut, fin, &copie) == 0) {
+            atomic_fetch_add_explicit(&c->par_strategie[COPIE_RANGE], 1, memory_order_relaxed);
+            return 0;
+        }
+        if (s != COPIE_AUTO || !non_supporte(errno) || copie != debut) return -1;
+        atomic_store_explicit(&c->sans_range, true, memory_order_relaxed);
+    }
+    if ((s == COPIE_AUTO && !atomic_load_explicit(&c->sans_splice, memory_order_relaxed))
+        || s == COPIE_SPLICE) {
+        if (copier_splice(in, out, debut, fin, &copie) == 0) {
+            atomic_fetch_add_explicit(&c->par_strategie[COPIE_SPLICE], 1, memory_order_relaxed);
+            return 0;
+        }
+        if (s != COPIE_AUTO || !non_supporte(errno) || copie != debut) return -1;
+        atomic_store_explicit(&c->sans_splice, true, memory_order_relaxed);
+    }
+#ifdef AVEC_LIBURING
+    if ((s == COPIE_AUTO && !atomic_load_explicit(&c->sans_uring, memory_order_relaxed))
+        || s == COPIE_URING) {
+        if (copier_uring(in, out, debut, fin, &copie) == 0) {
+            atomic_fetch_add_explicit(&c->par_strategie[COPIE_URING], 1, memory_order_relaxed);
+            return 0;
+        }
+        if (s != COPIE_AUTO) return -1;
+        atomic_store_explicit(&c->sans_uring, true, memory_order_relaxed);
+    }
+#else
+    if (s == COPIE_URING) {
+        errno = ENOSYS;                 /* compile sans -DAVEC_LIBURING */
+        return -1;
+    }
+#endif
+    if (copier_rw(in, out, debut, fin, &copie) == 0) {
+        atomic_fetch_add_explicit(&c->par_strategie[COPIE_RW], 1, memory_order_relaxed);
+        return 0;
+    }
+    return -1;
+}
+
+int copieur_fichier(copieur_t *c, const char *source, const char *destination) {
+    int in = open(source, O_RDONLY | O_CLOEXEC);
+    if (in == -1) return -1;
+    struct stat st;
+    if (fstat(in, &st) == -1) {
+        close(in);
+        return -1;
+    }
+    int out = open(destination, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 07777);
+    if (out == -1) {
+        close(in);
+        return -1;
+    }
+
+    int ret = 0;
+    bool gros = st.st_size >= 1024 * 1024;
+    if (gros) posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    /* Taille finale d'abord : les trous non ecrits restent des trous */
+    if (st.st_size > 0 && ftruncate(out, st.st_size) == -1) ret = -1;
+
+    /* Un fichier dont les blocs couvrent la taille n'a pas de trou :
+       eviter deux lseek par fichier sur les petits fichiers */
+    bool creux = c->preserver_trous && (off_t)st.st_blocks * 512 < st.st_size;
+    off_t pos = 0;
+    while (ret == 0 && pos < st.st_size) {
+        off_t debut = pos, fin = st.st_size;
+        if (creux) {
+            debut = lseek(in, pos, SEEK_DATA);
+            if (debut == -1) {
+                if (errno == ENXIO) break;          /* trou jusqu'a la fin */
+                debut = pos;                        /* SEEK_DATA non supporte */
+                creux = false;
+            } else {
+                fin = lseek(in, debut, SEEK_HOLE);
+                if (fin == -1) fin = st.st_size;
+                if (debut > pos) atomic_fetch_add_explicit(&c->trous, 1, memory_order_relaxed);
+            }
+        }
+        if (copier_extent(c, in, out, debut, fin) == -1) ret = -1;
+        pos = fin;
+    }
+
+    int err = errno;
+    if (gros) posix_fadvise(in, 0, 0, POSIX_FADV_DONTNEED);   /* ne pas polluer le cache */
+    close(in);
+    if (close(out) == -1 && ret == 0) {
+        err = errno;
+        ret = -1;
+    }
+    if (ret == 0) {
+        atomic_fetch_add_explicit(&c->fichiers, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&c->octets, (unsigned long)st.st_size, memory_order_relaxed);
+    } else {
+        atomic_fetch_add_explicit(&c->erreurs, 1, memory_order_relaxed);
+    }
+    errno = err;
+    return ret;
+}
+
+/* --- Arborescences : le thread appelant parcourt, les workers copient --- */
+
+typedef struct {
+    char *source;
+    char *destination;
+} tache_t;
+
+/* Droits d'un repertoire a poser une fois son contenu copie */
+typedef struct mode_differe {
+    struct mode_differe *suivant;
+    mode_t mode;
+    char chemin[];
+} mode_differe_t;
+
+typedef struct {
+    copieur_t *copieur;
+    mode_differe_t *modes;          /* ordre suffixe : enfants avant parents */
+    mode_differe_t **fin_modes;
+    tache_t *taches[FILE_TACHES];
+    size_t tete, queue;
+    bool termine;
+    pthread_mutex_t mutex;
+    pthread_cond_t non_vide, non_pleine;
+} file_taches_t;
+
+static void *worker_copie(void *arg) {
+    file_taches_t *f = arg;
+    for (;;) {
+        pthread_mutex_lock(&f->mutex);
+        while (f->tete == f->queue && !f->termine) pthread_cond_wait(&f->non_vide, &f->mutex);
+        if (f->tete == f->queue) {
+            pthread_mutex_unlock(&f->mutex);
+            return NULL;
+        }
+        tache_t *t = f->taches[f->queue++ % FILE_TACHES];
+        pthread_cond_signal(&f->non_pleine);
+        pthread_mutex_unlock(&f->mutex);
+
+        copieur_fichier(f->copieur, t->source, t->destination);
+        free(t->source);
+        free(t->destination);
+        free(t);
+    }
+}
+
+static int soumettre(file_taches_t *f, const char *source, const char *destination) {
+    tache_t *t = malloc(sizeof(*t));
+    if (!t) return -1;
+    t->source = strdup(source);
+    t->destination = strdup(destination);
+    pthread_mutex_lock(&f->mutex);
+    while (f->tete - f->queue == FILE_TACHES) pthread_cond_wait(&f->non_pleine, &f->mutex);
+    f->taches[f->tete++ % FILE_TACHES] = t;
+    pthread_cond_signal(&f->non_vide);
+    pthread_mutex_unlock(&f->mutex);
+    return 0;
+}
+
+static int parcourir(copieur_t *c, file_taches_t *f, const char *source, const char *destination) {
+    struct stat st;
+    if (stat(source, &st) == -1) return -1;
+    /* 0700 pendant la copie : une source en lecture seule (0555) rendrait
+       la destination inaccessible en ecriture ; mode final pose apres */
+    if (mkdir(destination, 0700) == -1 && errno != EEXIST) return -1;
+
+    DIR *d = opendir(source);
+    if (!d) return -1;
+    int ret = 0;
+    struct dirent *e;
+    char src[PATH_MAX], dst[PATH_MAX];
+    while ((e = readdir(d)) != NULL) {
+        if (strcmp(e->d_name, ".") == 0 || strcmp(e->d_name, "..") == 0) continue;
+        if (snprintf(src, sizeof(src), "%s/%s", source, e->d_name) >= (int)sizeof(src)
+            || snprintf(dst, sizeof(dst), "%s/%s", destination, e->d_name) >= (int)sizeof(dst)) {
+            atomic_fetch_add(&c->erreurs, 1);
+            continue;
+        }
+        unsigned char type = e->d_type;
+        if (type == DT_UNKNOWN) {
+            struct stat se;
+            if (lstat(src, &se) == -1) continue;
+            type = S_ISDIR(se.st_mode) ? DT_DIR : S_ISLNK(se.st_mode) ? DT_LNK
+                 : S_ISREG(se.st_mode) ? DT_REG : DT_UNKNOWN;
+        }
+        if (type == DT_DIR) {
+            if (parcourir(c, f, src, dst) == -1) ret = -1;
+        } else if (type == DT_REG) {
+            /* Sans file : copie directe par le thread qui parcourt */
+            if (f ? soumettre(f, src, dst) : copieur_fichier(c, src, dst)) ret = -1;
+        } else if (type == DT_LNK) {
+            char cible[PATH_MAX];
+            ssize_t n = readlink(src, cible, sizeof(cible) - 1);
+            if (n >= 0) {
+                cible[n] = '\0';
+                if (symlink(cible, dst) == -1 && errno != EEXIST) ret = -1;
+            }
+        }
+    }
+    closedir(d);
+
+    /* Sans file, le contenu est deja copie ; sinon les workers peuvent
+       encore ecrire dedans : droits poses apres leur arret */
+    if (!f) {
+        if (chmod(destination, st.st_mode & 07777) == -1) ret = -1;
+        return ret;
+    }
+    size_t n = strlen(destination) + 1;
+    mode_differe_t *m = malloc(sizeof(*m) + n);
+    if (!m) return -1;
+    m->suivant = NULL;
+    m->mode = st.st_mode & 07777;
+    memcpy(m->chemin, destination, n);
+    *f->fin_modes = m;
+    f->fin_modes = &m->suivant;
+    return ret;
+}
+
+int copieur_arbre(copieur_t *c, const char *source, const char *destination) {
+    if (c->threads == 1) return parcourir(c, NULL, source, destination);
+
+    file_taches_t *f = calloc(1, sizeof(*f));
+    if (!f) return -1;
+    f->copieur = c;
+    f->fin_modes = &f->modes;
+    pthread_mutex_init(&f->mutex, NULL);
+    pthread_cond_init(&f->non_vide, NULL);
+    pthread_cond_init(&f->non_pleine, NULL);
+
+    pthread_t workers[MAX_THREADS];
+    int nb = 0;
+    for (; nb < c->threads; nb++) {
+        if (pthread_create(&workers[nb], NULL, worker_copie, f) != 0) break;
+    }
+    int ret = nb > 0 ? parcourir(c, f, source, destination) : -1;
+
+    pthread_mutex_lock(&f->mutex);
+    f->termine = true;
+    pthread_cond_broadcast(&f->non_vide);
+    pthread_mutex_unlock(&f->mutex);
+    for (int i = 0; i < nb; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    while (f->modes) {
+        mode_differe_t *m = f->modes;
+        if (chmod(m->chemin, m->mode) == -1) ret = -1;
+        f->modes = m->suivant;
+        free(m);
+    }
+
+    pthread_cond_destroy(&f->non_pleine);
+    pthread_cond_destroy(&f->non_vide);
+    pthread_mutex_destroy(&f->mutex);
+    free(f);
+    return ret == 0 && atomic_load(&c->erreurs) == 0 ? 0 : -1;
+}
+
+/* ---------------------------------------------------------------------------
+   Reference : boucles de 10_copie_fichier.c
+   --------------------------------------------------------------------------- */
+
+static int copy_syscall(const char *src, const char *dst) {
+    int fd_in, fd_out;
+    char buffer[8192];
+    ssize_t n;
+
+    fd_in = open(src, O_RDONLY);
+    if (fd_in == -1) return -1;
+    fd_out = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd_out == -1) {
+        close(fd_in);
+        return -1;
+    }
+    while ((n = read(fd_in, buffer, sizeof(buffer))) > 0) {
+        if (write(fd_out, buffer, (size_t)n) != n) {
+            close(fd_in);
+            close(fd_out);
+            return -1;
+        }
+    }
+    close(fd_in);
+    close(fd_out);
+    return n == -1 ? -1 : 0;
+}
+
+static int copy_stdio(const char *src, const char *dst) {
+    FILE *fp_in, *fp_out;
+    char buffer[8192];
+    size_t n;
+
+    fp_in = fopen(src, "rb");
+    if (fp_in == NULL) return -1;
+    fp_out = fopen(dst, "wb");
+    if (fp_out == NULL) {
+        fclose(fp_in);
+        return -1;
+    }
+    while ((n = fread(buffer, 1, sizeof(buffer), fp_in)) > 0) {
+        if (fwrite(buffer, 1, n, fp_out) != n) {
+            fclose(fp_in);
+            fclose(fp_out);
+            return -1;
+        }
+    }
+    int ret = ferror(fp_in) ? -1 : 0;
+    fclose(fp_in);
+    fclose(fp_out);
+    return ret;
+}
+
+/* Parcours sequentiel + copy_syscall : l'arborescence « a la main » */
+static int arbre_boucle(const char *source, const char *destination) {
+    if (mkdir(destination, 0755) == -1 && errno != EEXIST) return -1;
+    DIR *d = opendir(source);
+    if (!d) return -1;
+    int ret = 0;
+    struct dirent *e;
+    char src[PATH_MAX], dst[PATH_MAX];
+    while ((e = readdir(d)) != NULL) {
+        if (e->d_name[0] == '.') continue;
+        snprintf(src, sizeof(src), "%s/%s", source, e->d_name);
+        snprintf(dst, sizeof(dst), "%s/%s", destination, e->d_name);
+        if (e->d_type == DT_DIR) {
+            if (arbre_boucle(src, dst) == -1) ret = -1;
+        } else if (copy_syscall(src, dst) == -1) {
+            ret = -1;
+        }
+    }
+    closedir(d);
+    return ret;
+}
+
+/* ---------------------------------------------------------------------------
+   Benchmark
+   --------------------------------------------------------------------------- */
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Sortir la source du cache de page pour mesurer le disque, pas la RAM.
+   drop_caches exige root ; sinon POSIX_FADV_DONTNEED fichier par fichier */
+static int vider_fichier(const char *chemin, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    if (type == FTW_F) {
+        int fd = open(chemin, O_RDONLY);
+        if (fd != -1) {
+            fdatasync(fd);
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+        }
+    }
+    return 0;
+}
+
+static void vider_cache(const char *chemin) {
+    sync();
+    int fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+    if (fd != -1) {
+        bool ok = write(fd, "1", 1) == 1;
+        close(fd);
+        if (ok) return;
+    }
+    nftw(chemin, vider_fichier, 32, FTW_PHYS);
+}
+
+static int supprimer_entree(const char *chemin, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    return type == FTW_DP ? rmdir(chemin) : unlink(chemin);
+}
+
+static void supprimer(const char *chemin) {
+    nftw(chemin, supprimer_entree, 32, FTW_DEPTH | FTW_PHYS);
+}
+
+static bool fichiers_identiques(const char *a, const char *b) {
+    int fa = open(a, O_RDONLY), fb = open(b, O_RDONLY);
+    bool egal = fa != -1 && fb != -1;
+    static char ba[1 << 16], bb[1 << 16];
+    while (egal) {
+        ssize_t na = read(fa, ba, sizeof(ba));
+        ssize_t nb = read(fb, bb, sizeof(bb));
+        if (na != nb || na < 0 || memcmp(ba, bb, (size_t)na) != 0) egal = false;
+        if (na <= 0) break;
+    }
+    if (fa != -1) close(fa);
+    if (fb != -1) close(fb);
+    return egal;
+}
+
+static long long blocs(const char *chemin) {
+    struct stat st;
+    return stat(chemin, &st) == 0 ? (long long)st.st_blocks * 512 : -1;
+}
+
+/* Source creuse : 40 % donnees, 20 % trou, 40 % donnees */
+static int creer_gros_fichier(const char *chemin, long taille_mo) {
+    int fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) return -1;
+    char *buf = malloc(TAILLE_BLOC_RW);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+    unsigned long x = 88172645463325252UL;
+    off_t taille = (off_t)taille_mo << 20;
+    for (off_t off = 0; off < taille; off += TAILLE_BLOC_RW) {
+        if (off >= taille * 4 / 10 && off < taille * 6 / 10) continue;
+        for (size_t i = 0; i < TAILLE_BLOC_RW; i += sizeof(unsigned long)) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            memcpy(buf + i, &x, sizeof(x));
+        }
+        if (pwrite(fd, buf, TAILLE_BLOC_RW, off) != TAILLE_BLOC_RW) {
+            free(buf);
+            close(fd);
+            return -1;
+        }
+    }
+    int ret = ftruncate(fd, taille);
+    free(buf);
+    close(fd);
+    return ret;
+}
+
+static int creer_arbre(const char *racine, long nb_fichiers) {
+    char chemin[PATH_MAX + 64];
+    static char contenu[16384];
+    for (size_t i = 0; i < sizeof(contenu); i++) contenu[i] = (char)('a' + i % 26);
+    if (mkdir(racine, 0755) == -1) return -1;
+    for (long i = 0; i < nb_fichiers; i++) {
+        if (i % 1000 == 0) {
+            snprintf(chemin, sizeof(chemin), "%s/d%03ld", racine, i / 1000);
+            if (mkdir(chemin, 0755) == -1) return -1;
+        }
+        snprintf(chemin, sizeof(chemin), "%s/d%03ld/f%06ld", racine, i / 1000, i);
+        int fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) return -1;
+        size_t n = 512 + (size_t)(i * 7919) % (sizeof(contenu) - 512);
+        bool ok = write(fd, contenu, n) == (ssize_t)n;
+        close(fd);
+        if (!ok) return -1;
+    }
+    return 0;
+}
+
+static long arbre_fichiers_a_verifier;
+static long arbre_differences;
+static const char *arbre_copie_racine;
+static size_t arbre_source_longueur;
+
+static int verifier_entree(const char *chemin, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)ftw;
+    if (type != FTW_F) return 0;
+    char autre[PATH_MAX];
+    snprintf(autre, sizeof(autre), "%s%s", arbre_copie_racine, chemin + arbre_source_longueur);
+    arbre_fichiers_a_verifier++;
+    if (!fichiers_identiques(chemin, autre)) arbre_differences++;
+    return 0;
+}
+
+static bool arbres_identiques(const char *source, const char *copie) {
+    arbre_fichiers_a_verifier = arbre_differences = 0;
+    arbre_copie_racine = copie;
+    arbre_source_longueur = strlen(source);
+    nftw(source, verifier_entree, 32, FTW_PHYS);
+    return arbre_differences == 0;
+}
+
+int main(int argc, char *argv[]) {
+    long taille_mo = argc > 1 ? atol(argv[1]) : 256;
+    long nb_fichiers = argc > 2 ? atol(argv[2]) : 10000;
+    long nb_coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = argc > 3 ? atoi(argv[3]) : (int)(nb_coeurs * 2 < 8 ? 8 : nb_coeurs * 2);
+    const char *rep = argc > 4 ? argv[4] : "/tmp";
+    bool ok = true;
+
+    char base[PATH_MAX / 2], src[PATH_MAX], dst[PATH_MAX];
+    snprintf(base, sizeof(base), "%s/moteur_copie_%d", rep, (int)getpid());
+    if (mkdir(base, 0755) == -1) {
+        perror("mkdir");
+        return 1;
+    }
+
+    /* --- Gros fichier creux --- */
+    snprintf(src, sizeof(src), "%s/gros.src", base);
+    snprintf(dst, sizeof(dst), "%s/gros.dst", base);
+    printf("=== Gros fichier : %ld Mo dont 20 %% de trou (%s) ===\n", taille_mo, rep);
+    if (creer_gros_fichier(src, taille_mo) == -1) {
+        perror("creation source");
+        supprimer(base);
+        return 1;
+    }
+    printf("Source : %lld Mo alloues\n\n", blocs(src) >> 20);
+    printf("%-24s %10s %10s %12s  %s\n", "Methode", "Temps (s)", "Mo/s", "Alloue (Mo)", "Verif");
+
+    for (int m = -2; m < NB_STRATEGIES; m++) {
+        copieur_t c;
+        const char *nom = m == -2 ? "boucle 8 Ko (10)" : m == -1 ? "stdio 8 Ko (10)"
+                        : noms_strategies[m];
+#ifndef AVEC_LIBURING
+        if (m == COPIE_URING) {
+            printf("%-24s %10s\n", nom, "(compiler avec -DAVEC_LIBURING -luring)");
+            continue;
+        }
+#endif
+        if (m >= 0) copieur_init(&c, (strategie_t)m, 1);
+        unlink(dst);
+        vider_cache(base);
+
+        double debut = secondes();
+        int r = m == -2 ? copy_syscall(src, dst) : m == -1 ? copy_stdio(src, dst)
+              : copieur_fichier(&c, src, dst);
+        double duree = secondes() - debut;
+
+        if (r == -1) {
+            printf("%-24s %10s (%s)\n", nom, "echec", strerror(errno));
+            if (m != COPIE_RANGE && m != COPIE_SPLICE) ok = false;   /* peuvent etre refusees */
+            continue;
+        }
+        bool egal = fichiers_identiques(src, dst);
+        /* Le moteur ne doit pas allouer le trou */
+        if (m >= 0 && blocs(dst) > blocs(src) + TAILLE_BLOC_RW) egal = false;
+        ok = ok && egal;
+        char detail[64] = "";
+        if (m == COPIE_AUTO) {
+            for (int s = COPIE_RANGE; s < NB_STRATEGIES; s++) {
+                if (atomic_load(&c.par_strategie[s])) {
+                    snprintf(detail, sizeof(detail), " -> %s", noms_strategies[s]);
+                }
+            }
+        }
+        printf("%-24s %10.3f %10.0f %12lld  %s%s\n", nom, duree, (double)taille_mo / duree,
+               blocs(dst) >> 20, egal ? "ok" : "DIFFERENT", detail);
+    }
+    unlink(src);
+    unlink(dst);
+
+    /* --- Arborescence de petits fichiers --- */
+    snprintf(src, sizeof(src), "%s/arbre.src", base);
+    printf("\n=== Arborescence : %ld fichiers de 0,5 a 16 Ko ===\n", nb_fichiers);
+    if (creer_arbre(src, nb_fichiers) == -1) {
+        perror("creation arbre");
+        supprimer(base);
+        return 1;
+    }
+    printf("%-24s %10s %12s  %s\n", "Methode", "Temps (s)", "Fichiers/s", "Verif");
+
+    int variantes[] = { 0, 1, threads };
+    for (int v = 0; v < 3; v++) {
+        char nom[48];
+        snprintf(dst, sizeof(dst), "%s/arbre.dst%d", base, v);
+        copieur_t c;
+        if (v == 0) {
+            snprintf(nom, sizeof(nom), "boucle 8 Ko (10)");
+        } else {
+            snprintf(nom, sizeof(nom), "moteur, %d thread%s", variantes[v], variantes[v] > 1 ? "s" : "");
+            copieur_init(&c, COPIE_AUTO, variantes[v]);
+        }
+        vider_cache(src);
+
+        double debut = secondes();
+        int r = v == 0 ? arbre_boucle(src, dst) : copieur_arbre(&c, src, dst);
+        double duree = secondes() - debut;
+
+        bool egal = r == 0 && arbres_identiques(src, dst) && arbre_fichiers_a_verifier == nb_fichiers;
+        ok = ok && egal;
+        printf("%-24s %10.3f %12.0f  %s\n", nom, duree, (double)nb_fichiers / duree,
+               egal ? "ok" : "DIFFERENT");
+        supprimer(dst);
+    }
+    supprimer(base);
+
+    printf("\nVerification : %s\n", ok ? "copies identiques, trous conserves par le moteur" : "ECHEC");
+    return ok ? 0 : 1;
+}
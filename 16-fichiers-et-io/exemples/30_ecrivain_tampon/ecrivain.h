@@ -0,0 +1,330 @@
+/* ============================================================================
+   Section 16.5 : I/O bufferise vs non bufferise
+   Description : Ecrivain bufferise a tampon visible (bibliotheque header-only)
+                 - reserver/valider : formater directement dans le tampon,
+                   sans copie intermediaire
+                 - ecriture vectorielle : le contenu du tampon et les gros
+                   segments de l'appelant partent en un seul writev()
+                 - taille de tampon adaptative guidee par le debit mesure
+                 - mode O_DIRECT aligne pour les grosses sorties sequentielles
+                 Destine a etre partage par loggers et exporteurs
+   Fichier source : 05-io-bufferise.md
+   ============================================================================ */
+
+#ifndef ECRIVAIN_H
+#define ECRIVAIN_H
+
+/* O_DIRECT n'est visible qu'avec _GNU_SOURCE defini avant tout include */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define ECRIVAIN_ADAPTATIF 0x1          /* capacite ajustee selon le debit */
+#define ECRIVAIN_DIRECT    0x2          /* O_DIRECT si le systeme de fichiers l'accepte */
+
+#define ECRIVAIN_CAPACITE_DEFAUT (64 * 1024)
+#define ECRIVAIN_CAPACITE_MIN    (4 * 1024)
+#define ECRIVAIN_CAPACITE_MAX    (4 * 1024 * 1024)
+#define ECRIVAIN_ALIGNEMENT      4096   /* O_DIRECT : adresse, taille, position */
+#define ECRIVAIN_FENETRE         8      /* vidages par mesure de debit */
+#define ECRIVAIN_IOV_MAX         64
+
+typedef struct {
+    int fd;
+    int options;
+    char *tampon;
+    size_t capacite;
+    size_t utilise;
+    size_t reserve;                     /* taille de la derniere reservation */
+    int erreur;                         /* errno collant de la premiere erreur */
+
+    /* Adaptation : montee de colline sur le debit par fenetre de vidages */
+    uint64_t fenetre_debut_ns;
+    uint64_t fenetre_octets;
+    int fenetre_vidages;
+    double debit_precedent;             /* octets/ns */
+    int sens;                           /* +1 grossir, -1 reduire */
+    size_t capacite_voulue;
+
+    /* Statistiques */
+    unsigned long appels_write;
+    unsigned long appels_writev;
+    unsigned long long octets;
+} ecrivain_t;
+
+static inline uint64_t ecrivain_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline char *ecrivain_allouer(size_t capacite) {
+    /* Toujours aligne : le mode direct peut etre active a l'ouverture */
+    return aligned_alloc(ECRIVAIN_ALIGNEMENT, capacite);
+}
+
+/* Prend possession de fd. capacite 0 = defaut.
+   Retour : 0, ou -1 si l'allocation echoue */
+static inline int ecrivain_init_fd(ecrivain_t *e, int fd, size_t capacite, int options) {
+    memset(e, 0, sizeof(*e));
+    if (capacite == 0) capacite = ECRIVAIN_CAPACITE_DEFAUT;
+    capacite = (capacite + ECRIVAIN_ALIGNEMENT - 1) & ~(size_t)(ECRIVAIN_ALIGNEMENT - 1);
+    e->fd = fd;
+    e->options = options;
+    e->capacite = e->capacite_voulue = capacite;
+    e->sens = 1;
+    e->tampon = ecrivain_allouer(capacite);
+    if (!e->tampon) return -1;
+    e->fenetre_debut_ns = ecrivain_ns();
+    return 0;
+}
+
+/* Ouvre (cree/tronque) chemin. ECRIVAIN_DIRECT est retire de options si
+   le systeme de fichiers refuse O_DIRECT (tmpfs...) */
+static inline int ecrivain_ouvrir(ecrivain_t *e, const char *chemin, size_t capacite, int options) {
+    int fd = -1;
+#ifdef O_DIRECT
+    if (options & ECRIVAIN_DIRECT) {
+        fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+    }
+#endif
+    if (fd == -1) {
+        options &= ~ECRIVAIN_DIRECT;
+        fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd == -1) return -1;
+    }
+    if (ecrivain_init_fd(e, fd, capacite, options) == -1) {
+        close(fd);
+        return -1;
+    }
+    return 0;
+}
+
+/* writev complet : reprend apres les ecritures partielles */
+static inline int ecrivain_writev_tout(ecrivain_t *e, struct iovec *iov, int n) {
+    while (n > 0) {
+        ssize_t w = n == 1 ? write(e->fd, iov[0].iov_base, iov[0].iov_len)
+                           : writev(e->fd, iov, n);
+        if (n == 1) e->appels_write++;
+        else e->appels_writev++;
+        if (w < 0) {
+            if (errno == EINTR) continue;
+            if (!e->erreur) e->erreur = errno;
+            return -1;
+        }
+        e->octets += (unsigned long long)w;
+        while (n > 0 && (size_t)w >= iov[0].iov_len) {
+            w -= (ssize_t)iov[0].iov_len;
+            iov++;
+            n--;
+        }
+        if (n > 0) {
+            iov[0].iov_base = (char *)iov[0].iov_base + w;
+            iov[0].iov_len -= (size_t)w;
+        }
+    }
+    return 0;
+}
+
+/* Ajuste la capacite quand le tampon est vide : on continue dans le meme
+   sens tant que le debit progresse, on repart dans l'autre sinon */
+static inline void ecrivain_adapter(ecrivain_t *e, size_t octets) {
+    e->fenetre_octets += octets;
+    if (++e->fenetre_vidages < ECRIVAIN_FENETRE) return;
+
+    uint64_t maintenant = ecrivain_ns();
+    double debit = (double)e->fenetre_octets / (double)(maintenant - e->fenetre_debut_ns + 1);
+    if (debit < e->debit_precedent * 0.95) e->sens = -e->sens;
+    e->debit_precedent = debit;
+    e->fenetre_debut_ns = maintenant;
+    e->fenetre_octets = 0;
+    e->fenetre_vidages = 0;
+
+    size_t voulue = e->sens > 0 ? e->capacite * 2 : e->capacite / 2;
+    if (voulue < ECRIVAIN_CAPACITE_MIN) voulue = ECRIVAIN_CAPACITE_MIN, e->sens = 1;
+    if (voulue > ECRIVAIN_CAPACITE_MAX) voulue = ECRIVAIN_CAPACITE_MAX, e->sens = -1;
+    e->capacite_voulue = voulue;
+}
+
+static inline void ecrivain_redimensionner(ecrivain_t *e) {
+    if (e->capacite_voulue == e->capacite || e->utilise > 0) return;
+    char *nouveau = ecrivain_allouer(e->capacite_voulue);
+    if (!nouveau) return;                   /* garder l'ancien tampon */
+    free(e->tampon);
+    e->tampon = nouveau;
+    e->capacite = e->capacite_voulue;
+}
+
+/* Vide le tampon, suivi de segments supplementaires ecrits tels quels.
+   En mode direct seuls les blocs entiers partent ; le reste (< 4 Ko)
+   est ramene en tete du tampon. */
+static inline int ecrivain_vider_avec(ecrivain_t *e, const struct iovec *extra, int nb_extra) {
+    if (e->erreur) {
+        errno = e->erreur;
+        return -1;
+    }
+    struct iovec iov[ECRIVAIN_IOV_MAX + 1];
+    int n = 0;
+    size_t a_ecrire = e->utilise;
+    if (e->options & ECRIVAIN_DIRECT) a_ecrire &= ~(size_t)(ECRIVAIN_ALIGNEMENT - 1);
+    if (a_ecrire > 0) iov[n++] = (struct iovec){ e->tampon, a_ecrire };
+
+    size_t total = a_ecrire;
+    for (int i = 0; i < nb_extra; i++) {
+        iov[n++] = extra[i];
+        total += extra[i].iov_len;
+    }
+    if (n == 0) return 0;
+
+    if (ecrivain_writev_tout(e, iov, n) == -1) {
+        errno = e->erreur;
+        return -1;
+    }
+
+    size_t reste = e->utilise - a_ecrire;
+    if (reste > 0) memmove(e->tampon, e->tampon + a_ecrire, reste);
+    e->utilise = reste;
+
+    if (e->options & ECRIVAIN_ADAPTATIF) {
+        ecrivain_adapter(e, total);
+        ecrivain_redimensionner(e);
+    }
+    return 0;
+}
+
+static inline int ecrivain_vider(ecrivain_t *e) {
+    return ecrivain_vider_avec(e, NULL, 0);
+}
+
+/* Reserve n octets contigus dans le tampon et retourne leur adresse.
+   L'appelant y ecrit puis appelle ecrivain_valider(e, m) avec m <= n.
+   NULL si n depasse la capacite (utiliser ecrivain_ecrire) ou erreur. */
+static inline char *ecrivain_reserver(ecrivain_t *e, size_t n) {
+    if (e->capacite - e->utilise < n) {
+        if (ecrivain_vider(e) == -1) return NULL;
+        if (e->capacite - e->utilise < n) {
+            /* Grossir si l'adaptation le permet, sinon refuser */
+            if (!(e->options & ECRIVAIN_ADAPTATIF) || n > ECRIVAIN_CAPACITE_MAX / 2) {
+                errno = EMSGSIZE;
+                return NULL;
+            }
+            size_t voulue = e->capacite;
+            while (voulue - e->utilise < n) voulue *= 2;
+            char *nouveau = ecrivain_allouer(voulue);
+            if (!nouveau) return NULL;
+            memcpy(nouveau, e->tampon, e->utilise);
+            free(e->tampon);
+            e->tampon = nouveau;
+            e->capacite = e->capacite_voulue = voulue;
+        }
+    }
+    e->reserve = n;
+    return e->tampon + e->utilise;
+}
+
+static inline void ecrivain_valider(ecrivain_t *e, size_t n) {
+    if (n > e->reserve) n = e->reserve;
+    e->utilise += n;
+    e->reserve = 0;
+}
+
+/* Segments de l'appelant. Les petits sont copies dans le tampon ; des
+   qu'un segment ne tient pas, le tampon et tous les segments restants
+   partent ensemble en un writev (ordre conserve, pas de copie des gros).
+   En mode direct tout passe par le tampon aligne. */
+static inline int ecrivain_ecrirev(ecrivain_t *e, const struct iovec *segments, int nb) {
+    int i = 0;
+    while (i < nb) {
+        const struct iovec *s = &segments[i];
+        if (s->iov_len <= e->capacite - e->utilise) {
+            memcpy(e->tampon + e->utilise, s->iov_base, s->iov_len);
+            e->utilise += s->iov_len;
+            i++;
+            continue;
+        }
+        if (e->options & ECRIVAIN_DIRECT) {
+            /* Remplir, vider les blocs entiers, continuer */
+            const char *p = s->iov_base;
+            size_t len = s->iov_len;
+            while (len > 0) {
+                size_t place = e->capacite - e->utilise;
+                size_t k = len < place ? len : place;
+                memcpy(e->tampon + e->utilise, p, k);
+                e->utilise += k;
+                p += k;
+                len -= k;
+                if (len > 0 && ecrivain_vider(e) == -1) return -1;
+            }
+            i++;
+            continue;
+        }
+        /* Petit segment sans place : vider puis recopier */
+        if (s->iov_len < e->capacite / 2) {
+            if (ecrivain_vider(e) == -1) return -1;
+            continue;
+        }
+        int nb_extra = nb - i < ECRIVAIN_IOV_MAX ? nb - i : ECRIVAIN_IOV_MAX;
+        if (ecrivain_vider_avec(e, &segments[i], nb_extra) == -1) return -1;
+        i += nb_extra;
+    }
+    return 0;
+}
+
+static inline int ecrivain_ecrire(ecrivain_t *e, const void *donnees, size_t n) {
+    struct iovec iov = { (void *)donnees, n };
+    return ecrivain_ecrirev(e, &iov, 1);
+}
+
+static inline int ecrivain_printf(ecrivain_t *e, const char *format, ...) {
+    size_t estime = 256;
+    for (;;) {
+        char *p = ecrivain_reserver(e, estime);
+        if (!p) return -1;
+        va_list ap;
+        va_start(ap, format);
+        int n = vsnprintf(p, estime, format, ap);
+        va_end(ap);
+        if (n < 0) return -1;
+        if ((size_t)n < estime) {
+            ecrivain_valider(e, (size_t)n);
+            return n;
+        }
+        estime = (size_t)n + 1;           /* trop court : reserver assez */
+    }
+}
+
+/* Vide tout et ferme. En mode direct la queue non alignee est ecrite
+   apres avoir retire O_DIRECT du descripteur. */
+static inline int ecrivain_fermer(ecrivain_t *e) {
+    int ret = ecrivain_vider(e);
+#ifdef O_DIRECT
+    if (ret == 0 && (e->options & ECRIVAIN_DIRECT) && e->utilise > 0) {
+        int flags = fcntl(e->fd, F_GETFL);
+        if (flags == -1 || fcntl(e->fd, F_SETFL, flags & ~O_DIRECT) == -1) {
+            ret = -1;
+        } else {
+            e->options &= ~ECRIVAIN_DIRECT;
+            ret = ecrivain_vider(e);
+        }
+    }
+#endif
+    int err = errno;
+    if (close(e->fd) == -1 && ret == 0) {
+        err = errno;
+        ret = -1;
+    }
+    free(e->tampon);
+    e->tampon = NULL;
+    errno = err;
+    return ret;
+}
+
+#endif /* ECRIVAIN_H */
@@ -0,0 +1,196 @@
+/* ============================================================================
+   Section 16.5 : I/O bufferise vs non bufferise
+   Description : Benchmark de l'ecrivain bufferise (ecrivain.h) etendant
+                 09_benchmark_io.c et 14_benchmark_buffering.c
+                 - enregistrements de 16 o a 1 Mo
+                 - write() par enregistrement, stdio, ecrivain (copie,
+                   reserver/valider, adaptatif, O_DIRECT)
+                 - debit, appels systeme, verification du contenu
+   Fichier source : 05-io-bufferise.md
+   ============================================================================ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include "ecrivain.h"
+
+#define MAX_ENREGISTREMENTS (1L << 20)   /* borne write() a 16 o */
+
+typedef enum {
+    METH_WRITE,
+    METH_STDIO,
+    METH_COPIE,
+    METH_RESERVER,
+    METH_ADAPTATIF,
+    METH_DIRECT,
+    NB_METHODES
+} methode_t;
+
+static const char *noms_methodes[NB_METHODES] = {
+    "write()", "stdio fwrite", "ecrivain copie", "reserver/valider",
+    "adaptatif", "O_DIRECT"
+};
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Enregistrement i : numero en tete puis motif dependant de i */
+static void remplir(char *p, size_t taille, long i) {
+    for (size_t k = 0; k < taille; k++) p[k] = (char)('A' + (i + (long)k) % 26);
+    if (taille >= 9) {
+        char tete[10];
+        snprintf(tete, sizeof(tete), "%08lx;", (unsigned long)i & 0xffffffffUL);
+        memcpy(p, tete, 9);
+    }
+}
+
+static uint64_t empreinte(const char *chemin, long long *taille) {
+    static char buf[1 << 16];
+    uint64_t h = 1469598103934665603ULL;
+    *taille = 0;
+    int fd = open(chemin, O_RDONLY);
+    if (fd == -1) return 0;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t k = 0; k < n; k++) h = (h ^ (unsigned char)buf[k]) * 1099511628211ULL;
+        *taille += n;
+    }
+    close(fd);
+    return h;
+}
+
+typedef struct {
+    double duree;
+    unsigned long appels;               /* 0 = inconnu (stdio) */
+    size_t capacite_finale;
+    int erreur;
+} resultat_t;
+
+static resultat_t executer(methode_t m, const char *chemin, size_t taille, long nb, char *scratch) {
+    resultat_t r = { 0 };
+    double debut = secondes();
+
+    if (m == METH_WRITE) {
+        int fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd == -1) {
+            r.erreur = errno;
+            return r;
+        }
+        for (long i = 0; i < nb; i++) {
+            remplir(scratch, taille, i);
+            if (write(fd, scratch, taille) != (ssize_t)taille) r.erreur = EIO;
+            r.appels++;
+        }
+        fsync(fd);
+        close(fd);
+    } else if (m == METH_STDIO) {
+        FILE *fp = fopen(chemin, "w");
+        if (!fp) {
+            r.erreur = errno;
+            return r;
+        }
+        for (long i = 0; i < nb; i++) {
+            remplir(scratch, taille, i);
+            if (fwrite(scratch, 1, taille, fp) != taille) r.erreur = EIO;
+        }
+        fflush(fp);
+        fsync(fileno(fp));
+        fclose(fp);
+    } else {
+        ecrivain_t e;
+        int options = m == METH_ADAPTATIF ? ECRIVAIN_ADAPTATIF
+                    : m == METH_DIRECT ? ECRIVAIN_DIRECT : 0;
+        size_t capacite = m == METH_DIRECT ? 1024 * 1024 : 0;
+        if (ecrivain_ouvrir(&e, chemin, capacite, options) == -1) {
+            r.erreur = errno;
+            return r;
+        }
+        for (long i = 0; i < nb; i++) {
+            char *p = m == METH_RESERVER ? ecrivain_reserver(&e, taille) : NULL;
+            if (p) {
+                remplir(p, taille, i);              /* formate sur place */
+                ecrivain_valider(&e, taille);
+            } else {
+                remplir(scratch, taille, i);        /* plus grand que le tampon */
+                if (ecrivain_ecrire(&e, scratch, taille) == -1) r.erreur = errno;
+            }
+        }
+        if (ecrivain_vider(&e) == -1) r.erreur = errno;
+        fsync(e.fd);
+        r.capacite_finale = e.capacite;
+        if (ecrivain_fermer(&e) == -1) r.erreur = errno;
+        r.appels = e.appels_write + e.appels_writev;   /* queue du mode direct comprise */
+    }
+    r.duree = secondes() - debut;
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    long total_mo = argc > 1 ? atol(argv[1]) : 64;
+    const char *rep = argc > 2 ? argv[2] : "/tmp";
+    if (total_mo < 1) total_mo = 1;
+
+    char chemin[4096];
+    snprintf(chemin, sizeof(chemin), "%s/ecrivain_%d.dat", rep, (int)getpid());
+    char *scratch = malloc(1024 * 1024);
+    if (!scratch) return 1;
+
+    /* Un fichier de test de la methode directe dit si O_DIRECT est accepte */
+    ecrivain_t essai;
+    if (ecrivain_ouvrir(&essai, chemin, 0, ECRIVAIN_DIRECT) == -1) {
+        perror("ouverture");
+        free(scratch);
+        return 1;
+    }
+    bool direct = (essai.options & ECRIVAIN_DIRECT) != 0;
+    ecrivain_fermer(&essai);
+
+    printf("=== Ecriture de %ld Mo par taille d'enregistrement (%s, O_DIRECT %s) ===\n\n",
+           total_mo, rep, direct ? "actif" : "refuse -> bufferise");
+    printf("%-9s %-18s %10s %10s %10s  %s\n", "Taille", "Methode", "Mo/s", "Appels", "Tampon", "Verif");
+
+    bool ok = true;
+    for (size_t taille = 16; taille <= 1024 * 1024; taille *= 4) {
+        long nb = (long)(((size_t)total_mo << 20) / taille);
+        if (nb > MAX_ENREGISTREMENTS) nb = MAX_ENREGISTREMENTS;
+        if (nb < 1) nb = 1;
+        double mo = (double)nb * (double)taille / (1024.0 * 1024.0);
+
+        uint64_t reference = 0;
+        for (int m = 0; m < NB_METHODES; m++) {
+            resultat_t r = executer((methode_t)m, chemin, taille, nb, scratch);
+            long long octets;
+            uint64_t h = empreinte(chemin, &octets);
+            if (m == 0) reference = h;
+            bool egal = r.erreur == 0 && h == reference && octets == (long long)nb * (long long)taille;
+            ok = ok && egal;
+
+            char appels[24] = "-", tampon[24] = "-";
+            if (r.appels) snprintf(appels, sizeof(appels), "%lu", r.appels);
+            if (r.capacite_finale) snprintf(tampon, sizeof(tampon), "%zu K", r.capacite_finale / 1024);
+            char etiquette[16] = "";
+            if (m == 0) {
+                if (taille < 1024) snprintf(etiquette, sizeof(etiquette), "%zu o", taille);
+                else snprintf(etiquette, sizeof(etiquette), "%zu Ko", taille / 1024);
+            }
+            printf("%-9s %-18s %10.0f %10s %10s  %s\n", etiquette, noms_methodes[m],
+                   mo / r.duree, appels, tampon, egal ? "ok" : "DIFFERENT");
+        }
+        printf("\n");
+    }
+    unlink(chemin);
+    free(scratch);
+
+    printf("Verification : %s\n", ok ? "fichiers identiques pour toutes les methodes" : "ECHEC");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,431 @@
+/* ============================================================================
+   Section 16.8 : I/O asynchrone (AIO)
+   Description : Couche d'E/S fichier asynchrones par lots (header-only)
+                 - backend io_uring par appels systeme directs (pas de
+                   liburing) : files profondes, fichiers enregistres,
+                   tampons fixes, chaines liees (IOSQE_IO_LINK),
+                   soumission et recolte par lots
+                 - backend pool de threads (pread/pwrite) de meme API,
+                   choisi quand io_uring est indisponible (noyau ancien,
+                   seccomp, kernel.io_uring_disabled)
+   Fichier source : 08-io-asynchrone.md
+   ============================================================================ */
+
+#ifndef ES_ASYNC_H
+#define ES_ASYNC_H
+
+/* syscall() n'est visible qu'avec _GNU_SOURCE defini avant tout include */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <linux/io_uring.h>
+
+#define ES_THREADS         0x1          /* forcer le pool de threads */
+#define ES_THREADS_MAX     64
+#define ES_FICHIERS_MAX    64
+
+typedef enum { ES_LIRE, ES_ECRIRE } es_op_t;
+
+typedef enum { ES_BACKEND_URING, ES_BACKEND_THREADS } es_backend_t;
+
+typedef struct es_requete {
+    es_op_t op;
+    int fichier;                        /* indice dans la table enregistree */
+    int tampon;                         /* indice de tampon fixe, -1 sinon */
+    void *buf;
+    size_t len;
+    off_t off;
+    struct es_requete *suite;           /* lancee seulement si celle-ci reussit en entier */
+    ssize_t resultat;                   /* octets, ou -errno (-ECANCELED : chaine rompue) */
+    void *donnees;                      /* libre pour l'appelant */
+    struct es_requete *file_;           /* interne : chainage des files */
+} es_requete_t;
+
+typedef struct {
+    es_backend_t backend;
+    unsigned profondeur;
+    unsigned en_vol;                    /* soumises, pas encore recoltees */
+    int fds[ES_FICHIERS_MAX];
+    int nb_fichiers;
+    bool tampons_fixes;
+
+    /* io_uring */
+    int ring_fd;
+    void *sq_map, *cq_map;
+    size_t sq_taille, cq_taille;
+    struct io_uring_sqe *sqes;
+    size_t sqes_taille;
+    unsigned *sq_tete, *sq_queue, *sq_masque, *sq_tableau;
+    unsigned *cq_tete, *cq_queue, *cq_masque;
+    struct io_uring_cqe *cqes;
+    unsigned sq_entrees;
+    unsigned sq_locale;                 /* queue locale, publiee par es_envoyer */
+    unsigned a_soumettre;
+
+    /* Pool de threads */
+    pthread_t threads[ES_THREADS_MAX];
+    int nb_threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t travail, termine;
+    es_requete_t *preparees, *preparees_fin;    /* en attente de es_envoyer */
+    es_requete_t *attente, *attente_fin;        /* tetes de chaines a executer */
+    es_requete_t *finies, *finies_fin;
+    bool arret;
+
+    /* Statistiques */
+    unsigned long appels_systeme;
+    unsigned long soumises;
+} es_async_t;
+
+/* --- io_uring : appels systeme directs --- */
+
+static inline int es_sys_setup(unsigned entrees, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entrees, p);
+}
+
+static inline int es_sys_enter(int fd, unsigned a_soumettre, unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, a_soumettre, min_complete, flags, NULL, 0);
+}
+
+static inline int es_sys_register(int fd, unsigned opcode, const void *arg, unsigned nb) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nb);
+}
+
+static inline unsigned es_charger(const unsigned *p) {
+    return atomic_load_explicit((_Atomic unsigned *)p, memory_order_acquire);
+}
+
+static inline void es_publier(unsigned *p, unsigned v) {
+    atomic_store_explicit((_Atomic unsigned *)p, v, memory_order_release);
+}
+
+static inline int es_uring_init(es_async_t *a) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    a->ring_fd = es_sys_setup(a->profondeur, &p);
+    if (a->ring_fd < 0) return -1;
+
+    a->sq_entrees = p.sq_entries;
+    a->sq_taille = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    a->cq_taille = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (a->cq_taille > a->sq_taille) a->sq_taille = a->cq_taille;
+        a->cq_taille = a->sq_taille;
+    }
+    a->sq_map = mmap(NULL, a->sq_taille, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                     a->ring_fd, IORING_OFF_SQ_RING);
+    if (a->sq_map == MAP_FAILED) goto echec;
+    a->cq_map = a->sq_map;
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        a->cq_map = mmap(NULL, a->cq_taille, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                         a->ring_fd, IORING_OFF_CQ_RING);
+        if (a->cq_map == MAP_FAILED) {
+            munmap(a->sq_map, a->sq_taille);
+            goto echec;
+        }
+    }
+    a->sqes_taille = p.sq_entries * sizeof(struct io_uring_sqe);
+    a->sqes = mmap(NULL, a->sqes_taille, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   a->ring_fd, IORING_OFF_SQES);
+    if (a->sqes == MAP_FAILED) {
+        if (a->cq_map != a->sq_map) munmap(a->cq_map, a->cq_taille);
+        munmap(a->sq_map, a->sq_taille);
+        goto echec;
+    }
+
+    char *sq = a->sq_map, *cq = a->cq_map;
+    a->sq_tete = (unsigned *)(sq + p.sq_off.head);
+    a->sq_queue = (unsigned *)(sq + p.sq_off.tail);
+    a->sq_masque = (unsigned *)(sq + p.sq_off.ring_mask);
+    a->sq_tableau = (unsigned *)(sq + p.sq_off.array);
+    a->cq_tete = (unsigned *)(cq + p.cq_off.head);
+    a->cq_queue = (unsigned *)(cq + p.cq_off.tail);
+    a->cq_masque = (unsigned *)(cq + p.cq_off.ring_mask);
+    a->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    a->sq_locale = *a->sq_queue;
+    return 0;
+
+echec:
+    close(a->ring_fd);
+    return -1;
+}
+
+static inline int es_uring_envoyer(es_async_t *a, unsigned min_complete) {
+    unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    if (a->a_soumettre == 0 && min_complete == 0) return 0;
+    es_publier(a->sq_queue, a->sq_locale);
+    for (;;) {
+        a->appels_systeme++;
+        int r = es_sys_enter(a->ring_fd, a->a_soumettre, min_complete, flags);
+        if (r >= 0) {
+            a->a_soumettre -= (unsigned)r < a->a_soumettre ? (unsigned)r : a->a_soumettre;
+            if (a->a_soumettre == 0 || min_complete) return 0;
+            continue;                   /* soumission partielle */
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EBUSY) {
+            /* CQ pleine : l'appelant doit recolter */
+            if (min_complete) return 0;
+        }
+        return -1;
+    }
+}
+
+static inline struct io_uring_sqe *es_uring_sqe(es_async_t *a) {
+    if (a->sq_locale - es_charger(a->sq_tete) == a->sq_entrees) {
+        if (es_uring_envoyer(a, 0) == -1) return NULL;
+    }
+    unsigned i = a->sq_locale & *a->sq_masque;
+    a->sq_tableau[i] = i;
+    a->sq_locale++;
+    a->a_soumettre++;
+    struct io_uring_sqe *sqe = &a->sqes[i];
+    memset(sqe, 0, sizeof(*sqe));
+    return sqe;
+}
+
+static inline int es_uring_soumettre(es_async_t *a, es_requete_t *r) {
+    for (; r; r = r->suite) {
+        struct io_uring_sqe *sqe = es_uring_sqe(a);
+        if (!sqe) return -1;
+        bool fixe = a->tampons_fixes && r->tampon >= 0;
+        if (r->op == ES_LIRE) sqe->opcode = fixe ? IORING_OP_READ_FIXED : IORING_OP_READ;
+        else sqe->opcode = fixe ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+        sqe->fd = r->fichier;                       /* indice : IOSQE_FIXED_FILE */
+        sqe->flags = IOSQE_FIXED_FILE | (r->suite ? IOSQE_IO_LINK : 0);
+        sqe->addr = (uint64_t)(uintptr_t)r->buf;
+        sqe->len = (uint32_t)r->len;
+        sqe->off = (uint64_t)r->off;
+        if (fixe) sqe->buf_index = (uint16_t)r->tampon;
+        sqe->user_data = (uint64_t)(uintptr_t)r;
+    }
+    return 0;
+}
+
+static inline int es_uring_recolter(es_async_t *a, es_requete_t **sortie, int max, int min) {
+    int n = 0;
+    for (;;) {
+        unsigned tete = *a->cq_tete;
+        unsigned queue = es_charger(a->cq_queue);
+        while (tete != queue && n < max) {
+            struct io_uring_cqe *cqe = &a->cqes[tete & *a->cq_masque];
+            es_requete_t *r = (es_requete_t *)(uintptr_t)cqe->user_data;
+            r->resultat = cqe->res;
+            sortie[n++] = r;
+            tete++;
+        }
+        es_publier(a->cq_tete, tete);               /* un seul store par lot */
+        if (n >= min || n == max) {
+            /* Sans attente, les SQE preparees partent quand meme (min == 0 :
+               scrutation) ; sinon elles partent avec l'attente ci-dessous */
+            if (es_uring_envoyer(a, 0) == -1 && n == 0) return -1;
+            return n;
+        }
+        if (es_uring_envoyer(a, (unsigned)(min - n)) == -1) return n > 0 ? n : -1;
+    }
+}
+
+/* --- Pool de threads --- */
+
+static inline void es_ajouter(es_requete_t **tete, es_requete_t **fin, es_requete_t *r) {
+    r->file_ = NULL;
+    if (*fin) (*fin)->file_ = r;
+    else *tete = r;
+    *fin = r;
+}
+
+static inline void *es_worker(void *arg) {
+    es_async_t *a = arg;
+    pthread_mutex_lock(&a->mutex);
+    for (;;) {
+        while (!a->attente && !a->arret) pthread_cond_wait(&a->travail, &a->mutex);
+        if (!a->attente) break;
+        es_requete_t *chaine = a->attente;
+        a->attente = chaine->file_;
+        if (!a->attente) a->attente_fin = NULL;
+        pthread_mutex_unlock(&a->mutex);
+
+        /* Meme semantique qu'IOSQE_IO_LINK : echec ou transfert court
+           annule la suite de la chaine */
+        bool rompue = false;
+        for (es_requete_t *r = chaine; r; r = r->suite) {
+            if (rompue) {
+                r->resultat = -ECANCELED;
+                continue;
+            }
+            int fd = a->fds[r->fichier];
+            ssize_t n;
+            do {
+                n = r->op == ES_LIRE ? pread(fd, r->buf, r->len, r->off)
+                                     : pwrite(fd, r->buf, r->len, r->off);
+            } while (n < 0 && errno == EINTR);
+            r->resultat = n < 0 ? -errno : n;
+            if (r->suite && (n < 0 || (size_t)n < r->len)) rompue = true;
+        }
+
+        pthread_mutex_lock(&a->mutex);
+        for (es_requete_t *r = chaine; r; r = r->suite) {
+            es_ajouter(&a->finies, &a->finies_fin, r);
+        }
+        pthread_cond_signal(&a->termine);
+    }
+    pthread_mutex_unlock(&a->mutex);
+    return NULL;
+}
+
+static inline int es_threads_init(es_async_t *a) {
+    pthread_mutex_init(&a->mutex, NULL);
+    pthread_cond_init(&a->travail, NULL);
+    pthread_cond_init(&a->termine, NULL);
+    int voulus = a->profondeur < ES_THREADS_MAX ? (int)a->profondeur : ES_THREADS_MAX;
+    for (; a->nb_threads < voulus; a->nb_threads++) {
+        if (pthread_create(&a->threads[a->nb_threads], NULL, es_worker, a) != 0) break;
+    }
+    return a->nb_threads > 0 ? 0 : -1;
+}
+
+static inline int es_threads_recolter(es_async_t *a, es_requete_t **sortie, int max, int min) {
+    int n = 0;
+    pthread_mutex_lock(&a->mutex);
+    for (;;) {
+        while (a->finies && n < max) {
+            es_requete_t *r = a->finies;
+            a->finies = r->file_;
+            sortie[n++] = r;
+        }
+        if (!a->finies) a->finies_fin = NULL;
+        if (n >= min || n == max) break;
+        pthread_cond_wait(&a->termine, &a->mutex);
+    }
+    pthread_mutex_unlock(&a->mutex);
+    return n;
+}
+
+/* --- API commune --- */
+
+/* profondeur : requetes en vol au plus (puissance de 2 conseillee).
+   Retour : 0, ou -1 si aucun backend n'a pu demarrer */
+static inline int es_init(es_async_t *a, unsigned profondeur, int options) {
+    memset(a, 0, sizeof(*a));
+    a->profondeur = profondeur < 1 ? 1 : profondeur;
+    a->ring_fd = -1;
+    if (!(options & ES_THREADS) && es_uring_init(a) == 0) {
+        a->backend = ES_BACKEND_URING;
+        return 0;
+    }
+    a->backend = ES_BACKEND_THREADS;
+    return es_threads_init(a);
+}
+
+static inline const char *es_nom_backend(const es_async_t *a) {
+    return a->backend == ES_BACKEND_URING ? "io_uring" : "threads";
+}
+
+/* Les requetes designent ensuite les fichiers par leur indice */
+static inline int es_enregistrer_fichiers(es_async_t *a, const int *fds, int nb) {
+    if (nb > ES_FICHIERS_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    if (a->backend == ES_BACKEND_URING
+        && es_sys_register(a->ring_fd, IORING_REGISTER_FILES, fds, (unsigned)nb) < 0) {
+        return -1;
+    }
+    memcpy(a->fds, fds, (size_t)nb * sizeof(int));
+    a->nb_fichiers = nb;
+    return 0;
+}
+
+/* Epingle les tampons une fois pour toutes (plus de get_user_pages par E/S).
+   Echec non fatal : les requetes a tampon fixe passent en READ/WRITE */
+static inline int es_enregistrer_tampons(es_async_t *a, const struct iovec *iov, int nb) {
+    if (a->backend != ES_BACKEND_URING) return 0;
+    if (es_sys_register(a->ring_fd, IORING_REGISTER_BUFFERS, iov, (unsigned)nb) < 0) return -1;
+    a->tampons_fixes = true;
+    return 0;
+}
+
+/* Prepare une requete (ou une chaine via ->suite) ; rien ne part avant
+   es_envoyer ou es_recolter. EAGAIN si la profondeur serait depassee. */
+static inline int es_soumettre(es_async_t *a, es_requete_t *r) {
+    unsigned n = 0;
+    for (es_requete_t *q = r; q; q = q->suite) n++;
+    if (a->en_vol + n > a->profondeur) {
+        errno = EAGAIN;
+        return -1;
+    }
+    if (a->backend == ES_BACKEND_URING) {
+        if (es_uring_soumettre(a, r) == -1) return -1;
+    } else {
+        pthread_mutex_lock(&a->mutex);
+        es_ajouter(&a->preparees, &a->preparees_fin, r);
+        pthread_mutex_unlock(&a->mutex);
+    }
+    a->en_vol += n;
+    a->soumises += n;
+    return 0;
+}
+
+/* Publie toutes les requetes preparees en un seul appel */
+static inline int es_envoyer(es_async_t *a) {
+    if (a->backend == ES_BACKEND_URING) return es_uring_envoyer(a, 0);
+    pthread_mutex_lock(&a->mutex);
+    if (a->preparees) {
+        if (a->attente_fin) a->attente_fin->file_ = a->preparees;
+        else a->attente = a->preparees;
+        a->attente_fin = a->preparees_fin;
+        a->preparees = a->preparees_fin = NULL;
+        pthread_cond_broadcast(&a->travail);
+    }
+    pthread_mutex_unlock(&a->mutex);
+    return 0;
+}
+
+/* Envoie ce qui est prepare, puis attend au moins min terminaisons et
+   en retourne au plus max dans sortie (chaque requete d'une chaine a la
+   sienne). Retour : nombre recolte, ou -1 */
+static inline int es_recolter(es_async_t *a, es_requete_t **sortie, int max, int min) {
+    if (min > (int)a->en_vol) min = (int)a->en_vol;
+    if (min > max) min = max;
+    int n;
+    if (a->backend == ES_BACKEND_URING) {
+        n = es_uring_recolter(a, sortie, max, min);
+    } else {
+        es_envoyer(a);
+        n = es_threads_recolter(a, sortie, max, min);
+    }
+    if (n > 0) a->en_vol -= (unsigned)n;
+    return n;
+}
+
+static inline void es_detruire(es_async_t *a) {
+    if (a->backend == ES_BACKEND_URING) {
+        munmap(a->sqes, a->sqes_taille);
+        if (a->cq_map != a->sq_map) munmap(a->cq_map, a->cq_taille);
+        munmap(a->sq_map, a->sq_taille);
+        close(a->ring_fd);
+        return;
+    }
+    pthread_mutex_lock(&a->mutex);
+    a->arret = true;
+    pthread_cond_broadcast(&a->travail);
+    pthread_mutex_unlock(&a->mutex);
+    for (int i = 0; i < a->nb_threads; i++) {
+        pthread_join(a->threads[i], NULL);
+    }
+    pthread_cond_destroy(&a->termine);
+    pthread_cond_destroy(&a->travail);
+    pthread_mutex_destroy(&a->mutex);
+}
+
+#endif /* ES_ASYNC_H */
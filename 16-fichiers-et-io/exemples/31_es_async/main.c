@@ -0,0 +1,345 @@
+/* ============================================================================
+   Section 16.8 : I/O asynchrone (AIO)
+   Description : Benchmark de la couche es_async.h contre POSIX AIO
+                 (25_aio_polling.c, 26_aio_signal.c) et io_uring a
+                 profondeur 1 (27_io_uring_basic.c)
+                 - lectures aleatoires de 4 Ko en O_DIRECT, profondeur de
+                   file 1 a 256 : io_uring, pool de threads, POSIX AIO
+                 - copie par chaines liees lecture -> ecriture sur
+                   tampons fixes, verifiee octet par octet
+   Fichier source : 08-io-asynchrone.md
+   ============================================================================ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <aio.h>
+#include <time.h>
+#include <unistd.h>
+#include "es_async.h"
+
+#define BLOC 4096
+#define PROFONDEUR_MAX 256
+#define COPIE_PROFONDEUR 32
+#define COPIE_BLOC (128 * 1024)
+
+typedef enum { METH_URING, METH_THREADS, METH_POSIX_AIO, NB_METHODES } methode_t;
+
+static const char *noms_methodes[NB_METHODES] = { "io_uring", "threads", "POSIX AIO" };
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static unsigned long long aleatoire(unsigned long long *x) {
+    *x ^= *x << 13;
+    *x ^= *x >> 7;
+    *x ^= *x << 17;
+    return *x;
+}
+
+static int creer_fichier(const char *chemin, long taille_mo) {
+    int fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) return -1;
+    char *buf = malloc(1 << 20);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+    unsigned long long x = 0x9e3779b97f4a7c15ULL;
+    for (long i = 0; i < taille_mo; i++) {
+        for (size_t k = 0; k < (1 << 20); k += 8) {
+            unsigned long long v = aleatoire(&x);
+            memcpy(buf + k, &v, 8);
+        }
+        if (write(fd, buf, 1 << 20) != 1 << 20) {
+            free(buf);
+            close(fd);
+            return -1;
+        }
+    }
+    free(buf);
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return 0;
+}
+
+typedef struct {
+    double iops;
+    double latence_us;                  /* moyenne par requete */
+    double appels_par_es;               /* io_uring_enter par E/S, -1 sans objet */
+    const char *backend;
+} mesure_t;
+
+/* Maintient profondeur lectures en vol pendant duree secondes */
+static int mesurer_es(es_async_t *a, int fd, long nb_blocs, unsigned profondeur, double duree,
+                      char *tampons, mesure_t *m) {
+    es_requete_t reqs[PROFONDEUR_MAX];
+    es_requete_t *finies[PROFONDEUR_MAX];
+    double depart[PROFONDEUR_MAX];
+    unsigned long long x = 42;
+    if (es_enregistrer_fichiers(a, &fd, 1) == -1) return -1;
+    struct iovec iov = { tampons, (size_t)profondeur * BLOC };
+    es_enregistrer_tampons(a, &iov, 1);
+
+    for (unsigned i = 0; i < profondeur; i++) {
+        reqs[i] = (es_requete_t){ .op = ES_LIRE, .fichier = 0, .tampon = 0,
+                                  .buf = tampons + (size_t)i * BLOC, .len = BLOC,
+                                  .off = (off_t)(aleatoire(&x) % (unsigned long long)nb_blocs) * BLOC,
+                                  .donnees = &depart[i] };
+        depart[i] = secondes();
+        if (es_soumettre(a, &reqs[i]) == -1) return -1;
+    }
+
+    long terminees = 0;
+    double latence = 0, debut = secondes(), fin = debut + duree;
+    for (;;) {
+        int n = es_recolter(a, finies, PROFONDEUR_MAX, 1);
+        if (n < 0) return -1;
+        double maintenant = secondes();
+        for (int k = 0; k < n; k++) {
+            es_requete_t *r = finies[k];
+            if (r->resultat != BLOC) return -1;
+            latence += maintenant - *(double *)r->donnees;
+            terminees++;
+            if (maintenant < fin) {
+                r->off = (off_t)(aleatoire(&x) % (unsigned long long)nb_blocs) * BLOC;
+                *(double *)r->donnees = maintenant;
+                if (es_soumettre(a, r) == -1) return -1;
+            }
+        }
+        if (a->en_vol == 0) break;
+    }
+    double total = secondes() - debut;
+    m->iops = (double)terminees / total;
+    m->latence_us = latence / (double)terminees * 1e6;
+    m->appels_par_es = a->backend == ES_BACKEND_URING
+                     ? (double)a->appels_systeme / (double)a->soumises : -1;
+    m->backend = es_nom_backend(a);
+    return 0;
+}
+
+/* POSIX AIO : aio_suspend sur la liste, puis balayage des terminees */
+static int mesurer_aio(int fd, long nb_blocs, unsigned profondeur, double duree,
+                       char *tampons, mesure_t *m) {
+    static struct aiocb cbs[PROFONDEUR_MAX];
+    const struct aiocb *liste[PROFONDEUR_MAX];
+    double depart[PROFONDEUR_MAX];
+    unsigned long long x = 42;
+
+    for (unsigned i = 0; i < profondeur; i++) {
+        memset(&cbs[i], 0, sizeof(cbs[i]));
+        cbs[i].aio_fildes = fd;
+        cbs[i].aio_buf = tampons + (size_t)i * BLOC;
+        cbs[i].aio_nbytes = BLOC;
+        cbs[i].aio_offset = (off_t)(aleatoire(&x) % (unsigned long long)nb_blocs) * BLOC;
+        cbs[i].aio_sigevent.sigev_notify = SIGEV_NONE;
+        depart[i] = secondes();
+        if (aio_read(&cbs[i]) == -1) return -1;
+        liste[i] = &cbs[i];
+    }
+
+    long terminees = 0;
+    unsigned actives = profondeur;
+    double latence = 0, debut = secondes(), fin = debut + duree;
+    while (actives > 0) {
+        if (aio_suspend(liste, (int)profondeur, NULL) == -1 && errno != EINTR) return -1;
+        double maintenant = secondes();
+        for (unsigned i = 0; i < profondeur; i++) {
+            if (!liste[i] || aio_error(&cbs[i]) == EINPROGRESS) continue;
+            if (aio_return(&cbs[i]) != BLOC) return -1;
+            latence += maintenant - depart[i];
+            terminees++;
+            if (maintenant < fin) {
+                cbs[i].aio_offset = (off_t)(aleatoire(&x) % (unsigned long long)nb_blocs) * BLOC;
+                depart[i] = maintenant;
+                if (aio_read(&cbs[i]) == -1) return -1;
+            } else {
+                liste[i] = NULL;        /* aio_suspend ignore les NULL */
+                actives--;
+            }
+        }
+    }
+    double total = secondes() - debut;
+    m->iops = (double)terminees / total;
+    m->latence_us = latence / (double)terminees * 1e6;
+    m->appels_par_es = -1;
+    m->backend = "glibc";
+    return 0;
+}
+
+/* Copie src -> dst par chaines liees lecture -> ecriture : l'ecriture
+   part des que la lecture se termine, sans aller-retour par l'appelant.
+   Un traitement entre les deux exigerait de relancer l'ecriture a la
+   terminaison de la lecture (une recolte de plus par morceau). */
+static int copier_chaines(int options, int src, int dst, off_t taille, const char **backend) {
+    es_async_t a;
+    if (es_init(&a, COPIE_PROFONDEUR, options) == -1) return -1;
+    *backend = es_nom_backend(&a);
+    char *tampons = aligned_alloc(BLOC, (size_t)COPIE_PROFONDEUR / 2 * COPIE_BLOC);
+    es_requete_t *reqs = calloc(COPIE_PROFONDEUR, sizeof(*reqs));
+    es_requete_t *finies[COPIE_PROFONDEUR];
+    int fds[2] = { src, dst };
+    int ret = -1;
+    if (!tampons || !reqs || es_enregistrer_fichiers(&a, fds, 2) == -1) goto fin;
+    struct iovec iov = { tampons, (size_t)COPIE_PROFONDEUR / 2 * COPIE_BLOC };
+    es_enregistrer_tampons(&a, &iov, 1);
+
+    off_t prochain = 0;
+    int chaines_actives = 0;
+    bool erreur = false;
+    /* Chaine i : reqs[2i] lecture, reqs[2i+1] ecriture du meme tampon */
+    for (int i = 0; i < COPIE_PROFONDEUR / 2 || chaines_actives > 0;) {
+        if (i < COPIE_PROFONDEUR / 2 && prochain < taille && !erreur) {
+            es_requete_t *l = &reqs[2 * i], *e = &reqs[2 * i + 1];
+            size_t len = taille - prochain < COPIE_BLOC ? (size_t)(taille - prochain) : COPIE_BLOC;
+            char *buf = tampons + (size_t)i * COPIE_BLOC;
+            *l = (es_requete_t){ .op = ES_LIRE, .fichier = 0, .tampon = 0, .buf = buf,
+                                 .len = len, .off = prochain, .suite = e };
+            *e = (es_requete_t){ .op = ES_ECRIRE, .fichier = 1, .tampon = 0, .buf = buf,
+                                 .len = len, .off = prochain, .donnees = l };
+            prochain += (off_t)len;
+            if (es_soumettre(&a, l) == -1) goto fin;
+            chaines_actives++;
+            i++;
+            continue;
+        }
+        if (chaines_actives == 0) break;
+        int n = es_recolter(&a, finies, COPIE_PROFONDEUR, 1);
+        if (n < 0) goto fin;
+        for (int k = 0; k < n; k++) {
+            es_requete_t *r = finies[k];
+            if (r->resultat < 0 || (size_t)r->resultat != r->len) erreur = true;
+            if (r->op != ES_ECRIRE) continue;
+            chaines_actives--;
+            /* Chaine terminee : relancer sur le morceau suivant */
+            if (prochain < taille && !erreur) {
+                es_requete_t *l = r->donnees;
+                size_t len = taille - prochain < COPIE_BLOC ? (size_t)(taille - prochain) : COPIE_BLOC;
+                l->len = r->len = len;
+                l->off = r->off = prochain;
+                prochain += (off_t)len;
+                if (es_soumettre(&a, l) == -1) goto fin;
+                chaines_actives++;
+            }
+        }
+    }
+    ret = erreur ? -1 : 0;
+fin:
+    es_detruire(&a);
+    free(reqs);
+    free(tampons);
+    return ret;
+}
+
+static bool identiques(const char *a, const char *b) {
+    static char ba[1 << 16], bb[1 << 16];
+    int fa = open(a, O_RDONLY), fb = open(b, O_RDONLY);
+    bool egal = fa != -1 && fb != -1;
+    while (egal) {
+        ssize_t na = read(fa, ba, sizeof(ba)), nb = read(fb, bb, sizeof(bb));
+        if (na != nb || na < 0 || memcmp(ba, bb, (size_t)na) != 0) egal = false;
+        if (na <= 0) break;
+    }
+    if (fa != -1) close(fa);
+    if (fb != -1) close(fb);
+    return egal;
+}
+
+int main(int argc, char *argv[]) {
+    long taille_mo = argc > 1 ? atol(argv[1]) : 256;
+    double duree = (argc > 2 ? atof(argv[2]) : 300) / 1000.0;
+    const char *rep = argc > 3 ? argv[3] : "/tmp";
+    if (taille_mo < 1) taille_mo = 1;
+
+    char chemin[4096], copie[4200];
+    snprintf(chemin, sizeof(chemin), "%s/es_async_%d.dat", rep, (int)getpid());
+    snprintf(copie, sizeof(copie), "%s.copie", chemin);
+    if (creer_fichier(chemin, taille_mo) == -1) {
+        perror("creation");
+        return 1;
+    }
+
+    /* O_DIRECT : mesurer le peripherique, pas le cache de page */
+    int fd = open(chemin, O_RDONLY | O_DIRECT);
+    bool direct = fd != -1;
+    if (!direct) fd = open(chemin, O_RDONLY);
+    char *tampons = aligned_alloc(BLOC, (size_t)PROFONDEUR_MAX * BLOC);
+    if (fd == -1 || !tampons) {
+        perror("open");
+        unlink(chemin);
+        return 1;
+    }
+    long nb_blocs = (taille_mo << 20) / BLOC;
+
+    es_async_t essai;
+    bool uring = es_init(&essai, 1, 0) == 0 && essai.backend == ES_BACKEND_URING;
+    es_detruire(&essai);
+
+    printf("=== Lectures aleatoires de 4 Ko sur %ld Mo (%s, %s) ===\n", taille_mo, rep,
+           direct ? "O_DIRECT" : "cache de page : O_DIRECT refuse");
+    if (!uring) printf("io_uring indisponible : repli sur le pool de threads\n");
+    printf("\n%-5s %-10s %-9s %10s %14s %14s\n", "QD", "Methode", "Backend", "IOPS",
+           "Latence (us)", "Appels/E-S");
+
+    bool ok = true;
+    for (unsigned qd = 1; qd <= PROFONDEUR_MAX; qd *= 2) {
+        for (int meth = 0; meth < NB_METHODES; meth++) {
+            if (meth == METH_URING && !uring) continue;
+            mesure_t m = { 0 };
+            int r;
+            if (meth == METH_POSIX_AIO) {
+                r = mesurer_aio(fd, nb_blocs, qd, duree, tampons, &m);
+            } else {
+                es_async_t a;
+                r = es_init(&a, qd, meth == METH_THREADS ? ES_THREADS : 0);
+                if (r == 0) {
+                    r = mesurer_es(&a, fd, nb_blocs, qd, duree, tampons, &m);
+                    es_detruire(&a);
+                }
+            }
+            if (r == -1) {
+                printf("%-5u %-10s echec (%s)\n", qd, noms_methodes[meth], strerror(errno));
+                ok = false;
+                continue;
+            }
+            char appels[24] = "-";
+            if (m.appels_par_es >= 0) snprintf(appels, sizeof(appels), "%.3f", m.appels_par_es);
+            printf("%-5u %-10s %-9s %10.0f %14.1f %14s\n", qd, meth == METH_URING || meth == METH_THREADS
+                   ? "es_async" : noms_methodes[meth], m.backend, m.iops, m.latence_us, appels);
+        }
+    }
+    close(fd);
+    free(tampons);
+
+    /* --- Chaines liees --- */
+    printf("\n=== Copie par chaines liees lecture -> ecriture (%d Ko, %d chaines) ===\n",
+           COPIE_BLOC / 1024, COPIE_PROFONDEUR / 2);
+    for (int o = 0; o < 2; o++) {
+        if (o == 0 && !uring) continue;
+        int src = open(chemin, O_RDONLY);
+        int dst = open(copie, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        const char *backend = "?";
+        double debut = secondes();
+        int r = src != -1 && dst != -1
+              ? copier_chaines(o ? ES_THREADS : 0, src, dst, (off_t)taille_mo << 20, &backend) : -1;
+        double t = secondes() - debut;
+        if (src != -1) close(src);
+        if (dst != -1) close(dst);
+        bool egal = r == 0 && identiques(chemin, copie);
+        ok = ok && egal;
+        printf("%-9s %8.0f Mo/s  %s\n", backend, (double)taille_mo / t, egal ? "copie identique" : "DIFFERENTE");
+        unlink(copie);
+    }
+    unlink(chemin);
+
+    printf("\nVerification : %s\n", ok ? "toutes les lectures completes, copies identiques" : "ECHEC");
+    return ok ? 0 : 1;
+}
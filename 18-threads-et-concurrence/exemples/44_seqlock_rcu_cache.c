@@ -0,0 +1,346 @@
+/* ============================================================================
+   Section 18.11 : Read-write locks (alternatives read-mostly)
+   Description : Cache de configuration publie par seqlock (petite config
+                 POD copiee) et par echange de pointeur facon RCU avec
+                 recuperation QSBR - les lecteurs ne font aucun RMW atomique.
+                 Benchmark du debit lecteurs de 1 a 64 threads, avec un
+                 ecrivain concurrent, contre le pthread_rwlock_t de
+                 35_rwlock_cache.c
+   Fichier source : 11-read-write-locks.md
+   ============================================================================ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LIGNE_CACHE 64
+#define MAX_LECTEURS 128
+#define DUREE_MS 200
+#define PERIODE_ECRIVAIN_US 1000
+
+/* Config de 256 octets ; controle == version si la lecture est coherente */
+typedef struct {
+    int version;
+    char texte[248];
+    int controle;
+} Config;
+
+/* ---------------------------------------------------------------------------
+   Seqlock : numero de sequence impair pendant une ecriture. Le lecteur
+   copie puis verifie que la sequence n'a pas change. Les donnees sont des
+   mots atomiques relaxed : pas de data race au sens C11.
+   --------------------------------------------------------------------------- */
+
+#define SEQLOCK_MOTS ((sizeof(Config) + 7) / 8)
+
+typedef struct {
+    _Alignas(LIGNE_CACHE) atomic_uint seq;
+    atomic_uint_least64_t mots[SEQLOCK_MOTS];
+    pthread_mutex_t ecrivains;   /* serialise les ecrivains entre eux */
+} seqlock_t;
+
+void seqlock_init(seqlock_t *sl, const Config *initiale) {
+    uint64_t tmp[SEQLOCK_MOTS] = {0};
+    memcpy(tmp, initiale, sizeof(Config));
+    atomic_init(&sl->seq, 0);
+    for (size_t i = 0; i < SEQLOCK_MOTS; i++) atomic_init(&sl->mots[i], tmp[i]);
+    pthread_mutex_init(&sl->ecrivains, NULL);
+}
+
+void seqlock_lire(seqlock_t *sl, Config *dst) {
+    uint64_t tmp[SEQLOCK_MOTS];
+    unsigned s1, s2;
+    int essais = 0;
+
+    for (;;) {
+        s1 = atomic_load_explicit(&sl->seq, memory_order_acquire);
+        if (!(s1 & 1)) {
+            for (size_t i = 0; i < SEQLOCK_MOTS; i++) {
+                tmp[i] = atomic_load_explicit(&sl->mots[i], memory_order_relaxed);
+            }
+            /* Ordonne les lectures de donnees avant la relecture de seq */
+            atomic_thread_fence(memory_order_acquire);
+            s2 = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+            if (s1 == s2) break;
+        }
+        /* Ecrivain preempte en pleine ecriture : ceder le coeur */
+        if (++essais > 100) sched_yield();
+    }
+    memcpy(dst, tmp, sizeof(Config));
+}
+
+void seqlock_ecrire(seqlock_t *sl, const Config *src) {
+    uint64_t tmp[SEQLOCK_MOTS] = {0};
+    memcpy(tmp, src, sizeof(Config));
+
+    pthread_mutex_lock(&sl->ecrivains);
+    unsigned s = atomic_load_explicit(&sl->seq, memory_order_relaxed);
+    atomic_store_explicit(&sl->seq, s + 1, memory_order_relaxed);
+    /* Le passage a impair est visible avant toute nouvelle donnee */
+    atomic_thread_fence(memory_order_release);
+    for (size_t i = 0; i < SEQLOCK_MOTS; i++) {
+        atomic_store_explicit(&sl->mots[i], tmp[i], memory_order_relaxed);
+    }
+    atomic_store_explicit(&sl->seq, s + 2, memory_order_release);
+    pthread_mutex_unlock(&sl->ecrivains);
+}
+
+/* ---------------------------------------------------------------------------
+   RCU / QSBR : les lecteurs lisent le pointeur courant sans verrou et
+   annoncent periodiquement un etat quiescent (simple store). L'ecrivain
+   publie une nouvelle copie, avance l'epoque, attend que chaque lecteur en
+   ligne ait annonce l'epoque puis libere l'ancienne copie.
+   --------------------------------------------------------------------------- */
+
+#define RCU_HORS_LIGNE UINT64_MAX
+
+typedef struct {
+    _Alignas(LIGNE_CACHE) atomic_uint_least64_t quiescent;
+} rcu_lecteur_t;
+
+typedef struct {
+    _Atomic(Config *) courante;
+    _Alignas(LIGNE_CACHE) atomic_uint_least64_t epoque;
+    rcu_lecteur_t lecteurs[MAX_LECTEURS];
+    pthread_mutex_t ecrivains;
+} rcu_t;
+
+int rcu_init(rcu_t *r, const Config *initiale) {
+    Config *c = malloc(sizeof(Config));
+    if (!c) return -1;
+    *c = *initiale;
+    atomic_init(&r->courante, c);
+    atomic_init(&r->epoque, 1);
+    for (int i = 0; i < MAX_LECTEURS; i++) {
+        atomic_init(&r->lecteurs[i].quiescent, RCU_HORS_LIGNE);
+    }
+    pthread_mutex_init(&r->ecrivains, NULL);
+    return 0;
+}
+
+void rcu_detruire(rcu_t *r) {
+    free(atomic_load(&r->courante));
+    pthread_mutex_destroy(&r->ecrivains);
+}
+
+/* Le pointeur reste valide jusqu'au prochain rcu_quiescent() du lecteur */
+static inline const Config *rcu_lire(rcu_t *r) {
+    return atomic_load_explicit(&r->courante, memory_order_acquire);
+}
+
+static inline void rcu_quiescent(rcu_t *r, int id) {
+    uint64_t e = atomic_load_explicit(&r->epoque, memory_order_acquire);
+    atomic_store_explicit(&r->lecteurs[id].quiescent, e, memory_order_release);
+}
+
+void rcu_en_ligne(rcu_t *r, int id) {
+    rcu_quiescent(r, id);
+    /* StoreLoad : l'annonce doit etre visible avant la lecture de
+       courante, sinon l'ecrivain croit ce lecteur hors ligne et libere
+       la copie qu'il s'apprete a lire (paire avec rcu_synchroniser) */
+    atomic_thread_fence(memory_order_seq_cst);
+}
+
+void rcu_hors_ligne(rcu_t *r, int id) {
+    atomic_store_explicit(&r->lecteurs[id].quiescent, RCU_HORS_LIGNE,
+                          memory_order_release);
+}
+
+/* Attend une periode de grace : tous les lecteurs ont quitte l'ancienne copie */
+static void rcu_synchroniser(rcu_t *r) {
+    uint64_t cible = atomic_fetch_add(&r->epoque, 1) + 1;
+    atomic_thread_fence(memory_order_seq_cst);  /* paire avec rcu_en_ligne */
+    for (int i = 0; i < MAX_LECTEURS; i++) {
+        while (atomic_load_explicit(&r->lecteurs[i].quiescent,
+                                    memory_order_acquire) < cible) {
+            sched_yield();
+        }
+    }
+}
+
+int rcu_publier(rcu_t *r, const Config *src) {
+    Config *nouvelle = malloc(sizeof(Config));
+    if (!nouvelle) return -1;
+    *nouvelle = *src;
+
+    pthread_mutex_lock(&r->ecrivains);
+    Config *ancienne = atomic_exchange(&r->courante, nouvelle);
+    rcu_synchroniser(r);
+    pthread_mutex_unlock(&r->ecrivains);
+
+    free(ancienne);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+   Reference : le ConfigCache de 35_rwlock_cache.c
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    Config config;
+    pthread_rwlock_t rwlock;
+} ConfigCache;
+
+/* ---------------------------------------------------------------------------
+   Benchmark
+   --------------------------------------------------------------------------- */
+
+typedef enum { METH_RWLOCK, METH_SEQLOCK, METH_RCU } methode_t;
+
+static const char *noms_methodes[] = { "rwlock", "seqlock", "rcu/qsbr" };
+
+static ConfigCache cache = { .rwlock = PTHREAD_RWLOCK_INITIALIZER };
+static seqlock_t seqlock;
+static rcu_t rcu;
+
+static methode_t methode;
+static atomic_bool arret;
+
+typedef struct {
+    _Alignas(LIGNE_CACHE) long lectures;
+    long incoherences;
+    int id;
+} resultat_lecteur_t;
+
+/* Travail du lecteur : parcourir la config (somme des octets du texte) */
+static int verifier(const Config *c) {
+    unsigned somme = 0;
+    for (size_t i = 0; i < sizeof(c->texte); i++) somme += (unsigned char)c->texte[i];
+    return c->controle == c->version && somme != 0;
+}
+
+static void *lecteur(void *arg) {
+    resultat_lecteur_t *res = arg;
+    long lectures = 0, incoherences = 0;
+    Config copie;
+
+    if (methode == METH_RCU) rcu_en_ligne(&rcu, res->id);
+
+    while (!atomic_load_explicit(&arret, memory_order_relaxed)) {
+        switch (methode) {
+        case METH_RWLOCK:
+            pthread_rwlock_rdlock(&cache.rwlock);
+            incoherences += !verifier(&cache.config);
+            pthread_rwlock_unlock(&cache.rwlock);
+            break;
+        case METH_SEQLOCK:
+            seqlock_lire(&seqlock, &copie);
+            incoherences += !verifier(&copie);
+            break;
+        case METH_RCU:
+            incoherences += !verifier(rcu_lire(&rcu));
+            rcu_quiescent(&rcu, res->id);
+            break;
+        }
+        lectures++;
+    }
+
+    if (methode == METH_RCU) rcu_hors_ligne(&rcu, res->id);
+
+    res->lectures = lectures;
+    res->incoherences = incoherences;
+    return NULL;
+}
+
+static void remplir(Config *c, int version) {
+    memset(c, 0, sizeof(*c));
+    c->version = version;
+    snprintf(c->texte, sizeof(c->texte), "nouvelle_config_%d", version);
+    c->controle = version;
+}
+
+static void *ecrivain(void *arg) {
+    long *mises_a_jour = arg;
+    Config c;
+    int version = 1;
+
+    while (!atomic_load_explicit(&arret, memory_order_relaxed)) {
+        remplir(&c, ++version);
+        switch (methode) {
+        case METH_RWLOCK:
+            pthread_rwlock_wrlock(&cache.rwlock);
+            cache.config = c;
+            pthread_rwlock_unlock(&cache.rwlock);
+            break;
+        case METH_SEQLOCK:
+            seqlock_ecrire(&seqlock, &c);
+            break;
+        case METH_RCU:
+            if (rcu_publier(&rcu, &c) != 0) return NULL;
+            break;
+        }
+        (*mises_a_jour)++;
+        usleep(PERIODE_ECRIVAIN_US);
+    }
+    return NULL;
+}
+
+static void mesurer(int nb_lecteurs) {
+    static resultat_lecteur_t res[MAX_LECTEURS];
+    pthread_t threads[MAX_LECTEURS], th_ecrivain;
+    long mises_a_jour = 0;
+
+    atomic_store(&arret, false);
+    for (int i = 0; i < nb_lecteurs; i++) {
+        res[i] = (resultat_lecteur_t){ .id = i };
+        pthread_create(&threads[i], NULL, lecteur, &res[i]);
+    }
+    pthread_create(&th_ecrivain, NULL, ecrivain, &mises_a_jour);
+
+    usleep(DUREE_MS * 1000);
+    atomic_store(&arret, true);
+
+    long total = 0, incoherences = 0;
+    for (int i = 0; i < nb_lecteurs; i++) {
+        pthread_join(threads[i], NULL);
+        total += res[i].lectures;
+        incoherences += res[i].incoherences;
+    }
+    pthread_join(th_ecrivain, NULL);
+
+    printf("%-10s %8d %16.1f %10ld %12ld\n", noms_methodes[methode], nb_lecteurs,
+           (double)total / (DUREE_MS / 1000.0) / 1e6, mises_a_jour, incoherences);
+}
+
+int main(int argc, char *argv[]) {
+    int max_lecteurs = argc > 1 ? atoi(argv[1]) : 64;
+    if (max_lecteurs < 1) max_lecteurs = 1;
+    if (max_lecteurs > MAX_LECTEURS) max_lecteurs = MAX_LECTEURS;
+
+    Config initiale;
+    remplir(&initiale, 1);
+    cache.config = initiale;
+    seqlock_init(&seqlock, &initiale);
+    if (rcu_init(&rcu, &initiale) != 0) {
+        fprintf(stderr, "Erreur allocation\n");
+        return 1;
+    }
+
+    printf("=== Cache de configuration read-mostly ===\n");
+    printf("(ecrivain toutes les %d us, %d ms par mesure)\n\n",
+           PERIODE_ECRIVAIN_US, DUREE_MS);
+    printf("%-10s %8s %16s %10s %12s\n",
+           "Methode", "Lecteurs", "Mlectures/s", "Ecritures", "Incoherences");
+
+    for (int m = METH_RWLOCK; m <= METH_RCU; m++) {
+        methode = (methode_t)m;
+        for (int n = 1; n <= max_lecteurs; n *= 2) {
+            mesurer(n);
+        }
+        printf("\n");
+    }
+
+    rcu_detruire(&rcu);
+    pthread_rwlock_destroy(&cache.rwlock);
+    pthread_mutex_destroy(&seqlock.ecrivains);
+    return 0;
+}
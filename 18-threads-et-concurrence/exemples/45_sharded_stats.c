@@ -0,0 +1,319 @@
+/* ============================================================================
+   Section 18.10.6 : Performance et cas d'usage
+   Description : Module de statistiques shardees - compteurs nommes et
+                 histogrammes dans des slabs alignes sur une ligne de cache,
+                 un slab par thread (_Thread_local, aucun RMW) ou par CPU
+                 (sched_getcpu, accelere par rseq sur glibc >= 2.35), fusion
+                 paresseuse a la lecture. Benchmark de passage a l'echelle
+                 contre l'histogramme atomique partage de 33_atomic_histogram.c
+   Fichier source : 10.6-performance-cas-usage.md
+   ============================================================================ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LIGNE_CACHE 64
+#define STATS_MAX_COMPTEURS 64
+#define STATS_NOM_MAX 32
+
+#define NB_BUCKETS 10
+#define NB_VALEURS 2000000
+#define MAX_THREADS 256
+
+/* ---------------------------------------------------------------------------
+   API
+   --------------------------------------------------------------------------- */
+
+typedef enum { STATS_PAR_THREAD, STATS_PAR_CPU } stats_mode_t;
+
+/* Un slab = les compteurs d'un thread (ou d'un CPU), jamais partage en
+   ecriture avec un autre slab : pas de faux partage */
+typedef struct slab {
+    _Alignas(LIGNE_CACHE) atomic_uint_least64_t valeurs[STATS_MAX_COMPTEURS];
+    pthread_t proprietaire;
+    struct slab *suivant;
+} slab_t;
+
+typedef struct {
+    unsigned long id;                      /* unique, cle du cache TLS */
+    stats_mode_t mode;
+    pthread_mutex_t mutex;                 /* enregistrements uniquement */
+    int nb_compteurs;
+    char noms[STATS_MAX_COMPTEURS][STATS_NOM_MAX];
+    slab_t *slabs;                         /* liste des slabs par thread */
+    slab_t *slabs_cpu;                     /* tableau [nb_cpus] */
+    int nb_cpus;
+} stats_t;
+
+/* Cache TLS : slab du thread courant pour le dernier registre utilise */
+static _Thread_local slab_t *slab_local;
+static _Thread_local unsigned long slab_registre;
+
+static atomic_ulong prochain_id = 1;
+
+stats_t *stats_creer(stats_mode_t mode) {
+    stats_t *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->id = atomic_fetch_add(&prochain_id, 1);
+    s->mode = mode;
+    pthread_mutex_init(&s->mutex, NULL);
+
+    if (mode == STATS_PAR_CPU) {
+        long n = sysconf(_SC_NPROCESSORS_CONF);
+        s->nb_cpus = n > 0 ? (int)n : 1;
+        s->slabs_cpu = aligned_alloc(LIGNE_CACHE,
+                                     (size_t)s->nb_cpus * sizeof(slab_t));
+        if (!s->slabs_cpu) {
+            free(s);
+            return NULL;
+        }
+        memset(s->slabs_cpu, 0, (size_t)s->nb_cpus * sizeof(slab_t));
+    }
+    return s;
+}
+
+void stats_detruire(stats_t *s) {
+    if (!s) return;
+    slab_t *sl = s->slabs;
+    while (sl) {
+        slab_t *suivant = sl->suivant;
+        free(sl);
+        sl = suivant;
+    }
+    free(s->slabs_cpu);
+    pthread_mutex_destroy(&s->mutex);
+    free(s);
+}
+
+/* Enregistre nb compteurs consecutifs (nb > 1 : histogramme).
+   Retourne l'identifiant du premier, ou -1 si le registre est plein */
+int stats_enregistrer(stats_t *s, const char *nom, int nb) {
+    pthread_mutex_lock(&s->mutex);
+    int id = s->nb_compteurs;
+    if (nb < 1 || id + nb > STATS_MAX_COMPTEURS) {
+        pthread_mutex_unlock(&s->mutex);
+        return -1;
+    }
+    for (int i = 0; i < nb; i++) {
+        if (nb == 1) snprintf(s->noms[id], STATS_NOM_MAX, "%s", nom);
+        else snprintf(s->noms[id + i], STATS_NOM_MAX, "%.20s[%d]", nom, i % STATS_MAX_COMPTEURS);
+    }
+    s->nb_compteurs += nb;
+    pthread_mutex_unlock(&s->mutex);
+    return id;
+}
+
+/* Chemin lent : defaut du cache TLS, recherche ou creation du slab.
+   Un pthread_t recycle reprend le slab d'un thread termine : sans risque,
+   il n'y a toujours qu'un ecrivain a la fois */
+static slab_t *slab_thread(stats_t *s) {
+    pthread_t moi = pthread_self();
+    slab_t *sl;
+
+    pthread_mutex_lock(&s->mutex);
+    for (sl = s->slabs; sl; sl = sl->suivant) {
+        if (pthread_equal(sl->proprietaire, moi)) break;
+    }
+    if (!sl) {
+        sl = aligned_alloc(LIGNE_CACHE, sizeof(slab_t));
+        if (sl) {
+            memset(sl, 0, sizeof(*sl));
+            sl->proprietaire = moi;
+            sl->suivant = s->slabs;
+            s->slabs = sl;
+        }
+    }
+    pthread_mutex_unlock(&s->mutex);
+
+    if (sl) {
+        slab_local = sl;
+        slab_registre = s->id;
+    }
+    return sl;
+}
+
+static inline void stats_ajouter(stats_t *s, int id, uint64_t n) {
+    if (s->mode == STATS_PAR_CPU) {
+        /* Deux threads peuvent partager un CPU (preemption) : RMW relaxed,
+           mais sur une ligne que seul ce CPU modifie en pratique */
+        int cpu = sched_getcpu();
+        if (cpu < 0 || cpu >= s->nb_cpus) cpu = 0;
+        atomic_fetch_add_explicit(&s->slabs_cpu[cpu].valeurs[id], n,
+                                  memory_order_relaxed);
+        return;
+    }
+
+    slab_t *sl = slab_registre == s->id ? slab_local : slab_thread(s);
+    if (!sl) return;
+    /* Ecrivain unique : load + store relaxed, pas d'instruction lock */
+    atomic_uint_least64_t *c = &sl->valeurs[id];
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + n,
+                          memory_order_relaxed);
+}
+
+/* Fusion a la lecture : somme du compteur sur tous les slabs */
+uint64_t stats_lire(stats_t *s, int id) {
+    uint64_t total = 0;
+    if (s->mode == STATS_PAR_CPU) {
+        for (int c = 0; c < s->nb_cpus; c++) {
+            total += atomic_load_explicit(&s->slabs_cpu[c].valeurs[id],
+                                          memory_order_relaxed);
+        }
+        return total;
+    }
+    pthread_mutex_lock(&s->mutex);
+    for (slab_t *sl = s->slabs; sl; sl = sl->suivant) {
+        total += atomic_load_explicit(&sl->valeurs[id], memory_order_relaxed);
+    }
+    pthread_mutex_unlock(&s->mutex);
+    return total;
+}
+
+/* Instantane de tous les compteurs (non atomique entre compteurs) */
+int stats_snapshot(stats_t *s, uint64_t *valeurs) {
+    int n = s->nb_compteurs;
+    for (int i = 0; i < n; i++) valeurs[i] = stats_lire(s, i);
+    return n;
+}
+
+/* ---------------------------------------------------------------------------
+   Benchmark
+   --------------------------------------------------------------------------- */
+
+typedef enum { PARTAGE, PARTAGE_ALIGNE, SHARD_THREAD, SHARD_CPU, NB_METHODES } methode_t;
+
+static const char *noms_methodes[NB_METHODES] = {
+    "atomique partage", "atomique aligne", "shard/thread", "shard/cpu"
+};
+
+/* 33_atomic_histogram.c : 10 atomic_int sur une ou deux lignes de cache */
+static atomic_int histogramme[NB_BUCKETS];
+
+/* Variante un bucket par ligne : plus de faux partage, mais toujours
+   un vrai partage entre threads */
+typedef struct {
+    _Alignas(LIGNE_CACHE) atomic_long valeur;
+} bucket_aligne_t;
+static bucket_aligne_t histogramme_aligne[NB_BUCKETS];
+
+static stats_t *stats;
+static int histo_id;
+static methode_t methode;
+
+static void *generer_valeurs(void *arg) {
+    unsigned int seed = (unsigned int)(uintptr_t)arg;
+
+    for (int i = 0; i < NB_VALEURS; i++) {
+        int bucket = (int)(rand_r(&seed) % NB_BUCKETS);
+        switch (methode) {
+        case PARTAGE:
+            atomic_fetch_add(&histogramme[bucket], 1);
+            break;
+        case PARTAGE_ALIGNE:
+            atomic_fetch_add(&histogramme_aligne[bucket].valeur, 1);
+            break;
+        default:
+            stats_ajouter(stats, histo_id + bucket, 1);
+            break;
+        }
+    }
+    return NULL;
+}
+
+static double mesurer(int nb_threads, long *total) {
+    pthread_t threads[MAX_THREADS];
+    struct timespec debut, fin;
+
+    for (int i = 0; i < NB_BUCKETS; i++) {
+        atomic_store(&histogramme[i], 0);
+        atomic_store(&histogramme_aligne[i].valeur, 0);
+    }
+    if (methode == SHARD_THREAD || methode == SHARD_CPU) {
+        stats = stats_creer(methode == SHARD_CPU ? STATS_PAR_CPU : STATS_PAR_THREAD);
+        if (!stats) return -1.0;
+        stats_enregistrer(stats, "valeurs_generees", 1);
+        histo_id = stats_enregistrer(stats, "histogramme", NB_BUCKETS);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &debut);
+    for (int i = 0; i < nb_threads; i++) {
+        pthread_create(&threads[i], NULL, generer_valeurs, (void *)(uintptr_t)(i + 1));
+    }
+    for (int i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+
+    *total = 0;
+    for (int b = 0; b < NB_BUCKETS; b++) {
+        switch (methode) {
+        case PARTAGE:        *total += atomic_load(&histogramme[b]); break;
+        case PARTAGE_ALIGNE: *total += atomic_load(&histogramme_aligne[b].valeur); break;
+        default:             *total += (long)stats_lire(stats, histo_id + b); break;
+        }
+    }
+    if (stats) {
+        stats_detruire(stats);
+        stats = NULL;
+    }
+
+    return (double)(fin.tv_sec - debut.tv_sec) +
+           (double)(fin.tv_nsec - debut.tv_nsec) / 1e9;
+}
+
+int main(int argc, char *argv[]) {
+    long nb_coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = argc > 1 ? atoi(argv[1]) : (int)(nb_coeurs > 0 ? nb_coeurs : 1) * 2;
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+    printf("=== Histogramme concurrent : partage vs shard ===\n");
+    printf("(%d valeurs/thread, %d buckets, %ld coeurs)\n\n",
+           NB_VALEURS, NB_BUCKETS, nb_coeurs);
+    printf("%-18s %8s %12s %10s\n", "Methode", "Threads", "Mops/s", "Total");
+
+    int erreurs = 0;
+    for (int m = 0; m < NB_METHODES; m++) {
+        methode = (methode_t)m;
+        for (int n = 1; n <= max_threads; n *= 2) {
+            long total;
+            double duree = mesurer(n, &total);
+            if (duree < 0) {
+                fprintf(stderr, "Erreur allocation\n");
+                return 1;
+            }
+            int ok = total == (long)n * NB_VALEURS;
+            erreurs += !ok;
+            printf("%-18s %8d %12.1f %10ld%s\n", noms_methodes[m], n,
+                   (double)n * NB_VALEURS / duree / 1e6, total,
+                   ok ? "" : "  ERREUR");
+        }
+        printf("\n");
+    }
+
+    /* Demonstration des compteurs nommes et de l'instantane */
+    stats_t *demo = stats_creer(STATS_PAR_THREAD);
+    if (!demo) return 1;
+    int req = stats_enregistrer(demo, "requetes", 1);
+    int oct = stats_enregistrer(demo, "octets", 1);
+    stats_ajouter(demo, req, 3);
+    stats_ajouter(demo, oct, 4096);
+    uint64_t valeurs[STATS_MAX_COMPTEURS];
+    int n = stats_snapshot(demo, valeurs);
+    printf("Instantane :");
+    for (int i = 0; i < n; i++) printf(" %s=%llu", demo->noms[i], (unsigned long long)valeurs[i]);
+    printf("\n");
+    stats_detruire(demo);
+
+    printf("Verification : %s\n", erreurs == 0 ? "totaux corrects" : "ECHEC");
+    return erreurs == 0 ? 0 : 1;
+}
@@ -0,0 +1,507 @@
+/* ============================================================================
+   Section 18.13 : Barrieres de threads
+   Description : Moteur de stencil parallele pour la simulation de
+                 42_barrier_simulation.c (moyenne 3x3 des voisins)
+                 - double tampon echange par pointeur : plus de recopie ni
+                   de seconde barriere par iteration
+                 - grille allouee dynamiquement avec halo de zeros et poids
+                   precalcules : noyau sans branche, vectorise par GCC
+                 - tuiles dimensionnees sur le L2 avec halo de PROFONDEUR
+                   cellules : plusieurs pas de temps par chargement
+                 - barriere a inversion de sens, attente active puis futex
+                 Benchmark du debit (points/s) jusqu'a 16384 x 16384
+   Fichier source : 13-barrieres-threads.md
+   ============================================================================ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <limits.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define LIGNE_CACHE 64
+#define MAX_THREADS 256
+#define PROFONDEUR 4              /* pas de temps par chargement de tuile */
+#define TUILE_COLS 256            /* 3 lignes de tuile tiennent dans le L1 */
+#define ATTENTE_ACTIVE 4000       /* tours de spin avant de dormir */
+#define POINTS_PAR_MESURE (1L << 27)
+#define L2_DEFAUT (1024 * 1024)
+
+/* ---------------------------------------------------------------------------
+   Barriere a inversion de sens (spin puis futex)
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    _Alignas(LIGNE_CACHE) atomic_int restants;
+    atomic_int endormis;
+    _Alignas(LIGNE_CACHE) atomic_int sens;    /* seul mot observe en attente */
+    int nb;
+} barriere_t;
+
+static void barriere_init(barriere_t *b, int nb) {
+    atomic_init(&b->restants, nb);
+    atomic_init(&b->endormis, 0);
+    atomic_init(&b->sens, 0);
+    b->nb = nb;
+}
+
+static long futex(atomic_int *adresse, int op, int valeur) {
+    return syscall(SYS_futex, (int *)adresse, op, valeur, NULL, NULL, 0);
+}
+
+static inline void pause_cpu(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Chaque thread garde son propre sens : le dernier arrive inverse le sens
+   partage, ce qui libere tout le monde en une seule ecriture. Retourne 1
+   pour le dernier arrive (comme PTHREAD_BARRIER_SERIAL_THREAD) */
+static int barriere_attendre(barriere_t *b, int *sens_local) {
+    int sens = !*sens_local;
+    *sens_local = sens;
+
+    if (atomic_fetch_sub_explicit(&b->restants, 1, memory_order_acq_rel) == 1) {
+        atomic_store_explicit(&b->restants, b->nb, memory_order_relaxed);
+        /* seq_cst : soit l'endormi voit le nouveau sens, soit on le voit */
+        atomic_store(&b->sens, sens);
+        if (atomic_load(&b->endormis) > 0) {
+            futex(&b->sens, FUTEX_WAKE_PRIVATE, INT_MAX);
+        }
+        return 1;
+    }
+
+    for (int i = 0; i < ATTENTE_ACTIVE; i++) {
+        if (atomic_load_explicit(&b->sens, memory_order_acquire) == sens) return 0;
+        pause_cpu();
+    }
+
+    /* Plus de coeurs que de threads prets (ou desequilibre) : dormir */
+    atomic_fetch_add(&b->endormis, 1);
+    while (atomic_load(&b->sens) != sens) {
+        futex(&b->sens, FUTEX_WAIT_PRIVATE, !sens);
+    }
+    atomic_fetch_sub(&b->endormis, 1);
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+   Grille avec halo
+   --------------------------------------------------------------------------- */
+
+/* (n + 2) lignes de 'pas' doubles. La colonne 0 est alignee sur 64 octets,
+   le halo est en colonne -1 et n, les lignes -1 et n : toujours nuls */
+typedef struct {
+    int n;
+    size_t pas;
+    double *cellules;
+} grille_t;
+
+static int grille_creer(grille_t *g, int n) {
+    g->n = n;
+    g->pas = 8 + (((size_t)n + 1 + 7) & ~(size_t)7);
+    /* Pas de memset : chaque thread touche ses propres lignes (first touch) */
+    g->cellules = aligned_alloc(LIGNE_CACHE, (size_t)(n + 2) * g->pas * sizeof(double));
+    return g->cellules ? 0 : -1;
+}
+
+static void grille_liberer(grille_t *g) {
+    free(g->cellules);
+    g->cellules = NULL;
+}
+
+/* Ligne i (de -1 a n), pointee sur la colonne 0 */
+static inline double *grille_ligne(const grille_t *g, int i) {
+    return g->cellules + (size_t)(i + 1) * g->pas + 8;
+}
+
+/* Valeur initiale deterministe : calculable par n'importe quel thread */
+static inline double valeur_initiale(int i, int j) {
+    uint32_t x = (uint32_t)i * 2654435761u ^ (uint32_t)j * 2246822519u;
+    x ^= x >> 15;
+    x *= 2654435761u;
+    x ^= x >> 13;
+    return (double)(x % 10000) / 100.0;
+}
+
+/* Lignes [debut, fin) des deux grilles, halos compris */
+static void grille_initialiser(grille_t *g, grille_t *h, int debut, int fin) {
+    int n = g->n;
+    if (debut == 0) debut = -1;
+    if (fin == n) fin = n + 1;
+    for (int i = debut; i < fin; i++) {
+        double *lg = grille_ligne(g, i) - 8;
+        double *lh = grille_ligne(h, i) - 8;
+        memset(lg, 0, g->pas * sizeof(double));
+        memset(lh, 0, h->pas * sizeof(double));
+        if (i < 0 || i >= n) continue;
+        for (int j = 0; j < n; j++) lg[8 + j] = valeur_initiale(i, j);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   Noyaux
+   --------------------------------------------------------------------------- */
+
+/* 42_barrier_simulation.c : test de bornes sur chaque voisin */
+static double calculer_moyenne(const grille_t *g, int i, int j) {
+    double somme = 0.0;
+    int count = 0;
+
+    for (int di = -1; di <= 1; di++) {
+        for (int dj = -1; dj <= 1; dj++) {
+            int ni = i + di;
+            int nj = j + dj;
+
+            if (ni >= 0 && ni < g->n && nj >= 0 && nj < g->n) {
+                somme += grille_ligne(g, ni)[nj];
+                count++;
+            }
+        }
+    }
+
+    return somme / count;
+}
+
+/* Une ligne de stencil sans aucune condition : les voisins hors grille
+   valent 0 (halo) et poids[j] = 1 / nombre de voisins reels. Meme ordre
+   d'addition que calculer_moyenne(). GCC vectorise la boucle (-O3) */
+static void noyau_ligne(double *restrict dst, const double *restrict haut,
+                        const double *restrict milieu, const double *restrict bas,
+                        const double *restrict poids, int nb) {
+    for (int j = 0; j < nb; j++) {
+        double somme = haut[j - 1] + haut[j] + haut[j + 1]
+                     + milieu[j - 1] + milieu[j] + milieu[j + 1]
+                     + bas[j - 1] + bas[j] + bas[j + 1];
+        dst[j] = somme * poids[j];
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   Moteur
+   --------------------------------------------------------------------------- */
+
+typedef enum { METH_NAIF, METH_DOUBLE_TAMPON, METH_TUILES, NB_METHODES } methode_t;
+
+static const char *noms_methodes[NB_METHODES] = {
+    "42 (copie, 2 barr.)", "double tampon", "tuiles temporelles"
+};
+
+typedef struct {
+    methode_t methode;
+    int nb_threads;
+    int iterations;
+    grille_t grilles[2];
+    double *poids_interieur;      /* lignes 1..n-2 : 1 / (3 * voisins colonne) */
+    double *poids_bord;           /* lignes 0 et n-1 : 1 / (2 * voisins colonne) */
+    int tuile_lignes;             /* hauteur des tuiles, selon le L2 */
+    barriere_t barriere;
+    pthread_barrier_t barriere_posix;
+    struct timespec debut, fin;
+    const grille_t *resultat;
+} moteur_t;
+
+typedef struct {
+    moteur_t *m;
+    int id;
+} contexte_t;
+
+static inline const double *poids_ligne(const moteur_t *m, int i) {
+    return (i == 0 || i == m->grilles[0].n - 1) ? m->poids_bord : m->poids_interieur;
+}
+
+/* Une iteration, bandes de colonnes de TUILE_COLS pour rester dans le L1 */
+static void pas_direct(const moteur_t *m, const grille_t *src, const grille_t *dst,
+                       int debut, int fin) {
+    int n = src->n;
+    for (int j0 = 0; j0 < n; j0 += TUILE_COLS) {
+        int nb = n - j0 < TUILE_COLS ? n - j0 : TUILE_COLS;
+        for (int i = debut; i < fin; i++) {
+            noyau_ligne(grille_ligne(dst, i) + j0,
+                        grille_ligne(src, i - 1) + j0,
+                        grille_ligne(src, i) + j0,
+                        grille_ligne(src, i + 1) + j0,
+                        poids_ligne(m, i) + j0, nb);
+        }
+    }
+}
+
+/* Blocage temporel : la tuile [i0, i0+h) x [j0, j0+w) est chargee avec un
+   halo de p cellules dans deux tampons prives (taille du L2), avance de p
+   pas en reduisant la zone valide d'une cellule par pas, puis seul son
+   interieur est ecrit dans dst. Les cellules hors grille restent nulles */
+static void tuile_temporelle(const moteur_t *m, const grille_t *src, const grille_t *dst,
+                             double *a, double *b, size_t lpas,
+                             int i0, int h, int j0, int w, int p) {
+    int n = src->n;
+    int hh = h + 2 * p, ww = w + 2 * p;
+    int c_debut = p - j0 > 0 ? p - j0 : 0;
+    int c_fin = n - j0 + p < ww ? n - j0 + p : ww;
+
+    for (int r = 0; r < hh; r++) {
+        int gi = i0 - p + r;
+        double *la = a + (size_t)r * lpas, *lb = b + (size_t)r * lpas;
+        if (gi < 0 || gi >= n) {
+            memset(la, 0, (size_t)ww * sizeof(double));
+            memset(lb, 0, (size_t)ww * sizeof(double));
+            continue;
+        }
+        memset(la, 0, (size_t)c_debut * sizeof(double));
+        memset(lb, 0, (size_t)c_debut * sizeof(double));
+        memcpy(la + c_debut, grille_ligne(src, gi) + j0 - p + c_debut,
+               (size_t)(c_fin - c_debut) * sizeof(double));
+        memset(la + c_fin, 0, (size_t)(ww - c_fin) * sizeof(double));
+        memset(lb + c_fin, 0, (size_t)(ww - c_fin) * sizeof(double));
+    }
+
+    int r_min = p - i0 > 0 ? p - i0 : 0;
+    int r_max = n - i0 + p < hh ? n - i0 + p : hh;
+    for (int k = 1; k <= p; k++) {
+        int rd = r_min > k ? r_min : k, rf = r_max < hh - k ? r_max : hh - k;
+        int cd = c_debut > k ? c_debut : k, cf = c_fin < ww - k ? c_fin : ww - k;
+        for (int r = rd; r < rf; r++) {
+            noyau_ligne(b + (size_t)r * lpas + cd,
+                        a + (size_t)(r - 1) * lpas + cd,
+                        a + (size_t)r * lpas + cd,
+                        a + (size_t)(r + 1) * lpas + cd,
+                        poids_ligne(m, i0 - p + r) + j0 - p + cd, cf - cd);
+        }
+        double *t = a;
+        a = b;
+        b = t;
+    }
+
+    for (int r = 0; r < h; r++) {
+        memcpy(grille_ligne(dst, i0 + r) + j0, a + (size_t)(r + p) * lpas + p,
+               (size_t)w * sizeof(double));
+    }
+}
+
+static void pas_tuiles(const moteur_t *m, const grille_t *src, const grille_t *dst,
+                       double *a, double *b, size_t lpas, int debut, int fin, int p) {
+    int n = src->n;
+    for (int i0 = debut; i0 < fin; i0 += m->tuile_lignes) {
+        int h = fin - i0 < m->tuile_lignes ? fin - i0 : m->tuile_lignes;
+        for (int j0 = 0; j0 < n; j0 += TUILE_COLS) {
+            int w = n - j0 < TUILE_COLS ? n - j0 : TUILE_COLS;
+            tuile_temporelle(m, src, dst, a, b, lpas, i0, h, j0, w, p);
+        }
+    }
+}
+
+static void *simuler_region(void *arg) {
+    contexte_t *ctx = arg;
+    moteur_t *m = ctx->m;
+    int n = m->grilles[0].n;
+    int debut = (int)((long)n * ctx->id / m->nb_threads);
+    int fin = (int)((long)n * (ctx->id + 1) / m->nb_threads);
+    int sens = 0;
+
+    grille_initialiser(&m->grilles[0], &m->grilles[1], debut, fin);
+
+    /* Tampons prives des tuiles temporelles */
+    size_t lpas = ((size_t)TUILE_COLS + 2 * PROFONDEUR + 7) & ~(size_t)7;
+    size_t taille = (size_t)(m->tuile_lignes + 2 * PROFONDEUR) * lpas * sizeof(double);
+    double *a = NULL, *b = NULL;
+    if (m->methode == METH_TUILES) {
+        a = aligned_alloc(LIGNE_CACHE, taille);
+        b = aligned_alloc(LIGNE_CACHE, taille);
+        if (!a || !b) {
+            fprintf(stderr, "Erreur allocation tuiles\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (barriere_attendre(&m->barriere, &sens)) clock_gettime(CLOCK_MONOTONIC, &m->debut);
+
+    const grille_t *src = &m->grilles[0], *dst = &m->grilles[1];
+    int restant = m->iterations;
+    while (restant > 0) {
+        int p = 1;
+        switch (m->methode) {
+        case METH_NAIF:
+            for (int i = debut; i < fin; i++) {
+                for (int j = 0; j < n; j++) {
+                    grille_ligne(dst, i)[j] = calculer_moyenne(src, i, j);
+                }
+            }
+            pthread_barrier_wait(&m->barriere_posix);
+            for (int i = debut; i < fin; i++) {
+                memcpy(grille_ligne(src, i), grille_ligne(dst, i), (size_t)n * sizeof(double));
+            }
+            pthread_barrier_wait(&m->barriere_posix);
+            break;
+        case METH_DOUBLE_TAMPON:
+            pas_direct(m, src, dst, debut, fin);
+            break;
+        default:
+            p = restant < PROFONDEUR ? restant : PROFONDEUR;
+            pas_tuiles(m, src, dst, a, b, lpas, debut, fin, p);
+            break;
+        }
+        restant -= p;
+
+        if (m->methode != METH_NAIF) {
+            barriere_attendre(&m->barriere, &sens);
+            const grille_t *t = src;
+            src = dst;
+            dst = t;
+        }
+    }
+
+    if (barriere_attendre(&m->barriere, &sens)) {
+        clock_gettime(CLOCK_MONOTONIC, &m->fin);
+        m->resultat = src;
+    }
+    free(a);
+    free(b);
+    return NULL;
+}
+
+static int moteur_creer(moteur_t *m, int n, long l2) {
+    memset(m, 0, sizeof(*m));
+    if (grille_creer(&m->grilles[0], n) != 0 || grille_creer(&m->grilles[1], n) != 0) {
+        return -1;
+    }
+    size_t taille = (((size_t)n * sizeof(double)) + LIGNE_CACHE - 1) & ~(size_t)(LIGNE_CACHE - 1);
+    m->poids_interieur = aligned_alloc(LIGNE_CACHE, taille);
+    m->poids_bord = aligned_alloc(LIGNE_CACHE, taille);
+    if (!m->poids_interieur || !m->poids_bord) return -1;
+    for (int j = 0; j < n; j++) {
+        int colonnes = (j == 0 || j == n - 1) ? 2 : 3;
+        m->poids_interieur[j] = 1.0 / (3 * colonnes);
+        m->poids_bord[j] = 1.0 / (2 * colonnes);
+    }
+
+    /* Deux tampons de tuile (halo compris) dans la moitie du L2 */
+    long lignes = l2 / 2 / (2 * (long)sizeof(double)) / (TUILE_COLS + 2 * PROFONDEUR)
+                  - 2 * PROFONDEUR;
+    m->tuile_lignes = lignes < 8 ? 8 : (int)lignes;
+    return 0;
+}
+
+static void moteur_liberer(moteur_t *m) {
+    grille_liberer(&m->grilles[0]);
+    grille_liberer(&m->grilles[1]);
+    free(m->poids_interieur);
+    free(m->poids_bord);
+}
+
+/* Retourne la duree en secondes */
+static double moteur_executer(moteur_t *m, methode_t methode, int nb_threads, int iterations) {
+    pthread_t threads[MAX_THREADS];
+    contexte_t ctx[MAX_THREADS];
+
+    m->methode = methode;
+    m->nb_threads = nb_threads;
+    m->iterations = iterations;
+    barriere_init(&m->barriere, nb_threads);
+    pthread_barrier_init(&m->barriere_posix, NULL, (unsigned)nb_threads);
+
+    for (int i = 0; i < nb_threads; i++) {
+        ctx[i] = (contexte_t){ .m = m, .id = i };
+        pthread_create(&threads[i], NULL, simuler_region, &ctx[i]);
+    }
+    for (int i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_barrier_destroy(&m->barriere_posix);
+
+    return (double)(m->fin.tv_sec - m->debut.tv_sec) +
+           (double)(m->fin.tv_nsec - m->debut.tv_nsec) / 1e9;
+}
+
+/* ---------------------------------------------------------------------------
+   Verification et benchmark
+   --------------------------------------------------------------------------- */
+
+/* Taille non multiple des tuiles, iterations non multiples de PROFONDEUR */
+static int verifier(long l2, int nb_threads) {
+    const int n = 500, iterations = 10;
+    moteur_t m;
+    double *reference = malloc((size_t)n * n * sizeof(double));
+    if (!reference || moteur_creer(&m, n, l2) != 0) return 0;
+
+    double pire = 0.0;
+    for (int meth = 0; meth < NB_METHODES; meth++) {
+        moteur_executer(&m, (methode_t)meth, nb_threads, iterations);
+        for (int i = 0; i < n; i++) {
+            const double *ligne = grille_ligne(m.resultat, i);
+            for (int j = 0; j < n; j++) {
+                double *ref = &reference[(size_t)i * n + j];
+                if (meth == METH_NAIF) {
+                    *ref = ligne[j];
+                    continue;
+                }
+                double ecart = (ligne[j] - *ref) / *ref;
+                if (ecart < 0) ecart = -ecart;
+                if (ecart > pire) pire = ecart;
+            }
+        }
+    }
+    moteur_liberer(&m);
+    free(reference);
+    printf("Verification (%dx%d, %d iterations) : ecart relatif max %.1e\n\n",
+           n, n, iterations, pire);
+    return pire < 1e-12;
+}
+
+int main(int argc, char *argv[]) {
+    long nb_coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nb_coeurs < 1) nb_coeurs = 1;
+    int taille_max = argc > 1 ? atoi(argv[1]) : 4096;
+    int max_threads = argc > 2 ? atoi(argv[2]) : (int)nb_coeurs;
+    if (taille_max < 1024) taille_max = 1024;
+    if (taille_max > 16384) taille_max = 16384;
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+    long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (l2 <= 0) l2 = L2_DEFAUT;
+
+    printf("=== Moteur de stencil 3x3 (simulation de 42_barrier_simulation) ===\n");
+    printf("(L2 %ld Ko, tuiles %d colonnes, profondeur %d, %ld coeurs)\n\n",
+           l2 / 1024, TUILE_COLS, PROFONDEUR, nb_coeurs);
+
+    int ok = verifier(l2, max_threads < 4 ? max_threads : 4);
+
+    printf("%-8s %-20s %8s %6s %10s %10s\n",
+           "Taille", "Methode", "Threads", "Iter", "Gpts/s", "Echelle");
+    for (int n = 1024; n <= taille_max; n *= 2) {
+        moteur_t m;
+        if (moteur_creer(&m, n, l2) != 0) {
+            fprintf(stderr, "Erreur allocation (%dx%d)\n", n, n);
+            return 1;
+        }
+        int iterations = (int)(POINTS_PAR_MESURE / ((long)n * n));
+        iterations = iterations < PROFONDEUR ? PROFONDEUR : iterations;
+
+        for (int meth = 0; meth < NB_METHODES; meth++) {
+            double debit_1 = 0.0;
+            for (int t = 1;; t = t * 2 > max_threads ? max_threads : t * 2) {
+                double duree = moteur_executer(&m, (methode_t)meth, t, iterations);
+                double debit = (double)n * n * iterations / duree / 1e9;
+                if (t == 1) debit_1 = debit;
+                printf("%-8d %-20s %8d %6d %10.2f %9.1fx\n", n, noms_methodes[meth],
+                       t, iterations, debit, debit / debit_1);
+                if (t == max_threads) break;
+            }
+        }
+        printf("\n");
+        moteur_liberer(&m);
+    }
+
+    printf("Verification : %s\n", ok ? "resultats identiques" : "ECHEC");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,337 @@
+/* ============================================================================
+   Section 18.6 : Mutex et sections critiques
+   Description : Zoo de verrous derriere une API unique
+                 - pthread_mutex_t (reference de 22_mutex_performance.c)
+                 - TTAS (test and test-and-set) avec recul exponentiel
+                 - ticket lock (FIFO)
+                 - MCS (file chainee, chaque thread attend sur son noeud)
+                 - mutex futex adaptatif : attente active breve puis sommeil
+                 Matrice de benchmark : longueur de section critique x
+                 nombre de threads (jusqu'a 4x le nombre de coeurs),
+                 debit et equite (indice de Jain, min/max)
+   Fichier source : 06-mutex.md
+   ============================================================================ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define LIGNE_CACHE 64
+#define MAX_THREADS 256
+#define RECUL_MIN 4               /* pauses du premier recul TTAS */
+#define RECUL_MAX 1024
+#define ADAPTATIF_SPINS 100       /* essais avant futex_wait */
+#define HORS_SC 50                /* travail local entre deux acquisitions */
+#define DUREE_DEFAUT_MS 100
+
+/* ---------------------------------------------------------------------------
+   API
+   --------------------------------------------------------------------------- */
+
+typedef enum {
+    VERROU_PTHREAD, VERROU_TTAS, VERROU_TICKET, VERROU_MCS, VERROU_ADAPTATIF,
+    NB_VERROUS
+} verrou_type_t;
+
+static const char *noms_verrous[NB_VERROUS] = {
+    "pthread", "ttas+recul", "ticket", "mcs", "adaptatif"
+};
+
+typedef struct mcs_noeud {
+    _Atomic(struct mcs_noeud *) suivant;
+    atomic_bool attend;
+} mcs_noeud_t;
+
+/* Contexte d'une acquisition, fourni par l'appelant (pile) et passe a
+   prendre puis a rendre. Seul MCS s'en sert : c'est le maillon de la file */
+typedef struct {
+    _Alignas(LIGNE_CACHE) mcs_noeud_t mcs;
+} verrou_noeud_t;
+
+typedef struct {
+    verrou_type_t type;
+    union {
+        pthread_mutex_t mutex;
+        atomic_int ttas;                    /* 0 libre, 1 pris */
+        struct {
+            atomic_uint suivant;            /* prochain ticket distribue */
+            atomic_uint servi;              /* ticket autorise a entrer */
+        } ticket;
+        _Atomic(mcs_noeud_t *) mcs;         /* queue de la file, NULL si libre */
+        atomic_int futex;                   /* 0 libre, 1 pris, 2 pris + dormeurs */
+    };
+} verrou_t;
+
+static long futex(atomic_int *adresse, int op, int valeur) {
+    return syscall(SYS_futex, (int *)adresse, op, valeur, NULL, NULL, 0);
+}
+
+static inline void pause_cpu(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+void verrou_init(verrou_t *v, verrou_type_t type) {
+    memset(v, 0, sizeof(*v));
+    v->type = type;
+    switch (type) {
+    case VERROU_PTHREAD:   pthread_mutex_init(&v->mutex, NULL); break;
+    case VERROU_TTAS:      atomic_init(&v->ttas, 0); break;
+    case VERROU_TICKET:
+        atomic_init(&v->ticket.suivant, 0);
+        atomic_init(&v->ticket.servi, 0);
+        break;
+    case VERROU_MCS:       atomic_init(&v->mcs, NULL); break;
+    default:               atomic_init(&v->futex, 0); break;
+    }
+}
+
+void verrou_detruire(verrou_t *v) {
+    if (v->type == VERROU_PTHREAD) pthread_mutex_destroy(&v->mutex);
+}
+
+/* TTAS : on ne tente l'echange (qui invalide la ligne chez les autres)
+   que si le verrou semble libre ; en cas d'echec, recul exponentiel */
+static void ttas_prendre(atomic_int *v) {
+    int recul = RECUL_MIN;
+    for (;;) {
+        while (atomic_load_explicit(v, memory_order_relaxed)) pause_cpu();
+        if (!atomic_exchange_explicit(v, 1, memory_order_acquire)) return;
+        for (int i = 0; i < recul; i++) pause_cpu();
+        if (recul < RECUL_MAX) recul *= 2;
+    }
+}
+
+/* MCS : chaque thread s'accroche en queue et attend sur son propre noeud,
+   le detenteur passe la main a son successeur : une seule ligne de cache
+   transferee par passage de relais */
+static void mcs_prendre(_Atomic(mcs_noeud_t *) *queue, mcs_noeud_t *moi) {
+    atomic_store_explicit(&moi->suivant, NULL, memory_order_relaxed);
+    atomic_store_explicit(&moi->attend, true, memory_order_relaxed);
+    mcs_noeud_t *pred = atomic_exchange_explicit(queue, moi, memory_order_acq_rel);
+    if (!pred) return;
+    atomic_store_explicit(&pred->suivant, moi, memory_order_release);
+    while (atomic_load_explicit(&moi->attend, memory_order_acquire)) pause_cpu();
+}
+
+static void mcs_rendre(_Atomic(mcs_noeud_t *) *queue, mcs_noeud_t *moi) {
+    mcs_noeud_t *succ = atomic_load_explicit(&moi->suivant, memory_order_acquire);
+    if (!succ) {
+        mcs_noeud_t *attendu = moi;
+        if (atomic_compare_exchange_strong_explicit(queue, &attendu, NULL,
+                                                    memory_order_release,
+                                                    memory_order_relaxed)) {
+            return;
+        }
+        /* Un successeur s'est accroche mais n'a pas encore publie son noeud */
+        while (!(succ = atomic_load_explicit(&moi->suivant, memory_order_acquire))) {
+            pause_cpu();
+        }
+    }
+    atomic_store_explicit(&succ->attend, false, memory_order_release);
+}
+
+/* Mutex futex a trois etats (Drepper, "Futexes Are Tricky") precede d'une
+   courte attente active : une section critique breve se libere souvent
+   avant qu'un appel systeme n'ait le temps d'aboutir */
+static void adaptatif_prendre(atomic_int *f) {
+    int c = 0;
+    if (atomic_compare_exchange_strong_explicit(f, &c, 1, memory_order_acquire,
+                                                memory_order_relaxed)) {
+        return;
+    }
+    for (int i = 0; i < ADAPTATIF_SPINS; i++) {
+        pause_cpu();
+        c = atomic_load_explicit(f, memory_order_relaxed);
+        if (c == 0 && atomic_compare_exchange_weak_explicit(f, &c, 1, memory_order_acquire,
+                                                            memory_order_relaxed)) {
+            return;
+        }
+        if (c == 2) break;          /* deja des dormeurs : inutile d'insister */
+    }
+    if (c != 2) c = atomic_exchange_explicit(f, 2, memory_order_acquire);
+    while (c != 0) {
+        futex(f, FUTEX_WAIT_PRIVATE, 2);
+        c = atomic_exchange_explicit(f, 2, memory_order_acquire);
+    }
+}
+
+static void adaptatif_rendre(atomic_int *f) {
+    if (atomic_fetch_sub_explicit(f, 1, memory_order_release) != 1) {
+        atomic_store_explicit(f, 0, memory_order_release);
+        futex(f, FUTEX_WAKE_PRIVATE, 1);
+    }
+}
+
+static inline void verrou_prendre(verrou_t *v, verrou_noeud_t *n) {
+    switch (v->type) {
+    case VERROU_PTHREAD: pthread_mutex_lock(&v->mutex); break;
+    case VERROU_TTAS:    ttas_prendre(&v->ttas); break;
+    case VERROU_TICKET: {
+        unsigned int mon_ticket = atomic_fetch_add_explicit(&v->ticket.suivant, 1,
+                                                            memory_order_relaxed);
+        while (atomic_load_explicit(&v->ticket.servi, memory_order_acquire) != mon_ticket) {
+            pause_cpu();
+        }
+        break;
+    }
+    case VERROU_MCS:     mcs_prendre(&v->mcs, &n->mcs); break;
+    default:             adaptatif_prendre(&v->futex); break;
+    }
+}
+
+static inline void verrou_rendre(verrou_t *v, verrou_noeud_t *n) {
+    switch (v->type) {
+    case VERROU_PTHREAD: pthread_mutex_unlock(&v->mutex); break;
+    case VERROU_TTAS:    atomic_store_explicit(&v->ttas, 0, memory_order_release); break;
+    case VERROU_TICKET: {
+        /* Seul le detenteur ecrit 'servi' : load + store suffisent */
+        unsigned int s = atomic_load_explicit(&v->ticket.servi, memory_order_relaxed);
+        atomic_store_explicit(&v->ticket.servi, s + 1, memory_order_release);
+        break;
+    }
+    case VERROU_MCS:     mcs_rendre(&v->mcs, &n->mcs); break;
+    default:             adaptatif_rendre(&v->futex); break;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   Benchmark
+   --------------------------------------------------------------------------- */
+
+/* Donnees protegees : volatile pour que la section critique ne soit pas
+   reduite par l'optimiseur */
+static struct {
+    _Alignas(LIGNE_CACHE) long compteur;
+    volatile long donnees[8];
+} partage;
+
+static verrou_t verrou;
+static int longueur_sc;
+static atomic_bool depart, arret;
+
+typedef struct {
+    _Alignas(LIGNE_CACHE) long operations;
+} resultat_t;
+
+static resultat_t resultats[MAX_THREADS];
+
+static void *travailleur(void *arg) {
+    resultat_t *r = arg;
+    verrou_noeud_t noeud;
+    volatile long local = 0;
+    long ops = 0;
+
+    while (!atomic_load_explicit(&depart, memory_order_acquire)) pause_cpu();
+
+    while (!atomic_load_explicit(&arret, memory_order_relaxed)) {
+        verrou_prendre(&verrou, &noeud);
+        partage.compteur++;
+        for (int k = 0; k < longueur_sc; k++) partage.donnees[k & 7] += k;
+        verrou_rendre(&verrou, &noeud);
+        ops++;
+
+        for (int k = 0; k < HORS_SC; k++) local += k;
+    }
+    r->operations = ops;
+    return NULL;
+}
+
+typedef struct {
+    double mops;
+    double jain;                  /* 1 = parfaitement equitable, 1/n = un seul thread */
+    double min_max;
+    bool exclusion_ok;
+} mesure_t;
+
+static mesure_t mesurer(verrou_type_t type, int nb_threads, int duree_ms) {
+    pthread_t threads[MAX_THREADS];
+    struct timespec debut, fin;
+    mesure_t m = { 0 };
+
+    verrou_init(&verrou, type);
+    partage.compteur = 0;
+    atomic_store(&depart, false);
+    atomic_store(&arret, false);
+    for (int i = 0; i < nb_threads; i++) {
+        resultats[i].operations = 0;
+        pthread_create(&threads[i], NULL, travailleur, &resultats[i]);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &debut);
+    atomic_store(&depart, true);
+    usleep((useconds_t)duree_ms * 1000);
+    atomic_store(&arret, true);
+    for (int i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &fin);
+    verrou_detruire(&verrou);
+
+    double total = 0.0, carres = 0.0;
+    long min = resultats[0].operations, max = min;
+    for (int i = 0; i < nb_threads; i++) {
+        double x = (double)resultats[i].operations;
+        total += x;
+        carres += x * x;
+        if (resultats[i].operations < min) min = resultats[i].operations;
+        if (resultats[i].operations > max) max = resultats[i].operations;
+    }
+    double duree = (double)(fin.tv_sec - debut.tv_sec) +
+                   (double)(fin.tv_nsec - debut.tv_nsec) / 1e9;
+    m.mops = total / duree / 1e6;
+    m.jain = carres > 0 ? total * total / (nb_threads * carres) : 0.0;
+    m.min_max = max > 0 ? (double)min / (double)max : 0.0;
+    m.exclusion_ok = partage.compteur == (long)total;
+    return m;
+}
+
+int main(int argc, char *argv[]) {
+    long nb_coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+    if (nb_coeurs < 1) nb_coeurs = 1;
+    int duree_ms = argc > 1 ? atoi(argv[1]) : DUREE_DEFAUT_MS;
+    int max_threads = argc > 2 ? atoi(argv[2]) : (int)nb_coeurs * 4;
+    if (duree_ms < 1) duree_ms = 1;
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+    const int longueurs[] = { 0, 50, 500 };
+    const int nb_longueurs = (int)(sizeof(longueurs) / sizeof(longueurs[0]));
+
+    printf("=== Zoo de verrous : debit et equite ===\n");
+    printf("(%d ms par mesure, %ld coeurs, %d iterations hors section critique)\n",
+           duree_ms, nb_coeurs, HORS_SC);
+    printf("'*' : plus de threads que de coeurs (sursouscription)\n\n");
+
+    int erreurs = 0;
+    for (int l = 0; l < nb_longueurs; l++) {
+        longueur_sc = longueurs[l];
+        printf("--- Section critique : %d iterations ---\n", longueur_sc);
+        printf("%-12s %8s %10s %8s %8s\n", "Verrou", "Threads", "Mops/s", "Jain", "min/max");
+        for (int t = 0; t < NB_VERROUS; t++) {
+            for (int n = 1; n <= max_threads; n *= 2) {
+                mesure_t m = mesurer((verrou_type_t)t, n, duree_ms);
+                erreurs += !m.exclusion_ok;
+                printf("%-12s %7d%c %10.2f %8.3f %8.3f%s\n", noms_verrous[t], n,
+                       n > nb_coeurs ? '*' : ' ', m.mops, m.jain, m.min_max,
+                       m.exclusion_ok ? "" : "  EXCLUSION VIOLEE");
+            }
+        }
+        printf("\n");
+    }
+
+    printf("Verification : %s\n", erreurs == 0 ? "exclusion mutuelle respectee" : "ECHEC");
+    return erreurs == 0 ? 0 : 1;
+}
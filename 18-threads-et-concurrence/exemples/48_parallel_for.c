@@ -0,0 +1,452 @@
+/* ============================================================================
+   Section 18.3 : Passage de parametres
+   Description : Mini runtime fork-join remplacant le decoupage manuel de
+                 09_calcul_parallele.c
+                 - pool de workers persistant (attente active breve puis
+                   variable de condition), l'appelant participe
+                 - parallel_for / parallel_reduce par blocs de 'grain'
+                   distribues dynamiquement (compteur atomique)
+                 - accumulateurs de reduction un par worker, alignes sur
+                   une ligne de cache (pas de faux partage)
+                 Benchmark contre pthread_create/join a chaque calcul, sur
+                 petites et grandes entrees, travail regulier et irregulier
+   Fichier source : 03-passage-parametres.md
+   ============================================================================ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LIGNE_CACHE 64
+#define MAX_THREADS 256
+#define ATTENTE_ACTIVE 2000       /* tours de spin avant de dormir */
+#define GRAIN_MIN 2048            /* en dessous, le calcul reste sequentiel */
+#define BLOCS_PAR_THREAD 8        /* grain automatique : n / (threads * 8) */
+
+static inline void pause_cpu(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* ---------------------------------------------------------------------------
+   API
+   --------------------------------------------------------------------------- */
+
+typedef void (*corps_for_t)(void *ctx, long debut, long fin);
+typedef void (*corps_reduce_t)(void *ctx, long debut, long fin, void *acc);
+
+typedef struct pool pool_t;
+
+typedef struct {
+    pool_t *pool;
+    int id;
+} worker_arg_t;
+
+struct pool {
+    pthread_t threads[MAX_THREADS];
+    worker_arg_t args[MAX_THREADS];
+    int nb_threads;                     /* workers + thread appelant */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_travail;
+    pthread_cond_t cond_fin;
+    atomic_ulong generation;            /* incrementee a chaque lot */
+    atomic_int actifs;                  /* workers encore dans le lot */
+    atomic_int arret;
+
+    /* Lot courant (un seul appelant a la fois) */
+    long fin, grain;
+    _Alignas(LIGNE_CACHE) atomic_long suivant;
+    corps_for_t corps_for;
+    corps_reduce_t corps_reduce;
+    void (*neutre)(void *acc);
+    void *ctx;
+
+    /* Accumulateurs : un emplacement de 'pas_acc' octets par participant */
+    unsigned char *accumulateurs;
+    size_t pas_acc, capacite_acc;
+};
+
+/* Consomme les blocs du lot courant ; id 0 = thread appelant */
+static void executer_lot(pool_t *p, int id) {
+    void *acc = NULL;
+    if (p->corps_reduce) {
+        acc = p->accumulateurs + (size_t)id * p->pas_acc;
+        p->neutre(acc);
+    }
+    for (;;) {
+        long debut = atomic_fetch_add_explicit(&p->suivant, p->grain, memory_order_relaxed);
+        if (debut >= p->fin) break;
+        long fin = p->fin - debut < p->grain ? p->fin : debut + p->grain;
+        if (acc) p->corps_reduce(p->ctx, debut, fin, acc);
+        else p->corps_for(p->ctx, debut, fin);
+    }
+}
+
+static void *worker(void *arg) {
+    worker_arg_t *w = arg;
+    pool_t *p = w->pool;
+    unsigned long vue = 0;
+
+    for (;;) {
+        /* Attente active : un lot qui suit de pres evite le reveil */
+        for (int i = 0; i < ATTENTE_ACTIVE; i++) {
+            if (atomic_load_explicit(&p->generation, memory_order_acquire) != vue
+                || atomic_load_explicit(&p->arret, memory_order_relaxed)) {
+                break;
+            }
+            pause_cpu();
+        }
+        pthread_mutex_lock(&p->mutex);
+        while (!atomic_load(&p->arret) && atomic_load(&p->generation) == vue) {
+            pthread_cond_wait(&p->cond_travail, &p->mutex);
+        }
+        pthread_mutex_unlock(&p->mutex);
+        if (atomic_load(&p->arret)) break;
+        vue = atomic_load_explicit(&p->generation, memory_order_acquire);
+
+        executer_lot(p, w->id);
+
+        if (atomic_fetch_sub_explicit(&p->actifs, 1, memory_order_acq_rel) == 1) {
+            pthread_mutex_lock(&p->mutex);
+            pthread_cond_signal(&p->cond_fin);
+            pthread_mutex_unlock(&p->mutex);
+        }
+    }
+    return NULL;
+}
+
+/* nb_threads <= 0 : nombre de coeurs */
+pool_t *pool_creer(int nb_threads) {
+    if (nb_threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        nb_threads = n > 0 ? (int)n : 1;
+    }
+    if (nb_threads > MAX_THREADS) nb_threads = MAX_THREADS;
+
+    pool_t *p = aligned_alloc(LIGNE_CACHE, sizeof(pool_t));
+    if (!p) return NULL;
+    memset(p, 0, sizeof(*p));
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->cond_travail, NULL);
+    pthread_cond_init(&p->cond_fin, NULL);
+
+    p->nb_threads = nb_threads;
+    for (int i = 1; i < nb_threads; i++) {
+        p->args[i] = (worker_arg_t){ .pool = p, .id = i };
+        if (pthread_create(&p->threads[i], NULL, worker, &p->args[i]) != 0) {
+            p->nb_threads = i;
+            break;
+        }
+    }
+    return p;
+}
+
+void pool_detruire(pool_t *p) {
+    if (!p) return;
+    pthread_mutex_lock(&p->mutex);
+    atomic_store(&p->arret, 1);
+    pthread_cond_broadcast(&p->cond_travail);
+    pthread_mutex_unlock(&p->mutex);
+    for (int i = 1; i < p->nb_threads; i++) {
+        pthread_join(p->threads[i], NULL);
+    }
+    pthread_cond_destroy(&p->cond_fin);
+    pthread_cond_destroy(&p->cond_travail);
+    pthread_mutex_destroy(&p->mutex);
+    free(p->accumulateurs);
+    free(p);
+}
+
+static long grain_effectif(const pool_t *p, long n, long grain) {
+    if (grain > 0) return grain;
+    grain = n / ((long)p->nb_threads * BLOCS_PAR_THREAD);
+    return grain < GRAIN_MIN ? GRAIN_MIN : grain;
+}
+
+static void lancer_lot(pool_t *p, long debut, long fin, long grain) {
+    p->fin = fin;
+    p->grain = grain;
+    atomic_store_explicit(&p->suivant, debut, memory_order_relaxed);
+    atomic_store_explicit(&p->actifs, p->nb_threads - 1, memory_order_relaxed);
+
+    pthread_mutex_lock(&p->mutex);
+    atomic_fetch_add_explicit(&p->generation, 1, memory_order_release);
+    pthread_cond_broadcast(&p->cond_travail);
+    pthread_mutex_unlock(&p->mutex);
+
+    executer_lot(p, 0);
+
+    for (int i = 0; i < ATTENTE_ACTIVE; i++) {
+        if (atomic_load_explicit(&p->actifs, memory_order_acquire) == 0) return;
+        pause_cpu();
+    }
+    pthread_mutex_lock(&p->mutex);
+    while (atomic_load(&p->actifs) > 0) {
+        pthread_cond_wait(&p->cond_fin, &p->mutex);
+    }
+    pthread_mutex_unlock(&p->mutex);
+}
+
+/* corps(ctx, d, f) sur des blocs [d, f) de 'grain' indices couvrant
+   [debut, fin). grain <= 0 : choisi automatiquement. Une entree plus
+   petite qu'un bloc est traitee par l'appelant, sans reveiller le pool */
+void parallel_for(pool_t *p, long debut, long fin, long grain,
+                  corps_for_t corps, void *ctx) {
+    long n = fin - debut;
+    if (n <= 0) return;
+    grain = grain_effectif(p, n, grain);
+    if (p->nb_threads < 2 || n <= grain) {
+        corps(ctx, debut, fin);
+        return;
+    }
+    p->corps_for = corps;
+    p->corps_reduce = NULL;
+    p->ctx = ctx;
+    lancer_lot(p, debut, fin, grain);
+}
+
+/* Reduction : chaque participant part de neutre(acc) dans son propre
+   emplacement, puis les accumulateurs sont combines dans 'resultat'
+   (taille octets) par l'appelant. Retourne -1 si l'allocation echoue */
+int parallel_reduce(pool_t *p, long debut, long fin, long grain,
+                    void *resultat, size_t taille,
+                    void (*neutre)(void *acc), corps_reduce_t corps,
+                    void (*combiner)(void *acc, const void *autre), void *ctx) {
+    long n = fin - debut;
+    neutre(resultat);
+    if (n <= 0) return 0;
+    grain = grain_effectif(p, n, grain);
+    if (p->nb_threads < 2 || n <= grain) {
+        corps(ctx, debut, fin, resultat);
+        return 0;
+    }
+
+    size_t pas = (taille + LIGNE_CACHE - 1) & ~(size_t)(LIGNE_CACHE - 1);
+    if (pas * (size_t)p->nb_threads > p->capacite_acc) {
+        free(p->accumulateurs);
+        p->capacite_acc = pas * (size_t)p->nb_threads;
+        p->accumulateurs = aligned_alloc(LIGNE_CACHE, p->capacite_acc);
+        if (!p->accumulateurs) {
+            p->capacite_acc = 0;
+            return -1;
+        }
+    }
+    p->pas_acc = pas;
+    p->corps_for = NULL;
+    p->corps_reduce = corps;
+    p->neutre = neutre;
+    p->ctx = ctx;
+    lancer_lot(p, debut, fin, grain);
+
+    for (int i = 0; i < p->nb_threads; i++) {
+        combiner(resultat, p->accumulateurs + (size_t)i * pas);
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+   Charges de travail
+   --------------------------------------------------------------------------- */
+
+/* Regulier : somme d'un tableau (09_calcul_parallele.c) */
+static void neutre_somme(void *acc) {
+    *(long long *)acc = 0;
+}
+
+static void combiner_somme(void *acc, const void *autre) {
+    *(long long *)acc += *(const long long *)autre;
+}
+
+static void corps_somme(void *ctx, long debut, long fin, void *acc) {
+    const int *tableau = ctx;
+    long long s = 0;
+    for (long i = debut; i < fin; i++) s += tableau[i];
+    *(long long *)acc += s;
+}
+
+/* Irregulier : iterations de Mandelbrot par ligne, tres variables */
+#define MANDEL_LARGEUR 512
+#define MANDEL_MAX_ITER 1000
+
+static long mandel_ligne(long y, long hauteur) {
+    long total = 0;
+    double ci = -1.5 + 3.0 * (double)y / (double)hauteur;
+    for (int x = 0; x < MANDEL_LARGEUR; x++) {
+        double cr = -2.0 + 3.0 * x / MANDEL_LARGEUR;
+        double zr = 0.0, zi = 0.0;
+        int k = 0;
+        while (k < MANDEL_MAX_ITER && zr * zr + zi * zi < 4.0) {
+            double t = zr * zr - zi * zi + cr;
+            zi = 2.0 * zr * zi + ci;
+            zr = t;
+            k++;
+        }
+        total += k;
+    }
+    return total;
+}
+
+static void corps_mandel(void *ctx, long debut, long fin, void *acc) {
+    long hauteur = *(const long *)ctx;
+    long long s = 0;
+    for (long y = debut; y < fin; y++) s += mandel_ligne(y, hauteur);
+    *(long long *)acc += s;
+}
+
+/* Tableau traite en place (parallel_for) */
+static void corps_doubler(void *ctx, long debut, long fin) {
+    int *tableau = ctx;
+    for (long i = debut; i < fin; i++) tableau[i] *= 2;
+}
+
+/* ---------------------------------------------------------------------------
+   Reference : decoupage manuel de 09 en plages egales, threads crees et
+   joints a chaque calcul, sommes partielles dans des ThreadData voisins
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    void (*corps)(void *ctx, long debut, long fin, void *acc);
+    void *ctx;
+    long debut;
+    long fin;
+    long long somme;
+} ThreadData;
+
+static void *calculer_somme_partielle(void *arg) {
+    ThreadData *data = arg;
+    data->corps(data->ctx, data->debut, data->fin, &data->somme);
+    return NULL;
+}
+
+static long long reduce_pthread(int nb_threads, long n,
+                                void (*corps)(void *, long, long, void *), void *ctx) {
+    pthread_t threads[MAX_THREADS];
+    ThreadData data[MAX_THREADS];
+    long par_thread = n / nb_threads;
+
+    for (int i = 0; i < nb_threads; i++) {
+        data[i] = (ThreadData){
+            .corps = corps, .ctx = ctx,
+            .debut = i * par_thread,
+            .fin = i == nb_threads - 1 ? n : (i + 1) * par_thread,
+        };
+        pthread_create(&threads[i], NULL, calculer_somme_partielle, &data[i]);
+    }
+    long long total = 0;
+    for (int i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+        total += data[i].somme;
+    }
+    return total;
+}
+
+/* ---------------------------------------------------------------------------
+   Benchmark
+   --------------------------------------------------------------------------- */
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+typedef enum { METH_SEQUENTIEL, METH_PTHREAD, METH_POOL, NB_METHODES } methode_t;
+
+static const char *noms_methodes[NB_METHODES] = {
+    "sequentiel", "pthread/appel (09)", "pool reduce"
+};
+
+static long long executer(methode_t m, pool_t *pool, long n, long grain,
+                          void (*corps)(void *, long, long, void *), void *ctx) {
+    long long r = 0;
+    switch (m) {
+    case METH_SEQUENTIEL: corps(ctx, 0, n, &r); break;
+    case METH_PTHREAD:    r = reduce_pthread(pool->nb_threads, n, corps, ctx); break;
+    default:
+        parallel_reduce(pool, 0, n, grain, &r, sizeof(r),
+                        neutre_somme, corps, combiner_somme, ctx);
+        break;
+    }
+    return r;
+}
+
+int main(int argc, char *argv[]) {
+    int nb_threads = argc > 1 ? atoi(argv[1]) : 0;
+    pool_t *pool = pool_creer(nb_threads);
+    if (!pool) {
+        fprintf(stderr, "Erreur creation du pool\n");
+        return 1;
+    }
+
+    const long tailles[] = { 1000, 100000, 10000000 };
+    const int nb_tailles = (int)(sizeof(tailles) / sizeof(tailles[0]));
+    long n_max = tailles[nb_tailles - 1];
+    /* Zero : le warm-up double des valeurs definies (pas de debordement) */
+    int *tableau = calloc((size_t)n_max, sizeof(int));
+    if (!tableau) {
+        fprintf(stderr, "Erreur allocation\n");
+        return 1;
+    }
+    parallel_for(pool, 0, n_max, 0, corps_doubler, tableau);   /* warm-up */
+    for (long i = 0; i < n_max; i++) tableau[i] = (int)(i % 1000) + 1;
+
+    printf("=== parallel_reduce vs pthread_create par calcul (%d threads) ===\n\n",
+           pool->nb_threads);
+    printf("%-14s %10s %-20s %12s %10s\n", "Charge", "n", "Methode", "us/appel", "Acceleration");
+
+    int erreurs = 0;
+    for (int t = 0; t < nb_tailles; t++) {
+        long n = tailles[t];
+        int repetitions = (int)(100000000 / n);
+        if (repetitions > 10000) repetitions = 10000;
+        long long attendu = 0;
+        double temps_seq = 0.0;
+        for (int m = 0; m < NB_METHODES; m++) {
+            long long r = 0;
+            double debut = secondes();
+            for (int k = 0; k < repetitions; k++) {
+                r = executer((methode_t)m, pool, n, 0, corps_somme, tableau);
+            }
+            double us = (secondes() - debut) / repetitions * 1e6;
+            if (m == METH_SEQUENTIEL) {
+                attendu = r;
+                temps_seq = us;
+            }
+            erreurs += r != attendu;
+            printf("%-14s %10ld %-20s %12.2f %9.2fx%s\n", "somme", n, noms_methodes[m],
+                   us, temps_seq / us, r == attendu ? "" : "  ERREUR");
+        }
+    }
+
+    /* Irregulier : le decoupage statique laisse des threads inactifs */
+    long hauteur = 1024;
+    long long attendu = 0;
+    double temps_seq = 0.0;
+    for (int m = 0; m < NB_METHODES; m++) {
+        double debut = secondes();
+        long long r = executer((methode_t)m, pool, hauteur, 4, corps_mandel, &hauteur);
+        double us = (secondes() - debut) * 1e6;
+        if (m == METH_SEQUENTIEL) {
+            attendu = r;
+            temps_seq = us;
+        }
+        erreurs += r != attendu;
+        printf("%-14s %10ld %-20s %12.2f %9.2fx%s\n", "mandelbrot", hauteur,
+               noms_methodes[m], us, temps_seq / us, r == attendu ? "" : "  ERREUR");
+    }
+
+    free(tableau);
+    pool_detruire(pool);
+    printf("\nVerification : %s\n", erreurs == 0 ? "resultats identiques" : "ECHEC");
+    return erreurs == 0 ? 0 : 1;
+}
@@ -0,0 +1,538 @@
+/* ============================================================================
+   Section 18.9 : Semaphores
+   Description : Pool de ressources identifiees (connexions) remplacant le
+                 semaphore compteur de 29_sem_pool.c
+                 - poignees typees : chaque prise rend une ressource precise
+                 - cache par thread (_Thread_local) + liste libre globale
+                   lock-free (pile de Treiber a etiquette, sans ABA)
+                 - vol dans les caches des autres threads si la liste est vide
+                 - attente bornee avec timeout, hooks de verification et
+                   d'eviction, metriques de temps d'attente par pool
+                 Benchmark prise/retour a 64 threads contre sem_wait/sem_post
+   Fichier source : 09-semaphores.md
+   ============================================================================ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+
+#define LIGNE_CACHE 64
+#define CACHE_MAX 2               /* ressources gardees par thread */
+#define VIDE UINT32_MAX
+#define NB_BUCKETS_ATTENTE 32     /* histogramme log2 des attentes (ns) */
+
+/* ---------------------------------------------------------------------------
+   API
+   --------------------------------------------------------------------------- */
+
+enum { LIBRE, EN_CACHE, PRISE };
+
+/* Poignee rendue par pool_prendre() : 'objet' est la ressource elle-meme
+   (ici un connexion_t *), 'id' l'identifie dans le pool */
+typedef struct {
+    _Alignas(LIGNE_CACHE) atomic_int etat;
+    atomic_uint suivant;                /* maillon de la liste libre */
+    uint32_t id;
+    void *objet;
+    int64_t cree_ns;
+    int64_t utilise_ns;                 /* dernier retour au pool */
+} ressource_t;
+
+typedef struct {
+    void *(*creer)(void *ctx, uint32_t id);
+    void (*evincer)(void *objet, void *ctx);  /* destruction d'une ressource */
+    int (*verifier)(void *objet, void *ctx);  /* 1 si saine */
+    void *ctx;
+    int64_t verifier_apres_ns;          /* verifier si inactive depuis plus */
+    int64_t duree_vie_ns;               /* 0 : illimitee */
+} pool_hooks_t;
+
+typedef struct {
+    uint64_t attentes;                  /* prises passees par le chemin lent */
+    uint64_t expirations;
+    uint64_t evictions;
+    uint64_t attente_totale_ns;
+    uint64_t attente_max_ns;
+    uint64_t histogramme[NB_BUCKETS_ATTENTE];   /* bucket b : [2^b, 2^(b+1)) ns */
+} pool_metriques_t;
+
+typedef struct {
+    unsigned long id;                   /* unique, cle du cache TLS */
+    uint32_t taille;
+    ressource_t *ressources;
+    pool_hooks_t hooks;
+
+    _Alignas(LIGNE_CACHE) _Atomic uint64_t tete;   /* etiquette << 32 | indice */
+
+    /* Chemin lent uniquement */
+    _Alignas(LIGNE_CACHE) atomic_int en_attente;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    atomic_uint_least64_t attentes, expirations, evictions;
+    atomic_uint_least64_t attente_totale_ns, attente_max_ns;
+    atomic_uint_least64_t histogramme[NB_BUCKETS_ATTENTE];
+} pool_t;
+
+/* Cache TLS : ressources reservees au thread pour le dernier pool utilise.
+   Elles restent volables (etat EN_CACHE) par les autres threads */
+static _Thread_local struct {
+    unsigned long pool;
+    int nb;
+    uint32_t ressources[CACHE_MAX];
+} cache_local;
+
+static atomic_ulong prochain_id = 1;
+
+static int64_t maintenant_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Pile de Treiber : l'etiquette incrementee a chaque modification de la
+   tete empeche un CAS de reussir sur une tete recyclee (ABA) */
+static void pile_empiler(pool_t *p, uint32_t i) {
+    uint64_t tete = atomic_load_explicit(&p->tete, memory_order_relaxed);
+    uint64_t nouvelle;
+    do {
+        atomic_store_explicit(&p->ressources[i].suivant, (uint32_t)tete, memory_order_relaxed);
+        nouvelle = (((tete >> 32) + 1) << 32) | i;
+    } while (!atomic_compare_exchange_weak(&p->tete, &tete, nouvelle));
+}
+
+static uint32_t pile_depiler(pool_t *p) {
+    uint64_t tete = atomic_load(&p->tete);
+    for (;;) {
+        uint32_t i = (uint32_t)tete;
+        if (i == VIDE) return VIDE;
+        uint32_t suivant = atomic_load_explicit(&p->ressources[i].suivant,
+                                                memory_order_relaxed);
+        uint64_t nouvelle = (((tete >> 32) + 1) << 32) | suivant;
+        if (atomic_compare_exchange_weak(&p->tete, &tete, nouvelle)) return i;
+    }
+}
+
+pool_t *pool_creer(uint32_t taille, const pool_hooks_t *hooks) {
+    pool_t *p = aligned_alloc(LIGNE_CACHE, sizeof(pool_t));
+    if (!p) return NULL;
+    memset(p, 0, sizeof(*p));
+    p->ressources = aligned_alloc(LIGNE_CACHE, (size_t)taille * sizeof(ressource_t));
+    if (!p->ressources) {
+        free(p);
+        return NULL;
+    }
+    memset(p->ressources, 0, (size_t)taille * sizeof(ressource_t));
+    p->id = atomic_fetch_add(&prochain_id, 1);
+    p->taille = taille;
+    p->hooks = *hooks;
+    atomic_init(&p->tete, VIDE);
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->cond, NULL);
+
+    int64_t t = maintenant_ns();
+    for (uint32_t i = taille; i-- > 0;) {
+        ressource_t *r = &p->ressources[i];
+        r->id = i;
+        r->objet = hooks->creer ? hooks->creer(hooks->ctx, i) : NULL;
+        r->cree_ns = r->utilise_ns = t;
+        atomic_init(&r->etat, LIBRE);
+        pile_empiler(p, i);
+    }
+    return p;
+}
+
+/* Toutes les ressources doivent avoir ete rendues */
+void pool_detruire(pool_t *p) {
+    if (!p) return;
+    for (uint32_t i = 0; i < p->taille; i++) {
+        if (p->hooks.evincer) p->hooks.evincer(p->ressources[i].objet, p->hooks.ctx);
+    }
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->mutex);
+    free(p->ressources);
+    free(p);
+}
+
+/* Remplace la ressource par une neuve (verification echouee, duree de
+   vie depassee ou poignee rendue invalide) */
+static void ressource_renouveler(pool_t *p, ressource_t *r, int64_t t) {
+    if (p->hooks.evincer) p->hooks.evincer(r->objet, p->hooks.ctx);
+    r->objet = p->hooks.creer ? p->hooks.creer(p->hooks.ctx, r->id) : NULL;
+    r->cree_ns = t;
+    atomic_fetch_add_explicit(&p->evictions, 1, memory_order_relaxed);
+}
+
+/* Chemin rapide : cache du thread, liste globale, puis vol */
+static ressource_t *essayer_prendre(pool_t *p) {
+    if (cache_local.pool == p->id) {
+        while (cache_local.nb > 0) {
+            ressource_t *r = &p->ressources[cache_local.ressources[--cache_local.nb]];
+            int attendu = EN_CACHE;
+            if (atomic_compare_exchange_strong_explicit(&r->etat, &attendu, PRISE,
+                                                        memory_order_acquire,
+                                                        memory_order_relaxed)) {
+                return r;
+            }
+            /* Volee entre-temps par un autre thread */
+        }
+    }
+
+    uint32_t i = pile_depiler(p);
+    if (i != VIDE) {
+        atomic_store_explicit(&p->ressources[i].etat, PRISE, memory_order_relaxed);
+        return &p->ressources[i];
+    }
+
+    for (uint32_t k = 0; k < p->taille; k++) {
+        ressource_t *r = &p->ressources[k];
+        int attendu = EN_CACHE;
+        if (atomic_load_explicit(&r->etat, memory_order_relaxed) == EN_CACHE
+            && atomic_compare_exchange_strong_explicit(&r->etat, &attendu, PRISE,
+                                                       memory_order_acquire,
+                                                       memory_order_relaxed)) {
+            return r;
+        }
+    }
+    return NULL;
+}
+
+static void noter_attente(pool_t *p, int64_t debut) {
+    uint64_t ns = (uint64_t)(maintenant_ns() - debut);
+    int b = ns ? 63 - __builtin_clzll(ns) : 0;
+    if (b >= NB_BUCKETS_ATTENTE) b = NB_BUCKETS_ATTENTE - 1;
+    atomic_fetch_add_explicit(&p->attentes, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->attente_totale_ns, ns, memory_order_relaxed);
+    atomic_fetch_add_explicit(&p->histogramme[b], 1, memory_order_relaxed);
+    uint64_t max = atomic_load_explicit(&p->attente_max_ns, memory_order_relaxed);
+    while (ns > max && !atomic_compare_exchange_weak_explicit(&p->attente_max_ns, &max, ns,
+                                                             memory_order_relaxed,
+                                                             memory_order_relaxed)) {
+    }
+}
+
+/* Prend une ressource ; attend au plus timeout_ms (< 0 : indefiniment).
+   Retourne NULL avec errno = ETIMEDOUT si le delai expire */
+ressource_t *pool_prendre(pool_t *p, int timeout_ms) {
+    ressource_t *r = essayer_prendre(p);
+
+    if (!r) {
+        int64_t debut = maintenant_ns();
+        struct timespec echeance;
+        clock_gettime(CLOCK_REALTIME, &echeance);
+        echeance.tv_sec += timeout_ms / 1000;
+        echeance.tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+        if (echeance.tv_nsec >= 1000000000L) {
+            echeance.tv_sec++;
+            echeance.tv_nsec -= 1000000000L;
+        }
+
+        /* seq_cst : soit le retour voit en_attente, soit on voit la ressource */
+        atomic_fetch_add(&p->en_attente, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        pthread_mutex_lock(&p->mutex);
+        while (!(r = essayer_prendre(p))) {
+            int rc = timeout_ms < 0 ? pthread_cond_wait(&p->cond, &p->mutex)
+                                    : pthread_cond_timedwait(&p->cond, &p->mutex, &echeance);
+            if (rc == ETIMEDOUT) {
+                r = essayer_prendre(p);     /* derniere chance, puis on sort */
+                break;
+            }
+        }
+        pthread_mutex_unlock(&p->mutex);
+        atomic_fetch_sub(&p->en_attente, 1);
+
+        if (!r) {
+            atomic_fetch_add_explicit(&p->expirations, 1, memory_order_relaxed);
+            errno = ETIMEDOUT;
+            return NULL;
+        }
+        noter_attente(p, debut);
+    }
+
+    if (p->hooks.verifier && p->hooks.verifier_apres_ns > 0) {
+        int64_t t = maintenant_ns();
+        if (t - r->utilise_ns > p->hooks.verifier_apres_ns
+            && !p->hooks.verifier(r->objet, p->hooks.ctx)) {
+            ressource_renouveler(p, r, t);
+        }
+    }
+    return r;
+}
+
+/* Rend la ressource ; valide = 0 si l'appelant l'a trouvee defectueuse */
+void pool_rendre(pool_t *p, ressource_t *r, int valide) {
+    if (!valide || p->hooks.verifier_apres_ns > 0 || p->hooks.duree_vie_ns > 0) {
+        int64_t t = maintenant_ns();
+        if (!valide || (p->hooks.duree_vie_ns > 0 && t - r->cree_ns > p->hooks.duree_vie_ns)) {
+            ressource_renouveler(p, r, t);
+        }
+        r->utilise_ns = t;
+    }
+
+    /* Personne n'attend : garder la ressource pour la prochaine prise */
+    if (atomic_load(&p->en_attente) == 0) {
+        if (cache_local.pool != p->id) {
+            cache_local.pool = p->id;
+            cache_local.nb = 0;
+        }
+        if (cache_local.nb < CACHE_MAX) {
+            atomic_store(&r->etat, EN_CACHE);
+            cache_local.ressources[cache_local.nb++] = r->id;
+            /* Un thread a pu commencer a attendre entre-temps : il volera */
+            if (atomic_load(&p->en_attente) == 0) return;
+            pthread_mutex_lock(&p->mutex);
+            pthread_cond_signal(&p->cond);
+            pthread_mutex_unlock(&p->mutex);
+            return;
+        }
+    }
+
+    atomic_store_explicit(&r->etat, LIBRE, memory_order_release);
+    pile_empiler(p, r->id);
+    if (atomic_load(&p->en_attente) > 0) {
+        pthread_mutex_lock(&p->mutex);
+        pthread_cond_signal(&p->cond);
+        pthread_mutex_unlock(&p->mutex);
+    }
+}
+
+void pool_metriques(pool_t *p, pool_metriques_t *m) {
+    m->attentes = atomic_load(&p->attentes);
+    m->expirations = atomic_load(&p->expirations);
+    m->evictions = atomic_load(&p->evictions);
+    m->attente_totale_ns = atomic_load(&p->attente_totale_ns);
+    m->attente_max_ns = atomic_load(&p->attente_max_ns);
+    for (int b = 0; b < NB_BUCKETS_ATTENTE; b++) {
+        m->histogramme[b] = atomic_load(&p->histogramme[b]);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   Ressource typee : une connexion simulee
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    uint32_t id;
+    int numero;                         /* incremente a chaque reconnexion */
+    long requetes;
+    bool coupee;                        /* simulee pour la verification */
+} connexion_t;
+
+static atomic_int connexions_ouvertes;
+
+static void *connexion_ouvrir(void *ctx, uint32_t id) {
+    (void)ctx;
+    connexion_t *c = calloc(1, sizeof(*c));
+    if (c) {
+        c->id = id;
+        c->numero = atomic_fetch_add(&connexions_ouvertes, 1);
+    }
+    return c;
+}
+
+static void connexion_fermer(void *objet, void *ctx) {
+    (void)ctx;
+    free(objet);
+}
+
+static int connexion_verifier(void *objet, void *ctx) {
+    (void)ctx;
+    connexion_t *c = objet;
+    return c && !c->coupee;
+}
+
+/* ---------------------------------------------------------------------------
+   Benchmark
+   --------------------------------------------------------------------------- */
+
+#define NB_THREADS 64
+#define DUREE_MS 200
+#define UTILISATION 100           /* travail pendant la detention */
+#define NB_BUCKETS 40
+
+typedef enum { METH_SEMAPHORE, METH_POOL, NB_METHODES } methode_t;
+
+static const char *noms_methodes[NB_METHODES] = { "semaphore (29)", "pool" };
+
+static methode_t methode;
+static sem_t semaphore;
+static pool_t *pool;
+static atomic_bool depart, arret;
+
+typedef struct {
+    _Alignas(LIGNE_CACHE) long operations;
+    long histogramme[NB_BUCKETS];       /* latence prise + retour, log2 ns */
+} resultat_t;
+
+static resultat_t resultats[NB_THREADS];
+
+static void *client(void *arg) {
+    resultat_t *res = arg;
+    volatile long travail = 0;
+
+    while (!atomic_load_explicit(&depart, memory_order_acquire)) sched_yield();
+
+    while (!atomic_load_explicit(&arret, memory_order_relaxed)) {
+        int64_t t0 = maintenant_ns();
+        ressource_t *r = NULL;
+        if (methode == METH_SEMAPHORE) sem_wait(&semaphore);
+        else r = pool_prendre(pool, -1);
+        int64_t t1 = maintenant_ns();
+
+        if (r) ((connexion_t *)r->objet)->requetes++;
+        for (int k = 0; k < UTILISATION; k++) travail += k;
+
+        int64_t t2 = maintenant_ns();
+        if (methode == METH_SEMAPHORE) sem_post(&semaphore);
+        else pool_rendre(pool, r, 1);
+        int64_t t3 = maintenant_ns();
+
+        uint64_t ns = (uint64_t)((t1 - t0) + (t3 - t2));
+        int b = ns ? 63 - __builtin_clzll(ns) : 0;
+        res->histogramme[b < NB_BUCKETS ? b : NB_BUCKETS - 1]++;
+        res->operations++;
+    }
+    return NULL;
+}
+
+/* Borne haute (ns) du bucket contenant le percentile p */
+static uint64_t percentile(const long *histo, long total, double p) {
+    long cible = (long)(p / 100.0 * (double)total), cumul = 0;
+    for (int b = 0; b < NB_BUCKETS; b++) {
+        cumul += histo[b];
+        if (cumul > cible) return (uint64_t)2 << b;
+    }
+    return (uint64_t)1 << NB_BUCKETS;
+}
+
+static int mesurer(methode_t m, uint32_t taille) {
+    pthread_t threads[NB_THREADS];
+    pool_hooks_t hooks = {
+        .creer = connexion_ouvrir, .evincer = connexion_fermer,
+    };
+
+    methode = m;
+    if (m == METH_SEMAPHORE) sem_init(&semaphore, 0, taille);
+    else if (!(pool = pool_creer(taille, &hooks))) return -1;
+
+    memset(resultats, 0, sizeof(resultats));
+    atomic_store(&depart, false);
+    atomic_store(&arret, false);
+    for (int i = 0; i < NB_THREADS; i++) {
+        pthread_create(&threads[i], NULL, client, &resultats[i]);
+    }
+    int64_t debut = maintenant_ns();
+    atomic_store(&depart, true);
+    usleep(DUREE_MS * 1000);
+    atomic_store(&arret, true);
+    for (int i = 0; i < NB_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double duree = (double)(maintenant_ns() - debut) / 1e9;
+
+    long histo[NB_BUCKETS] = { 0 }, total = 0;
+    for (int i = 0; i < NB_THREADS; i++) {
+        total += resultats[i].operations;
+        for (int b = 0; b < NB_BUCKETS; b++) histo[b] += resultats[i].histogramme[b];
+    }
+
+    /* Chaque prise est attribuee a une connexion precise */
+    long requetes = 0;
+    pool_metriques_t pm = { 0 };
+    if (m == METH_POOL) {
+        for (uint32_t i = 0; i < taille; i++) {
+            requetes += ((connexion_t *)pool->ressources[i].objet)->requetes;
+        }
+        pool_metriques(pool, &pm);
+        pool_detruire(pool);
+        pool = NULL;
+    } else {
+        sem_destroy(&semaphore);
+        requetes = total;
+    }
+
+    printf("%-16s %6u %10.2f %8llu %8llu %8llu %9llu\n", noms_methodes[m], taille,
+           (double)total / duree / 1e6,
+           (unsigned long long)percentile(histo, total, 50.0),
+           (unsigned long long)percentile(histo, total, 99.0),
+           (unsigned long long)percentile(histo, total, 99.9),
+           (unsigned long long)pm.attentes);
+    return requetes == total ? 0 : 1;
+}
+
+int main(void) {
+    int erreurs = 0;
+
+    printf("=== Prise + retour, %d threads, %d ms ===\n", NB_THREADS, DUREE_MS);
+    printf("(latences : borne haute du bucket log2, en ns)\n\n");
+    printf("%-16s %6s %10s %8s %8s %8s %9s\n",
+           "Methode", "Taille", "Mops/s", "p50", "p99", "p99.9", "Attentes");
+    const uint32_t tailles[] = { 64, 8 };
+    for (size_t t = 0; t < sizeof(tailles) / sizeof(tailles[0]); t++) {
+        for (int m = 0; m < NB_METHODES; m++) {
+            int rc = mesurer((methode_t)m, tailles[t]);
+            if (rc < 0) {
+                fprintf(stderr, "Erreur creation du pool\n");
+                return 1;
+            }
+            erreurs += rc;
+        }
+    }
+
+    /* Timeout, verification et eviction */
+    printf("\n=== Timeout et sante ===\n");
+    pool_hooks_t hooks = {
+        .creer = connexion_ouvrir, .evincer = connexion_fermer,
+        .verifier = connexion_verifier, .verifier_apres_ns = 1,
+    };
+    pool_t *demo = pool_creer(2, &hooks);
+    if (!demo) return 1;
+    ressource_t *a = pool_prendre(demo, 0);
+    ressource_t *b = pool_prendre(demo, 0);
+    int64_t t0 = maintenant_ns();
+    ressource_t *c = pool_prendre(demo, 50);
+    printf("Pool epuise, timeout 50 ms : %s apres %.0f ms\n",
+           c ? "ressource obtenue" : "NULL (ETIMEDOUT)",
+           (double)(maintenant_ns() - t0) / 1e6);
+    erreurs += c != NULL;
+
+    /* Copie avant le retour : la connexion peut etre evincee (liberee)
+       par la prise suivante, la poignee rendue ne se dereference plus */
+    connexion_t *ca = a->objet;
+    uint32_t id = ca->id;
+    int numero = ca->numero;
+    ca->coupee = true;                  /* coupee pendant qu'elle dort au pool */
+    pool_rendre(demo, a, 1);
+    pool_rendre(demo, b, 1);
+    usleep(1000);
+    a = pool_prendre(demo, 0);
+    b = pool_prendre(demo, 0);
+    connexion_t *na = a->objet, *nb = b->objet;
+    bool renouvelee = (na->id == id ? na : nb)->numero != numero;
+    printf("Connexion %u coupee : %s\n", (unsigned)id,
+           renouvelee ? "evincee et rouverte a la prise" : "NON DETECTEE");
+    erreurs += !renouvelee;
+    pool_rendre(demo, a, 1);
+    pool_rendre(demo, b, 1);
+
+    pool_metriques_t m;
+    pool_metriques(demo, &m);
+    printf("Metriques : %llu attente(s), %llu expiration(s), %llu eviction(s), "
+           "attente max %.1f ms\n",
+           (unsigned long long)m.attentes, (unsigned long long)m.expirations,
+           (unsigned long long)m.evictions, (double)m.attente_max_ns / 1e6);
+    pool_detruire(demo);
+
+    printf("\nVerification : %s\n", erreurs == 0 ? "ressources et metriques coherentes" : "ECHEC");
+    return erreurs == 0 ? 0 : 1;
+}
@@ -0,0 +1,516 @@
+/* ============================================================================
+   Section 18.10.6 : Performance et cas d'usage
+   Description : Suite de microbenchmarks de concurrence etendant
+                 37_benchmark_atomics.c, threads epingles sur les coeurs
+                 - compteur partage de 1 a N threads : fetch_add relaxed,
+                   fetch_add seq_cst, boucle CAS, mutex
+                 - compteurs par thread voisins (faux partage) vs alignes
+                 - matrice de latence ping-pong d'une ligne de cache
+                   entre chaque paire de coeurs (echantillon reparti sur
+                   les paquets et noeuds NUMA au-dela de --matrice N)
+                 - aller-retour de message acquire/release vs seq_cst
+                 Sortie tableau ou CSV (--csv) pour comparer les machines
+   Fichier source : 10.6-performance-cas-usage.md
+   ============================================================================ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/utsname.h>
+
+#define LIGNE_CACHE 64
+#define MAX_THREADS 256
+#define NB_OPS 1000000
+#define NB_ALLERS_RETOURS 100000
+#define NB_PING_PONG_PAIRE 20000
+#define MAX_COEURS_MATRICE 16     /* defaut de --matrice : O(coeurs^2) mesures */
+#define SPINS_AVANT_YIELD 1024    /* garde-fou si deux threads partagent un coeur */
+
+/* ---------------------------------------------------------------------------
+   Sortie : une ligne par mesure, format tableau ou CSV
+   --------------------------------------------------------------------------- */
+
+static int sortie_csv;
+
+static void emettre_entete(void) {
+    if (sortie_csv) {
+        printf("suite,variante,threads,cpu_a,cpu_b,valeur,unite\n");
+    } else {
+        printf("%-12s %-20s %8s %6s %6s %12s %s\n",
+               "Suite", "Variante", "Threads", "CPU A", "CPU B", "Valeur", "Unite");
+    }
+}
+
+static void emettre(const char *suite, const char *variante, int threads,
+                    int cpu_a, int cpu_b, double valeur, const char *unite) {
+    if (sortie_csv) {
+        printf("%s,%s,%d,%d,%d,%.3f,%s\n", suite, variante, threads, cpu_a, cpu_b,
+               valeur, unite);
+    } else {
+        char a[12] = "-", b[12] = "-";
+        if (cpu_a >= 0) snprintf(a, sizeof(a), "%d", cpu_a);
+        if (cpu_b >= 0) snprintf(b, sizeof(b), "%d", cpu_b);
+        printf("%-12s %-20s %8d %6s %6s %12.2f %s\n", suite, variante, threads, a, b,
+               valeur, unite);
+    }
+    fflush(stdout);
+}
+
+/* Description de la machine : lignes '#' ignorees par les lecteurs CSV */
+static void emettre_machine(int nb_cpus) {
+    char modele[128] = "inconnu";
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    if (f) {
+        char ligne[256];
+        while (fgets(ligne, sizeof(ligne), f)) {
+            if (strncmp(ligne, "model name", 10) == 0) {
+                char *deux_points = strchr(ligne, ':');
+                if (deux_points) {
+                    snprintf(modele, sizeof(modele), "%s", deux_points + 2);
+                    modele[strcspn(modele, "\n")] = '\0';
+                }
+                break;
+            }
+        }
+        fclose(f);
+    }
+    struct utsname u;
+    uname(&u);
+    printf("# cpu=%s\n# cpus_autorises=%d\n# noyau=%s %s\n# compilateur=%s\n",
+           modele, nb_cpus, u.sysname, u.release, __VERSION__);
+}
+
+/* ---------------------------------------------------------------------------
+   Threads epingles
+   --------------------------------------------------------------------------- */
+
+static int cpus[MAX_THREADS];   /* CPU autorises par l'affinite du processus */
+static int nb_cpus;
+
+static void lister_cpus(void) {
+    cpu_set_t ens;
+    nb_cpus = 0;
+    if (sched_getaffinity(0, sizeof(ens), &ens) == 0) {
+        for (int c = 0; c < CPU_SETSIZE && nb_cpus < MAX_THREADS; c++) {
+            if (CPU_ISSET(c, &ens)) cpus[nb_cpus++] = c;
+        }
+    }
+    if (nb_cpus == 0) {
+        cpus[0] = 0;
+        nb_cpus = 1;
+    }
+}
+
+/* Paquet physique et noeud NUMA d'un CPU (sysfs) ; 0 si inconnu */
+static int lire_paquet(int cpu) {
+    char chemin[96];
+    snprintf(chemin, sizeof(chemin), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", cpu);
+    FILE *f = fopen(chemin, "r");
+    int paquet = 0;
+    if (f) {
+        if (fscanf(f, "%d", &paquet) != 1) paquet = 0;
+        fclose(f);
+    }
+    return paquet;
+}
+
+static int lire_noeud(int cpu) {
+    char chemin[64];
+    snprintf(chemin, sizeof(chemin), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *d = opendir(chemin);
+    int noeud = 0;
+    if (d) {
+        struct dirent *e;
+        while ((e = readdir(d)) != NULL) {
+            if (strncmp(e->d_name, "node", 4) == 0 && e->d_name[4] >= '0' && e->d_name[4] <= '9') {
+                noeud = atoi(e->d_name + 4);
+                break;
+            }
+        }
+        closedir(d);
+    }
+    return noeud;
+}
+
+static int comparer_int(const void *a, const void *b) {
+    return (*(const int *)a > *(const int *)b) - (*(const int *)a < *(const int *)b);
+}
+
+static int compter_distincts(const int *v, int n) {
+    int distincts = 0;
+    for (int i = 0; i < n; i++) {
+        int j = 0;
+        while (j < i && v[j] != v[i]) j++;
+        distincts += j == i;
+    }
+    return distincts;
+}
+
+/* CPU de la matrice : tous si n >= nb_cpus, sinon un echantillon pris a
+   tour de role dans chaque groupe (paquet, noeud NUMA), pour garder des
+   paires entre sockets au lieu des n premiers CPU du premier paquet */
+static int choisir_cpus_matrice(int n, int *choix, int *nb_paquets, int *nb_noeuds) {
+    static int paquet[MAX_THREADS], noeud[MAX_THREADS], groupe[MAX_THREADS];
+    int nb_groupes = 0;
+    for (int i = 0; i < nb_cpus; i++) {
+        paquet[i] = lire_paquet(cpus[i]);
+        noeud[i] = lire_noeud(cpus[i]);
+        int g = 0;
+        while (g < i && (paquet[g] != paquet[i] || noeud[g] != noeud[i])) g++;
+        groupe[i] = g == i ? nb_groupes++ : groupe[g];
+    }
+    *nb_paquets = compter_distincts(paquet, nb_cpus);
+    *nb_noeuds = compter_distincts(noeud, nb_cpus);
+    if (n >= nb_cpus) {
+        memcpy(choix, cpus, (size_t)nb_cpus * sizeof(int));
+        return nb_cpus;
+    }
+    int nb = 0;
+    for (int rang = 0; nb < n; rang++) {
+        for (int g = 0; g < nb_groupes && nb < n; g++) {
+            /* rang-ieme CPU du groupe g, s'il existe */
+            int vus = 0;
+            for (int i = 0; i < nb_cpus; i++) {
+                if (groupe[i] == g && vus++ == rang) {
+                    choix[nb++] = cpus[i];
+                    break;
+                }
+            }
+        }
+    }
+    qsort(choix, (size_t)nb, sizeof(int), comparer_int);
+    return nb;
+}
+
+static void epingler(pthread_t t, int cpu) {
+    cpu_set_t ens;
+    CPU_ZERO(&ens);
+    CPU_SET(cpu, &ens);
+    pthread_setaffinity_np(t, sizeof(ens), &ens);
+}
+
+static inline void pause_cpu(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __asm__ __volatile__("pause");
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+/* Attente active ; cede le coeur de temps en temps s'il est partage */
+#define ATTENDRE(condition)                                         \
+    do {                                                            \
+        unsigned spins_ = 0;                                        \
+        while (!(condition)) {                                      \
+            pause_cpu();                                            \
+            if (++spins_ % SPINS_AVANT_YIELD == 0) sched_yield();   \
+        }                                                           \
+    } while (0)
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Lance n threads epingles sur cpus[i % nb_cpus], depart synchronise.
+   Retourne la duree entre le depart et la fin du dernier thread */
+static atomic_int prets;
+static atomic_int top_depart;
+
+static void attendre_depart(void) {
+    atomic_fetch_add(&prets, 1);
+    ATTENDRE(atomic_load_explicit(&top_depart, memory_order_acquire));
+}
+
+static double lancer(int n, void *(*fonction)(void *)) {
+    pthread_t threads[MAX_THREADS];
+    atomic_store(&prets, 0);
+    atomic_store(&top_depart, 0);
+    for (long i = 0; i < n; i++) {
+        pthread_create(&threads[i], NULL, fonction, (void *)i);
+        epingler(threads[i], cpus[i % nb_cpus]);
+    }
+    ATTENDRE(atomic_load(&prets) == n);
+    double debut = secondes();
+    atomic_store_explicit(&top_depart, 1, memory_order_release);
+    for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    return secondes() - debut;
+}
+
+/* ---------------------------------------------------------------------------
+   1. Compteur partage
+   --------------------------------------------------------------------------- */
+
+static _Alignas(LIGNE_CACHE) atomic_long compteur;
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static long compteur_mutex;
+
+static void *partage_relaxed(void *arg) {
+    (void)arg;
+    attendre_depart();
+    for (int i = 0; i < NB_OPS; i++) {
+        atomic_fetch_add_explicit(&compteur, 1, memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static void *partage_seq_cst(void *arg) {
+    (void)arg;
+    attendre_depart();
+    for (int i = 0; i < NB_OPS; i++) atomic_fetch_add(&compteur, 1);
+    return NULL;
+}
+
+static void *partage_cas(void *arg) {
+    (void)arg;
+    attendre_depart();
+    for (int i = 0; i < NB_OPS; i++) {
+        long v = atomic_load_explicit(&compteur, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&compteur, &v, v + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+        }
+    }
+    return NULL;
+}
+
+static void *partage_mutex(void *arg) {
+    (void)arg;
+    attendre_depart();
+    for (int i = 0; i < NB_OPS; i++) {
+        pthread_mutex_lock(&mutex);
+        compteur_mutex++;
+        pthread_mutex_unlock(&mutex);
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+   2. Compteurs par thread : voisins vs un par ligne de cache
+   --------------------------------------------------------------------------- */
+
+static atomic_long voisins[MAX_THREADS];
+
+typedef struct {
+    _Alignas(LIGNE_CACHE) atomic_long valeur;
+} compteur_aligne_t;
+
+static compteur_aligne_t alignes[MAX_THREADS];
+
+/* Ecrivain unique : load + store relaxed, aucune instruction lock */
+static void *prive_voisins(void *arg) {
+    atomic_long *c = &voisins[(long)arg];
+    attendre_depart();
+    for (int i = 0; i < NB_OPS; i++) {
+        atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+    }
+    return NULL;
+}
+
+static void *prive_alignes(void *arg) {
+    atomic_long *c = &alignes[(long)arg].valeur;
+    attendre_depart();
+    for (int i = 0; i < NB_OPS; i++) {
+        atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1,
+                              memory_order_relaxed);
+    }
+    return NULL;
+}
+
+/* ---------------------------------------------------------------------------
+   3. Ping-pong d'une ligne de cache entre deux coeurs
+   4. Aller-retour de message : charge utile + numero de sequence
+   --------------------------------------------------------------------------- */
+
+static _Alignas(LIGNE_CACHE) atomic_int balle;
+static int nb_echanges;
+
+static void *renvoyeur(void *arg) {
+    (void)arg;
+    attendre_depart();
+    for (int i = 0; i < nb_echanges; i++) {
+        ATTENDRE(atomic_load_explicit(&balle, memory_order_acquire) == 1);
+        atomic_store_explicit(&balle, 0, memory_order_release);
+    }
+    return NULL;
+}
+
+static double ping_pong(int cpu_a, int cpu_b, int n) {
+    pthread_t t;
+    nb_echanges = n;
+    atomic_store(&balle, 0);
+    atomic_store(&prets, 0);
+    atomic_store(&top_depart, 0);
+    pthread_create(&t, NULL, renvoyeur, NULL);
+    epingler(t, cpu_b);
+    epingler(pthread_self(), cpu_a);
+
+    ATTENDRE(atomic_load(&prets) == 1);
+    atomic_store_explicit(&top_depart, 1, memory_order_release);
+    double debut = secondes();
+    for (int i = 0; i < n; i++) {
+        atomic_store_explicit(&balle, 1, memory_order_release);
+        ATTENDRE(atomic_load_explicit(&balle, memory_order_acquire) == 0);
+    }
+    double duree = secondes() - debut;
+    pthread_join(t, NULL);
+    return duree / n * 1e9;
+}
+
+/* Message de 6 mots publie par un numero de sequence (un producteur,
+   un consommateur), reponse sur une autre ligne */
+typedef struct {
+    _Alignas(LIGNE_CACHE) long donnees[6];
+    atomic_long sequence;
+    _Alignas(LIGNE_CACHE) atomic_long reponse;
+} boite_t;
+
+static boite_t boite;
+static int ordre_seq_cst;
+static atomic_long erreurs_message;
+
+static void *consommateur(void *arg) {
+    (void)arg;
+    memory_order charger = ordre_seq_cst ? memory_order_seq_cst : memory_order_acquire;
+    memory_order publier = ordre_seq_cst ? memory_order_seq_cst : memory_order_release;
+    attendre_depart();
+    for (long s = 1; s <= nb_echanges; s++) {
+        ATTENDRE(atomic_load_explicit(&boite.sequence, charger) == s);
+        long somme = 0;
+        for (int k = 0; k < 6; k++) somme += boite.donnees[k];
+        if (somme != 6 * s) atomic_fetch_add(&erreurs_message, 1);
+        atomic_store_explicit(&boite.reponse, s, publier);
+    }
+    return NULL;
+}
+
+static double message(int cpu_a, int cpu_b, int n, int seq_cst) {
+    pthread_t t;
+    memory_order charger = seq_cst ? memory_order_seq_cst : memory_order_acquire;
+    memory_order publier = seq_cst ? memory_order_seq_cst : memory_order_release;
+
+    ordre_seq_cst = seq_cst;
+    nb_echanges = n;
+    atomic_store(&boite.sequence, 0);
+    atomic_store(&boite.reponse, 0);
+    atomic_store(&prets, 0);
+    atomic_store(&top_depart, 0);
+    pthread_create(&t, NULL, consommateur, NULL);
+    epingler(t, cpu_b);
+    epingler(pthread_self(), cpu_a);
+
+    ATTENDRE(atomic_load(&prets) == 1);
+    atomic_store_explicit(&top_depart, 1, memory_order_release);
+    double debut = secondes();
+    for (long s = 1; s <= n; s++) {
+        for (int k = 0; k < 6; k++) boite.donnees[k] = s;
+        atomic_store_explicit(&boite.sequence, s, publier);
+        ATTENDRE(atomic_load_explicit(&boite.reponse, charger) == s);
+    }
+    double duree = secondes() - debut;
+    pthread_join(t, NULL);
+    return duree / n * 1e9;
+}
+
+/* ---------------------------------------------------------------------------
+   Programme principal
+   --------------------------------------------------------------------------- */
+
+int main(int argc, char *argv[]) {
+    int max_threads = 0, max_matrice = MAX_COEURS_MATRICE;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--csv") == 0) sortie_csv = 1;
+        else if (strcmp(argv[i], "--matrice") == 0 && i + 1 < argc) max_matrice = atoi(argv[++i]);
+        else max_threads = atoi(argv[i]);
+    }
+    lister_cpus();
+    if (max_threads <= 0 || max_threads > nb_cpus) max_threads = nb_cpus;
+
+    emettre_machine(nb_cpus);
+    emettre_entete();
+
+    /* Balayage 1, 2, 4, ..., max_threads (toujours inclus) */
+    int paliers[MAX_THREADS], nb_paliers = 0;
+    for (int n = 1; n < max_threads; n *= 2) paliers[nb_paliers++] = n;
+    paliers[nb_paliers++] = max_threads;
+
+    struct {
+        const char *nom;
+        void *(*fonction)(void *);
+    } partages[] = {
+        { "fetch_add_relaxed", partage_relaxed },
+        { "fetch_add_seq_cst", partage_seq_cst },
+        { "boucle_cas", partage_cas },
+        { "mutex", partage_mutex },
+    };
+    int erreurs = 0;
+    for (size_t v = 0; v < sizeof(partages) / sizeof(partages[0]); v++) {
+        for (int p = 0; p < nb_paliers; p++) {
+            int n = paliers[p];
+            atomic_store(&compteur, 0);
+            compteur_mutex = 0;
+            double duree = lancer(n, partages[v].fonction);
+            long total = partages[v].fonction == partage_mutex
+                         ? compteur_mutex : atomic_load(&compteur);
+            erreurs += total != (long)n * NB_OPS;
+            emettre("partage", partages[v].nom, n, -1, -1,
+                    (double)n * NB_OPS / duree / 1e6, "Mops/s");
+        }
+    }
+
+    for (int p = 0; p < nb_paliers; p++) {
+        int n = paliers[p];
+        double d_voisins = lancer(n, prive_voisins);
+        double d_alignes = lancer(n, prive_alignes);
+        emettre("prive", "voisins", n, -1, -1, (double)n * NB_OPS / d_voisins / 1e6, "Mops/s");
+        emettre("prive", "alignes", n, -1, -1, (double)n * NB_OPS / d_alignes / 1e6, "Mops/s");
+    }
+
+    /* Latence aller simple = aller-retour / 2 */
+    static int matrice[MAX_THREADS];
+    int nb_paquets, nb_noeuds;
+    int nb_matrice = choisir_cpus_matrice(max_matrice <= 0 ? nb_cpus : max_matrice, matrice,
+                                          &nb_paquets, &nb_noeuds);
+    printf("# matrice=%d/%d cpus, %d paquet(s), %d noeud(s) numa\n", nb_matrice, nb_cpus, nb_paquets,
+           nb_noeuds);
+    if (nb_matrice < nb_cpus) {
+        printf("# matrice tronquee : echantillon reparti sur les paquets et noeuds, "
+               "--matrice 0 pour toutes les paires\n");
+    }
+    if (nb_matrice < 2) {
+        /* Un seul coeur : les deux threads se relaient sur le meme CPU */
+        emettre("ping_pong", "meme_cpu", 2, cpus[0], cpus[0],
+                ping_pong(cpus[0], cpus[0], 1000) / 2, "ns");
+    }
+    for (int a = 0; a < nb_matrice; a++) {
+        for (int b = 0; b < nb_matrice; b++) {
+            if (a == b) continue;
+            emettre("ping_pong", "ligne_cache", 2, matrice[a], matrice[b],
+                    ping_pong(matrice[a], matrice[b], NB_PING_PONG_PAIRE) / 2, "ns");
+        }
+    }
+
+    int cpu_b = cpus[nb_cpus > 1 ? 1 : 0];
+    int allers = nb_cpus > 1 ? NB_ALLERS_RETOURS : 1000;
+    atomic_store(&erreurs_message, 0);
+    emettre("message", "acquire_release", 2, cpus[0], cpu_b,
+            message(cpus[0], cpu_b, allers, 0), "ns");
+    emettre("message", "seq_cst", 2, cpus[0], cpu_b,
+            message(cpus[0], cpu_b, allers, 1), "ns");
+    erreurs += (int)atomic_load(&erreurs_message);
+
+    printf("# verification=%s\n", erreurs == 0 ? "ok" : "ECHEC");
+    return erreurs == 0 ? 0 : 1;
+}
@@ -0,0 +1,506 @@
+/* ============================================================================
+   Section 18.12 : Thread-local storage
+   Description : Allocateur slab d'objets de taille fixe a magazines
+                 (Bonwick) construit sur __thread
+                 - deux magazines par thread et par cache en TLS : alloc et
+                   free sans verrou ni instruction atomique
+                 - depot partage echangeant des magazines pleins / vides
+                   (un verrou tous les MAG_TAILLE objets)
+                 - liberation depuis un autre thread : l'objet rejoint le
+                   magazine du thread qui libere, les magazines circulent
+                   par le depot (producteur -> consommateur)
+                 - vidage automatique a la sortie du thread (destructeur
+                   pthread_key, __thread n'en a pas)
+                 Benchmark contre malloc et le pool de 24/06 sous mutex
+   Fichier source : 12-thread-local-storage.md
+   ============================================================================ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MAG_TAILLE 64             /* objets par magazine */
+#define SLAB_TAILLE (64 * 1024)   /* tranche demandee a malloc */
+#define SLAB_MAX_CACHES 8
+#define ALIGNEMENT 16
+
+/* ---------------------------------------------------------------------------
+   API
+   --------------------------------------------------------------------------- */
+
+typedef struct magazine {
+    struct magazine *suivant;
+    int nb;
+    void *objets[MAG_TAILLE];
+} magazine_t;
+
+typedef struct slab {
+    struct slab *suivant;
+} slab_t;
+
+typedef struct {
+    char nom[32];
+    size_t taille_objet;
+    int index;                          /* entree dans le TLS */
+    unsigned long id;                   /* unique, detecte un index recycle */
+
+    pthread_mutex_t depot;              /* protege tout ce qui suit */
+    magazine_t *pleins;
+    magazine_t *vides;
+    slab_t *slabs;
+    char *bump, *bump_fin;              /* tranche en cours de decoupage */
+    size_t objets_crees;
+    size_t echanges;
+} slab_cache_t;
+
+typedef struct {
+    unsigned long id;
+    slab_cache_t *cache;
+    magazine_t *charge;                 /* magazine courant */
+    magazine_t *precedent;              /* plein ou vide, evite le ping-pong au depot */
+} tls_cache_t;
+
+static __thread tls_cache_t tls_caches[SLAB_MAX_CACHES];
+
+static pthread_mutex_t registre_mutex = PTHREAD_MUTEX_INITIALIZER;
+static slab_cache_t *registre[SLAB_MAX_CACHES];
+static unsigned long prochain_id = 1;
+static pthread_key_t cle_sortie;
+static pthread_once_t cle_once = PTHREAD_ONCE_INIT;
+
+static void depot_rendre(slab_cache_t *c, magazine_t *m) {
+    if (!m) return;
+    if (m->nb > 0) {
+        m->suivant = c->pleins;
+        c->pleins = m;
+    } else {
+        m->suivant = c->vides;
+        c->vides = m;
+    }
+}
+
+/* Rend les magazines du thread courant au depot */
+void slab_vider_thread(slab_cache_t *c) {
+    tls_cache_t *t = &tls_caches[c->index];
+    if (t->id != c->id) return;
+    pthread_mutex_lock(&c->depot);
+    depot_rendre(c, t->charge);
+    depot_rendre(c, t->precedent);
+    pthread_mutex_unlock(&c->depot);
+    t->charge = t->precedent = NULL;
+}
+
+/* Destructeur de la cle : appele a la sortie de chaque thread qui a
+   utilise un cache, pendant que son TLS est encore valide */
+static void sortie_thread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&registre_mutex);
+    for (int i = 0; i < SLAB_MAX_CACHES; i++) {
+        slab_cache_t *c = registre[i];
+        if (c && tls_caches[i].id == c->id) slab_vider_thread(c);
+    }
+    pthread_mutex_unlock(&registre_mutex);
+}
+
+static void creer_cle(void) {
+    pthread_key_create(&cle_sortie, sortie_thread);
+}
+
+slab_cache_t *slab_creer(const char *nom, size_t taille_objet) {
+    pthread_once(&cle_once, creer_cle);
+    slab_cache_t *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    snprintf(c->nom, sizeof(c->nom), "%s", nom);
+    if (taille_objet < sizeof(void *)) taille_objet = sizeof(void *);
+    c->taille_objet = (taille_objet + ALIGNEMENT - 1) & ~(size_t)(ALIGNEMENT - 1);
+    pthread_mutex_init(&c->depot, NULL);
+
+    pthread_mutex_lock(&registre_mutex);
+    c->index = -1;
+    for (int i = 0; i < SLAB_MAX_CACHES; i++) {
+        if (!registre[i]) {
+            registre[i] = c;
+            c->index = i;
+            c->id = prochain_id++;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&registre_mutex);
+    if (c->index < 0) {
+        pthread_mutex_destroy(&c->depot);
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+/* Tous les objets doivent avoir ete liberes et les threads utilisateurs
+   termines (ou avoir appele slab_vider_thread) */
+void slab_detruire(slab_cache_t *c) {
+    if (!c) return;
+    slab_vider_thread(c);
+    pthread_mutex_lock(&registre_mutex);
+    registre[c->index] = NULL;
+    pthread_mutex_unlock(&registre_mutex);
+
+    magazine_t *listes[2] = { c->pleins, c->vides };
+    for (int l = 0; l < 2; l++) {
+        while (listes[l]) {
+            magazine_t *suivant = listes[l]->suivant;
+            free(listes[l]);
+            listes[l] = suivant;
+        }
+    }
+    while (c->slabs) {
+        slab_t *suivant = c->slabs->suivant;
+        free(c->slabs);
+        c->slabs = suivant;
+    }
+    pthread_mutex_destroy(&c->depot);
+    free(c);
+}
+
+static tls_cache_t *tls_pour(slab_cache_t *c) {
+    tls_cache_t *t = &tls_caches[c->index];
+    if (t->id != c->id) {
+        /* Premier usage de ce cache par ce thread : armer le vidage */
+        t->id = c->id;
+        t->cache = c;
+        t->charge = t->precedent = NULL;
+        pthread_setspecific(cle_sortie, (void *)1);
+    }
+    return t;
+}
+
+/* Remplit m depuis les slabs (depot verrouille) */
+static int remplir_depuis_slabs(slab_cache_t *c, magazine_t *m) {
+    while (m->nb < MAG_TAILLE / 2) {
+        /* Sans slab (bump NULL), NULL + taille serait indefini : tester d'abord */
+        if (!c->bump || (size_t)(c->bump_fin - c->bump) < c->taille_objet) {
+            slab_t *s = malloc(SLAB_TAILLE);
+            if (!s) break;
+            s->suivant = c->slabs;
+            c->slabs = s;
+            c->bump = (char *)s + ALIGNEMENT;
+            c->bump_fin = (char *)s + SLAB_TAILLE;
+        }
+        m->objets[m->nb++] = c->bump;
+        c->bump += c->taille_objet;
+        c->objets_crees++;
+    }
+    return m->nb;
+}
+
+static magazine_t *magazine_vide(slab_cache_t *c) {
+    magazine_t *m = c->vides;
+    if (m) {
+        c->vides = m->suivant;
+    } else {
+        m = malloc(sizeof(*m));
+        if (m) m->nb = 0;
+    }
+    return m;
+}
+
+void *slab_alloc(slab_cache_t *c) {
+    tls_cache_t *t = tls_pour(c);
+
+    /* Chemin rapide : aucun verrou, aucune instruction atomique */
+    if (t->charge && t->charge->nb > 0) return t->charge->objets[--t->charge->nb];
+    if (t->precedent && t->precedent->nb > 0) {
+        magazine_t *m = t->charge;
+        t->charge = t->precedent;
+        t->precedent = m;
+        return t->charge->objets[--t->charge->nb];
+    }
+
+    /* Les deux sont vides : echanger un vide contre un plein au depot */
+    pthread_mutex_lock(&c->depot);
+    magazine_t *plein = c->pleins;
+    if (plein) {
+        c->pleins = plein->suivant;
+        c->echanges++;
+    } else {
+        plein = t->charge ? t->charge : magazine_vide(c);
+        if (plein && plein == t->charge) t->charge = NULL;
+        if (!plein || remplir_depuis_slabs(c, plein) == 0) {
+            if (plein) depot_rendre(c, plein);
+            pthread_mutex_unlock(&c->depot);
+            return NULL;
+        }
+    }
+    depot_rendre(c, t->precedent);
+    t->precedent = t->charge;
+    t->charge = plein;
+    pthread_mutex_unlock(&c->depot);
+    return t->charge->objets[--t->charge->nb];
+}
+
+void slab_free(slab_cache_t *c, void *p) {
+    if (!p) return;
+    tls_cache_t *t = tls_pour(c);
+
+    if (t->charge && t->charge->nb < MAG_TAILLE) {
+        t->charge->objets[t->charge->nb++] = p;
+        return;
+    }
+    if (t->precedent && t->precedent->nb < MAG_TAILLE) {
+        magazine_t *m = t->charge;
+        t->charge = t->precedent;
+        t->precedent = m;
+        t->charge->objets[t->charge->nb++] = p;
+        return;
+    }
+
+    /* Les deux sont pleins (ou absents) : deposer un plein, prendre un vide */
+    pthread_mutex_lock(&c->depot);
+    magazine_t *vide = magazine_vide(c);
+    if (vide && t->precedent) c->echanges++;
+    if (!vide) {
+        pthread_mutex_unlock(&c->depot);
+        abort();                        /* plus de memoire pour un magazine */
+    }
+    depot_rendre(c, t->precedent);
+    t->precedent = t->charge;
+    t->charge = vide;
+    pthread_mutex_unlock(&c->depot);
+    t->charge->objets[t->charge->nb++] = p;
+}
+
+/* Objets presents au depot (threads termines ou vides) */
+static size_t slab_objets_au_depot(slab_cache_t *c) {
+    size_t n = 0;
+    pthread_mutex_lock(&c->depot);
+    for (magazine_t *m = c->pleins; m; m = m->suivant) n += (size_t)m->nb;
+    pthread_mutex_unlock(&c->depot);
+    return n;
+}
+
+/* ---------------------------------------------------------------------------
+   Reference : pool de 24-gestion-memoire-avancee/06_pool_allocator.c
+   protege par un mutex global
+   --------------------------------------------------------------------------- */
+
+typedef struct PoolBlock {
+    struct PoolBlock *next;
+} PoolBlock;
+
+typedef struct {
+    void *memory;
+    PoolBlock *free_list;
+    pthread_mutex_t mutex;
+} Pool;
+
+static int pool_create(Pool *pool, size_t block_size, size_t num_blocks) {
+    if (block_size < sizeof(PoolBlock)) block_size = sizeof(PoolBlock);
+    pool->memory = malloc(block_size * num_blocks);
+    if (!pool->memory) return -1;
+    pool->free_list = pool->memory;
+    PoolBlock *current = pool->free_list;
+    for (size_t i = 0; i < num_blocks - 1; i++) {
+        current->next = (PoolBlock *)((char *)current + block_size);
+        current = current->next;
+    }
+    current->next = NULL;
+    pthread_mutex_init(&pool->mutex, NULL);
+    return 0;
+}
+
+static void *pool_alloc(Pool *pool) {
+    pthread_mutex_lock(&pool->mutex);
+    PoolBlock *block = pool->free_list;
+    if (block) pool->free_list = block->next;
+    pthread_mutex_unlock(&pool->mutex);
+    return block;
+}
+
+static void pool_free(Pool *pool, void *ptr) {
+    pthread_mutex_lock(&pool->mutex);
+    PoolBlock *block = ptr;
+    block->next = pool->free_list;
+    pool->free_list = block;
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void pool_destroy(Pool *pool) {
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->memory);
+}
+
+/* ---------------------------------------------------------------------------
+   Benchmark
+   --------------------------------------------------------------------------- */
+
+#define TAILLE_OBJET 64
+#define LOT 32                    /* objets vivants par thread en mode local */
+#define NB_PAIRES_PAR_THREAD 2000000
+#define MAX_THREADS 64
+#define ANNEAU 1024               /* file SPSC producteur -> consommateur */
+
+typedef enum { METH_MALLOC, METH_POOL_MUTEX, METH_SLAB, NB_METHODES } methode_t;
+
+static const char *noms_methodes[NB_METHODES] = { "malloc", "pool 06 + mutex", "slab magazines" };
+
+static methode_t methode;
+static slab_cache_t *cache;
+static Pool pool;
+static atomic_long corruptions;
+
+static inline void *allouer(void) {
+    switch (methode) {
+    case METH_MALLOC:     return malloc(TAILLE_OBJET);
+    case METH_POOL_MUTEX: return pool_alloc(&pool);
+    default:              return slab_alloc(cache);
+    }
+}
+
+static inline void liberer(void *p) {
+    switch (methode) {
+    case METH_MALLOC:     free(p); break;
+    case METH_POOL_MUTEX: pool_free(&pool, p); break;
+    default:              slab_free(cache, p); break;
+    }
+}
+
+/* Local : chaque thread alloue un lot puis le libere */
+static void *travail_local(void *arg) {
+    (void)arg;
+    void *lot[LOT];
+    for (long n = 0; n < NB_PAIRES_PAR_THREAD; n += LOT) {
+        for (int i = 0; i < LOT; i++) {
+            lot[i] = allouer();
+            *(long *)lot[i] = n + i;
+        }
+        for (int i = LOT; i-- > 0;) {
+            if (*(long *)lot[i] != n + i) atomic_fetch_add(&corruptions, 1);
+            liberer(lot[i]);
+        }
+    }
+    return NULL;
+}
+
+/* Inter-threads : le producteur alloue, le consommateur libere */
+typedef struct {
+    _Alignas(64) atomic_size_t tete;
+    _Alignas(64) atomic_size_t queue;
+    void *objets[ANNEAU];
+} anneau_t;
+
+static anneau_t anneaux[MAX_THREADS / 2];
+
+static void *producteur(void *arg) {
+    anneau_t *a = arg;
+    for (long n = 0; n < NB_PAIRES_PAR_THREAD; n++) {
+        void *p = allouer();
+        *(long *)p = n;
+        size_t t = atomic_load_explicit(&a->tete, memory_order_relaxed);
+        while (t - atomic_load_explicit(&a->queue, memory_order_acquire) == ANNEAU) {
+            sched_yield();
+        }
+        a->objets[t % ANNEAU] = p;
+        atomic_store_explicit(&a->tete, t + 1, memory_order_release);
+    }
+    return NULL;
+}
+
+static void *consommateur(void *arg) {
+    anneau_t *a = arg;
+    for (long n = 0; n < NB_PAIRES_PAR_THREAD; n++) {
+        size_t q = atomic_load_explicit(&a->queue, memory_order_relaxed);
+        while (atomic_load_explicit(&a->tete, memory_order_acquire) == q) sched_yield();
+        void *p = a->objets[q % ANNEAU];
+        atomic_store_explicit(&a->queue, q + 1, memory_order_release);
+        if (*(long *)p != n) atomic_fetch_add(&corruptions, 1);
+        liberer(p);
+    }
+    return NULL;
+}
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Retourne des millions de paires alloc/free par seconde */
+static double mesurer(methode_t m, int nb_threads, bool inter_threads) {
+    pthread_t threads[MAX_THREADS];
+    methode = m;
+    if (m == METH_POOL_MUTEX
+        && pool_create(&pool, TAILLE_OBJET, (size_t)nb_threads * (LOT + ANNEAU)) != 0) {
+        return -1.0;
+    }
+    if (m == METH_SLAB && !(cache = slab_creer("objet64", TAILLE_OBJET))) return -1.0;
+
+    double debut = secondes();
+    for (int i = 0; i < nb_threads; i++) {
+        if (!inter_threads) {
+            pthread_create(&threads[i], NULL, travail_local, NULL);
+        } else {
+            anneau_t *a = &anneaux[i / 2];
+            if (i % 2 == 0) {
+                atomic_store(&a->tete, 0);
+                atomic_store(&a->queue, 0);
+            }
+            pthread_create(&threads[i], NULL, i % 2 ? consommateur : producteur, a);
+        }
+    }
+    for (int i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double duree = secondes() - debut;
+
+    if (m == METH_POOL_MUTEX) pool_destroy(&pool);
+    if (m == METH_SLAB) {
+        /* Threads termines : tous les objets doivent etre revenus au depot */
+        if (slab_objets_au_depot(cache) != cache->objets_crees) {
+            atomic_fetch_add(&corruptions, 1);
+        }
+        slab_detruire(cache);
+        cache = NULL;
+    }
+
+    long paires = inter_threads ? (long)(nb_threads / 2) * NB_PAIRES_PAR_THREAD
+                                : (long)nb_threads * NB_PAIRES_PAR_THREAD;
+    return (double)paires / duree / 1e6;
+}
+
+int main(int argc, char *argv[]) {
+    long nb_coeurs = sysconf(_SC_NPROCESSORS_ONLN);
+    int max_threads = argc > 1 ? atoi(argv[1]) : (int)(nb_coeurs > 1 ? nb_coeurs : 2);
+    if (max_threads < 2) max_threads = 2;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+    printf("=== Paires alloc/free d'objets de %d octets (Mpaires/s) ===\n", TAILLE_OBJET);
+    printf("(%ld coeurs, magazines de %d objets)\n\n", nb_coeurs, MAG_TAILLE);
+    printf("%-10s %-18s %8s %12s\n", "Scenario", "Allocateur", "Threads", "Mpaires/s");
+
+    for (int inter = 0; inter <= 1; inter++) {
+        for (int m = 0; m < NB_METHODES; m++) {
+            for (int n = inter ? 2 : 1; n <= max_threads; n *= 2) {
+                double debit = mesurer((methode_t)m, n, inter);
+                if (debit < 0) {
+                    fprintf(stderr, "Erreur allocation\n");
+                    return 1;
+                }
+                printf("%-10s %-18s %8d %12.1f\n", inter ? "inter" : "local",
+                       noms_methodes[m], n, debit);
+            }
+        }
+        printf("\n");
+    }
+
+    long erreurs = atomic_load(&corruptions);
+    printf("Verification : %s\n", erreurs == 0
+           ? "aucune corruption, tous les objets revenus au depot" : "ECHEC");
+    return erreurs == 0 ? 0 : 1;
+}
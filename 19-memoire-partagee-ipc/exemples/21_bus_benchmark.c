@@ -0,0 +1,327 @@
+/* ============================================================================
+   Section 19.3 : Message Queues System V
+   Description : Bus de messages partage (21_bus_messages.h) contre la file
+                 System V de 05_server_priority.c
+                 - producteurs forkes, consommateur unique, 3 priorites
+                 - charge saturee (debit) et cadencee (latence de reveil)
+                 - msgrcv(-3) bloquant / bus strict / bus pondere 4:2:1
+                 - latence p50/p99 par priorite (hdr_histogram.h)
+                 - verification : ordre, contenu, blocs de l'arene rendus
+   Fichier source : 03-message-queues.md
+   ============================================================================ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/msg.h>
+#include <sys/wait.h>
+#include "21_bus_messages.h"
+#include "hdr_histogram.h"
+
+#define NOM_BUS         "/bus_benchmark"
+#define MAX_PRODUCTEURS 8
+#define BUDGET_OCTETS   (128L << 20)    /* par producteur, en mode sature */
+#define CADENCE_US      100             /* pause entre deux envois, mode cadence */
+#define SYSV_MAX        65536
+
+typedef enum { METH_SYSV, METH_BUS_STRICT, METH_BUS_PONDERE, NB_METHODES } methode_t;
+
+static const char *noms_methodes[NB_METHODES] = {
+    "SysV msgrcv(-3)", "bus strict", "bus pondere 4:2:1"
+};
+
+static const char *noms_priorites[BUS_PRIORITES] = { "urgent", "normal", "basse" };
+
+/* En-tete de chaque charge utile, suivi d'un motif verifiable */
+typedef struct {
+    uint64_t envoi_ns;
+    uint32_t producteur;
+    uint32_t sequence;                  /* par producteur et par priorite */
+} entete_t;
+
+struct message_sysv {
+    long mtype;                         /* priorite + 1 : msgrcv(-3) sert le plus petit */
+    unsigned char texte[SYSV_MAX];
+};
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t nanosecondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void remplir(unsigned char *p, size_t taille, uint32_t producteur, uint32_t sequence) {
+    entete_t e = { 0, producteur, sequence };
+    for (size_t k = sizeof(e); k < taille; k++) p[k] = (unsigned char)(sequence * 7 + producteur + k);
+    e.envoi_ns = nanosecondes();        /* au plus pres de l'envoi */
+    memcpy(p, &e, sizeof(e));
+}
+
+static bool motif_correct(const unsigned char *p, size_t taille, const entete_t *e) {
+    for (size_t k = sizeof(*e); k < taille; k++) {
+        if (p[k] != (unsigned char)(e->sequence * 7 + e->producteur + k)) return false;
+    }
+    return true;
+}
+
+static void pause_us(long us) {
+    struct timespec ts = { 0, us * 1000L };
+    nanosleep(&ts, NULL);
+}
+
+/* --- Producteurs (processus fils) --- */
+
+static int produire_sysv(int msqid, int id, long nb, size_t taille, bool cadence) {
+    struct message_sysv *m = malloc(sizeof(*m));
+    if (!m) return 1;
+    uint32_t sequences[BUS_PRIORITES] = { 0 };
+    for (long i = 0; i < nb; i++) {
+        int p = (int)(i % BUS_PRIORITES);
+        m->mtype = p + 1;
+        remplir(m->texte, taille, (uint32_t)id, sequences[p]++);
+        while (msgsnd(msqid, m, taille, 0) == -1) {
+            if (errno != EINTR) {
+                perror("msgsnd");
+                free(m);
+                return 1;
+            }
+        }
+        if (cadence) pause_us(CADENCE_US);
+    }
+    free(m);
+    return 0;
+}
+
+static int produire_bus(int id, long nb, size_t taille, bool cadence) {
+    bus_t b;
+    if (bus_ouvrir(&b, NOM_BUS) == -1) {   /* projection propre au fils */
+        perror("bus_ouvrir");
+        return 1;
+    }
+    unsigned char tampon[BUS_INLINE];
+    uint32_t sequences[BUS_PRIORITES] = { 0 };
+    for (long i = 0; i < nb; i++) {
+        int p = (int)(i % BUS_PRIORITES);
+        if (taille <= BUS_INLINE) {
+            remplir(tampon, taille, (uint32_t)id, sequences[p]++);
+            if (bus_publier_attendre(&b, p, 0, tampon, taille, -1) == -1) return 1;
+        } else {
+            /* Ecriture directe dans l'arene : aucune copie jusqu'au lecteur */
+            uint32_t bloc;
+            unsigned char *dst;
+            if ((dst = bus_allouer_attendre(&b, &bloc, -1)) == NULL) return 1;
+            remplir(dst, taille, (uint32_t)id, sequences[p]++);
+            if (bus_publier_bloc_attendre(&b, p, 0, bloc, taille, -1) == -1) return 1;
+        }
+        if (cadence) pause_us(CADENCE_US);
+    }
+    bus_fermer(&b);
+    return 0;
+}
+
+/* --- Consommateur (processus parent) --- */
+
+typedef struct {
+    double duree;
+    long recus[BUS_PRIORITES];
+    hdr_histogram_t latences[BUS_PRIORITES];
+    bool ordre_ok;
+    bool contenu_ok;
+    bool arene_ok;
+    bool erreur;
+} resultat_t;
+
+typedef struct {
+    uint32_t attendue[MAX_PRODUCTEURS][BUS_PRIORITES];
+} suivi_t;
+
+static void consigner(resultat_t *r, suivi_t *s, int p, const unsigned char *donnees, size_t taille, size_t attendue) {
+    uint64_t maintenant = nanosecondes();
+    entete_t e;
+    memcpy(&e, donnees, sizeof(e));
+    if (taille != attendue || e.producteur >= MAX_PRODUCTEURS) {
+        r->contenu_ok = false;
+        return;
+    }
+    if (e.sequence != s->attendue[e.producteur][p]) r->ordre_ok = false;
+    s->attendue[e.producteur][p] = e.sequence + 1;
+    if (!motif_correct(donnees, taille, &e)) r->contenu_ok = false;
+    hdr_enregistrer(&r->latences[p], (int64_t)(maintenant - e.envoi_ns));
+    r->recus[p]++;
+}
+
+static void executer(methode_t meth, resultat_t *r, int producteurs, long nb, size_t taille, bool cadence) {
+    memset(r, 0, sizeof(*r));
+    for (int p = 0; p < BUS_PRIORITES; p++) hdr_init(&r->latences[p], 100, 100000000000LL, 3);
+    r->ordre_ok = r->contenu_ok = r->arene_ok = true;
+    suivi_t *s = calloc(1, sizeof(*s));
+
+    int msqid = -1;
+    bus_t b;
+    if (meth == METH_SYSV) {
+        msqid = msgget(IPC_PRIVATE, IPC_CREAT | 0600);
+        if (msqid == -1) {
+            perror("msgget");
+            r->erreur = true;
+            free(s);
+            return;
+        }
+    } else {
+        bus_config_t cfg = { 1024, 256, (uint32_t)(taille > BUS_INLINE ? taille : 64) };
+        if (bus_creer(&b, NOM_BUS, &cfg) == -1) {
+            perror("bus_creer");
+            r->erreur = true;
+            free(s);
+            return;
+        }
+        static const int poids[BUS_PRIORITES] = { 4, 2, 1 };
+        bus_politique(&b, meth == METH_BUS_PONDERE ? BUS_PONDEREE : BUS_STRICTE, poids);
+    }
+
+    double debut = secondes();
+    pid_t fils[MAX_PRODUCTEURS];
+    for (int i = 0; i < producteurs; i++) {
+        fils[i] = fork();
+        if (fils[i] == 0) {
+            int code = meth == METH_SYSV ? produire_sysv(msqid, i, nb, taille, cadence)
+                                         : produire_bus(i, nb, taille, cadence);
+            _exit(code);
+        }
+    }
+
+    long total = (long)producteurs * nb;
+    struct message_sysv *m = meth == METH_SYSV ? malloc(sizeof(*m)) : NULL;
+    for (long i = 0; i < total && !r->erreur; i++) {
+        if (meth == METH_SYSV) {
+            /* Bloquant, type le plus petit d'abord : pas de scrutation */
+            ssize_t n = msgrcv(msqid, m, SYSV_MAX, -BUS_PRIORITES, 0);
+            if (n == -1) {
+                if (errno == EINTR) {
+                    i--;
+                    continue;
+                }
+                perror("msgrcv");
+                r->erreur = true;
+                break;
+            }
+            consigner(r, s, (int)m->mtype - 1, m->texte, (size_t)n, taille);
+        } else {
+            bus_message_t bm;
+            if (bus_recevoir(&b, &bm, 10000) == -1) {
+                fprintf(stderr, "bus_recevoir : delai depasse\n");
+                r->erreur = true;
+                break;
+            }
+            /* Lecture sur place dans l'arene, puis restitution du bloc */
+            consigner(r, s, bm.priorite, bus_donnees(&b, &bm), bm.longueur, taille);
+            bus_liberer(&b, &bm);
+        }
+    }
+    r->duree = secondes() - debut;
+
+    for (int i = 0; i < producteurs; i++) {
+        int statut;
+        if (waitpid(fils[i], &statut, 0) == -1 || !WIFEXITED(statut) || WEXITSTATUS(statut) != 0) {
+            r->erreur = true;
+        }
+    }
+    if (meth == METH_SYSV) {
+        msgctl(msqid, IPC_RMID, NULL);
+        free(m);
+    } else {
+        r->arene_ok = bus_blocs_libres(&b) == b.e->nb_blocs;
+        bus_fermer(&b);
+        bus_detruire(NOM_BUS);
+    }
+    free(s);
+}
+
+static long lire_limite(const char *chemin, long defaut) {
+    FILE *f = fopen(chemin, "r");
+    long v = defaut;
+    if (f) {
+        if (fscanf(f, "%ld", &v) != 1) v = defaut;
+        fclose(f);
+    }
+    return v;
+}
+
+int main(int argc, char *argv[]) {
+    long nb_sature = argc > 1 ? atol(argv[1]) : 30000;
+    int producteurs = argc > 2 ? atoi(argv[2]) : 2;
+    if (nb_sature < BUS_PRIORITES) nb_sature = BUS_PRIORITES;
+    if (producteurs < 1) producteurs = 1;
+    if (producteurs > MAX_PRODUCTEURS) producteurs = MAX_PRODUCTEURS;
+    long nb_cadence = nb_sature / 10 < 3000 ? nb_sature / 10 : 3000;
+    if (nb_cadence < BUS_PRIORITES) nb_cadence = BUS_PRIORITES;
+
+    long msgmax = lire_limite("/proc/sys/kernel/msgmax", 8192);
+    long msgmnb = lire_limite("/proc/sys/kernel/msgmnb", 16384);
+    printf("=== Bus partage vs file System V : %d producteurs, 1 consommateur ===\n", producteurs);
+    printf("msgmax = %ld o, msgmnb = %ld o ; bus : 1024 emplacements par priorite, "
+           "en ligne <= %d o, au-dela bloc d'arene\n\n", msgmax, msgmnb, BUS_INLINE);
+
+    static const size_t tailles[] = { 32, 4096, 65536 };
+    bool ok = true;
+    for (int cadence = 0; cadence <= 1; cadence++) {
+        printf("--- %s ---\n", cadence ? "Charge cadencee (pause de 100 us entre envois) : latence de reveil"
+                                     : "Charge saturee : debit");
+        printf("%-7s %-18s %10s %9s", "Taille", "Methode", "msg/s", "Mo/s");
+        for (int p = 0; p < BUS_PRIORITES; p++) printf("  %-6s p50/p99 us", noms_priorites[p]);
+        printf("  Verif\n");
+
+        for (size_t t = 0; t < sizeof(tailles) / sizeof(tailles[0]); t++) {
+            size_t taille = tailles[t];
+            long nb = cadence ? nb_cadence : nb_sature;
+            if (!cadence && nb > BUDGET_OCTETS / (long)taille) nb = BUDGET_OCTETS / (long)taille;
+            nb -= nb % BUS_PRIORITES;
+
+            for (int meth = 0; meth < NB_METHODES; meth++) {
+                char etiquette[16] = "";
+                if (meth == 0) snprintf(etiquette, sizeof(etiquette), "%zu o", taille);
+                printf("%-7s %-18s", etiquette, noms_methodes[meth]);
+                if (meth == METH_SYSV && (long)taille > msgmax) {
+                    printf(" %10s  (taille > msgmax : impossible en System V)\n", "-");
+                    continue;
+                }
+                fflush(stdout);                 /* avant fork */
+
+                resultat_t r;
+                executer((methode_t)meth, &r, producteurs, nb, taille, cadence);
+                long total = 0;
+                for (int p = 0; p < BUS_PRIORITES; p++) total += r.recus[p];
+                bool egal = !r.erreur && r.ordre_ok && r.contenu_ok && r.arene_ok
+                            && total == (long)producteurs * nb;
+                ok = ok && egal;
+
+                printf(" %10.0f %9.1f", (double)total / r.duree,
+                       (double)total * (double)taille / r.duree / (1024.0 * 1024.0));
+                for (int p = 0; p < BUS_PRIORITES; p++) {
+                    printf("  %8.1f/%-10.1f", hdr_percentile(&r.latences[p], 50.0) / 1e3,
+                           hdr_percentile(&r.latences[p], 99.0) / 1e3);
+                }
+                printf("  %s\n", egal ? "ok" : !r.ordre_ok ? "ORDRE" : !r.contenu_ok ? "CONTENU"
+                                       : !r.arene_ok ? "FUITE ARENE" : "ERREUR");
+                for (int p = 0; p < BUS_PRIORITES; p++) hdr_liberer(&r.latences[p]);
+            }
+        }
+        printf("\n");
+    }
+
+    printf("Verification : %s\n", ok ? "tous les messages recus, dans l'ordre et intacts"
+                                     : "ECHEC");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,530 @@
+/* ============================================================================
+   Section 19.3 : Message Queues System V
+   Description : Bus de messages a priorites en memoire partagee POSIX
+                 (header-only), remplacant msgsnd/msgrcv de 05 et 06
+                 - un anneau MPMC sans verrou par priorite (Vyukov)
+                 - defilement strict ou pondere (deficit round robin)
+                 - attente bloquante par futex partage, pas de scrutation,
+                   des deux cotes : consommateur sur bus vide, producteur
+                   sur anneau plein ou arene epuisee
+                 - gros messages sans copie : blocs d'une arene partagee
+                   designes par un indice, valable dans tous les processus
+   Fichier source : 03-message-queues.md
+   ============================================================================ */
+#ifndef BUS_MESSAGES_H
+#define BUS_MESSAGES_H
+
+/* syscall() et SYS_futex exigent _GNU_SOURCE avant tout include */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define BUS_MAGIQUE      0x42555332u    /* "BUS2" : mots futex de places */
+#define BUS_PRIORITES    3              /* 0 = urgent ... 2 = basse */
+#define BUS_INLINE       48             /* octets transportes dans l'emplacement */
+#define BUS_SANS_BLOC    UINT32_MAX
+#define BUS_ATTENTE_SPIN 200
+#define BUS_ATTENTE_CEDE 16             /* sched_yield bornes avant le futex */
+
+typedef enum { BUS_STRICTE, BUS_PONDEREE } bus_politique_t;
+
+typedef struct {
+    uint32_t capacite;                  /* emplacements par anneau (puissance de 2) */
+    uint32_t nb_blocs;                  /* arene : nombre de blocs */
+    uint32_t taille_bloc;               /* arene : octets par bloc */
+} bus_config_t;
+
+/* Emplacement d'anneau : une ligne de cache */
+typedef struct {
+    atomic_uint sequence;
+    uint32_t type;
+    uint32_t longueur;
+    uint32_t bloc;                      /* BUS_SANS_BLOC : donnees en ligne */
+    unsigned char donnees[BUS_INLINE];
+} bus_emplacement_t;
+
+typedef struct {
+    _Alignas(64) atomic_uint tete;      /* prochain a publier */
+    _Alignas(64) atomic_uint queue;     /* prochain a consommer */
+    _Alignas(64) uint32_t decalage;     /* des emplacements depuis le debut du segment */
+} bus_anneau_t;
+
+typedef struct {
+    uint32_t magique;
+    uint32_t capacite;
+    uint32_t nb_blocs;
+    uint32_t taille_bloc;
+    uint64_t taille_segment;
+    uint64_t decalage_suivants;         /* uint32_t[nb_blocs] : liste libre */
+    uint64_t decalage_arene;
+    _Alignas(64) atomic_uint evenements;    /* mot futex : change a chaque publication */
+    _Alignas(64) atomic_uint lecteur_attend;    /* 1 : un consommateur va dormir sur evenements */
+    _Alignas(64) atomic_uint places;    /* mot futex : change a chaque emplacement ou bloc libere */
+    _Alignas(64) atomic_uint reveil_demande;    /* 1 : un producteur va dormir sur places */
+    _Alignas(64) atomic_uint_least64_t libres;  /* (etiquette << 32) | (indice + 1) */
+    bus_anneau_t anneaux[BUS_PRIORITES];
+} bus_entete_t;
+
+/* Vue locale d'un processus sur le segment */
+typedef struct {
+    bus_entete_t *e;
+    bus_emplacement_t *emplacements[BUS_PRIORITES];
+    uint32_t *suivants;
+    unsigned char *arene;
+    /* Politique de defilement, propre au consommateur */
+    bus_politique_t politique;
+    int poids[BUS_PRIORITES];
+    int credit[BUS_PRIORITES];
+    int courante;
+} bus_t;
+
+typedef struct {
+    int priorite;
+    uint32_t type;
+    uint32_t longueur;
+    uint32_t bloc;
+    unsigned char en_ligne[BUS_INLINE];
+} bus_message_t;
+
+static inline long bus_futex(atomic_uint *mot, int op, unsigned val, const struct timespec *delai) {
+    /* Pas de FUTEX_PRIVATE_FLAG : le mot est partage entre processus */
+    return syscall(SYS_futex, (unsigned *)mot, op, val, delai, NULL, 0);
+}
+
+/* Appele a chaque emplacement ou bloc libere. Reveille tous les
+   producteurs en attente de place : ils peuvent attendre des anneaux
+   differents ou l'arene, un seul reveil pourrait tomber sur un
+   producteur qui ne peut toujours pas avancer. Le drapeau
+   est consomme par l'echange : un seul appel systeme par endormissement,
+   pas un par message tant que les producteurs n'ont pas repris la main */
+static inline void bus_signaler_place(bus_t *b) {
+    atomic_fetch_add_explicit(&b->e->places, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&b->e->reveil_demande, memory_order_relaxed)
+        && atomic_exchange_explicit(&b->e->reveil_demande, 0, memory_order_seq_cst)) {
+        bus_futex(&b->e->places, FUTEX_WAKE, INT_MAX, NULL);
+    }
+}
+
+/* Echeance absolue (CLOCK_MONOTONIC) dans timeout_ms */
+static inline void bus_echeance(struct timespec *echeance, int timeout_ms) {
+    clock_gettime(CLOCK_MONOTONIC, echeance);
+    echeance->tv_sec += timeout_ms / 1000;
+    echeance->tv_nsec += (long)(timeout_ms % 1000) * 1000000L;
+    if (echeance->tv_nsec >= 1000000000L) {
+        echeance->tv_sec++;
+        echeance->tv_nsec -= 1000000000L;
+    }
+}
+
+/* Delai relatif restant avant echeance (FUTEX_WAIT) ; false si expiree */
+static inline bool bus_reste(const struct timespec *echeance, struct timespec *reste) {
+    struct timespec maintenant;
+    clock_gettime(CLOCK_MONOTONIC, &maintenant);
+    reste->tv_sec = echeance->tv_sec - maintenant.tv_sec;
+    reste->tv_nsec = echeance->tv_nsec - maintenant.tv_nsec;
+    if (reste->tv_nsec < 0) {
+        reste->tv_sec--;
+        reste->tv_nsec += 1000000000L;
+    }
+    return reste->tv_sec >= 0;
+}
+
+static inline void bus_attacher(bus_t *b, bus_entete_t *e) {
+    memset(b, 0, sizeof(*b));
+    b->e = e;
+    for (int p = 0; p < BUS_PRIORITES; p++) {
+        b->emplacements[p] = (bus_emplacement_t *)((char *)e + e->anneaux[p].decalage);
+        b->poids[p] = 1;
+    }
+    b->suivants = (uint32_t *)((char *)e + e->decalage_suivants);
+    b->arene = (unsigned char *)e + e->decalage_arene;
+    b->politique = BUS_STRICTE;
+}
+
+/* Cree (ou recree) le segment nom. Retour : 0, ou -1 avec errno */
+static inline int bus_creer(bus_t *b, const char *nom, const bus_config_t *cfg) {
+    if (cfg->capacite == 0 || (cfg->capacite & (cfg->capacite - 1)) || cfg->nb_blocs >= UINT32_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    size_t taille_bloc = (cfg->taille_bloc + 63) & ~(size_t)63;
+    size_t taille = (sizeof(bus_entete_t) + 63) & ~(size_t)63;
+    uint32_t decalages[BUS_PRIORITES];
+    for (int p = 0; p < BUS_PRIORITES; p++) {
+        decalages[p] = (uint32_t)taille;
+        taille += (size_t)cfg->capacite * sizeof(bus_emplacement_t);
+    }
+    size_t decalage_suivants = taille;
+    taille += ((size_t)cfg->nb_blocs * sizeof(uint32_t) + 4095) & ~(size_t)4095;
+    size_t decalage_arene = (taille + 4095) & ~(size_t)4095;
+    taille = decalage_arene + (size_t)cfg->nb_blocs * taille_bloc;
+
+    shm_unlink(nom);
+    int fd = shm_open(nom, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd == -1) return -1;
+    if (ftruncate(fd, (off_t)taille) == -1) {
+        close(fd);
+        shm_unlink(nom);
+        return -1;
+    }
+    bus_entete_t *e = mmap(NULL, taille, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (e == MAP_FAILED) {
+        shm_unlink(nom);
+        return -1;
+    }
+
+    /* Segment neuf : deja a zero */
+    e->capacite = cfg->capacite;
+    e->nb_blocs = cfg->nb_blocs;
+    e->taille_bloc = (uint32_t)taille_bloc;
+    e->taille_segment = taille;
+    e->decalage_suivants = decalage_suivants;
+    e->decalage_arene = decalage_arene;
+    for (int p = 0; p < BUS_PRIORITES; p++) {
+        e->anneaux[p].decalage = decalages[p];
+        bus_emplacement_t *s = (bus_emplacement_t *)((char *)e + decalages[p]);
+        for (uint32_t i = 0; i < cfg->capacite; i++) atomic_init(&s[i].sequence, i);
+    }
+    uint32_t *suivants = (uint32_t *)((char *)e + decalage_suivants);
+    for (uint32_t i = 0; i < cfg->nb_blocs; i++) suivants[i] = i + 1 < cfg->nb_blocs ? i + 2 : 0;
+    atomic_init(&e->libres, cfg->nb_blocs ? 1 : 0);
+    atomic_store_explicit(&e->evenements, 0, memory_order_relaxed);
+    atomic_store_explicit(&e->places, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    e->magique = BUS_MAGIQUE;           /* dernier : le segment est pret */
+
+    bus_attacher(b, e);
+    return 0;
+}
+
+static inline int bus_ouvrir(bus_t *b, const char *nom) {
+    int fd = shm_open(nom, O_RDWR, 0);
+    if (fd == -1) return -1;
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(bus_entete_t)) {
+        close(fd);
+        errno = EINVAL;
+        return -1;
+    }
+    bus_entete_t *e = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (e == MAP_FAILED) return -1;
+    if (e->magique != BUS_MAGIQUE || e->taille_segment != (uint64_t)st.st_size) {
+        munmap(e, (size_t)st.st_size);
+        errno = EINVAL;
+        return -1;
+    }
+    bus_attacher(b, e);
+    return 0;
+}
+
+static inline void bus_fermer(bus_t *b) {
+    munmap(b->e, b->e->taille_segment);
+    b->e = NULL;
+}
+
+/* Retire le nom ; le segment disparait au dernier bus_fermer */
+static inline int bus_detruire(const char *nom) {
+    return shm_unlink(nom);
+}
+
+/* poids : messages servis par tour pour chaque priorite (BUS_PONDEREE) */
+static inline void bus_politique(bus_t *b, bus_politique_t politique, const int *poids) {
+    b->politique = politique;
+    for (int p = 0; p < BUS_PRIORITES; p++) {
+        b->poids[p] = poids && poids[p] > 0 ? poids[p] : 1;
+        b->credit[p] = b->poids[p];
+    }
+    b->courante = 0;
+}
+
+/* --- Arene : pile de Treiber etiquetee d'indices de blocs --- */
+
+static inline void *bus_bloc(bus_t *b, uint32_t bloc) {
+    return b->arene + (size_t)bloc * b->e->taille_bloc;
+}
+
+/* Reserve un bloc a remplir sur place puis a publier avec bus_publier_bloc.
+   NULL (ENOMEM) si l'arene est epuisee */
+static inline void *bus_allouer(bus_t *b, uint32_t *bloc) {
+    uint64_t tete = atomic_load_explicit(&b->e->libres, memory_order_acquire);
+    for (;;) {
+        uint32_t indice = (uint32_t)tete;
+        if (indice == 0) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        uint64_t nouvelle = ((tete >> 32) + 1) << 32 | b->suivants[indice - 1];
+        if (atomic_compare_exchange_weak_explicit(&b->e->libres, &tete, nouvelle,
+                                                  memory_order_acquire, memory_order_acquire)) {
+            *bloc = indice - 1;
+            return bus_bloc(b, indice - 1);
+        }
+    }
+}
+
+static inline void bus_rendre_bloc(bus_t *b, uint32_t bloc) {
+    uint64_t tete = atomic_load_explicit(&b->e->libres, memory_order_relaxed);
+    uint64_t nouvelle;
+    do {
+        b->suivants[bloc] = (uint32_t)tete;
+        nouvelle = ((tete >> 32) + 1) << 32 | (bloc + 1);
+    } while (!atomic_compare_exchange_weak_explicit(&b->e->libres, &tete, nouvelle,
+                                                    memory_order_release, memory_order_relaxed));
+    bus_signaler_place(b);
+}
+
+/* --- Anneaux --- */
+
+static inline int bus_enfiler(bus_t *b, int priorite, uint32_t type, uint32_t longueur,
+                              uint32_t bloc, const void *donnees) {
+    bus_anneau_t *a = &b->e->anneaux[priorite];
+    bus_emplacement_t *s;
+    uint32_t masque = b->e->capacite - 1;
+    unsigned pos = atomic_load_explicit(&a->tete, memory_order_relaxed);
+    for (;;) {
+        s = &b->emplacements[priorite][pos & masque];
+        unsigned seq = atomic_load_explicit(&s->sequence, memory_order_acquire);
+        int diff = (int)(seq - pos);
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&a->tete, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            errno = EAGAIN;             /* anneau plein */
+            return -1;
+        } else {
+            pos = atomic_load_explicit(&a->tete, memory_order_relaxed);
+        }
+    }
+    s->type = type;
+    s->longueur = longueur;
+    s->bloc = bloc;
+    if (donnees) memcpy(s->donnees, donnees, longueur);
+    atomic_store_explicit(&s->sequence, pos + 1, memory_order_release);
+
+    /* Reveil : compteur d'evenements + drapeau consomme par l'echange,
+       comme bus_signaler_place. Un compteur de dormeurs imposait un appel
+       systeme par publication tant que le consommateur reveille n'avait
+       pas encore ete ordonnance */
+    atomic_fetch_add_explicit(&b->e->evenements, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&b->e->lecteur_attend, memory_order_relaxed)
+        && atomic_exchange_explicit(&b->e->lecteur_attend, 0, memory_order_seq_cst)) {
+        bus_futex(&b->e->evenements, FUTEX_WAKE, INT_MAX, NULL);
+    }
+    return 0;
+}
+
+static inline bool bus_defiler_anneau(bus_t *b, int priorite, bus_message_t *m) {
+    bus_anneau_t *a = &b->e->anneaux[priorite];
+    bus_emplacement_t *s;
+    uint32_t masque = b->e->capacite - 1;
+    unsigned pos = atomic_load_explicit(&a->queue, memory_order_relaxed);
+    for (;;) {
+        s = &b->emplacements[priorite][pos & masque];
+        unsigned seq = atomic_load_explicit(&s->sequence, memory_order_acquire);
+        int diff = (int)(seq - (pos + 1));
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&a->queue, &pos, pos + 1,
+                                                      memory_order_relaxed, memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;               /* vide */
+        } else {
+            pos = atomic_load_explicit(&a->queue, memory_order_relaxed);
+        }
+    }
+    m->priorite = priorite;
+    m->type = s->type;
+    m->longueur = s->longueur;
+    m->bloc = s->bloc;
+    if (m->bloc == BUS_SANS_BLOC) memcpy(m->en_ligne, s->donnees, m->longueur);
+    atomic_store_explicit(&s->sequence, pos + masque + 1, memory_order_release);
+    bus_signaler_place(b);
+    return true;
+}
+
+/* Petit message copie dans l'emplacement (longueur <= BUS_INLINE).
+   EAGAIN si l'anneau de cette priorite est plein */
+static inline int bus_publier(bus_t *b, int priorite, uint32_t type, const void *donnees, size_t longueur) {
+    if (priorite < 0 || priorite >= BUS_PRIORITES || longueur > BUS_INLINE) {
+        errno = EINVAL;
+        return -1;
+    }
+    return bus_enfiler(b, priorite, type, (uint32_t)longueur, BUS_SANS_BLOC, donnees);
+}
+
+/* Gros message deja ecrit dans un bloc de l'arene : seul l'indice circule */
+static inline int bus_publier_bloc(bus_t *b, int priorite, uint32_t type, uint32_t bloc, size_t longueur) {
+    if (priorite < 0 || priorite >= BUS_PRIORITES || longueur > b->e->taille_bloc
+        || bloc >= b->e->nb_blocs) {
+        errno = EINVAL;
+        return -1;
+    }
+    return bus_enfiler(b, priorite, type, (uint32_t)longueur, bloc, NULL);
+}
+
+static inline bool bus_essayer(bus_t *b, bus_message_t *m) {
+    if (b->politique == BUS_STRICTE) {
+        for (int p = 0; p < BUS_PRIORITES; p++) {
+            if (bus_defiler_anneau(b, p, m)) return true;
+        }
+        return false;
+    }
+    /* Deficit round robin : la priorite courante consomme son credit,
+       une priorite vide ou a court de credit passe la main */
+    for (int essais = 0; essais < 2 * BUS_PRIORITES; essais++) {
+        int p = b->courante;
+        if (b->credit[p] > 0 && bus_defiler_anneau(b, p, m)) {
+            b->credit[p]--;
+            return true;
+        }
+        b->credit[p] = b->poids[p];
+        b->courante = (p + 1) % BUS_PRIORITES;
+    }
+    return false;
+}
+
+/* Recoit un message selon la politique. timeout_ms < 0 : attente infinie.
+   Retour : 0, ou -1 (ETIMEDOUT) */
+static inline int bus_recevoir(bus_t *b, bus_message_t *m, int timeout_ms) {
+    for (int i = 0; i < BUS_ATTENTE_SPIN; i++) {
+        if (bus_essayer(b, m)) return 0;
+    }
+    struct timespec echeance;
+    if (timeout_ms >= 0) bus_echeance(&echeance, timeout_ms);
+    for (;;) {
+        unsigned vu = atomic_load_explicit(&b->e->evenements, memory_order_seq_cst);
+        atomic_store_explicit(&b->e->lecteur_attend, 1, memory_order_seq_cst);
+        if (bus_essayer(b, m)) return 0;
+        struct timespec reste, *delai = NULL;
+        if (timeout_ms >= 0) {
+            if (!bus_reste(&echeance, &reste)) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            delai = &reste;
+        }
+        /* Ne dort que si aucune publication n'a eu lieu depuis vu ; le
+           drapeau est repose a chaque tour : plusieurs consommateurs
+           peuvent attendre, le reveil les libere tous */
+        bus_futex(&b->e->evenements, FUTEX_WAIT, vu, delai);
+        if (bus_essayer(b, m)) return 0;
+    }
+}
+
+/* --- Cote producteur : attente de place au lieu de EAGAIN/ENOMEM --- */
+
+typedef struct {
+    int genre;                          /* 0 : en ligne, 1 : bloc, 2 : allocation */
+    int priorite;
+    uint32_t type;
+    const void *donnees;
+    size_t longueur;
+    uint32_t *bloc;
+    void *alloue;
+} bus_envoi_t;
+
+static inline int bus_tenter(bus_t *b, bus_envoi_t *v) {
+    switch (v->genre) {
+    case 0: return bus_publier(b, v->priorite, v->type, v->donnees, v->longueur);
+    case 1: return bus_publier_bloc(b, v->priorite, v->type, *v->bloc, v->longueur);
+    default:
+        v->alloue = bus_allouer(b, v->bloc);
+        return v->alloue ? 0 : -1;
+    }
+}
+
+/* Protocole de bus_recevoir, sur le mot places : le producteur lit
+   places, demande un reveil, reessaie, puis ne dort que si aucune place
+   n'a ete liberee depuis sa lecture (le noyau compare places a vu).
+   Quelques sched_yield bornes d'abord : si le consommateur tourne sur le
+   meme coeur, lui ceder la main libere une place bien plus vite qu'un
+   aller-retour futex ; s'il est bloque, on finit par dormir */
+static inline int bus_attendre_place(bus_t *b, bus_envoi_t *v, int timeout_ms) {
+    for (int i = 0; i < BUS_ATTENTE_SPIN + BUS_ATTENTE_CEDE; i++) {
+        if (i >= BUS_ATTENTE_SPIN) sched_yield();
+        if (bus_tenter(b, v) == 0) return 0;
+        if (errno != EAGAIN && errno != ENOMEM) return -1;
+    }
+    struct timespec echeance;
+    if (timeout_ms >= 0) bus_echeance(&echeance, timeout_ms);
+    for (;;) {
+        unsigned vu = atomic_load_explicit(&b->e->places, memory_order_seq_cst);
+        atomic_store_explicit(&b->e->reveil_demande, 1, memory_order_seq_cst);
+        int r = bus_tenter(b, v);
+        if (r == 0 || (errno != EAGAIN && errno != ENOMEM)) return r;
+        struct timespec reste, *delai = NULL;
+        if (timeout_ms >= 0) {
+            if (!bus_reste(&echeance, &reste)) {
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            delai = &reste;
+        }
+        bus_futex(&b->e->places, FUTEX_WAIT, vu, delai);
+    }
+}
+
+/* Versions bloquantes de bus_publier, bus_publier_bloc et bus_allouer :
+   attendent qu'un consommateur libere un emplacement ou un bloc.
+   timeout_ms < 0 : attente infinie. Retour : 0 / bloc, ou -1 / NULL
+   (ETIMEDOUT, EINVAL) */
+static inline int bus_publier_attendre(bus_t *b, int priorite, uint32_t type, const void *donnees,
+                                       size_t longueur, int timeout_ms) {
+    bus_envoi_t v = { .genre = 0, .priorite = priorite, .type = type, .donnees = donnees,
+                      .longueur = longueur };
+    return bus_attendre_place(b, &v, timeout_ms);
+}
+
+static inline int bus_publier_bloc_attendre(bus_t *b, int priorite, uint32_t type, uint32_t bloc,
+                                            size_t longueur, int timeout_ms) {
+    bus_envoi_t v = { .genre = 1, .priorite = priorite, .type = type, .longueur = longueur,
+                      .bloc = &bloc };
+    return bus_attendre_place(b, &v, timeout_ms);
+}
+
+static inline void *bus_allouer_attendre(bus_t *b, uint32_t *bloc, int timeout_ms) {
+    bus_envoi_t v = { .genre = 2, .bloc = bloc };
+    return bus_attendre_place(b, &v, timeout_ms) == 0 ? v.alloue : NULL;
+}
+
+/* Donnees d'un message recu : en ligne, ou directement dans l'arene */
+static inline const void *bus_donnees(bus_t *b, const bus_message_t *m) {
+    return m->bloc == BUS_SANS_BLOC ? (const void *)m->en_ligne : bus_bloc(b, m->bloc);
+}
+
+/* A appeler une fois les donnees exploitees (rend le bloc eventuel) */
+static inline void bus_liberer(bus_t *b, bus_message_t *m) {
+    if (m->bloc != BUS_SANS_BLOC) bus_rendre_bloc(b, m->bloc);
+    m->bloc = BUS_SANS_BLOC;
+}
+
+/* Blocs disponibles dans l'arene (a appeler bus au repos) */
+static inline uint32_t bus_blocs_libres(bus_t *b) {
+    uint32_t n = 0;
+    uint32_t indice = (uint32_t)atomic_load_explicit(&b->e->libres, memory_order_acquire);
+    while (indice != 0 && n <= b->e->nb_blocs) {
+        n++;
+        indice = b->suivants[indice - 1];
+    }
+    return n;
+}
+
+#endif /* BUS_MESSAGES_H */
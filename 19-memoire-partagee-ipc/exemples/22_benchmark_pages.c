@@ -0,0 +1,236 @@
+/* ============================================================================
+   Section 19.1 : Shared Memory (Memoire Partagee)
+   Description : Acces aleatoires a un grand segment (22_segment_pages.h)
+                 selon la taille de page, en partage et en prive
+                 - 4 Ko / THP / hugetlb, avec repli affiche
+                 - chasse de pointeurs (latence par acces dependant)
+                 - lectures aleatoires independantes (debit)
+                 - defauts de TLB par perf_event_open si disponible
+                 - verification : meme cycle et meme somme partout,
+                   segment nomme relu par un processus fils
+   Fichier source : 01-shared-memory.md
+   ============================================================================ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include "22_segment_pages.h"
+
+#define NOM_SEGMENT "/segment_pages"
+#define MARQUE      0x5345474du         /* "SEGM", ecrit par le fils */
+
+/* Une ligne de cache par element : un acces = une ligne distincte */
+typedef struct {
+    uint64_t suivant;
+    uint64_t valeur;
+    char bourrage[48];
+} ligne_t;
+
+typedef struct {
+    const char *nom;
+    seg_pages_t pages;
+    int options;
+} config_t;
+
+static const config_t configs[] = {
+    { "partage", SEG_PAGES_NORMALES, 0 },
+    { "partage", SEG_PAGES_THP, 0 },
+    { "partage", SEG_PAGES_HUGETLB, 0 },
+    { "prive", SEG_PAGES_NORMALES, SEG_PRIVE },
+    { "prive", SEG_PAGES_THP, SEG_PRIVE },
+    { "prive", SEG_PAGES_HUGETLB, SEG_PRIVE },
+};
+
+static uint64_t aleatoire(uint64_t *etat) {
+    uint64_t x = *etat;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *etat = x;
+}
+
+static uint64_t valeur_de(uint64_t i) {
+    return i * 0x9E3779B97F4A7C15ULL;
+}
+
+/* dTLB-load-misses de ce processus, espace utilisateur ; -1 si absent
+   (machine virtuelle, perf_event_paranoid) */
+static int ouvrir_compteur_tlb(void) {
+    struct perf_event_attr a;
+    memset(&a, 0, sizeof(a));
+    a.size = sizeof(a);
+    a.type = PERF_TYPE_HW_CACHE;
+    a.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+             | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    a.disabled = 1;
+    a.exclude_kernel = 1;
+    a.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &a, 0, -1, -1, 0);
+}
+
+static void compteur_demarrer(int fd) {
+    if (fd == -1) return;
+    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+}
+
+static long long compteur_arreter(int fd) {
+    long long n = -1;
+    if (fd == -1) return -1;
+    ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(fd, &n, sizeof(n)) != sizeof(n)) n = -1;
+    return n;
+}
+
+/* Cycle unique (Sattolo) sur toutes les lignes, graine fixe : meme
+   parcours quel que soit le segment */
+static void construire(ligne_t *t, uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        t[i].suivant = i;
+        t[i].valeur = valeur_de(i);
+    }
+    uint64_t etat = 0x2545F4914F6CDD1DULL;
+    for (uint64_t i = n - 1; i > 0; i--) {
+        uint64_t j = aleatoire(&etat) % i;
+        uint64_t tmp = t[i].suivant;
+        t[i].suivant = t[j].suivant;
+        t[j].suivant = tmp;
+    }
+}
+
+static uint64_t chasser(const ligne_t *t, long acces) {
+    uint64_t p = 0;
+    for (long k = 0; k < acces; k++) p = t[p].suivant;
+    return p;
+}
+
+static uint64_t lire_aleatoire(const ligne_t *t, uint64_t n, long acces) {
+    uint64_t etat = 0x853C49E6748FEA9BULL, somme = 0;
+    for (long k = 0; k < acces; k++) somme += t[aleatoire(&etat) % n].valeur;
+    return somme;
+}
+
+static uint64_t somme_attendue(uint64_t n, long acces) {
+    uint64_t etat = 0x853C49E6748FEA9BULL, somme = 0;
+    for (long k = 0; k < acces; k++) somme += valeur_de(aleatoire(&etat) % n);
+    return somme;
+}
+
+/* Le fils rouvre le segment par son nom, verifie une ligne et en marque une autre */
+static bool verifier_partage(const segment_t *s, uint64_t n) {
+    const ligne_t *t = s->adresse;
+    uint64_t attendu = t[0].suivant;
+    pid_t pid = fork();
+    if (pid == 0) {
+        segment_t vue;
+        if (segment_ouvrir(&vue, NOM_SEGMENT) == -1) _exit(1);
+        ligne_t *u = vue.adresse;
+        int code = u[0].suivant == attendu ? 0 : 2;
+        u[n - 1].valeur = MARQUE;
+        segment_fermer(&vue);
+        _exit(code);
+    }
+    int statut;
+    if (pid == -1 || waitpid(pid, &statut, 0) == -1) return false;
+    bool ok = WIFEXITED(statut) && WEXITSTATUS(statut) == 0 && t[n - 1].valeur == MARQUE;
+    ((ligne_t *)s->adresse)[n - 1].valeur = valeur_de(n - 1);
+    return ok;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage : %s [-t taille_mo] [-a acces_millions] [-n defaut|locale|entrelacee]\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    long taille_mo = 512, acces = 4000000;
+    seg_numa_t numa = SEG_NUMA_DEFAUT;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:a:n:h")) != -1) {
+        switch (opt) {
+        case 't': taille_mo = atol(optarg); break;
+        case 'a': acces = (long)(atof(optarg) * 1e6); break;
+        case 'n':
+            if (strcmp(optarg, "locale") == 0) numa = SEG_NUMA_LOCAL;
+            else if (strcmp(optarg, "entrelacee") == 0) numa = SEG_NUMA_ENTRELACE;
+            else numa = SEG_NUMA_DEFAUT;
+            break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (taille_mo < 4) taille_mo = 4;
+    if (acces < 1000) acces = 1000;
+    size_t taille = (size_t)taille_mo << 20;
+    uint64_t n = taille / sizeof(ligne_t);
+
+    int tlb = ouvrir_compteur_tlb();
+    printf("=== Segment de %ld Mo, %ld acces aleatoires, NUMA %s ===\n", taille_mo, acces, seg_noms_numa[numa]);
+    printf("Compteur dTLB : %s\n\n", tlb == -1 ? "indisponible (perf_event_open refuse)" : "actif");
+    printf("%-8s %-18s %8s %9s %10s %10s %11s %10s  %s\n", "Segment", "Pages (obtenu)", "Gdes pg",
+           "Prech. ms", "Constr. ms", "Chasse ns", "Alea Mac/s", "dTLB/acces", "Verif");
+
+    uint64_t attendue = somme_attendue(n, acces);
+    uint64_t fin_reference = 0;
+    bool reference = false, ok = true;
+    for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+        const config_t *cf = &configs[c];
+        segment_t s;
+        bool partage = !(cf->options & SEG_PRIVE);
+        if (segment_creer(&s, partage ? NOM_SEGMENT : NULL, taille, cf->pages, numa,
+                          cf->options | SEG_PRECHARGER) == -1) {
+            printf("%-8s %-18s creation impossible : %s\n", cf->nom, seg_noms_pages[cf->pages], strerror(errno));
+            ok = false;
+            continue;
+        }
+        char pages[32];
+        snprintf(pages, sizeof(pages), "%s%s%s", seg_noms_pages[cf->pages],
+                 s.obtenu != cf->pages ? " -> " : "", s.obtenu != cf->pages ? seg_noms_pages[s.obtenu] : "");
+        ligne_t *t = s.adresse;
+
+        double debut = seg_secondes();
+        construire(t, n);
+        double construction = seg_secondes() - debut;
+
+        compteur_demarrer(tlb);
+        debut = seg_secondes();
+        uint64_t fin = chasser(t, acces);
+        double chasse = seg_secondes() - debut;
+        long long manques = compteur_arreter(tlb);
+
+        debut = seg_secondes();
+        uint64_t somme = lire_aleatoire(t, n, acces);
+        double alea = seg_secondes() - debut;
+
+        if (!reference) {
+            fin_reference = fin;
+            reference = true;
+        }
+        bool egal = fin == fin_reference && somme == attendue;
+        if (partage) egal = egal && verifier_partage(&s, n);
+        ok = ok && egal;
+
+        char tlb_txt[24] = "-";
+        if (manques >= 0) snprintf(tlb_txt, sizeof(tlb_txt), "%.3f", (double)manques / (double)acces);
+        printf("%-8s %-18s %6zu Mo %9.0f %10.0f %10.1f %11.1f %10s  %s\n", cf->nom, pages,
+               segment_octets_grandes_pages(&s) >> 20, s.duree_prechargement * 1e3, construction * 1e3,
+               chasse * 1e9 / (double)acces, (double)acces / alea / 1e6, tlb_txt, egal ? "ok" : "DIFFERENT");
+        if (s.erreur_numa) printf("         (mbind refuse : %s)\n", strerror(s.erreur_numa));
+
+        segment_detruire(&s);
+        segment_fermer(&s);
+    }
+    if (tlb != -1) close(tlb);
+
+    printf("\nVerification : %s\n", ok ? "meme cycle et meme somme pour tous les segments, partage relu par le fils"
+                                     : "ECHEC");
+    return ok ? 0 : 1;
+}
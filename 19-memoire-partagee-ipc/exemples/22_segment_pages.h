@@ -0,0 +1,308 @@
+/* ============================================================================
+   Section 19.1 : Shared Memory (Memoire Partagee)
+   Description : Creation de segments partages a grandes pages et placement
+                 NUMA (header-only), pour les tables de plusieurs Go
+                 - hugetlb (MAP_HUGETLB, memfd MFD_HUGETLB, hugetlbfs)
+                 - THP (madvise MADV_HUGEPAGE, adresse alignee sur 2 Mo)
+                 - repli hugetlb -> THP -> pages de 4 Ko
+                 - politique NUMA par mbind : locale ou entrelacee
+                 - pre-chargement (MADV_POPULATE_WRITE ou parcours)
+   Fichier source : 01-shared-memory.md
+   ============================================================================ */
+#ifndef SEGMENT_PAGES_H
+#define SEGMENT_PAGES_H
+
+/* memfd_create, MAP_HUGETLB et syscall() exigent _GNU_SOURCE avant tout include */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#define SEG_GRANDE_PAGE (2UL * 1024 * 1024)
+
+#ifndef MADV_POPULATE_WRITE
+#define MADV_POPULATE_WRITE 23          /* Linux 5.14 */
+#endif
+
+typedef enum { SEG_PAGES_NORMALES, SEG_PAGES_THP, SEG_PAGES_HUGETLB } seg_pages_t;
+typedef enum { SEG_NUMA_DEFAUT, SEG_NUMA_LOCAL, SEG_NUMA_ENTRELACE } seg_numa_t;
+
+/* Options de segment_creer */
+#define SEG_PRECHARGER 0x1              /* toutes les pages allouees a la creation */
+#define SEG_PRIVE      0x2              /* anonyme MAP_PRIVATE : herite par fork, non partage */
+
+static const char *const seg_noms_pages[] = { "4 Ko", "THP", "hugetlb" };
+static const char *const seg_noms_numa[] = { "defaut", "locale", "entrelacee" };
+
+typedef struct {
+    void *adresse;
+    size_t taille;                      /* arrondie a la taille de page obtenue */
+    seg_pages_t demande;
+    seg_pages_t obtenu;                 /* apres repli et, si pre-charge, controle smaps */
+    seg_numa_t numa;
+    int erreur_numa;                    /* errno de mbind, 0 si applique */
+    int fd;                             /* -1 pour SEG_PRIVE */
+    char chemin[PATH_MAX];              /* "" si anonyme */
+    double duree_prechargement;
+    void *reservation;                  /* zone PROT_NONE d'alignement (THP) */
+    size_t taille_reservation;
+} segment_t;
+
+static inline double seg_secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Point de montage hugetlbfs (ex. /dev/hugepages), 0 si trouve */
+static inline int seg_montage_hugetlbfs(char *rep, size_t taille) {
+    FILE *f = fopen("/proc/mounts", "r");
+    if (!f) return -1;
+    char source[256], point[PATH_MAX / 2], type[64];
+    int trouve = -1;
+    while (fscanf(f, "%255s %2047s %63s %*[^\n]", source, point, type) == 3) {
+        if (strcmp(type, "hugetlbfs") == 0) {
+            snprintf(rep, taille, "%s", point);
+            trouve = 0;
+            break;
+        }
+    }
+    fclose(f);
+    return trouve;
+}
+
+/* Noeuds NUMA en ligne ("0-1,3") -> masque ; nombre de bits utiles */
+static inline unsigned long seg_noeuds_en_ligne(unsigned long *masque) {
+    *masque = 1;
+    FILE *f = fopen("/sys/devices/system/node/online", "r");
+    if (!f) return 1;
+    char ligne[256];
+    unsigned long max = 0;
+    if (fgets(ligne, sizeof(ligne), f)) {
+        *masque = 0;
+        for (char *p = ligne; *p && *p != '\n';) {
+            unsigned long a = strtoul(p, &p, 10), b = a;
+            if (*p == '-') b = strtoul(p + 1, &p, 10);
+            for (unsigned long n = a; n <= b && n < 8 * sizeof(*masque); n++) *masque |= 1UL << n;
+            if (b > max) max = b;
+            if (*p == ',') p++;
+        }
+    }
+    fclose(f);
+    return max + 2;                     /* maxnode du noyau : bits + 1 */
+}
+
+/* A appliquer avant le premier acces : la politique vaut pour les pages
+   futures (et pour l'objet shmem entier si le segment est partage) */
+static inline int seg_appliquer_numa(segment_t *s) {
+    if (s->numa == SEG_NUMA_DEFAUT) return 0;
+    unsigned long masque;
+    unsigned long maxnode = seg_noeuds_en_ligne(&masque);
+    long r = s->numa == SEG_NUMA_LOCAL
+           ? syscall(SYS_mbind, s->adresse, s->taille, MPOL_LOCAL, NULL, 0UL, 0U)
+           : syscall(SYS_mbind, s->adresse, s->taille, MPOL_INTERLEAVE, &masque, maxnode, 0U);
+    s->erreur_numa = r == -1 ? errno : 0;
+    return r == -1 ? -1 : 0;
+}
+
+/* Octets du segment reellement servis par des grandes pages (smaps) */
+static inline size_t segment_octets_grandes_pages(const segment_t *s) {
+    FILE *f = fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+    char ligne[512];
+    unsigned long cible = (unsigned long)s->adresse;
+    int dedans = 0;
+    size_t total = 0;
+    while (fgets(ligne, sizeof(ligne), f)) {
+        unsigned long debut, fin, ko;
+        char droits[8], champ[64];
+        if (sscanf(ligne, "%lx-%lx %7s", &debut, &fin, droits) == 3) {
+            /* En-tete d'une nouvelle zone : ne compte que celles du segment */
+            dedans = debut >= cible && debut < cible + s->taille;
+            continue;
+        }
+        if (!dedans || sscanf(ligne, "%63[^:]: %lu kB", champ, &ko) != 2) continue;
+        if (strcmp(champ, "AnonHugePages") == 0 || strcmp(champ, "ShmemPmdMapped") == 0
+            || strcmp(champ, "FilePmdMapped") == 0 || strcmp(champ, "Shared_Hugetlb") == 0
+            || strcmp(champ, "Private_Hugetlb") == 0) {
+            total += (size_t)ko * 1024;
+        }
+    }
+    fclose(f);
+    return total;
+}
+
+static inline int seg_precharger(segment_t *s) {
+    double debut = seg_secondes();
+    if (madvise(s->adresse, s->taille, MADV_POPULATE_WRITE) == -1) {
+        if (errno != EINVAL) return -1;
+        /* Noyau ancien : une ecriture par page suffit a l'allouer */
+        volatile char *p = s->adresse;
+        for (size_t i = 0; i < s->taille; i += 4096) p[i] = p[i];
+    }
+    s->duree_prechargement = seg_secondes() - debut;
+    return 0;
+}
+
+/* Projette taille octets de fd (ou anonyme si fd == -1) ; pour THP,
+   l'adresse est alignee sur 2 Mo pour que chaque bloc puisse etre une PMD */
+static inline void *seg_projeter(segment_t *s, int fd, int drapeaux) {
+    if (s->obtenu != SEG_PAGES_THP) {
+        return mmap(NULL, s->taille, PROT_READ | PROT_WRITE, drapeaux, fd, 0);
+    }
+    s->taille_reservation = s->taille + SEG_GRANDE_PAGE;
+    s->reservation = mmap(NULL, s->taille_reservation, PROT_NONE,
+                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (s->reservation == MAP_FAILED) {
+        s->reservation = NULL;
+        return MAP_FAILED;
+    }
+    uintptr_t a = ((uintptr_t)s->reservation + SEG_GRANDE_PAGE - 1) & ~(uintptr_t)(SEG_GRANDE_PAGE - 1);
+    void *p = mmap((void *)a, s->taille, PROT_READ | PROT_WRITE, drapeaux | MAP_FIXED, fd, 0);
+    if (p == MAP_FAILED) {
+        munmap(s->reservation, s->taille_reservation);
+        s->reservation = NULL;
+    }
+    return p;
+}
+
+/* Une tentative avec le mode s->obtenu ; -1 pour passer au repli */
+static inline int seg_essayer(segment_t *s, const char *nom, size_t taille, int options) {
+    bool enorme = s->obtenu == SEG_PAGES_HUGETLB;
+    size_t page = enorme || s->obtenu == SEG_PAGES_THP ? SEG_GRANDE_PAGE : 4096;
+    s->taille = (taille + page - 1) & ~(page - 1);
+    s->fd = -1;
+    s->chemin[0] = '\0';
+    int drapeaux;
+
+    if (options & SEG_PRIVE) {
+        drapeaux = MAP_PRIVATE | MAP_ANONYMOUS | (enorme ? MAP_HUGETLB : 0);
+    } else {
+        drapeaux = MAP_SHARED;
+        if (nom == NULL) {
+            s->fd = (int)syscall(SYS_memfd_create, "segment", MFD_CLOEXEC | (enorme ? MFD_HUGETLB : 0));
+        } else if (enorme) {
+            char rep[PATH_MAX / 2];
+            if (seg_montage_hugetlbfs(rep, sizeof(rep)) == -1) return -1;
+            snprintf(s->chemin, sizeof(s->chemin), "%s/%s", rep, nom[0] == '/' ? nom + 1 : nom);
+            s->fd = open(s->chemin, O_CREAT | O_RDWR | O_TRUNC, 0600);
+        } else {
+            snprintf(s->chemin, sizeof(s->chemin), "%s", nom);
+            shm_unlink(nom);
+            s->fd = shm_open(nom, O_CREAT | O_EXCL | O_RDWR, 0600);
+        }
+        if (s->fd == -1 || ftruncate(s->fd, (off_t)s->taille) == -1) goto echec;
+    }
+
+    s->adresse = seg_projeter(s, s->fd, drapeaux);
+    if (s->adresse == MAP_FAILED) goto echec;   /* hugetlb : ENOMEM si le pool est vide */
+    if (s->obtenu == SEG_PAGES_THP && madvise(s->adresse, s->taille, MADV_HUGEPAGE) == -1) {
+        munmap(s->reservation, s->taille_reservation);   /* THP desactive (never) */
+        s->reservation = NULL;
+        goto echec;
+    }
+    return 0;
+
+echec:
+    if (s->fd != -1) close(s->fd);
+    if (s->chemin[0]) {
+        if (enorme) unlink(s->chemin);
+        else shm_unlink(s->chemin);
+    }
+    s->fd = -1;
+    s->chemin[0] = '\0';
+    return -1;
+}
+
+/* Cree un segment de taille octets. nom : NULL pour un segment anonyme
+   (memfd, partage par fork ou passage du descripteur), sinon nom POSIX
+   (shm_open) ou fichier hugetlbfs. Le mode de pages se replie jusqu'aux
+   pages de 4 Ko ; s->obtenu dit ce qui a ete accorde.
+   Retour : 0, ou -1 avec errno si meme les pages de 4 Ko echouent */
+static inline int segment_creer(segment_t *s, const char *nom, size_t taille,
+                                seg_pages_t pages, seg_numa_t numa, int options) {
+    memset(s, 0, sizeof(*s));
+    s->demande = pages;
+    s->numa = numa;
+    int r = -1;
+    for (int mode = (int)pages; mode >= 0 && r == -1; mode--) {
+        s->obtenu = (seg_pages_t)mode;
+        r = seg_essayer(s, nom, taille, options);
+    }
+    if (r == -1) return -1;
+
+    seg_appliquer_numa(s);              /* echec non fatal : voir erreur_numa */
+    if (options & SEG_PRECHARGER) {
+        if (seg_precharger(s) == -1) return -1;
+        /* THP n'est qu'un conseil : le noyau peut l'ignorer (shmem_enabled) */
+        if (s->obtenu == SEG_PAGES_THP && segment_octets_grandes_pages(s) == 0) {
+            s->obtenu = SEG_PAGES_NORMALES;
+        }
+    }
+    return 0;
+}
+
+/* Rattache un segment nomme cree par un autre processus : fichier
+   hugetlbfs s'il existe, sinon objet shm_open (projete aligne pour THP) */
+static inline int segment_ouvrir(segment_t *s, const char *nom) {
+    memset(s, 0, sizeof(*s));
+    char rep[PATH_MAX / 2];
+    s->obtenu = SEG_PAGES_THP;
+    if (seg_montage_hugetlbfs(rep, sizeof(rep)) == 0) {
+        snprintf(s->chemin, sizeof(s->chemin), "%s/%s", rep, nom[0] == '/' ? nom + 1 : nom);
+        s->fd = open(s->chemin, O_RDWR);
+        if (s->fd != -1) s->obtenu = SEG_PAGES_HUGETLB;
+    }
+    if (s->obtenu != SEG_PAGES_HUGETLB) {
+        snprintf(s->chemin, sizeof(s->chemin), "%s", nom);
+        s->fd = shm_open(nom, O_RDWR, 0);
+    }
+    struct stat st;
+    if (s->fd == -1 || fstat(s->fd, &st) == -1) goto echec;
+    s->demande = s->obtenu;
+    s->taille = (size_t)st.st_size;
+    s->adresse = seg_projeter(s, s->fd, MAP_SHARED);
+    if (s->adresse == MAP_FAILED) goto echec;
+    if (s->obtenu == SEG_PAGES_THP) madvise(s->adresse, s->taille, MADV_HUGEPAGE);
+    return 0;
+
+echec:
+    if (s->fd != -1) close(s->fd);
+    s->fd = -1;
+    s->adresse = NULL;
+    return -1;
+}
+
+static inline void segment_fermer(segment_t *s) {
+    if (s->reservation) {
+        /* La reservation couvre le segment : un seul munmap suffit */
+        munmap(s->reservation, s->taille_reservation);
+    } else if (s->adresse) {
+        munmap(s->adresse, s->taille);
+    }
+    if (s->fd != -1) close(s->fd);
+    s->adresse = NULL;
+    s->reservation = NULL;
+    s->fd = -1;
+}
+
+/* Retire le nom (shm ou hugetlbfs) ; la memoire part au dernier fermer */
+static inline int segment_detruire(segment_t *s) {
+    if (s->chemin[0] == '\0') return 0;
+    int r = s->obtenu == SEG_PAGES_HUGETLB ? unlink(s->chemin) : shm_unlink(s->chemin);
+    s->chemin[0] = '\0';
+    return r;
+}
+
+#endif /* SEGMENT_PAGES_H */
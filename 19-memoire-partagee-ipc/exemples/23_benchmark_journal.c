@@ -0,0 +1,340 @@
+/* ============================================================================
+   Section 19.5 : Memory-mapped Files (mmap)
+   Description : Benchmark du journal mmap (23_journal_mmap.h) contre une
+                 journalisation fprintf + fflush
+                 - ajouts/s et validations selon la taille du lot
+                 - lecteurs concurrents dans des processus fils
+                 - reprise apres arret brutal et enregistrement corrompu
+                 - echeance du delai sans nouvel ajout (timerfd + poll)
+                 - acces direct par l'index clairseme
+   Fichier source : 05-mmap.md
+   ============================================================================ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include "23_journal_mmap.h"
+
+#define NB_LECTEURS   2
+#define MAX_DURABLES  2000              /* une synchro par enregistrement : borne */
+
+typedef enum {
+    METH_FPRINTF,
+    METH_FPRINTF_SYNC,
+    METH_LOT_1,
+    METH_LOT_64,
+    METH_LOT_1024,
+    METH_DELAI,
+    METH_FERMETURE,
+    NB_METHODES
+} methode_t;
+
+static const char *noms_methodes[NB_METHODES] = {
+    "fprintf+fflush", "fprintf+fdatasync", "journal lot 1", "journal lot 64",
+    "journal lot 1024", "journal delai 2 ms", "journal a la fermeture"
+};
+
+static const char *niveaux[] = { "INFO", "DEBUG", "WARN", "ERROR" };
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+/* Ligne de log deterministe numero i (longueur variable) */
+static int generer(char *buf, size_t taille, uint64_t i) {
+    uint32_t h = (uint32_t)(i * 2654435761u);
+    return snprintf(buf, taille, "ts=%llu niveau=%s service=api-%02u requete=%08x duree_us=%u message=%.*s\n",
+                    1700000000000ULL + i, niveaux[h % 4], h % 17, h, h % 100000, (int)(h % 48) + 4,
+                    "requete traitee sans erreur pour le client authentifie courant");
+}
+
+static bool contenu_correct(const void *donnees, uint32_t longueur, uint64_t i) {
+    char attendu[256];
+    int n = generer(attendu, sizeof(attendu), i);
+    return (uint32_t)n == longueur && memcmp(donnees, attendu, longueur) == 0;
+}
+
+typedef struct {
+    double duree;
+    uint64_t validations;
+    uint64_t octets;
+    bool ok;
+} resultat_t;
+
+static resultat_t executer(methode_t m, const char *chemin, long nb) {
+    resultat_t r = { 0, 0, 0, true };
+    char ligne[256];
+    unlink(chemin);
+    double debut = secondes();
+
+    if (m == METH_FPRINTF || m == METH_FPRINTF_SYNC) {
+        FILE *f = fopen(chemin, "w");
+        if (!f) {
+            r.ok = false;
+            return r;
+        }
+        for (long i = 0; i < nb; i++) {
+            int n = generer(ligne, sizeof(ligne), (uint64_t)i);
+            fprintf(f, "%s", ligne);
+            fflush(f);
+            if (m == METH_FPRINTF_SYNC) {
+                fdatasync(fileno(f));
+                r.validations++;
+            }
+            r.octets += (uint64_t)n;
+        }
+        fclose(f);
+        r.duree = secondes() - debut;
+
+        /* Verification : autant de lignes que d'ecritures */
+        f = fopen(chemin, "r");
+        long lignes = 0;
+        while (f && fgets(ligne, sizeof(ligne), f)) lignes++;
+        if (f) fclose(f);
+        r.ok = lignes == nb;
+        return r;
+    }
+
+    journal_config_t cfg = { 0, 0, 0 };
+    if (m == METH_LOT_1) cfg.lot_max = 1;
+    if (m == METH_LOT_64) cfg.lot_max = 64;
+    if (m == METH_LOT_1024) cfg.lot_max = 1024;
+    if (m == METH_DELAI) cfg.delai_max_us = 2000;
+    journal_t j;
+    if (journal_ouvrir(&j, chemin, &cfg) == -1) {
+        perror("journal_ouvrir");
+        r.ok = false;
+        return r;
+    }
+    for (long i = 0; i < nb; i++) {
+        int n = generer(ligne, sizeof(ligne), (uint64_t)i);
+        if (journal_ajouter(&j, ligne, (uint32_t)n) != i) r.ok = false;
+        r.octets += (uint64_t)n;
+    }
+    journal_valider(&j);
+    r.validations = j.nb_validations;
+    journal_fermer(&j);
+    r.duree = secondes() - debut;
+
+    /* Verification : reprise complete puis acces direct aleatoire */
+    if (journal_ouvrir(&j, chemin, NULL) == -1 || j.nb_repris != (uint64_t)nb) {
+        r.ok = false;
+    } else {
+        uint64_t etat = 88172645463325252ULL;
+        for (int k = 0; k < 1000; k++) {
+            etat ^= etat << 13, etat ^= etat >> 7, etat ^= etat << 17;
+            uint64_t i = etat % (uint64_t)nb;
+            uint32_t longueur;
+            const void *p = journal_lire(&j, i, &longueur);
+            if (!p || !contenu_correct(p, longueur, i)) r.ok = false;
+        }
+    }
+    journal_fermer(&j);
+    return r;
+}
+
+/* Lecteur (processus fils) : suit le journal jusqu'a nb enregistrements */
+static int suivre(const char *chemin, long nb, uint64_t *retard_max) {
+    journal_lecteur_t l;
+    for (int essai = 0; journal_lecteur_ouvrir(&l, chemin, true) == -1; essai++) {
+        if (essai > 1000) return 1;
+        usleep(1000);
+    }
+    long lus = 0;
+    *retard_max = 0;
+    while (lus < nb) {
+        const void *p;
+        uint32_t longueur;
+        int r = journal_lecteur_suivant(&l, &p, &longueur);
+        if (r == -1) {
+            journal_lecteur_fermer(&l);
+            return 2;
+        }
+        if (r == 0) {
+            usleep(50);                 /* rattrape : laisser l'ecrivain avancer */
+            continue;
+        }
+        if (!contenu_correct(p, longueur, (uint64_t)lus)) {
+            journal_lecteur_fermer(&l);
+            return 3;
+        }
+        lus++;
+        journal_entete_t *e = (journal_entete_t *)l.v.base;
+        uint64_t retard = atomic_load_explicit(&e->fin_publiee, memory_order_relaxed) - l.position;
+        if (retard > *retard_max) *retard_max = retard;
+    }
+    journal_lecteur_fermer(&l);
+    return 0;
+}
+
+static bool tester_lecteurs(const char *chemin, long nb) {
+    unlink(chemin);
+    journal_config_t cfg = { 1 << 20, 64, 0 };     /* petits extents : les lecteurs suivent l'agrandissement */
+    journal_t j;
+    if (journal_ouvrir(&j, chemin, &cfg) == -1) return false;
+
+    int tubes[NB_LECTEURS][2];
+    pid_t fils[NB_LECTEURS];
+    for (int k = 0; k < NB_LECTEURS; k++) {
+        if (pipe(tubes[k]) == -1) return false;
+        fils[k] = fork();
+        if (fils[k] == 0) {
+            uint64_t retard = 0;
+            int code = suivre(chemin, nb, &retard);
+            if (write(tubes[k][1], &retard, sizeof(retard)) != sizeof(retard)) code = 4;
+            _exit(code);
+        }
+        close(tubes[k][1]);
+    }
+
+    char ligne[256];
+    double debut = secondes();
+    for (long i = 0; i < nb; i++) {
+        int n = generer(ligne, sizeof(ligne), (uint64_t)i);
+        journal_ajouter(&j, ligne, (uint32_t)n);
+    }
+    journal_valider(&j);
+    double duree = secondes() - debut;
+    uint64_t extensions = j.nb_extensions;
+
+    bool ok = true;
+    for (int k = 0; k < NB_LECTEURS; k++) {
+        uint64_t retard = 0;
+        int statut;
+        if (read(tubes[k][0], &retard, sizeof(retard)) != sizeof(retard)) retard = 0;
+        close(tubes[k][0]);
+        waitpid(fils[k], &statut, 0);
+        bool bon = WIFEXITED(statut) && WEXITSTATUS(statut) == 0;
+        ok = ok && bon;
+        printf("  lecteur %d : %ld enregistrements verifies, retard max %.1f Ko  %s\n",
+               k, bon ? nb : 0, (double)retard / 1024.0, bon ? "ok" : "ECHEC");
+    }
+    printf("  ecrivain : %.0f ajouts/s avec %d lecteurs, %llu extensions de 1 Mo\n",
+           (double)nb / duree, NB_LECTEURS, (unsigned long long)extensions);
+    journal_fermer(&j);
+    return ok;
+}
+
+/* Arret brutal (fils termine sans fermer, page cache intact) puis corruption d'un enregistrement
+   non valide : la reprise s'arrete juste avant, et un ajout plus court ne
+   fait pas revivre les enregistrements suivants */
+static bool tester_reprise(const char *chemin) {
+    const long valides = 1000, perdus = 20, corrompu = 5;
+    unlink(chemin);
+    pid_t pid = fork();
+    if (pid == 0) {
+        journal_t j;
+        char ligne[256];
+        if (journal_ouvrir(&j, chemin, NULL) == -1) _exit(1);
+        for (long i = 0; i < valides + perdus; i++) {
+            int n = generer(ligne, sizeof(ligne), (uint64_t)i);
+            journal_ajouter(&j, ligne, (uint32_t)n);
+            if (i == valides - 1) journal_valider(&j);
+        }
+        _exit(0);                       /* pas de journal_fermer */
+    }
+    int statut;
+    waitpid(pid, &statut, 0);
+
+    journal_t j;
+    if (journal_ouvrir(&j, chemin, NULL) == -1) return false;
+    uint64_t apres_arret = j.nb_repris;
+    bool ok = apres_arret == (uint64_t)(valides + perdus);
+    uint32_t longueur;
+    const unsigned char *p = journal_lire(&j, (uint64_t)(valides + corrompu), &longueur);
+    off_t position = (off_t)(p - j.v.base) + 10;
+    journal_fermer(&j);
+
+    int fd = open(chemin, O_WRONLY);
+    if (fd == -1 || pwrite(fd, "#", 1, position) != 1) ok = false;
+    if (fd != -1) close(fd);
+
+    if (journal_ouvrir(&j, chemin, NULL) == -1) return false;
+    uint64_t repris = j.nb_repris, ecartes = j.octets_ecartes;
+    ok = ok && repris == (uint64_t)(valides + corrompu);
+    char court[] = "redemarrage";
+    journal_ajouter(&j, court, sizeof(court) - 1);
+    journal_fermer(&j);
+
+    if (journal_ouvrir(&j, chemin, NULL) == -1) return false;
+    ok = ok && j.nb_repris == (uint64_t)(valides + corrompu + 1);
+    const void *dernier = journal_lire(&j, j.nb_repris - 1, &longueur);
+    ok = ok && dernier && longueur == sizeof(court) - 1 && memcmp(dernier, court, longueur) == 0;
+    printf("  %ld valides + %ld sans validation, fils termine sans fermer : %llu repris\n",
+           valides, perdus, (unsigned long long)apres_arret);
+    printf("  enregistrement %ld corrompu : %llu repris, %llu octets ecartes ; "
+           "apres un ajout : %llu (generation %u)  %s\n", valides + corrompu,
+           (unsigned long long)repris, (unsigned long long)ecartes,
+           (unsigned long long)j.nb_repris, j.generation, ok ? "ok" : "ECHEC");
+    journal_fermer(&j);
+    return ok;
+}
+
+/* Ecrivain qui se tait apres un ajout : le lot doit devenir durable a
+   l'echeance du delai, sans attendre un ajout qui ne viendra pas */
+static bool tester_echeance(const char *chemin) {
+    const uint32_t delai_us = 2000;
+    unlink(chemin);
+    journal_t j;
+    journal_config_t cfg = { 1 << 20, 0, delai_us };
+    if (journal_ouvrir(&j, chemin, &cfg) == -1) return false;
+    char ligne[256];
+    int n = generer(ligne, sizeof(ligne), 0);
+    double t0 = secondes();
+    bool ok = journal_ajouter(&j, ligne, (uint32_t)n) == 0 && j.fin_durable < j.fin;
+    struct pollfd pfd = { journal_fd_echeance(&j), POLLIN, 0 };
+    while (ok && j.fin_durable < j.fin && secondes() - t0 < 1.0) {
+        if (poll(&pfd, 1, 1000) == -1 && errno != EINTR) ok = false;
+        else if (journal_echeance(&j) == -1) ok = false;
+    }
+    double attente = secondes() - t0;
+    ok = ok && j.fin_durable == j.fin && j.nb_validations == 1 && attente >= delai_us / 1e6;
+    printf("  1 ajout puis silence : durable apres %.1f ms (delai %.0f ms), %llu validation  %s\n",
+           attente * 1e3, delai_us / 1e3, (unsigned long long)j.nb_validations, ok ? "ok" : "ECHEC");
+    journal_fermer(&j);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    long nb = argc > 1 ? atol(argv[1]) : 200000;
+    const char *rep = argc > 2 ? argv[2] : "/tmp";
+    if (nb < 1000) nb = 1000;
+    char chemin[4096];
+    snprintf(chemin, sizeof(chemin), "%s/journal_%d.jrn", rep, (int)getpid());
+
+    printf("=== Journal mmap : %ld lignes de log (%s) ===\n\n", nb, rep);
+    printf("%-24s %9s %12s %8s %11s  %s\n", "Methode", "Lignes", "Ajouts/s", "Mo/s", "Synchros", "Verif");
+    bool ok = true;
+    for (int m = 0; m < NB_METHODES; m++) {
+        long n = (m == METH_FPRINTF_SYNC || m == METH_LOT_1) && nb > MAX_DURABLES ? MAX_DURABLES : nb;
+        resultat_t r = executer((methode_t)m, chemin, n);
+        ok = ok && r.ok;
+        printf("%-24s %9ld %12.0f %8.1f %11llu  %s\n", noms_methodes[m], n, (double)n / r.duree,
+               (double)r.octets / r.duree / (1024.0 * 1024.0), (unsigned long long)r.validations,
+               r.ok ? "ok" : "ECHEC");
+    }
+
+    printf("\n--- Lecteurs concurrents (processus fils, CRC verifie) ---\n");
+    ok = tester_lecteurs(chemin, nb) && ok;
+
+    printf("\n--- Reprise apres arret brutal ---\n");
+    ok = tester_reprise(chemin) && ok;
+
+    printf("\n--- Echeance du delai sans nouvel ajout ---\n");
+    ok = tester_echeance(chemin) && ok;
+    unlink(chemin);
+
+    printf("\nVerification : %s\n", ok ? "contenu, reprise, echeance et lecteurs concurrents corrects" : "ECHEC");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,495 @@
+/* ============================================================================
+   Section 19.5 : Memory-mapped Files (mmap)
+   Description : Journal persistant en ajout seul projete par mmap
+                 (header-only), prolongeant 14_modify_file_mmap.c
+                 - enregistrements prefixes par leur longueur + CRC32C
+                 - fichier agrandi par extents fixes, projection a adresse
+                   stable (reservation PROT_NONE puis MAP_FIXED)
+                 - validation groupee : msync(MS_SYNC) d'un lot, ou a
+                   l'echeance d'un timerfd meme sans nouvel ajout
+                 - a l'ouverture : reprise apres coupure (CRC et numero
+                   de generation) et index clairseme des positions
+                 - un ecrivain (flock), lecteurs concurrents dans
+                   d'autres threads ou processus
+   Fichier source : 05-mmap.md
+   ============================================================================ */
+#ifndef JOURNAL_MMAP_H
+#define JOURNAL_MMAP_H
+
+/* MAP_NORESERVE exige _GNU_SOURCE avant tout include */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+
+#define JOURNAL_MAGIQUE    0x4A524E31u  /* "JRN1" */
+#define JOURNAL_VERSION    1
+#define JOURNAL_ENTETE_MIN 4096         /* en-tete : une page d'au moins 4 Ko, puis enregistrements */
+#define JOURNAL_RESERVE    (1ULL << 36) /* 64 Go d'adresses : la base ne bouge jamais */
+#define JOURNAL_PAS_INDEX  64           /* une position memorisee tous les 64 enregistrements */
+#define JOURNAL_MAX        (1u << 30)
+
+typedef struct {
+    uint32_t magique;
+    uint32_t version;
+    uint64_t taille_extent;
+    uint32_t generation;                /* incrementee a chaque ouverture en ecriture */
+    uint32_t taille_entete;             /* page du createur ; 0 : ancien format, 4096 */
+    _Alignas(64) atomic_uint_least64_t fin_publiee;     /* lecteurs : lisibles jusqu'ici */
+} journal_entete_t;
+
+/* Enregistrement : prefixe, donnees, bourrage a 8. Le CRC couvre longueur,
+   generation et donnees. La generation ne decroit jamais le long du
+   journal : un ancien enregistrement reste derriere une queue dechiree ne
+   peut pas etre repris a la suite d'un enregistrement plus recent */
+typedef struct {
+    uint32_t longueur;
+    uint32_t generation;
+    uint32_t crc;
+    uint32_t reserve;
+} journal_prefixe_t;
+
+typedef struct {
+    uint64_t taille_extent;             /* 0 : 64 Mo */
+    uint32_t lot_max;                   /* validation auto apres n ajouts (0 : manuelle) */
+    uint32_t delai_max_us;              /* ... ou apres ce delai depuis le 1er ajout en attente */
+} journal_config_t;
+
+typedef struct {
+    uint64_t *positions;                /* positions[k] : debut de l'enregistrement k * PAS */
+    size_t nb_positions;
+    size_t capacite;
+    uint64_t nb_enregistrements;
+} journal_index_t;
+
+/* Projection commune a l'ecrivain et aux lecteurs */
+typedef struct {
+    int fd;
+    unsigned char *base;                /* reservation de JOURNAL_RESERVE octets */
+    uint64_t projete;                   /* octets du fichier projetes a base */
+    uint64_t debut;                     /* premier enregistrement, apres l'en-tete */
+    int protection;
+    journal_index_t index;
+} journal_vue_t;
+
+typedef struct {
+    journal_vue_t v;
+    journal_entete_t *e;
+    uint64_t fin;                       /* prochain octet a ecrire */
+    uint64_t fin_durable;               /* tout ce qui precede est sur disque */
+    uint64_t taille_extent;
+    uint32_t lot_max;
+    uint32_t delai_max_us;
+    uint32_t en_attente;
+    uint64_t premier_en_attente_ns;
+    int fd_echeance;                    /* timerfd du delai (-1 sans delai) : a surveiller par poll */
+    uint32_t generation;
+    uint64_t nb_repris;                 /* enregistrements retrouves a l'ouverture */
+    uint64_t octets_ecartes;            /* queue non reprise (dechiree ou non validee) */
+    uint64_t nb_validations;
+    uint64_t nb_extensions;
+} journal_t;
+
+typedef struct {
+    journal_vue_t v;
+    uint64_t position;                  /* prochain enregistrement a rendre */
+    uint32_t generation;                /* du dernier enregistrement rendu */
+    bool verifier;                      /* recalcule le CRC a chaque lecture */
+} journal_lecteur_t;
+
+/* --- CRC32C (Castagnoli), table construite au premier appel --- */
+
+static inline uint32_t journal_crc32c(uint32_t crc, const void *donnees, size_t n) {
+    static uint32_t table[256];
+    static atomic_bool prete;
+    if (!atomic_load_explicit(&prete, memory_order_acquire)) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) c = c & 1 ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            table[i] = c;               /* meme valeur si deux threads construisent */
+        }
+        atomic_store_explicit(&prete, true, memory_order_release);
+    }
+    const unsigned char *p = donnees;
+    crc = ~crc;
+    for (size_t i = 0; i < n; i++) crc = table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static inline uint32_t journal_crc_enregistrement(const journal_prefixe_t *pre, const void *donnees) {
+    uint32_t crc = journal_crc32c(0, &pre->longueur, sizeof(pre->longueur));
+    crc = journal_crc32c(crc, &pre->generation, sizeof(pre->generation));
+    return journal_crc32c(crc, donnees, pre->longueur);
+}
+
+static inline uint64_t journal_arrondi8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+static inline uint64_t journal_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Les offsets de mmap doivent etre alignes sur la page : l'en-tete en
+   occupe une entiere (16 ou 64 Ko sur certains noyaux arm64/ppc64) */
+static inline uint64_t journal_page(void) {
+    long page = sysconf(_SC_PAGESIZE);
+    return page > JOURNAL_ENTETE_MIN ? (uint64_t)page : JOURNAL_ENTETE_MIN;
+}
+
+/* Debut des enregistrements d'apres l'en-tete projete ; 0 s'il est invalide */
+static inline uint64_t journal_debut(const journal_entete_t *e, uint64_t projete) {
+    uint64_t debut = e->taille_entete ? e->taille_entete : JOURNAL_ENTETE_MIN;
+    if (debut < sizeof(journal_entete_t) || debut % 8 || debut > projete) return 0;
+    return debut;
+}
+
+/* --- Projection a base fixe --- */
+
+static inline int journal_vue_ouvrir(journal_vue_t *v, int fd, int protection) {
+    memset(v, 0, sizeof(*v));
+    v->fd = fd;
+    v->protection = protection;
+    v->base = mmap(NULL, JOURNAL_RESERVE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (v->base == MAP_FAILED) {
+        v->base = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/* Projette le fichier jusqu'a taille (multiple de page) au-dessus de la
+   reservation : les pointeurs deja rendus restent valides */
+static inline int journal_vue_etendre(journal_vue_t *v, uint64_t taille) {
+    if (taille <= v->projete) return 0;
+    if (taille > JOURNAL_RESERVE) {
+        errno = EFBIG;
+        return -1;
+    }
+    void *p = mmap(v->base + v->projete, taille - v->projete, v->protection,
+                   MAP_SHARED | MAP_FIXED, v->fd, (off_t)v->projete);
+    if (p == MAP_FAILED) return -1;
+    v->projete = taille;
+    return 0;
+}
+
+static inline void journal_vue_fermer(journal_vue_t *v) {
+    if (v->base) munmap(v->base, JOURNAL_RESERVE);
+    if (v->fd != -1) close(v->fd);
+    free(v->index.positions);
+    memset(v, 0, sizeof(*v));
+    v->fd = -1;
+}
+
+static inline int journal_indexer(journal_index_t *x, uint64_t position) {
+    if (x->nb_enregistrements % JOURNAL_PAS_INDEX == 0) {
+        if (x->nb_positions == x->capacite) {
+            size_t cap = x->capacite ? x->capacite * 2 : 1024;
+            uint64_t *p = realloc(x->positions, cap * sizeof(*p));
+            if (!p) return -1;
+            x->positions = p;
+            x->capacite = cap;
+        }
+        x->positions[x->nb_positions++] = position;
+    }
+    x->nb_enregistrements++;
+    return 0;
+}
+
+/* Enregistrement valide a position, sans depasser limite ; longueur ou 0.
+   *generation : en entree la plus petite admise, en sortie celle lue */
+static inline uint32_t journal_valide(const journal_vue_t *v, uint64_t position, uint64_t limite,
+                                      bool verifier, uint32_t *generation) {
+    if (position + sizeof(journal_prefixe_t) > limite) return 0;
+    const journal_entete_t *e = (const journal_entete_t *)v->base;
+    journal_prefixe_t pre;
+    memcpy(&pre, v->base + position, sizeof(pre));
+    if (pre.longueur == 0 || pre.longueur > JOURNAL_MAX
+        || position + sizeof(pre) + pre.longueur > limite
+        || pre.generation < *generation || pre.generation > e->generation) {
+        return 0;
+    }
+    if (verifier && journal_crc_enregistrement(&pre, v->base + position + sizeof(pre)) != pre.crc) {
+        return 0;
+    }
+    *generation = pre.generation;
+    return pre.longueur;
+}
+
+/* Acces direct au numero-ieme enregistrement deja indexe : saut par
+   l'index clairseme puis au plus PAS - 1 enregistrements parcourus */
+static inline const void *journal_vue_lire(const journal_vue_t *v, uint64_t numero, uint32_t *longueur) {
+    if (numero >= v->index.nb_enregistrements) {
+        errno = ERANGE;
+        return NULL;
+    }
+    uint64_t position = v->index.positions[numero / JOURNAL_PAS_INDEX];
+    journal_prefixe_t pre;
+    for (uint64_t k = numero % JOURNAL_PAS_INDEX;; k--) {
+        memcpy(&pre, v->base + position, sizeof(pre));
+        if (k == 0) break;
+        position += journal_arrondi8(sizeof(pre) + pre.longueur);
+    }
+    *longueur = pre.longueur;
+    return v->base + position + sizeof(pre);
+}
+
+/* --- Ecrivain --- */
+
+/* Ouvre ou cree le journal chemin. Un seul ecrivain a la fois (EWOULDBLOCK).
+   Reprise : les enregistrements sont relus jusqu'au premier invalide ; les
+   suivants sont ecrases par les prochains ajouts, d'une generation plus
+   grande, sans avoir a effacer la queue */
+static inline int journal_ouvrir(journal_t *j, const char *chemin, const journal_config_t *cfg) {
+    memset(j, 0, sizeof(*j));
+    j->fd_echeance = -1;
+    int fd = open(chemin, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd == -1) return -1;
+    if (flock(fd, LOCK_EX | LOCK_NB) == -1 || journal_vue_ouvrir(&j->v, fd, PROT_READ | PROT_WRITE) == -1) {
+        int e = errno;
+        close(fd);
+        errno = e;
+        return -1;
+    }
+    uint64_t page = journal_page();
+    uint64_t extent = cfg && cfg->taille_extent ? cfg->taille_extent : 64ULL << 20;
+    j->taille_extent = (extent + page - 1) & ~(page - 1);
+    j->lot_max = cfg ? cfg->lot_max : 0;
+    j->delai_max_us = cfg ? cfg->delai_max_us : 0;
+    if (j->delai_max_us
+        && (j->fd_echeance = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)) == -1)
+        goto echec;
+
+    struct stat st;
+    if (fstat(fd, &st) == -1) goto echec;
+    uint64_t taille = (uint64_t)st.st_size;
+    bool neuf = taille < JOURNAL_ENTETE_MIN;
+    if (neuf) taille = page + j->taille_extent;
+    /* Cree sous des pages plus petites : completer la derniere page locale
+       (des zeros, qui ne forment aucun enregistrement valide) */
+    taille = (taille + page - 1) & ~(page - 1);
+    if (taille != (uint64_t)st.st_size && ftruncate(fd, (off_t)taille) == -1) goto echec;
+    if (journal_vue_etendre(&j->v, taille) == -1) goto echec;
+    j->e = (journal_entete_t *)j->v.base;
+
+    if (neuf) {
+        j->e->version = JOURNAL_VERSION;
+        j->e->taille_extent = j->taille_extent;
+        j->e->generation = 0;
+        j->e->taille_entete = (uint32_t)page;
+        atomic_store_explicit(&j->e->fin_publiee, j->e->taille_entete, memory_order_relaxed);
+        j->e->magique = JOURNAL_MAGIQUE;
+        if (msync(j->e, j->e->taille_entete, MS_SYNC) == -1) goto echec;
+    } else if (j->e->magique != JOURNAL_MAGIQUE || j->e->version != JOURNAL_VERSION) {
+        errno = EINVAL;
+        goto echec;
+    }
+    /* Un journal cree avec des pages plus petites reste lisible : seule la
+       projection (depuis l'offset 0) doit etre alignee sur la page locale */
+    if ((j->v.debut = journal_debut(j->e, taille)) == 0) {
+        errno = EINVAL;
+        goto echec;
+    }
+
+    /* Reprise : chaque enregistrement est verifie */
+    uint64_t position = j->v.debut;
+    uint32_t n, generation = 0;
+    while ((n = journal_valide(&j->v, position, taille, true, &generation)) != 0) {
+        if (journal_indexer(&j->v.index, position) == -1) goto echec;
+        position += journal_arrondi8(sizeof(journal_prefixe_t) + n);
+    }
+    j->nb_repris = j->v.index.nb_enregistrements;
+    j->fin = j->fin_durable = position;
+
+    uint64_t fin_ancienne = atomic_load_explicit(&j->e->fin_publiee, memory_order_relaxed);
+    if (fin_ancienne > position) j->octets_ecartes = fin_ancienne - position;
+
+    /* Nouvelle generation durable avant tout ajout */
+    j->generation = ++j->e->generation;
+    atomic_store_explicit(&j->e->fin_publiee, position, memory_order_release);
+    if (msync(j->e, j->v.debut, MS_SYNC) == -1) goto echec;
+    return 0;
+
+echec:;
+    int e = errno;
+    if (j->fd_echeance != -1) close(j->fd_echeance);
+    journal_vue_fermer(&j->v);
+    errno = e;
+    return -1;
+}
+
+/* Rend durable tout ce qui a ete ajoute : un seul msync pour le lot.
+   msync(MS_SYNC) ecrit les pages et synchronise les donnees de la plage
+   (equivalent d'un fdatasync limite a la zone modifiee) */
+static inline int journal_valider(journal_t *j) {
+    if (j->fin == j->fin_durable) return 0;
+    long page = sysconf(_SC_PAGESIZE);
+    uint64_t debut = j->fin_durable & ~((uint64_t)page - 1);
+    if (msync(j->v.base + debut, j->fin - debut, MS_SYNC) == -1) return -1;
+    j->fin_durable = j->fin;
+    j->en_attente = 0;
+    j->nb_validations++;
+    return 0;
+}
+
+static inline int journal_agrandir(journal_t *j, uint64_t besoin) {
+    uint64_t taille = j->v.projete;
+    while (taille < besoin) taille += j->taille_extent;
+    /* Blocs reserves d'avance : pas de SIGBUS sur disque plein pendant l'ecriture */
+    int r = posix_fallocate(j->v.fd, (off_t)j->v.projete, (off_t)(taille - j->v.projete));
+    if (r != 0 && r != EOPNOTSUPP && r != EINVAL) {
+        errno = r;
+        return -1;
+    }
+    if (r != 0 && ftruncate(j->v.fd, (off_t)taille) == -1) return -1;
+    if (journal_vue_etendre(&j->v, taille) == -1) return -1;
+    j->nb_extensions++;
+    return 0;
+}
+
+/* Arme le timerfd pour dans attente_ns (one-shot) */
+static inline int journal_armer(journal_t *j, uint64_t attente_ns) {
+    if (attente_ns == 0) attente_ns = 1;            /* 0 desarmerait le timer */
+    struct itimerspec t = { { 0, 0 }, { (time_t)(attente_ns / 1000000000ULL), (long)(attente_ns % 1000000000ULL) } };
+    return timerfd_settime(j->fd_echeance, 0, &t, NULL);
+}
+
+/* Reste du delai compte depuis le premier ajout en attente, 0 s'il est ecoule */
+static inline uint64_t journal_reste_ns(const journal_t *j) {
+    uint64_t ecoule = journal_ns() - j->premier_en_attente_ns;
+    uint64_t delai = (uint64_t)j->delai_max_us * 1000;
+    return ecoule >= delai ? 0 : delai - ecoule;
+}
+
+/* Ajoute un enregistrement et le publie aux lecteurs. Durable apres le
+   prochain journal_valider (explicite, ou automatique selon lot/delai ;
+   le delai expire aussi sans ajout, via journal_echeance).
+   Retour : numero de l'enregistrement, ou -1 avec errno */
+static inline int64_t journal_ajouter(journal_t *j, const void *donnees, uint32_t longueur) {
+    if (longueur == 0 || longueur > JOURNAL_MAX) {
+        errno = EINVAL;
+        return -1;
+    }
+    uint64_t taille = journal_arrondi8(sizeof(journal_prefixe_t) + longueur);
+    if (j->fin + taille > j->v.projete && journal_agrandir(j, j->fin + taille) == -1) return -1;
+    if (journal_indexer(&j->v.index, j->fin) == -1) return -1;
+
+    journal_prefixe_t pre = { longueur, j->generation, 0, 0 };
+    pre.crc = journal_crc_enregistrement(&pre, donnees);
+    unsigned char *p = j->v.base + j->fin;
+    memcpy(p + sizeof(pre), donnees, longueur);
+    memcpy(p, &pre, sizeof(pre));
+    j->fin += taille;
+    atomic_store_explicit(&j->e->fin_publiee, j->fin, memory_order_release);
+
+    if (j->en_attente++ == 0 && j->delai_max_us) {
+        /* Un ecrivain qui se tait ensuite est valide a l'echeance du timer */
+        j->premier_en_attente_ns = journal_ns();
+        if (journal_armer(j, (uint64_t)j->delai_max_us * 1000) == -1) return -1;
+    }
+    if ((j->lot_max && j->en_attente >= j->lot_max) || (j->delai_max_us && journal_reste_ns(j) == 0)) {
+        if (journal_valider(j) == -1) return -1;
+    }
+    return (int64_t)j->v.index.nb_enregistrements - 1;
+}
+
+/* A appeler quand journal_fd_echeance devient lisible (poll/epoll) :
+   valide le lot en attente si le delai est ecoule, sinon rearme le timer
+   (echeance perimee d'un lot deja valide par lot_max ou explicitement) */
+static inline int journal_echeance(journal_t *j) {
+    if (j->fd_echeance == -1) return 0;
+    uint64_t expirations;
+    if (read(j->fd_echeance, &expirations, sizeof(expirations)) == -1 && errno != EAGAIN) return -1;
+    if (j->en_attente == 0) return 0;
+    uint64_t reste = journal_reste_ns(j);
+    return reste ? journal_armer(j, reste) : journal_valider(j);
+}
+
+/* -1 si le journal a ete ouvert sans delai_max_us */
+static inline int journal_fd_echeance(const journal_t *j) {
+    return j->fd_echeance;
+}
+
+static inline const void *journal_lire(const journal_t *j, uint64_t numero, uint32_t *longueur) {
+    return journal_vue_lire(&j->v, numero, longueur);
+}
+
+static inline int journal_fermer(journal_t *j) {
+    int r = journal_valider(j);
+    if (j->fd_echeance != -1) close(j->fd_echeance);
+    journal_vue_fermer(&j->v);
+    return r;
+}
+
+/* --- Lecteurs --- */
+
+static inline int journal_lecteur_ouvrir(journal_lecteur_t *l, const char *chemin, bool verifier) {
+    memset(l, 0, sizeof(*l));
+    int fd = open(chemin, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) return -1;
+    if (journal_vue_ouvrir(&l->v, fd, PROT_READ) == -1 || journal_vue_etendre(&l->v, journal_page()) == -1) {
+        int e = errno;
+        journal_vue_fermer(&l->v);
+        errno = e;
+        return -1;
+    }
+    const journal_entete_t *e = (const journal_entete_t *)l->v.base;
+    uint64_t page = journal_page();
+    if (e->magique != JOURNAL_MAGIQUE || e->version != JOURNAL_VERSION
+        || (l->v.debut = journal_debut(e, JOURNAL_RESERVE)) == 0
+        || journal_vue_etendre(&l->v, (l->v.debut + page - 1) & ~(page - 1)) == -1) {
+        journal_vue_fermer(&l->v);
+        errno = EINVAL;
+        return -1;
+    }
+    l->position = l->v.debut;
+    l->verifier = verifier;
+    return 0;
+}
+
+/* Prochain enregistrement publie. Retour : 1 (donnees, longueur remplis),
+   0 si le lecteur a rattrape l'ecrivain, -1 sur erreur (EBADMSG : CRC) */
+static inline int journal_lecteur_suivant(journal_lecteur_t *l, const void **donnees, uint32_t *longueur) {
+    journal_entete_t *e = (journal_entete_t *)l->v.base;
+    uint64_t fin = atomic_load_explicit(&e->fin_publiee, memory_order_acquire);
+    if (l->position >= fin) return 0;
+    if (fin > l->v.projete) {
+        /* L'ecrivain a agrandi le fichier : projeter les nouveaux extents */
+        struct stat st;
+        if (fstat(l->v.fd, &st) == -1) return -1;
+        if (journal_vue_etendre(&l->v, (uint64_t)st.st_size & ~(journal_page() - 1)) == -1) return -1;
+    }
+    uint32_t n = journal_valide(&l->v, l->position, fin, l->verifier, &l->generation);
+    if (n == 0) {
+        errno = EBADMSG;
+        return -1;
+    }
+    if (journal_indexer(&l->v.index, l->position) == -1) return -1;
+    *donnees = l->v.base + l->position + sizeof(journal_prefixe_t);
+    *longueur = n;
+    l->position += journal_arrondi8(sizeof(journal_prefixe_t) + n);
+    return 1;
+}
+
+/* Acces direct parmi les enregistrements deja parcourus par ce lecteur */
+static inline const void *journal_lecteur_lire(const journal_lecteur_t *l, uint64_t numero, uint32_t *longueur) {
+    return journal_vue_lire(&l->v, numero, longueur);
+}
+
+static inline void journal_lecteur_fermer(journal_lecteur_t *l) {
+    journal_vue_fermer(&l->v);
+}
+
+#endif /* JOURNAL_MMAP_H */
@@ -0,0 +1,367 @@
+/* ============================================================================
+   Section 19.4 : POSIX IPC vs System V IPC
+   Description : Benchmark des primitives futex (24_synchro_futex.h) contre
+                 le semaphore System V de 07 et le mutex pthread partage
+                 - verrou sans contention (ns par prendre + rendre)
+                 - latence de passage du verrou a un processus endormi
+                 - debit sous contention entre processus
+                 - aller-retour par condition / compteur d'evenements
+                 - reprise apres la mort du detenteur (mutex robuste)
+   Fichier source : 04-posix-vs-system-v.md
+   ============================================================================ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ipc.h>
+#include <sys/mman.h>
+#include <sys/sem.h>
+#include <sys/wait.h>
+#include "24_synchro_futex.h"
+
+#define NB_PASSAGES   2000
+#define NB_ALLERS     20000
+#define ATTENTE_US    200               /* le waiter a le temps de s'endormir */
+
+typedef enum { METH_SYSV, METH_PTHREAD, METH_FUTEX, METH_ROBUSTE, NB_METHODES } methode_t;
+
+static const char *noms_methodes[NB_METHODES] = {
+    "SysV semop", "pthread partage", "futex", "futex robuste"
+};
+
+typedef struct {
+    synchro_mutex_t mutex;
+    synchro_robuste_t robuste;
+    synchro_cond_t cond;
+    synchro_compteur_t compteurs[2];
+    pthread_mutex_t pmutex;
+    pthread_cond_t pcond;
+    int semid;
+    atomic_int etape;                   /* protocole du test de passage */
+    atomic_int pret;
+    atomic_uint_least64_t rendu_ns;
+    long compteur;                      /* protege par le verrou teste */
+    atomic_long tour;
+    long donnees[2];                    /* invariant : donnees[0] == donnees[1] */
+    uint64_t latences[NB_PASSAGES];
+} partage_t;
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t nanosecondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void prendre(partage_t *p, methode_t m) {
+    switch (m) {
+    case METH_SYSV: {
+        struct sembuf op = { 0, -1, 0 };
+        while (semop(p->semid, &op, 1) == -1 && errno == EINTR) {}
+        break;
+    }
+    case METH_PTHREAD: pthread_mutex_lock(&p->pmutex); break;
+    case METH_FUTEX:   synchro_mutex_prendre(&p->mutex); break;
+    default:           synchro_robuste_prendre(&p->robuste); break;
+    }
+}
+
+static void rendre(partage_t *p, methode_t m) {
+    switch (m) {
+    case METH_SYSV: {
+        struct sembuf op = { 0, +1, 0 };
+        semop(p->semid, &op, 1);
+        break;
+    }
+    case METH_PTHREAD: pthread_mutex_unlock(&p->pmutex); break;
+    case METH_FUTEX:   synchro_mutex_rendre(&p->mutex); break;
+    default:           synchro_robuste_rendre(&p->robuste); break;
+    }
+}
+
+/* Attente d'un drapeau partage : sched_yield laisse tourner l'autre
+   processus meme sur une machine a un seul coeur */
+static void attendre_valeur(atomic_int *a, int v) {
+    while (atomic_load_explicit(a, memory_order_acquire) != v) sched_yield();
+}
+
+static int comparer(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void reinitialiser(partage_t *p) {
+    synchro_mutex_init(&p->mutex);
+    synchro_robuste_init(&p->robuste);
+    synchro_cond_init(&p->cond);
+    synchro_compteur_init(&p->compteurs[0]);
+    synchro_compteur_init(&p->compteurs[1]);
+    atomic_store(&p->etape, 0);
+    atomic_store(&p->pret, 0);
+    atomic_store(&p->tour, 0);
+    p->compteur = 0;
+    p->donnees[0] = p->donnees[1] = 0;
+    semctl(p->semid, 0, SETVAL, 1);
+}
+
+/* --- 1. Sans contention --- */
+
+static double sans_contention(partage_t *p, methode_t m, long n) {
+    double debut = secondes();
+    for (long i = 0; i < n; i++) {
+        prendre(p, m);
+        p->compteur++;
+        rendre(p, m);
+    }
+    return (secondes() - debut) * 1e9 / (double)n;
+}
+
+/* --- 2. Passage du verrou a un processus endormi dessus --- */
+
+static bool passage(partage_t *p, methode_t m, double *p50, double *p99) {
+    reinitialiser(p);
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int k = 0; k < NB_PASSAGES; k++) {
+            attendre_valeur(&p->etape, 2 * k + 1);      /* le parent tient le verrou */
+            atomic_store_explicit(&p->pret, k + 1, memory_order_release);
+            prendre(p, m);                              /* s'endort */
+            p->latences[k] = nanosecondes() - atomic_load(&p->rendu_ns);
+            rendre(p, m);
+            atomic_store_explicit(&p->etape, 2 * k + 2, memory_order_release);
+        }
+        _exit(0);
+    }
+    struct timespec pause = { 0, ATTENTE_US * 1000L };
+    for (int k = 0; k < NB_PASSAGES; k++) {
+        prendre(p, m);
+        atomic_store_explicit(&p->etape, 2 * k + 1, memory_order_release);
+        attendre_valeur(&p->pret, k + 1);
+        nanosleep(&pause, NULL);
+        atomic_store(&p->rendu_ns, nanosecondes());
+        rendre(p, m);
+        attendre_valeur(&p->etape, 2 * k + 2);
+    }
+    int statut;
+    waitpid(pid, &statut, 0);
+    qsort(p->latences, NB_PASSAGES, sizeof(uint64_t), comparer);
+    *p50 = (double)p->latences[NB_PASSAGES / 2] / 1e3;
+    *p99 = (double)p->latences[NB_PASSAGES * 99 / 100] / 1e3;
+    return WIFEXITED(statut) && WEXITSTATUS(statut) == 0;
+}
+
+/* --- 3. Contention : chaque processus incremente le compteur protege --- */
+
+static bool contention(partage_t *p, methode_t m, int processus, long n, double *ops) {
+    reinitialiser(p);
+    double debut = secondes();
+    pid_t fils[8];
+    for (int i = 0; i < processus; i++) {
+        fils[i] = fork();
+        if (fils[i] == 0) {
+            for (long k = 0; k < n; k++) {
+                prendre(p, m);
+                p->compteur++;
+                rendre(p, m);
+            }
+            _exit(0);
+        }
+    }
+    for (int i = 0; i < processus; i++) waitpid(fils[i], NULL, 0);
+    *ops = (double)processus * (double)n / (secondes() - debut);
+    return p->compteur == (long)processus * n;
+}
+
+/* --- 4. Aller-retour : tour 0 -> 1 -> 0 entre deux processus --- */
+
+typedef enum { AR_PTHREAD, AR_FUTEX, AR_COMPTEUR, NB_AR } aller_retour_t;
+
+static const char *noms_ar[NB_AR] = {
+    "pthread_cond partage", "synchro_cond", "compteur d'evenements"
+};
+
+static void jouer(partage_t *p, aller_retour_t a, long moi, long n) {
+    for (long k = 0; k < n; k++) {
+        if (a == AR_PTHREAD) {
+            pthread_mutex_lock(&p->pmutex);
+            while (atomic_load(&p->tour) != moi) pthread_cond_wait(&p->pcond, &p->pmutex);
+            atomic_store(&p->tour, 1 - moi);
+            pthread_cond_signal(&p->pcond);
+            pthread_mutex_unlock(&p->pmutex);
+        } else if (a == AR_FUTEX) {
+            synchro_mutex_prendre(&p->mutex);
+            while (atomic_load(&p->tour) != moi) synchro_cond_attendre(&p->cond, &p->mutex, NULL);
+            atomic_store(&p->tour, 1 - moi);
+            synchro_cond_signaler(&p->cond);
+            synchro_mutex_rendre(&p->mutex);
+        } else {
+            synchro_compteur_t *le_mien = &p->compteurs[moi], *l_autre = &p->compteurs[1 - moi];
+            for (;;) {
+                unsigned vu = synchro_compteur_lire(le_mien);
+                if (atomic_load(&p->tour) == moi) break;
+                synchro_compteur_attendre(le_mien, vu, NULL);
+            }
+            atomic_store(&p->tour, 1 - moi);
+            synchro_compteur_signaler(l_autre);
+        }
+    }
+}
+
+static bool aller_retour(partage_t *p, aller_retour_t a, double *par_seconde) {
+    reinitialiser(p);
+    double debut = secondes();
+    pid_t pid = fork();
+    if (pid == 0) {
+        jouer(p, a, 1, NB_ALLERS);
+        _exit(0);
+    }
+    jouer(p, a, 0, NB_ALLERS);
+    int statut;
+    waitpid(pid, &statut, 0);
+    *par_seconde = NB_ALLERS / (secondes() - debut);
+    return WIFEXITED(statut) && WEXITSTATUS(statut) == 0 && atomic_load(&p->tour) == 0;
+}
+
+/* --- 5. Mutex robuste : le detenteur meurt en pleine section critique --- */
+
+static pid_t mourir_en_tenant(partage_t *p, int delai_ms) {
+    pid_t pid = fork();
+    if (pid == 0) {
+        synchro_robuste_prendre(&p->robuste);
+        p->donnees[0]++;                            /* invariant casse... */
+        atomic_store(&p->pret, 1);
+        if (delai_ms) {
+            struct timespec d = { 0, delai_ms * 1000000L };
+            nanosleep(&d, NULL);
+        }
+        _exit(0);                                   /* ... et jamais repare */
+    }
+    return pid;
+}
+
+static bool tester_robuste(partage_t *p) {
+    bool ok = true;
+
+    /* a) mort avant que le parent ne demande le verrou */
+    reinitialiser(p);
+    pid_t pid = mourir_en_tenant(p, 0);
+    waitpid(pid, NULL, 0);
+    int r = synchro_robuste_prendre(&p->robuste);
+    bool repare = r == EOWNERDEAD && p->donnees[0] != p->donnees[1];
+    p->donnees[1] = p->donnees[0];
+    synchro_robuste_coherent(&p->robuste);
+    synchro_robuste_rendre(&p->robuste);
+    r = synchro_robuste_prendre(&p->robuste);
+    synchro_robuste_rendre(&p->robuste);
+    printf("  detenteur mort avant la demande    : EOWNERDEAD, invariant repare, puis %s  %s\n",
+           r == 0 ? "0" : "erreur", repare && r == 0 ? "ok" : "ECHEC");
+    ok = ok && repare && r == 0;
+
+    /* b) parent endormi sur le verrou pendant la mort du detenteur */
+    reinitialiser(p);
+    pid = mourir_en_tenant(p, 100);
+    attendre_valeur(&p->pret, 1);
+    double debut = secondes();
+    r = synchro_robuste_prendre(&p->robuste);
+    double attente = secondes() - debut;
+    p->donnees[1] = p->donnees[0];
+    synchro_robuste_coherent(&p->robuste);
+    synchro_robuste_rendre(&p->robuste);
+    waitpid(pid, NULL, 0);
+    printf("  dormeur reveille par le noyau      : %s apres %.0f ms  %s\n",
+           r == EOWNERDEAD ? "EOWNERDEAD" : "autre", attente * 1e3, r == EOWNERDEAD ? "ok" : "ECHEC");
+    ok = ok && r == EOWNERDEAD;
+
+    /* c) repreneur qui rend sans declarer l'etat coherent */
+    reinitialiser(p);
+    pid = mourir_en_tenant(p, 0);
+    waitpid(pid, NULL, 0);
+    int r1 = synchro_robuste_prendre(&p->robuste);
+    synchro_robuste_rendre(&p->robuste);
+    int r2 = synchro_robuste_prendre(&p->robuste);
+    printf("  rendu sans synchro_robuste_coherent: %s puis %s  %s\n",
+           r1 == EOWNERDEAD ? "EOWNERDEAD" : "autre", r2 == ENOTRECOVERABLE ? "ENOTRECOVERABLE" : "autre",
+           r1 == EOWNERDEAD && r2 == ENOTRECOVERABLE ? "ok" : "ECHEC");
+    ok = ok && r1 == EOWNERDEAD && r2 == ENOTRECOVERABLE;
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    long iterations = argc > 1 ? atol(argv[1]) : 5000000;
+    int processus = argc > 2 ? atoi(argv[2]) : 2;
+    if (iterations < 1000) iterations = 1000;
+    if (processus < 2) processus = 2;
+    if (processus > 8) processus = 8;
+
+    partage_t *p = mmap(NULL, sizeof(partage_t), PROT_READ | PROT_WRITE,
+                        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        perror("mmap");
+        return 1;
+    }
+    p->semid = semget(IPC_PRIVATE, 1, IPC_CREAT | 0600);
+    if (p->semid == -1) {
+        perror("semget");
+        return 1;
+    }
+    pthread_mutexattr_t ma;
+    pthread_mutexattr_init(&ma);
+    pthread_mutexattr_setpshared(&ma, PTHREAD_PROCESS_SHARED);
+    pthread_mutex_init(&p->pmutex, &ma);
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setpshared(&ca, PTHREAD_PROCESS_SHARED);
+    pthread_cond_init(&p->pcond, &ca);
+
+    bool ok = true;
+    printf("=== Synchronisation inter-processus : futex vs System V vs pthread ===\n\n");
+    printf("%-16s %13s %20s %16s  %s\n", "Verrou", "Libre ns/op", "Passage p50/p99 us",
+           "Contention op/s", "Verif");
+    for (int m = 0; m < NB_METHODES; m++) {
+        reinitialiser(p);
+        long n = m == METH_SYSV ? iterations / 10 : iterations;
+        double libre = sans_contention(p, (methode_t)m, n);
+        bool egal = p->compteur == n;
+        double p50, p99, ops;
+        egal = passage(p, (methode_t)m, &p50, &p99) && egal;
+        egal = contention(p, (methode_t)m, processus, n / 10, &ops) && egal;
+        ok = ok && egal;
+        char passage_txt[32];
+        snprintf(passage_txt, sizeof(passage_txt), "%.1f/%.1f", p50, p99);
+        printf("%-16s %13.1f %20s %16.0f  %s\n", noms_methodes[m], libre, passage_txt, ops,
+               egal ? "ok" : "ECHEC");
+    }
+
+    printf("\n%-24s %14s  %s\n", "Aller-retour", "allers/s", "Verif");
+    for (int a = 0; a < NB_AR; a++) {
+        double par_seconde;
+        bool egal = aller_retour(p, (aller_retour_t)a, &par_seconde);
+        ok = ok && egal;
+        printf("%-24s %14.0f  %s\n", noms_ar[a], par_seconde, egal ? "ok" : "ECHEC");
+    }
+
+    printf("\n--- Mutex robuste ---\n");
+    ok = tester_robuste(p) && ok;
+
+    semctl(p->semid, 0, IPC_RMID);
+    pthread_mutex_destroy(&p->pmutex);
+    pthread_cond_destroy(&p->pcond);
+    munmap(p, sizeof(partage_t));
+
+    printf("\nVerification : %s\n", ok ? "compteurs exacts, tours alternes, reprise robuste conforme"
+                                     : "ECHEC");
+    return ok ? 0 : 1;
+}
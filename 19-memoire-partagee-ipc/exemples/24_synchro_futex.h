@@ -0,0 +1,306 @@
+/* ============================================================================
+   Section 19.4 : POSIX IPC vs System V IPC
+   Description : Primitives de synchronisation inter-processus construites
+                 directement sur futex(2), a placer en memoire partagee
+                 (header-only)
+                 - mutex : aucun appel systeme sans contention
+                 - mutex robuste : reprise apres la mort du detenteur
+                   (liste robuste du noyau, EOWNERDEAD / ENOTRECOVERABLE)
+                 - compteur d'evenements (eventcount)
+                 - variable de condition (reveil par FUTEX_CMP_REQUEUE)
+   Fichier source : 04-posix-vs-system-v.md
+   ============================================================================ */
+#ifndef SYNCHRO_FUTEX_H
+#define SYNCHRO_FUTEX_H
+
+/* syscall() exige _GNU_SOURCE avant tout include ; lier avec -pthread */
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define SYNCHRO_SPINS         100       /* essais avant de dormir */
+#define SYNCHRO_IRRECUPERABLE FUTEX_TID_MASK    /* aucun TID reel n'atteint cette valeur */
+
+/* Toutes les operations sont sans FUTEX_PRIVATE_FLAG : les mots vivent en
+   memoire partagee et le noyau les identifie par leur page physique */
+static inline long synchro_futex(atomic_uint *mot, int op, unsigned val,
+                                 const struct timespec *delai, atomic_uint *mot2, unsigned val3) {
+    return syscall(SYS_futex, (unsigned *)mot, op, val, delai, (unsigned *)mot2, val3);
+}
+
+static inline void synchro_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* --- Mutex a trois etats (Drepper) : 0 libre, 1 pris, 2 pris + dormeurs --- */
+
+typedef struct {
+    atomic_uint etat;
+} synchro_mutex_t;
+
+static inline void synchro_mutex_init(synchro_mutex_t *m) {
+    atomic_init(&m->etat, 0);
+}
+
+/* Chemin lent : annonce des dormeurs (2) puis attente. Egalement utilise
+   apres un reveil de condition, car d'autres attendent peut-etre encore */
+static inline void synchro_mutex_prendre_conteste(synchro_mutex_t *m) {
+    while (atomic_exchange_explicit(&m->etat, 2, memory_order_acquire) != 0) {
+        synchro_futex(&m->etat, FUTEX_WAIT, 2, NULL, NULL, 0);
+    }
+}
+
+static inline void synchro_mutex_prendre(synchro_mutex_t *m) {
+    unsigned c = 0;
+    if (atomic_compare_exchange_strong_explicit(&m->etat, &c, 1, memory_order_acquire,
+                                                memory_order_relaxed)) {
+        return;                         /* sans contention : aucun appel systeme */
+    }
+    for (int i = 0; i < SYNCHRO_SPINS && c != 2; i++) {
+        synchro_pause();
+        c = atomic_load_explicit(&m->etat, memory_order_relaxed);
+        if (c == 0 && atomic_compare_exchange_weak_explicit(&m->etat, &c, 1, memory_order_acquire,
+                                                            memory_order_relaxed)) {
+            return;
+        }
+    }
+    synchro_mutex_prendre_conteste(m);
+}
+
+static inline bool synchro_mutex_essayer(synchro_mutex_t *m) {
+    unsigned c = 0;
+    return atomic_compare_exchange_strong_explicit(&m->etat, &c, 1, memory_order_acquire,
+                                                   memory_order_relaxed);
+}
+
+static inline void synchro_mutex_rendre(synchro_mutex_t *m) {
+    if (atomic_exchange_explicit(&m->etat, 0, memory_order_release) == 2) {
+        synchro_futex(&m->etat, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+}
+
+/* --- Mutex robuste : protocole de la liste robuste du noyau ---
+   Le mot contient le TID du detenteur, FUTEX_WAITERS si quelqu'un dort,
+   FUTEX_OWNER_DIED pose par le noyau quand le detenteur meurt. Chaque
+   thread declare au noyau (set_robust_list) la liste des mutex qu'il
+   detient ; a sa mort, le noyau marque chacun et reveille un dormeur.
+   Attention : cet enregistrement remplace celui de la glibc pour le thread,
+   qui ne doit donc pas utiliser aussi PTHREAD_MUTEX_ROBUST */
+
+typedef struct {
+    atomic_uint mot;
+    uint32_t incoherent;                /* repris apres une mort, pas encore repare */
+    struct robust_list noeud;           /* chaine dans la liste du detenteur */
+} synchro_robuste_t;
+
+static _Thread_local struct robust_list_head synchro_tete;
+static _Thread_local bool synchro_tete_prete;
+static _Thread_local uint32_t synchro_tid_cache;
+
+static inline uint32_t synchro_tid(void) {
+    if (synchro_tid_cache == 0) synchro_tid_cache = (uint32_t)syscall(SYS_gettid);
+    return synchro_tid_cache;
+}
+
+/* Le fils d'un fork a un autre TID et le noyau a oublie sa liste robuste
+   (la glibc y reinstalle la sienne) : tout est a refaire */
+static inline void synchro_apres_fork(void) {
+    synchro_tete_prete = false;
+    synchro_tid_cache = 0;
+}
+
+/* Appele automatiquement au premier verrou robuste du thread */
+static inline int synchro_robuste_thread(void) {
+    static atomic_flag atfork = ATOMIC_FLAG_INIT;
+    if (!atomic_flag_test_and_set(&atfork)) pthread_atfork(NULL, NULL, synchro_apres_fork);
+    synchro_tete.list.next = &synchro_tete.list;
+    synchro_tete.futex_offset = (long)offsetof(synchro_robuste_t, mot) - (long)offsetof(synchro_robuste_t, noeud);
+    synchro_tete.list_op_pending = NULL;
+    synchro_tid_cache = 0;
+    if (syscall(SYS_set_robust_list, &synchro_tete, sizeof(synchro_tete)) == -1) return -1;
+    synchro_tete_prete = true;
+    return 0;
+}
+
+static inline void synchro_robuste_init(synchro_robuste_t *m) {
+    atomic_init(&m->mot, 0);
+    m->incoherent = 0;
+    m->noeud.next = NULL;
+}
+
+static inline void synchro_robuste_chainer(synchro_robuste_t *m) {
+    m->noeud.next = synchro_tete.list.next;
+    synchro_tete.list.next = &m->noeud;
+}
+
+/* Retour : 0 ; EOWNERDEAD si le detenteur precedent est mort (verrou pris,
+   donnees a verifier puis synchro_robuste_coherent) ; ENOTRECOVERABLE si un
+   repreneur a rendu le verrou sans le declarer coherent */
+static inline int synchro_robuste_prendre(synchro_robuste_t *m) {
+    if (!synchro_tete_prete && synchro_robuste_thread() == -1) return errno;
+    uint32_t tid = synchro_tid();
+    unsigned attente = 0;               /* FUTEX_WAITERS une fois qu'on a dormi */
+    synchro_tete.list_op_pending = &m->noeud;   /* couvre une mort entre CAS et chainage */
+    for (int essai = 0;; essai++) {
+        unsigned v = 0;
+        if (atomic_compare_exchange_strong_explicit(&m->mot, &v, tid | attente, memory_order_acquire,
+                                                    memory_order_relaxed)) {
+            synchro_robuste_chainer(m);
+            synchro_tete.list_op_pending = NULL;
+            return 0;
+        }
+        if (v == SYNCHRO_IRRECUPERABLE) {
+            synchro_tete.list_op_pending = NULL;
+            return ENOTRECOVERABLE;
+        }
+        if ((v & FUTEX_OWNER_DIED) && (v & FUTEX_TID_MASK) == 0) {
+            if (atomic_compare_exchange_strong_explicit(&m->mot, &v, tid | (v & FUTEX_WAITERS) | attente,
+                                                        memory_order_acquire, memory_order_relaxed)) {
+                m->incoherent = 1;
+                synchro_robuste_chainer(m);
+                synchro_tete.list_op_pending = NULL;
+                return EOWNERDEAD;
+            }
+            continue;
+        }
+        if (essai < SYNCHRO_SPINS) {
+            synchro_pause();
+            continue;
+        }
+        if (!(v & FUTEX_WAITERS)) {
+            if (!atomic_compare_exchange_strong_explicit(&m->mot, &v, v | FUTEX_WAITERS,
+                                                         memory_order_relaxed, memory_order_relaxed)) {
+                continue;
+            }
+            v |= FUTEX_WAITERS;
+        }
+        synchro_futex(&m->mot, FUTEX_WAIT, v, NULL, NULL, 0);
+        attente = FUTEX_WAITERS;
+    }
+}
+
+/* Apres EOWNERDEAD : l'etat protege a ete repare */
+static inline void synchro_robuste_coherent(synchro_robuste_t *m) {
+    m->incoherent = 0;
+}
+
+static inline void synchro_robuste_rendre(synchro_robuste_t *m) {
+    synchro_tete.list_op_pending = &m->noeud;
+    struct robust_list *p = &synchro_tete.list;
+    while (p->next != &m->noeud && p->next != &synchro_tete.list) p = p->next;
+    if (p->next == &m->noeud) p->next = m->noeud.next;
+
+    unsigned libre = m->incoherent ? SYNCHRO_IRRECUPERABLE : 0;
+    unsigned v = atomic_exchange_explicit(&m->mot, libre, memory_order_release);
+    if (libre) {
+        synchro_futex(&m->mot, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    } else if (v & FUTEX_WAITERS) {
+        synchro_futex(&m->mot, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+    synchro_tete.list_op_pending = NULL;
+}
+
+/* --- Compteur d'evenements : attendre qu'une valeur lue ait change --- */
+
+typedef struct {
+    atomic_uint sequence;
+    atomic_uint dormeurs;
+} synchro_compteur_t;
+
+static inline void synchro_compteur_init(synchro_compteur_t *c) {
+    atomic_init(&c->sequence, 0);
+    atomic_init(&c->dormeurs, 0);
+}
+
+static inline unsigned synchro_compteur_lire(synchro_compteur_t *c) {
+    return atomic_load_explicit(&c->sequence, memory_order_acquire);
+}
+
+/* Lire, tester la condition, puis attendre seulement si rien n'a change
+   depuis la lecture : aucun reveil perdu. delai NULL : attente infinie.
+   Retour : 0, ou ETIMEDOUT */
+static inline int synchro_compteur_attendre(synchro_compteur_t *c, unsigned vu, const struct timespec *delai) {
+    for (int i = 0; i < SYNCHRO_SPINS; i++) {
+        if (atomic_load_explicit(&c->sequence, memory_order_acquire) != vu) return 0;
+        synchro_pause();
+    }
+    atomic_fetch_add_explicit(&c->dormeurs, 1, memory_order_seq_cst);
+    int r = 0;
+    while (atomic_load_explicit(&c->sequence, memory_order_seq_cst) == vu) {
+        if (synchro_futex(&c->sequence, FUTEX_WAIT, vu, delai, NULL, 0) == -1 && errno == ETIMEDOUT) {
+            r = ETIMEDOUT;
+            break;
+        }
+    }
+    atomic_fetch_sub_explicit(&c->dormeurs, 1, memory_order_relaxed);
+    return r;
+}
+
+/* Avance le compteur et reveille tous les dormeurs (s'il y en a) */
+static inline void synchro_compteur_signaler(synchro_compteur_t *c) {
+    atomic_fetch_add_explicit(&c->sequence, 1, memory_order_seq_cst);
+    if (atomic_load_explicit(&c->dormeurs, memory_order_seq_cst) > 0) {
+        synchro_futex(&c->sequence, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+    }
+}
+
+/* --- Variable de condition associee a un synchro_mutex_t --- */
+
+typedef struct {
+    atomic_uint sequence;
+    atomic_uint dormeurs;
+} synchro_cond_t;
+
+static inline void synchro_cond_init(synchro_cond_t *c) {
+    atomic_init(&c->sequence, 0);
+    atomic_init(&c->dormeurs, 0);
+}
+
+/* A appeler mutex pris, dans une boucle qui reteste le predicat.
+   delai : relatif, NULL pour infini. Retour : 0, ou ETIMEDOUT (mutex repris) */
+static inline int synchro_cond_attendre(synchro_cond_t *c, synchro_mutex_t *m, const struct timespec *delai) {
+    unsigned seq = atomic_load_explicit(&c->sequence, memory_order_relaxed);
+    atomic_fetch_add_explicit(&c->dormeurs, 1, memory_order_relaxed);
+    synchro_mutex_rendre(m);
+    int r = 0;
+    if (synchro_futex(&c->sequence, FUTEX_WAIT, seq, delai, NULL, 0) == -1 && errno == ETIMEDOUT) {
+        r = ETIMEDOUT;
+    }
+    atomic_fetch_sub_explicit(&c->dormeurs, 1, memory_order_relaxed);
+    /* Peut-etre transfere sur le mutex par un diffuser : reprendre en "2" */
+    synchro_mutex_prendre_conteste(m);
+    return r;
+}
+
+static inline void synchro_cond_signaler(synchro_cond_t *c) {
+    atomic_fetch_add_explicit(&c->sequence, 1, memory_order_relaxed);
+    if (atomic_load_explicit(&c->dormeurs, memory_order_relaxed) > 0) {
+        synchro_futex(&c->sequence, FUTEX_WAKE, 1, NULL, NULL, 0);
+    }
+}
+
+/* Mutex pris. Reveille un dormeur et deplace les autres dans la file du
+   mutex : ils seront reveilles un par un a chaque rendre, sans troupeau */
+static inline void synchro_cond_diffuser(synchro_cond_t *c, synchro_mutex_t *m) {
+    unsigned seq = atomic_fetch_add_explicit(&c->sequence, 1, memory_order_relaxed) + 1;
+    if (atomic_load_explicit(&c->dormeurs, memory_order_relaxed) == 0) return;
+    /* Des dormeurs vont rejoindre le mutex : rendre devra reveiller */
+    atomic_store_explicit(&m->etat, 2, memory_order_relaxed);
+    while (synchro_futex(&c->sequence, FUTEX_CMP_REQUEUE, 1, (const struct timespec *)(uintptr_t)INT_MAX,
+                         &m->etat, seq) == -1 && errno == EAGAIN) {
+        seq = atomic_load_explicit(&c->sequence, memory_order_relaxed);
+    }
+}
+
+#endif /* SYNCHRO_FUTEX_H */
@@ -4,6 +4,10 @@
    Fichier source : 08-serveur-concurrent.md
    ============================================================================ */
 
+#ifdef MESURE_LATENCE
+#define _POSIX_C_SOURCE 200112L
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,6 +16,20 @@
 #include <sys/socket.h>
 #include <sys/epoll.h>
 
+#ifdef MESURE_LATENCE
+/* Compiler avec -DMESURE_LATENCE -I../../27-optimisation-performance/exemples/21_hdr_histogram */
+#include <time.h>
+#include "hdr_histogram.h"
+
+#define RAPPORT_TOUTES_LES 10000
+
+static int64_t maintenant_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+#endif
+
 #define PORT 8080
 #define MAX_EVENTS 100
 #define BUFFER_SIZE 1024
@@ -65,6 +83,16 @@ int main(void) {
 
     char buffer[BUFFER_SIZE];
 
+#ifdef MESURE_LATENCE
+    /* Temps de service recv -> send, 1 ns a 10 s, 3 chiffres significatifs */
+    hdr_histogram_t latence;
+    if (hdr_init(&latence, 1, 10000000000LL, 3) != 0) {
+        fprintf(stderr, "Erreur allocation histogramme\n");
+        exit(EXIT_FAILURE);
+    }
+    long requetes = 0;
+#endif
+
     /* Boucle evenementielle */
     while (1) {
         int n_events = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
@@ -103,6 +131,9 @@ int main(void) {
                 }
             } else {
                 /* Donnees d'un client */
+#ifdef MESURE_LATENCE
+                int64_t debut = maintenant_ns();
+#endif
                 ssize_t bytes_read = recv(fd, buffer, BUFFER_SIZE - 1, 0);
 
                 if (bytes_read <= 0) {
@@ -118,8 +149,18 @@ int main(void) {
                 } else {
                     /* Echo */
                     buffer[bytes_read] = '\0';
+#ifdef MESURE_LATENCE
+                    send(fd, buffer, (size_t)bytes_read, 0);
+                    hdr_enregistrer(&latence, maintenant_ns() - debut);
+                    if (++requetes % RAPPORT_TOUTES_LES == 0) {
+                        hdr_afficher(&latence, stdout, "Service :", "us", 1000.0);
+                        fflush(stdout);
+                        hdr_reinitialiser(&latence);
+                    }
+#else
                     printf("Socket %d : %s", fd, buffer);
                     send(fd, buffer, (size_t)bytes_read, 0);
+#endif
                 }
             }
         }
@@ -0,0 +1,168 @@
+/* ============================================================================
+   Section 20.8 : Serveur concurrent (mesure de charge)
+   Description : Generateur de charge echo TCP - N connexions en boucle
+                 fermee, chaque thread enregistre le temps aller-retour dans
+                 son histogramme HDR (wait-free). Affiche p50/p99/p99.9 par
+                 seconde puis le cumul. Fonctionne avec les serveurs echo
+                 01, 12, 13, 14, 15 et 16
+   Fichier source : 08-serveur-concurrent.md
+   ============================================================================ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "hdr_histogram.h"
+
+#define PORT 8080
+#define MAX_CONNEXIONS 256
+#define TAILLE_MESSAGE 64
+#define DUREE_DEFAUT 5
+
+typedef struct {
+    int id;
+    const char *ip;
+    int port;
+    long requetes;
+    long erreurs;
+} contexte_t;
+
+static hdr_enregistreur_t enregistreur;
+static atomic_bool arret;
+
+static int64_t maintenant_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int connecter(const char *ip, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    if (inet_pton(AF_INET, ip, &addr.sin_addr) != 1
+        || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    /* Petits messages : pas d'attente de Nagle */
+    int un = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &un, sizeof(un));
+    return fd;
+}
+
+static void *client(void *arg) {
+    contexte_t *ctx = arg;
+    hdr_histogram_t *h = hdr_enregistreur_thread(&enregistreur, ctx->id);
+    char message[TAILLE_MESSAGE];
+    char reponse[TAILLE_MESSAGE];
+
+    int fd = connecter(ctx->ip, ctx->port);
+    if (fd < 0) {
+        ctx->erreurs++;
+        return NULL;
+    }
+
+    memset(message, 'a' + ctx->id % 26, sizeof(message));
+    message[sizeof(message) - 1] = '\n';
+
+    while (!atomic_load_explicit(&arret, memory_order_relaxed)) {
+        int64_t debut = maintenant_ns();
+
+        if (send(fd, message, sizeof(message), MSG_NOSIGNAL) != (ssize_t)sizeof(message)) {
+            ctx->erreurs++;
+            break;
+        }
+        /* L'echo peut arriver en plusieurs segments */
+        size_t recu = 0;
+        while (recu < sizeof(reponse)) {
+            ssize_t n = recv(fd, reponse + recu, sizeof(reponse) - recu, 0);
+            if (n <= 0) break;
+            recu += (size_t)n;
+        }
+        if (recu < sizeof(reponse)) {
+            ctx->erreurs++;
+            break;
+        }
+
+        hdr_enregistrer(h, maintenant_ns() - debut);
+        ctx->requetes++;
+    }
+
+    close(fd);
+    return NULL;
+}
+
+int main(int argc, char *argv[]) {
+    const char *ip = argc > 1 ? argv[1] : "127.0.0.1";
+    int port = argc > 2 ? atoi(argv[2]) : PORT;
+    int nb = argc > 3 ? atoi(argv[3]) : 4;
+    int duree = argc > 4 ? atoi(argv[4]) : DUREE_DEFAUT;
+    if (nb < 1) nb = 1;
+    if (nb > MAX_CONNEXIONS) nb = MAX_CONNEXIONS;
+    if (duree < 1) duree = 1;
+
+    /* 1 ns a 10 s, 3 chiffres significatifs */
+    hdr_histogram_t intervalle, cumul;
+    if (hdr_enregistreur_init(&enregistreur, nb, 1, 10000000000LL, 3) != 0
+        || hdr_init(&intervalle, 1, 10000000000LL, 3) != 0
+        || hdr_init(&cumul, 1, 10000000000LL, 3) != 0) {
+        fprintf(stderr, "Erreur allocation\n");
+        return 1;
+    }
+
+    printf("Charge echo sur %s:%d : %d connexions, %d s, messages de %d octets\n",
+           ip, port, nb, duree, TAILLE_MESSAGE);
+
+    static contexte_t ctx[MAX_CONNEXIONS];
+    pthread_t threads[MAX_CONNEXIONS];
+    for (int i = 0; i < nb; i++) {
+        ctx[i] = (contexte_t){ .id = i, .ip = ip, .port = port };
+        pthread_create(&threads[i], NULL, client, &ctx[i]);
+    }
+
+    for (int s = 1; s <= duree; s++) {
+        sleep(1);
+        char libelle[32];
+        snprintf(libelle, sizeof(libelle), "[%3d s] RTT", s);
+        hdr_enregistreur_intervalle(&enregistreur, &intervalle);
+        hdr_afficher(&intervalle, stdout, libelle, "us", 1000.0);
+    }
+
+    atomic_store(&arret, true);
+    long requetes = 0, erreurs = 0;
+    for (int i = 0; i < nb; i++) {
+        pthread_join(threads[i], NULL);
+        requetes += ctx[i].requetes;
+        erreurs += ctx[i].erreurs;
+    }
+
+    hdr_enregistreur_cumul(&enregistreur, &cumul);
+    printf("\n=== Cumul ===\n");
+    printf("Requetes : %ld (%.0f req/s), erreurs : %ld\n",
+           requetes, (double)requetes / duree, erreurs);
+    printf("p50   : %8.1f us\n", (double)hdr_percentile(&cumul, 50.0) / 1000.0);
+    printf("p99   : %8.1f us\n", (double)hdr_percentile(&cumul, 99.0) / 1000.0);
+    printf("p99.9 : %8.1f us\n", (double)hdr_percentile(&cumul, 99.9) / 1000.0);
+    printf("max   : %8.1f us\n", (double)hdr_max(&cumul) / 1000.0);
+
+    hdr_liberer(&intervalle);
+    hdr_liberer(&cumul);
+    hdr_enregistreur_liberer(&enregistreur);
+    return erreurs == 0 ? 0 : 1;
+}
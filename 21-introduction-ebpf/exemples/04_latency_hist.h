@@ -0,0 +1,90 @@
+/* ============================================================================
+   Section 21.2.2 : BPF Maps - Monitoring de latence
+   Description : Histogramme log2 partage entre 04_latency_monitor.bpf.c et
+                 l'espace utilisateur (19_latence_histogramme)
+                 - log2 sans boucle ni __builtin_clz (absent de la cible BPF)
+                 - mise a jour d'un histogramme par CPU, sans atomique
+                 - meme code compile pour le noyau et pour le banc de test
+   Fichier source : 02.2-bpf-maps.md
+   ============================================================================ */
+#ifndef LATENCY_HIST_H
+#define LATENCY_HIST_H
+
+#include <linux/types.h>
+
+#ifndef __always_inline
+#define __always_inline inline __attribute__((always_inline))
+#endif
+
+#define LATENCE_SYSCALLS  512
+#define LATENCE_SLOTS     40        // case 39 : >= 2^39 ns (~9 min)
+#define LATENCE_SEUIL_DEFAUT 1000000ULL   // 1 ms, si config_map n'est pas ecrite
+
+// Case s : [2^s, 2^(s+1)) ns, la case 0 contient aussi 0
+struct latence_hist {
+    __u64 slots[LATENCE_SLOTS];
+    __u64 count;
+    __u64 total_ns;
+    __u64 max_ns;
+};
+
+// Configuration ecrite par le loader apres chargement, avant attachement
+struct latence_config {
+    __u64 seuil_ns;     // evenement ringbuf si duree > seuil (0 : defaut)
+    __u32 compat;       // 1 : ancien mode stats_map (count/total/min/max)
+    __u32 reserve;
+};
+
+static __always_inline __u32 latence_log2_32(__u32 v)
+{
+    __u32 r, decalage;
+
+    r = (v > 0xFFFF) << 4;
+    v >>= r;
+    decalage = (v > 0xFF) << 3;
+    v >>= decalage;
+    r |= decalage;
+    decalage = (v > 0xF) << 2;
+    v >>= decalage;
+    r |= decalage;
+    decalage = (v > 0x3) << 1;
+    v >>= decalage;
+    r |= decalage;
+    r |= (v >> 1);
+    return r;
+}
+
+static __always_inline __u32 latence_slot(__u64 duree_ns)
+{
+    __u32 haut = duree_ns >> 32;
+    __u32 slot = haut ? latence_log2_32(haut) + 32 : latence_log2_32((__u32)duree_ns);
+
+    if (slot >= LATENCE_SLOTS)
+        slot = LATENCE_SLOTS - 1;
+    return slot;
+}
+
+// L'histogramme est la valeur d'une map PERCPU : aucun autre CPU n'y ecrit
+static __always_inline void latence_hist_ajouter(struct latence_hist *h, __u64 duree_ns)
+{
+    __u32 slot = latence_slot(duree_ns);
+
+    if (slot < LATENCE_SLOTS)   // borne explicite pour le verifieur
+        h->slots[slot]++;
+    h->count++;
+    h->total_ns += duree_ns;
+    if (duree_ns > h->max_ns)
+        h->max_ns = duree_ns;
+}
+
+static __always_inline __u64 latence_seuil(const struct latence_config *c)
+{
+    return c && c->seuil_ns ? c->seuil_ns : LATENCE_SEUIL_DEFAUT;
+}
+
+static __always_inline int latence_aberrante(__u64 duree_ns, __u64 seuil_ns)
+{
+    return duree_ns > seuil_ns;
+}
+
+#endif /* LATENCY_HIST_H */
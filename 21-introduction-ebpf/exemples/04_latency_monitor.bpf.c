@@ -1,10 +1,14 @@
 /* ============================================================================
    Section 21.2.2 : BPF Maps - Monitoring de latence
    Description : Combine HASH + ARRAY + RINGBUF pour monitorer la latence syscall
+                 - mode histogramme (defaut) : log2 par CPU (PERCPU_ARRAY),
+                   ringbuf reserve aux valeurs aberrantes (> seuil)
+                 - mode compat : count/total/min/max partages (stats_map)
    Fichier source : 02.2-bpf-maps.md
    ============================================================================ */
 #include <linux/bpf.h>
 #include <bpf/bpf_helpers.h>
+#include "04_latency_hist.h"
 
 // Definitions locales des structures tracepoint (non disponibles via linux/bpf.h)
 struct trace_event_raw_sys_enter {
@@ -54,6 +58,31 @@ struct {
     __uint(max_entries, 256 * 1024);
 } events SEC(".maps");
 
+// Map 4 : Histogrammes log2 par syscall, un exemplaire par CPU (PERCPU_ARRAY)
+// -> increments sans atomique ni rebond de ligne de cache entre CPU
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, LATENCE_SYSCALLS);
+    __type(key, __u32);
+    __type(value, struct latence_hist);
+} hist_map SEC(".maps");
+
+// Map 5 : Configuration (seuil des valeurs aberrantes, mode)
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct latence_config);
+} config_map SEC(".maps");
+
+// Map 6 : Evenements perdus (ringbuf plein)
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, __u64);
+} pertes SEC(".maps");
+
 // Structure d'evenement pour le ring buffer
 struct event {
     __u32 pid;
@@ -92,23 +121,33 @@ int trace_exit(struct trace_event_raw_sys_exit *ctx)
     // Calculer la duree
     __u64 duration_ns = bpf_ktime_get_ns() - info->start_ts;
 
-    // Mettre a jour les statistiques
-    if (syscall_id < 512) {
-        struct latency_stats *stats = bpf_map_lookup_elem(&stats_map, &syscall_id);
-        if (stats) {
-            __sync_fetch_and_add(&stats->count, 1);
-            __sync_fetch_and_add(&stats->total_ns, duration_ns);
-
-            // Min/Max (attention : race possible, mais acceptable)
-            if (duration_ns < stats->min_ns || stats->min_ns == 0)
-                stats->min_ns = duration_ns;
-            if (duration_ns > stats->max_ns)
-                stats->max_ns = duration_ns;
+    __u32 zero = 0;
+    struct latence_config *config = bpf_map_lookup_elem(&config_map, &zero);
+
+    if (syscall_id < LATENCE_SYSCALLS) {
+        if (!config || !config->compat) {
+            // Histogramme : une case log2 par CPU
+            struct latence_hist *h = bpf_map_lookup_elem(&hist_map, &syscall_id);
+            if (h)
+                latence_hist_ajouter(h, duration_ns);
+        } else {
+            // Mettre a jour les statistiques
+            struct latency_stats *stats = bpf_map_lookup_elem(&stats_map, &syscall_id);
+            if (stats) {
+                __sync_fetch_and_add(&stats->count, 1);
+                __sync_fetch_and_add(&stats->total_ns, duration_ns);
+
+                // Min/Max (attention : race possible, mais acceptable)
+                if (duration_ns < stats->min_ns || stats->min_ns == 0)
+                    stats->min_ns = duration_ns;
+                if (duration_ns > stats->max_ns)
+                    stats->max_ns = duration_ns;
+            }
         }
     }
 
-    // Envoyer un evenement si latence > 1ms
-    if (duration_ns > 1000000) {  // 1ms
+    // Envoyer un evenement seulement si latence > seuil (1 ms par defaut)
+    if (latence_aberrante(duration_ns, latence_seuil(config))) {
         struct event *e = bpf_ringbuf_reserve(&events, sizeof(*e), 0);
         if (e) {
             e->pid = pid;
@@ -116,6 +155,10 @@ int trace_exit(struct trace_event_raw_sys_exit *ctx)
             e->duration_ns = duration_ns;
             bpf_get_current_comm(&e->comm, sizeof(e->comm));
             bpf_ringbuf_submit(e, 0);
+        } else {
+            __u64 *n = bpf_map_lookup_elem(&pertes, &zero);
+            if (n)
+                (*n)++;
         }
     }
 
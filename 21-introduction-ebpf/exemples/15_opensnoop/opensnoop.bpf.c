@@ -23,6 +23,14 @@ struct {
     __uint(max_entries, 256 * 1024);
 } events SEC(".maps");
 
+// Reservations refusees (anneau plein), lues par le moteur 18_moteur_ringbuf
+struct {
+    __uint(type, BPF_MAP_TYPE_PERCPU_ARRAY);
+    __type(key, u32);
+    __type(value, u64);
+    __uint(max_entries, 1);
+} pertes SEC(".maps");
+
 // Map temporaire pour stocker les arguments
 struct {
     __uint(type, BPF_MAP_TYPE_HASH);
@@ -58,8 +66,13 @@ int trace_exit_openat(struct trace_event_raw_sys_exit *ctx) {
 
     // Reserver de l'espace dans le ringbuffer
     struct event *e = bpf_ringbuf_reserve(&events, sizeof(*e), 0);
-    if (!e)
+    if (!e) {
+        u32 zero = 0;
+        u64 *n = bpf_map_lookup_elem(&pertes, &zero);
+        if (n)
+            (*n)++;
         goto cleanup;
+    }
 
     // Remplir l'evenement
     e->pid = pid;
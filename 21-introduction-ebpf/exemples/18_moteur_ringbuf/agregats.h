@@ -0,0 +1,234 @@
+/* ============================================================================
+   Section 21.4.1 : libbpf - Consommation d'un ringbuffer BPF
+   Description : Agregation et sortie en espace utilisateur pour le moteur
+                 - table de hachage a adressage ouvert (cle chaine bornee),
+                   agrandie par rehachage, classement des N premiers
+                 - sortie par lots : lignes formatees a la main dans un
+                   tampon, un seul write() par lot au lieu d'un par evenement
+   Fichier source : 04.1-libbpf.md
+   ============================================================================ */
+#ifndef AGREGATS_H
+#define AGREGATS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+
+/* ---------------------------------------------------------------------------
+   Table de comptage
+   --------------------------------------------------------------------------- */
+
+#define AGR_CLE_MAX 256         /* comme event.filename cote BPF */
+
+typedef struct {
+    uint64_t empreinte;         /* 0 : case libre */
+    uint64_t compte;
+    uint64_t erreurs;           /* evenements avec ret < 0 */
+    uint16_t longueur;
+    char cle[AGR_CLE_MAX];
+} agr_entree_t;
+
+typedef struct {
+    agr_entree_t *cases;
+    size_t capacite;            /* puissance de 2 */
+    size_t occupees;
+    uint64_t total;
+} agr_table_t;
+
+static inline uint64_t agr_empreinte(const char *cle, size_t n) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < n; i++) h = (h ^ (uint8_t)cle[i]) * 0x100000001b3ULL;
+    h ^= h >> 29;
+    return h | 1;
+}
+
+static inline int agr_init(agr_table_t *t, size_t capacite) {
+    size_t c = 64;
+    while (c < capacite) c <<= 1;
+    t->cases = calloc(c, sizeof(agr_entree_t));
+    if (!t->cases) return -1;
+    t->capacite = c;
+    t->occupees = 0;
+    t->total = 0;
+    return 0;
+}
+
+static inline void agr_liberer(agr_table_t *t) {
+    free(t->cases);
+    t->cases = NULL;
+    t->capacite = t->occupees = 0;
+}
+
+static inline void agr_vider(agr_table_t *t) {
+    memset(t->cases, 0, t->capacite * sizeof(agr_entree_t));
+    t->occupees = 0;
+    t->total = 0;
+}
+
+static inline agr_entree_t *agr_sonder(agr_entree_t *cases, size_t capacite, uint64_t h,
+                                       const char *cle, size_t n) {
+    size_t i = (size_t)h & (capacite - 1);
+    for (;;) {
+        agr_entree_t *e = &cases[i];
+        if (e->empreinte == 0) return e;
+        if (e->empreinte == h && e->longueur == n && memcmp(e->cle, cle, n) == 0) return e;
+        i = (i + 1) & (capacite - 1);
+    }
+}
+
+static inline int agr_agrandir(agr_table_t *t) {
+    size_t c = t->capacite * 2;
+    agr_entree_t *cases = calloc(c, sizeof(agr_entree_t));
+    if (!cases) return -1;
+    for (size_t i = 0; i < t->capacite; i++) {
+        agr_entree_t *e = &t->cases[i];
+        if (e->empreinte) *agr_sonder(cases, c, e->empreinte, e->cle, e->longueur) = *e;
+    }
+    free(t->cases);
+    t->cases = cases;
+    t->capacite = c;
+    return 0;
+}
+
+/* cle : chaine terminee par NUL d'au plus max octets (champ BPF) */
+static inline agr_entree_t *agr_compter(agr_table_t *t, const char *cle, size_t max, int erreur) {
+    size_t n = strnlen(cle, max < AGR_CLE_MAX ? max : AGR_CLE_MAX - 1);
+    uint64_t h = agr_empreinte(cle, n);
+    agr_entree_t *e = agr_sonder(t->cases, t->capacite, h, cle, n);
+    if (e->empreinte == 0) {
+        if ((t->occupees + 1) * 4 > t->capacite * 3) {
+            if (agr_agrandir(t) == -1) return NULL;
+            e = agr_sonder(t->cases, t->capacite, h, cle, n);
+        }
+        e->empreinte = h;
+        e->longueur = (uint16_t)n;
+        memcpy(e->cle, cle, n);
+        e->cle[n] = '\0';
+        t->occupees++;
+    }
+    e->compte++;
+    e->erreurs += erreur != 0;
+    t->total++;
+    return e;
+}
+
+static inline const agr_entree_t *agr_chercher(const agr_table_t *t, const char *cle) {
+    size_t n = strnlen(cle, AGR_CLE_MAX - 1);
+    const agr_entree_t *e = agr_sonder(t->cases, t->capacite, agr_empreinte(cle, n), cle, n);
+    return e->empreinte ? e : NULL;
+}
+
+/* Les n plus grands comptes, par ordre decroissant (insertion : n est petit) */
+static inline size_t agr_premiers(const agr_table_t *t, const agr_entree_t **sortie, size_t n) {
+    size_t k = 0;
+    for (size_t i = 0; i < t->capacite; i++) {
+        const agr_entree_t *e = &t->cases[i];
+        if (!e->empreinte) continue;
+        if (k == n && e->compte <= sortie[k - 1]->compte) continue;
+        size_t j = k < n ? k++ : n - 1;
+        while (j > 0 && sortie[j - 1]->compte < e->compte) {
+            sortie[j] = sortie[j - 1];
+            j--;
+        }
+        sortie[j] = e;
+    }
+    return k;
+}
+
+/* ---------------------------------------------------------------------------
+   Sortie par lots
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    int fd;
+    char *tampon;
+    size_t taille;
+    size_t utilise;
+    uint64_t ecritures;         /* appels write() effectifs */
+    int erreur;                 /* errno du premier write() en echec, 0 sinon */
+} sortie_t;
+
+static inline int sortie_init(sortie_t *s, int fd, size_t taille) {
+    s->tampon = malloc(taille);
+    if (!s->tampon) return -1;
+    s->fd = fd;
+    s->taille = taille;
+    s->utilise = 0;
+    s->ecritures = 0;
+    s->erreur = 0;
+    return 0;
+}
+
+/* En cas d'echec, les octets non ecrits sont ramenes en tete du tampon
+   et l'erreur est memorisee : l'appelant consulte s->erreur et s'arrete */
+static inline int sortie_vider(sortie_t *s) {
+    size_t fait = 0;
+    while (fait < s->utilise) {
+        ssize_t r = write(s->fd, s->tampon + fait, s->utilise - fait);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            if (!s->erreur) s->erreur = r < 0 ? errno : EIO;
+            memmove(s->tampon, s->tampon + fait, s->utilise - fait);
+            s->utilise -= fait;
+            return -1;
+        }
+        fait += (size_t)r;
+        s->ecritures++;
+    }
+    s->utilise = 0;
+    return 0;
+}
+
+static inline void sortie_liberer(sortie_t *s) {
+    sortie_vider(s);
+    free(s->tampon);
+    s->tampon = NULL;
+}
+
+/* Reserve place pour une ligne d'au plus n octets (n <= taille), vide le
+   tampon si besoin. Si l'ecriture echoue, le contenu en attente est
+   abandonne pour garder la place : la sortie est deja en erreur */
+static inline char *sortie_reserver(sortie_t *s, size_t n) {
+    if (s->utilise + n > s->taille && sortie_vider(s) == -1) s->utilise = 0;
+    return s->tampon + s->utilise;
+}
+
+/* Entier signe cadre a gauche sur largeur colonnes, suivi d'un espace */
+static inline char *sortie_entier(char *p, long long v, int largeur) {
+    char chiffres[24];
+    int n = 0;
+    unsigned long long u = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    do {
+        chiffres[n++] = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    int ecrit = 0;
+    if (v < 0) {
+        *p++ = '-';
+        ecrit++;
+    }
+    while (n) {
+        *p++ = chiffres[--n];
+        ecrit++;
+    }
+    while (ecrit++ < largeur) *p++ = ' ';
+    *p++ = ' ';
+    return p;
+}
+
+static inline char *sortie_texte(char *p, const char *texte, size_t max, int largeur) {
+    size_t n = strnlen(texte, max);
+    memcpy(p, texte, n);
+    p += n;
+    while ((int)n++ < largeur) *p++ = ' ';
+    return p;
+}
+
+static inline void sortie_valider(sortie_t *s, const char *fin) {
+    s->utilise = (size_t)(fin - s->tampon);
+}
+
+#endif /* AGREGATS_H */
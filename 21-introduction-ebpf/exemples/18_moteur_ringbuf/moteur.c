@@ -0,0 +1,709 @@
+/* ============================================================================
+   Section 21.4.1 : libbpf - Moteur de consommation pour opensnoop
+   Description : Remplace le printf par evenement de 15_opensnoop par le
+                 moteur moteur_ringbuf.h + agregats.h
+                 - attente epoll ou active, agregation par COMM et par
+                   fichier, cliches periodiques, sortie par lots
+                 - compteurs de pertes (map "pertes" de opensnoop.bpf.c)
+                   et de retard (octets en attente dans l'anneau)
+                 - rejeu de captures enregistrees dans un anneau simule
+                   de meme disposition : mesurable sans privileges
+                 - banc d'essai : printf par evenement contre le moteur
+   Fichier source : 04.1-libbpf.md
+   ============================================================================ */
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include "moteur_ringbuf.h"
+#include "agregats.h"
+#ifdef AVEC_LIBBPF
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+#endif
+
+// Structure identique au code kernel (15_opensnoop/opensnoop.bpf.c)
+struct event {
+    unsigned int pid;
+    unsigned int uid;
+    int ret;
+    char comm[16];
+    char filename[256];
+};
+
+/* ---------------------------------------------------------------------------
+   Captures : "RBCAPT01" puis { u32 taille ; u32 reserve ; u64 ns ; donnees
+   arrondies a 8 } pour chaque echantillon tel que lu dans l'anneau
+   --------------------------------------------------------------------------- */
+
+#define MAGIE_CAPTURE "RBCAPT01"
+
+typedef struct {
+    uint32_t taille;
+    uint32_t reserve;
+    uint64_t ns;
+} capture_entete_t;
+
+typedef struct {
+    uint8_t *octets;
+    size_t longueur;
+    size_t nombre;
+    const capture_entete_t **index;
+} capture_t;
+
+typedef struct {
+    FILE *f;
+    uint64_t debut;
+} enregistreur_t;
+
+static uint64_t ns_maintenant(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Taille d'un echantillon, arrondie en size_t ; 0 si elle depasse un
+   evenement (capture forgee : l'arrondi 32 bits deborderait) */
+static size_t capture_pas(const capture_entete_t *e) {
+    if (e->taille > sizeof(struct event)) return 0;
+    return sizeof(*e) + (((size_t)e->taille + 7) & ~(size_t)7);
+}
+
+static int capture_indexer(capture_t *c) {
+    size_t n = 0, p = 8;
+    while (c->longueur - p >= sizeof(capture_entete_t)) {
+        size_t pas = capture_pas((const capture_entete_t *)(c->octets + p));
+        if (pas == 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        if (pas > c->longueur - p) break;       /* dernier echantillon tronque */
+        p += pas;
+        n++;
+    }
+    c->index = malloc((n ? n : 1) * sizeof(*c->index));
+    if (!c->index) return -1;
+    c->nombre = 0;
+    p = 8;
+    while (c->nombre < n) {
+        const capture_entete_t *e = (const capture_entete_t *)(c->octets + p);
+        c->index[c->nombre++] = e;
+        p += capture_pas(e);
+    }
+    return 0;
+}
+
+static int capture_lire(capture_t *c, const char *chemin) {
+    memset(c, 0, sizeof(*c));
+    FILE *f = fopen(chemin, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    rewind(f);
+    c->octets = malloc(n > 8 ? (size_t)n : 8);
+    if (!c->octets || fread(c->octets, 1, (size_t)n, f) != (size_t)n || n < 8
+        || memcmp(c->octets, MAGIE_CAPTURE, 8) != 0) {
+        fclose(f);
+        free(c->octets);
+        errno = EINVAL;
+        return -1;
+    }
+    fclose(f);
+    c->longueur = (size_t)n;
+    if (capture_indexer(c) == -1) {
+        int err = errno;
+        free(c->octets);
+        c->octets = NULL;
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+static void capture_liberer(capture_t *c) {
+    free(c->octets);
+    free(c->index);
+    memset(c, 0, sizeof(*c));
+}
+
+static void enregistrer(enregistreur_t *r, const void *d, uint32_t taille) {
+    static const uint8_t zeros[8];
+    uint64_t t = ns_maintenant();
+    if (!r->debut) r->debut = t;
+    capture_entete_t e = { taille, 0, t - r->debut };
+    fwrite(&e, sizeof(e), 1, r->f);
+    fwrite(d, 1, taille, r->f);
+    fwrite(zeros, 1, ((taille + 7u) & ~7u) - taille, r->f);
+}
+
+/* Charge synthetique : rafales de 512 ouvertures espacees de 100 ns,
+   debit moyen ~ debit ev/s ; ~200 COMM et ~4000 chemins, repartition
+   biaisee vers quelques processus bavards ; 10 % d'ENOENT */
+static int capture_generer(capture_t *c, size_t n, double debit) {
+    memset(c, 0, sizeof(*c));
+    size_t pas = sizeof(capture_entete_t) + ((sizeof(struct event) + 7u) & ~7u);
+    c->longueur = 8 + n * pas;
+    c->octets = calloc(1, c->longueur);
+    if (!c->octets) return -1;
+    memcpy(c->octets, MAGIE_CAPTURE, 8);
+    uint64_t etat = 0x9E3779B97F4A7C15ULL, ns = 0;
+    const uint64_t rafale = 512, periode = (uint64_t)(1e9 * (double)rafale / debit);
+    for (size_t i = 0; i < n; i++) {
+        capture_entete_t *e = (capture_entete_t *)(c->octets + 8 + i * pas);
+        struct event *ev = (struct event *)(e + 1);
+        etat ^= etat << 13;
+        etat ^= etat >> 7;
+        etat ^= etat << 17;
+        unsigned proc = (unsigned)((etat & 0xFFFF) * (etat & 0xFFFF) >> 24) % 200;
+        unsigned fichier = (unsigned)(etat >> 20) % 4000;
+        e->taille = sizeof(struct event);
+        e->ns = ns;
+        ns += (i + 1) % rafale ? 100 : periode - (rafale - 1) * 100;
+        ev->pid = 1000 + proc;
+        ev->uid = proc % 7 ? 1000 : 0;
+        ev->ret = (etat >> 40) % 10 == 0 ? -2 : (int)(3 + (etat >> 48) % 60);
+        snprintf(ev->comm, sizeof(ev->comm), "proc%03u", proc);
+        snprintf(ev->filename, sizeof(ev->filename), "/usr/lib/x86_64-linux-gnu/mod%02u/lib%04u.so.%u",
+                 fichier % 37, fichier, fichier % 5);
+    }
+    return capture_indexer(c);
+}
+
+static int capture_ecrire(const capture_t *c, const char *chemin) {
+    FILE *f = fopen(chemin, "wb");
+    if (!f) return -1;
+    size_t ok = fwrite(c->octets, 1, c->longueur, f);
+    return fclose(f) == 0 && ok == c->longueur ? 0 : -1;
+}
+
+/* ---------------------------------------------------------------------------
+   Rejeu : un thread producteur alimente l'anneau simule au rythme de la
+   capture (vitesse 0 : au plus vite), il ne dort que s'il a plus de 50 us
+   d'avance, comme un noyau qui produit sur d'autres coeurs
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    anneau_t *anneau;
+    const capture_t *capture;
+    double vitesse;
+    volatile sig_atomic_t *arret;
+    uint64_t produits;
+} rejeu_t;
+
+static void *producteur(void *arg) {
+    rejeu_t *r = arg;
+    uint64_t debut = ns_maintenant();
+    for (size_t i = 0; i < r->capture->nombre && !*r->arret; i++) {
+        const capture_entete_t *e = r->capture->index[i];
+        if (r->vitesse > 0) {
+            uint64_t cible = debut + (uint64_t)((double)e->ns / r->vitesse);
+            uint64_t t = ns_maintenant();
+            if (cible > t + 50000) {
+                struct timespec d = { 0, (long)(cible - t) };
+                if (d.tv_nsec >= 1000000000L) {
+                    d.tv_sec = d.tv_nsec / 1000000000L;
+                    d.tv_nsec %= 1000000000L;
+                }
+                nanosleep(&d, NULL);
+            }
+        }
+        anneau_simule_produire(r->anneau, e + 1, e->taille);
+        r->produits++;
+    }
+    __atomic_store_n(r->arret, 1, __ATOMIC_SEQ_CST);
+    anneau_simule_signaler(r->anneau);
+    return NULL;
+}
+
+static uint64_t pertes_simulees(void *ctx) {
+    return ((anneau_t *)ctx)->pertes_simulees;
+}
+
+/* ---------------------------------------------------------------------------
+   Traitement des evenements
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    agr_table_t par_comm;
+    agr_table_t par_fichier;
+    sortie_t *sortie;           /* NULL : agregation seule */
+    FILE *flux;                 /* ancien chemin : printf par evenement */
+    enregistreur_t *enregistreur;
+    uint64_t malformes;
+} traitement_t;
+
+static int traiter_event(void *ctx, const void *donnees, uint32_t taille) {
+    traitement_t *t = ctx;
+    if (taille < sizeof(struct event)) {
+        t->malformes++;
+        return 0;
+    }
+    const struct event *e = donnees;
+    if (t->enregistreur) enregistrer(t->enregistreur, donnees, taille);
+    agr_compter(&t->par_comm, e->comm, sizeof(e->comm), e->ret < 0);
+    agr_compter(&t->par_fichier, e->filename, sizeof(e->filename), e->ret < 0);
+    if (t->sortie) {
+        char *p = sortie_reserver(t->sortie, 64 + sizeof(e->comm) + sizeof(e->filename));
+        p = sortie_entier(p, e->pid, 6);
+        p = sortie_entier(p, e->uid, 6);
+        p = sortie_texte(p, e->comm, sizeof(e->comm), 16);
+        *p++ = ' ';
+        p = sortie_entier(p, e->ret, 4);
+        p = sortie_texte(p, e->filename, sizeof(e->filename), 0);
+        *p++ = '\n';
+        sortie_valider(t->sortie, p);
+        if (t->sortie->erreur) return -1;       /* sortie fermee ou pleine : arret */
+    }
+    return 0;
+}
+
+// Callback de 15_opensnoop : un printf par evenement
+static int afficher_event(void *ctx, const void *donnees, uint32_t taille) {
+    traitement_t *t = ctx;
+    if (taille < sizeof(struct event)) {
+        t->malformes++;
+        return 0;
+    }
+    const struct event *e = donnees;
+    fprintf(t->flux, "%-6d %-6d %-16s %-4d %s\n", e->pid, e->uid, e->comm, e->ret, e->filename);
+    return 0;
+}
+
+static void afficher_premiers(const char *titre, const agr_table_t *t, size_t n) {
+    const agr_entree_t *premiers[16];
+    n = agr_premiers(t, premiers, n < 16 ? n : 16);
+    printf("  %-44s %10s %8s\n", titre, "ouvertures", "echecs");
+    for (size_t i = 0; i < n; i++)
+        printf("  %-44.44s %10llu %8llu\n", premiers[i]->cle, (unsigned long long)premiers[i]->compte,
+               (unsigned long long)premiers[i]->erreurs);
+}
+
+typedef struct {
+    traitement_t *traitement;
+    uint64_t precedent;
+    double debut;
+} cliche_ctx_t;
+
+static void cliche(void *ctx, const moteur_stats_t *s) {
+    cliche_ctx_t *c = ctx;
+    if (c->traitement->sortie) sortie_vider(c->traitement->sortie);
+    double t = moteur_secondes() - c->debut;
+    printf("--- %.1f s : %llu evenements (+%llu), %llu pertes, retard max %llu Ko, "
+           "%llu reveils, %zu COMM, %zu fichiers\n",
+           t, (unsigned long long)s->evenements, (unsigned long long)(s->evenements - c->precedent),
+           (unsigned long long)s->pertes, (unsigned long long)(s->retard_max >> 10),
+           (unsigned long long)s->reveils, c->traitement->par_comm.occupees,
+           c->traitement->par_fichier.occupees);
+    afficher_premiers("COMM", &c->traitement->par_comm, 5);
+    afficher_premiers("FILENAME", &c->traitement->par_fichier, 5);
+    fflush(stdout);
+    c->precedent = s->evenements;
+}
+
+static int traitement_init(traitement_t *t) {
+    memset(t, 0, sizeof(*t));
+    if (agr_init(&t->par_comm, 512) == -1) return -1;
+    return agr_init(&t->par_fichier, 8192);
+}
+
+static void traitement_liberer(traitement_t *t) {
+    agr_liberer(&t->par_comm);
+    agr_liberer(&t->par_fichier);
+}
+
+/* ---------------------------------------------------------------------------
+   Banc d'essai
+   --------------------------------------------------------------------------- */
+
+typedef enum {
+    METHODE_PRINTF,             /* 15_opensnoop : poll 100 ms + printf */
+    METHODE_AGREGATS,           /* epoll + agregation, cliches seulement */
+    METHODE_LOTS,               /* epoll + agregation + sortie par lots */
+    METHODE_ACTIF,              /* attente active + agregation */
+    NB_METHODES
+} methode_t;
+
+static const char *const noms_methodes[NB_METHODES] = {
+    "printf + poll 100 ms", "epoll + agregats", "epoll + agregats + lots", "actif + agregats",
+};
+
+typedef struct {
+    double secondes;
+    double cpu_ns_evenement;
+    moteur_stats_t stats;
+    uint64_t produits;
+    uint64_t lignes;
+    uint64_t ecritures;
+    bool ok;
+} resultat_t;
+
+static double cpu_thread(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static uint64_t compter_lignes(int fd) {
+    off_t n = lseek(fd, 0, SEEK_END);
+    if (n <= 0) return 0;
+    char *p = mmap(NULL, (size_t)n, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) return 0;
+    uint64_t lignes = 0;
+    for (off_t i = 0; i < n; i++) lignes += p[i] == '\n';
+    munmap(p, (size_t)n);
+    return lignes;
+}
+
+/* Les agregats doivent compter exactement les evenements recus ; sans
+   perte, ils doivent egaler ceux calcules directement sur la capture */
+static bool verifier_agregats(const traitement_t *t, const traitement_t *reference,
+                              const moteur_stats_t *s) {
+    if (t->par_comm.total != s->evenements || t->par_fichier.total != s->evenements) return false;
+    if (s->pertes) return true;
+    const agr_table_t *tables[2][2] = { { &t->par_comm, &reference->par_comm },
+                                        { &t->par_fichier, &reference->par_fichier } };
+    for (int k = 0; k < 2; k++) {
+        const agr_table_t *a = tables[k][0], *r = tables[k][1];
+        if (a->occupees != r->occupees) return false;
+        for (size_t i = 0; i < r->capacite; i++) {
+            const agr_entree_t *e = &r->cases[i];
+            if (!e->empreinte) continue;
+            const agr_entree_t *x = agr_chercher(a, e->cle);
+            if (!x || x->compte != e->compte || x->erreurs != e->erreurs) return false;
+        }
+    }
+    return true;
+}
+
+static int executer(methode_t m, const capture_t *c, size_t taille_anneau, double vitesse,
+                    const traitement_t *reference, resultat_t *res) {
+    memset(res, 0, sizeof(*res));
+    anneau_t a;
+    if (anneau_simule_creer(&a, taille_anneau) == -1) return -1;
+    traitement_t t;
+    if (traitement_init(&t) == -1) {
+        anneau_fermer(&a);
+        return -1;
+    }
+    int fd_sortie = memfd_create("sortie", MFD_CLOEXEC);
+    sortie_t sortie;
+    if (m == METHODE_PRINTF) {
+        t.flux = fdopen(dup(fd_sortie), "w");
+        setvbuf(t.flux, NULL, _IOLBF, 0);       /* comme un terminal */
+    } else if (m == METHODE_LOTS) {
+        sortie_init(&sortie, fd_sortie, 64 * 1024);
+        t.sortie = &sortie;
+    }
+
+    moteur_t mt;
+    moteur_init(&mt, &a, m == METHODE_ACTIF ? MOTEUR_ACTIF : MOTEUR_EPOLL,
+                m == METHODE_PRINTF ? afficher_event : traiter_event, &t);
+    moteur_pertes(&mt, pertes_simulees, &a);
+
+    volatile sig_atomic_t arret = 0;
+    rejeu_t r = { &a, c, vitesse, &arret, 0 };
+    double debut = moteur_secondes(), cpu = cpu_thread();
+    pthread_t th;
+    pthread_create(&th, NULL, producteur, &r);
+    if (m == METHODE_PRINTF) {
+        /* boucle de 15_opensnoop : ring_buffer__poll(rb, 100) */
+        while (!arret) {
+            moteur_attendre(&mt, 100);
+            moteur_consommer(&mt);
+        }
+        moteur_consommer(&mt);
+        moteur_actualiser_pertes(&mt);
+    } else {
+        moteur_boucle(&mt, &arret, 0, NULL, NULL);
+        if (t.sortie) sortie_vider(t.sortie);
+    }
+    cpu = cpu_thread() - cpu;
+    res->secondes = moteur_secondes() - debut;
+    pthread_join(th, NULL);
+    if (t.flux) fclose(t.flux);
+
+    res->stats = mt.stats;
+    res->produits = r.produits;
+    res->cpu_ns_evenement = mt.stats.evenements ? cpu * 1e9 / (double)mt.stats.evenements : 0;
+    res->lignes = compter_lignes(fd_sortie);
+    res->ok = mt.stats.evenements + mt.stats.pertes == r.produits && t.malformes == 0;
+    if (m == METHODE_PRINTF) {
+        res->ecritures = res->lignes;
+        res->ok = res->ok && res->lignes == mt.stats.evenements;
+    } else {
+        res->ok = res->ok && verifier_agregats(&t, reference, &mt.stats);
+        if (m == METHODE_LOTS) {
+            res->ecritures = sortie.ecritures;
+            res->ok = res->ok && res->lignes == mt.stats.evenements;
+            sortie_liberer(&sortie);
+        }
+    }
+    close(fd_sortie);
+    moteur_fermer(&mt);
+    traitement_liberer(&t);
+    anneau_fermer(&a);
+    return 0;
+}
+
+static int banc_essai(const capture_t *c, size_t taille_anneau, double vitesse) {
+    traitement_t reference;
+    if (traitement_init(&reference) == -1) return 1;
+    for (size_t i = 0; i < c->nombre; i++) traiter_event(&reference, c->index[i] + 1, c->index[i]->taille);
+
+    double duree = c->nombre ? (double)c->index[c->nombre - 1]->ns / 1e9 : 0;
+    char rythme[24] = "max";
+    if (vitesse > 0) snprintf(rythme, sizeof(rythme), "x%g", vitesse);
+    printf("=== Rejeu de %zu evenements opensnoop (%.2f s enregistrees, vitesse %s), anneau %zu Ko ===\n",
+           c->nombre, duree, rythme, taille_anneau >> 10);
+    printf("%-24s %9s %9s %8s %7s %9s %9s %9s  %s\n", "Methode", "Recus", "Pertes", "Ev/s (k)",
+           "ns CPU", "Reveils", "Retard Ko", "write()", "Verif");
+
+    bool ok = true;
+    for (int m = 0; m < NB_METHODES; m++) {
+        resultat_t r;
+        if (executer((methode_t)m, c, taille_anneau, vitesse, &reference, &r) == -1) {
+            printf("%-24s impossible : %s\n", noms_methodes[m], strerror(errno));
+            ok = false;
+            continue;
+        }
+        ok = ok && r.ok;
+        printf("%-24s %9llu %9llu %8.0f %7.0f %9llu %9llu %9llu  %s\n", noms_methodes[m],
+               (unsigned long long)r.stats.evenements, (unsigned long long)r.stats.pertes,
+               (double)r.stats.evenements / r.secondes / 1e3, r.cpu_ns_evenement,
+               (unsigned long long)r.stats.reveils, (unsigned long long)(r.stats.retard_max >> 10),
+               (unsigned long long)r.ecritures, r.ok ? "ok" : "ECHEC");
+    }
+    traitement_liberer(&reference);
+    printf("\nVerification : %s\n", ok ? "recus + pertes = produits, agregats identiques a la capture "
+                                         "(sans perte), une ligne par evenement"
+                                      : "ECHEC");
+    return ok ? 0 : 1;
+}
+
+/* ---------------------------------------------------------------------------
+   Modes interactifs : rejeu d'une capture, ou trace reelle (AVEC_LIBBPF)
+   --------------------------------------------------------------------------- */
+
+static volatile sig_atomic_t arret_global = 0;
+
+static void sig_handler(int sig) {
+    (void)sig;
+    arret_global = 1;
+}
+
+typedef struct {
+    bool actif;
+    bool verbeux;
+    double intervalle;
+    double vitesse;
+    size_t taille_anneau;
+    const char *objet;
+    const char *enregistrement;
+} options_t;
+
+static int consommer(moteur_t *mt, traitement_t *t, const options_t *o) {
+    sortie_t sortie;
+    if (o->verbeux) {
+        sortie_init(&sortie, STDOUT_FILENO, 64 * 1024);
+        t->sortie = &sortie;
+    }
+    cliche_ctx_t cc = { t, 0, moteur_secondes() };
+    int err = moteur_boucle(mt, &arret_global, o->intervalle, cliche, &cc);
+    arret_global = 1;                   /* arrete aussi le producteur de rejeu */
+    cliche(&cc, &mt->stats);
+    if (t->sortie) {
+        sortie_liberer(&sortie);
+        if (sortie.erreur) {
+            fprintf(stderr, "Sortie : %s\n", strerror(sortie.erreur));
+            err = -1;
+        }
+    }
+    t->sortie = NULL;
+    return err;
+}
+
+static int rejouer(const char *chemin, const options_t *o) {
+    capture_t c;
+    if (capture_lire(&c, chemin) == -1) {
+        fprintf(stderr, "Capture illisible %s : %s\n", chemin, strerror(errno));
+        return 1;
+    }
+    anneau_t a;
+    traitement_t t;
+    moteur_t mt;
+    if (anneau_simule_creer(&a, o->taille_anneau) == -1 || traitement_init(&t) == -1
+        || moteur_init(&mt, &a, o->actif ? MOTEUR_ACTIF : MOTEUR_EPOLL, traiter_event, &t) == -1) {
+        perror("initialisation");
+        return 1;
+    }
+    moteur_pertes(&mt, pertes_simulees, &a);
+    printf("Rejeu de %s : %zu evenements, mode %s\n", chemin, c.nombre, moteur_noms_modes[mt.mode]);
+    rejeu_t r = { &a, &c, o->vitesse, &arret_global, 0 };
+    pthread_t th;
+    pthread_create(&th, NULL, producteur, &r);
+    int err = consommer(&mt, &t, o);
+    pthread_join(th, NULL);
+    moteur_fermer(&mt);
+    traitement_liberer(&t);
+    anneau_fermer(&a);
+    capture_liberer(&c);
+    return err != 0;
+}
+
+#ifdef AVEC_LIBBPF
+typedef struct {
+    int fd;
+    int cpus;
+} pertes_bpf_t;
+
+// Somme de la map PERCPU_ARRAY "pertes" sur tous les CPU
+static uint64_t pertes_bpf(void *ctx) {
+    pertes_bpf_t *p = ctx;
+    uint64_t valeurs[p->cpus], total = 0;
+    uint32_t zero = 0;
+    if (bpf_map_lookup_elem(p->fd, &zero, valeurs) != 0) return 0;
+    for (int i = 0; i < p->cpus; i++) total += valeurs[i];
+    return total;
+}
+
+static int tracer(const options_t *o) {
+    struct rlimit rlim = { RLIM_INFINITY, RLIM_INFINITY };
+    setrlimit(RLIMIT_MEMLOCK, &rlim);
+
+    struct bpf_object *obj = bpf_object__open_file(o->objet, NULL);
+    if (!obj) {
+        fprintf(stderr, "Failed to open BPF object %s\n", o->objet);
+        return 1;
+    }
+    int err = bpf_object__load(obj);
+    if (err) {
+        fprintf(stderr, "Failed to load BPF object: %d\n", err);
+        bpf_object__close(obj);
+        return 1;
+    }
+    struct bpf_program *prog;
+    bpf_object__for_each_program(prog, obj) {
+        if (!bpf_program__attach(prog)) {
+            fprintf(stderr, "Failed to attach: %s\n", bpf_program__name(prog));
+            bpf_object__close(obj);
+            return 1;
+        }
+    }
+
+    struct bpf_map *events = bpf_object__find_map_by_name(obj, "events");
+    anneau_t a;
+    traitement_t t;
+    moteur_t mt;
+    if (!events || anneau_ouvrir_bpf(&a, bpf_map__fd(events), bpf_map__max_entries(events)) == -1
+        || traitement_init(&t) == -1
+        || moteur_init(&mt, &a, o->actif ? MOTEUR_ACTIF : MOTEUR_EPOLL, traiter_event, &t) == -1) {
+        perror("ringbuffer");
+        bpf_object__close(obj);
+        return 1;
+    }
+    pertes_bpf_t pb = { bpf_object__find_map_fd_by_name(obj, "pertes"), libbpf_num_possible_cpus() };
+    if (pb.fd >= 0) moteur_pertes(&mt, pertes_bpf, &pb);
+
+    enregistreur_t rec = { NULL, 0 };
+    if (o->enregistrement) {
+        rec.f = fopen(o->enregistrement, "wb");
+        if (!rec.f) {
+            perror(o->enregistrement);
+            return 1;
+        }
+        fwrite(MAGIE_CAPTURE, 1, 8, rec.f);
+        t.enregistreur = &rec;
+    }
+    printf("Trace en cours (mode %s, anneau %u Ko), Ctrl-C pour arreter\n", moteur_noms_modes[mt.mode],
+           bpf_map__max_entries(events) >> 10);
+    err = consommer(&mt, &t, o);
+    if (rec.f) fclose(rec.f);
+    moteur_fermer(&mt);
+    traitement_liberer(&t);
+    anneau_fermer(&a);
+    bpf_object__close(obj);
+    return err != 0;
+}
+#endif
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage : %s                          banc d'essai sur une capture synthetique\n"
+            "        %s -g capture [-n nombre]   generer une capture synthetique\n"
+            "        %s -r capture [-B]          rejouer (ou banc d'essai -B) une capture\n"
+#ifdef AVEC_LIBBPF
+            "        %s -o opensnoop.bpf.o [-e capture]  tracer (root), enregistrer\n"
+#endif
+            "Options : -a (attente active) -v (une ligne par evenement, par lots)\n"
+            "          -i secondes (cliches) -x vitesse (0 = au plus vite) -t taille_anneau_ko\n",
+            prog, prog, prog
+#ifdef AVEC_LIBBPF
+            , prog
+#endif
+            );
+}
+
+int main(int argc, char *argv[]) {
+    options_t o = { false, false, 1.0, 1.0, 256 * 1024, NULL, NULL };
+    const char *generer = NULL, *capture = NULL;
+    size_t nombre = 400000;
+    bool banc = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "g:n:r:Bo:e:avi:x:t:h")) != -1) {
+        switch (opt) {
+        case 'g': generer = optarg; break;
+        case 'n': nombre = (size_t)atol(optarg); break;
+        case 'r': capture = optarg; break;
+        case 'B': banc = true; break;
+        case 'o': o.objet = optarg; break;
+        case 'e': o.enregistrement = optarg; break;
+        case 'a': o.actif = true; break;
+        case 'v': o.verbeux = true; break;
+        case 'i': o.intervalle = atof(optarg); break;
+        case 'x': o.vitesse = atof(optarg); break;
+        case 't': o.taille_anneau = (size_t)atol(optarg) << 10; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+
+    if (o.objet) {
+#ifdef AVEC_LIBBPF
+        return tracer(&o);
+#else
+        fprintf(stderr, "Trace reelle indisponible : recompiler avec -DAVEC_LIBBPF -lbpf -lelf -lz\n");
+        return 1;
+#endif
+    }
+    if (capture && !banc) return rejouer(capture, &o);
+
+    capture_t c;
+    if (capture ? capture_lire(&c, capture) : capture_generer(&c, nombre, 800000.0)) {
+        fprintf(stderr, "Capture : %s\n", strerror(errno));
+        return 1;
+    }
+    if (generer) {
+        int err = capture_ecrire(&c, generer);
+        if (err) perror(generer);
+        else printf("%zu evenements ecrits dans %s (%zu Ko)\n", c.nombre, generer, c.longueur >> 10);
+        capture_liberer(&c);
+        return err != 0;
+    }
+    int code = banc_essai(&c, o.taille_anneau, o.vitesse);
+    capture_liberer(&c);
+    return code;
+}
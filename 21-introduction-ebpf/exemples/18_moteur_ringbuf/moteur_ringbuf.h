@@ -0,0 +1,356 @@
+/* ============================================================================
+   Section 21.4.1 : libbpf - Consommation d'un ringbuffer BPF
+   Description : Moteur de consommation bas cout pour BPF_MAP_TYPE_RINGBUF
+                 - lecture directe des pages mappees (sans ring_buffer__poll)
+                 - attente epoll sur le fd de la map, ou attente active
+                 - compteurs : evenements, passes, reveils, retard, pertes
+                 - anneau simule de meme disposition pour le rejeu sans
+                   privileges (memfd mappe deux fois, eventfd comme reveil)
+   Fichier source : 04.1-libbpf.md
+   ============================================================================ */
+#ifndef MOTEUR_RINGBUF_H
+#define MOTEUR_RINGBUF_H
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <linux/bpf.h>
+
+/* Disposition du noyau (kernel/bpf/ringbuf.c) :
+     page 0      : position consommateur (ecrite par l'espace utilisateur)
+     page 1      : position producteur (lecture seule)
+     pages 2..   : donnees, mappees deux fois a la suite pour qu'un
+                   enregistrement a cheval sur la fin reste contigu
+   Chaque enregistrement : en-tete de 8 octets (longueur | BUSY | DISCARD,
+   decalage de page) puis les donnees, arrondi a 8 octets. */
+
+typedef struct {
+    uint64_t *consommateur;
+    uint64_t *producteur;
+    uint8_t *donnees;
+    uint64_t masque;
+    int fd;                     /* surveille par epoll : map BPF ou eventfd */
+    bool simule;
+    void *carte;                /* anneau simule : une seule reservation */
+    size_t taille_carte;
+    void *carte_prod;           /* map BPF : pages producteur + donnees */
+    size_t taille_prod;
+    uint64_t pertes_simulees;   /* reservations refusees par le producteur simule */
+} anneau_t;
+
+typedef enum {
+    MOTEUR_EPOLL,               /* dort dans epoll_wait jusqu'au reveil du producteur */
+    MOTEUR_ACTIF                /* sonde la position producteur en boucle */
+} moteur_mode_t;
+
+typedef struct {
+    uint64_t evenements;
+    uint64_t octets;
+    uint64_t passes;            /* passes de consommation non vides */
+    uint64_t attentes;          /* epoll_wait (ou sondes vides en mode actif) */
+    uint64_t reveils;           /* attentes terminees avec des donnees */
+    uint64_t retard_max;        /* octets en attente au debut d'une passe */
+    uint64_t retard_cumule;
+    uint64_t pertes;            /* cote producteur : anneau plein */
+} moteur_stats_t;
+
+typedef int (*moteur_rappel_t)(void *ctx, const void *donnees, uint32_t taille);
+typedef uint64_t (*moteur_pertes_t)(void *ctx);
+
+typedef struct {
+    anneau_t *anneau;
+    moteur_mode_t mode;
+    int epfd;
+    moteur_rappel_t rappel;
+    void *ctx;
+    moteur_pertes_t lire_pertes;    /* facultatif : compteur noyau ou simule */
+    void *ctx_pertes;
+    moteur_stats_t stats;
+} moteur_t;
+
+static const char *const moteur_noms_modes[] = { "epoll", "actif" };
+
+static inline void rb_pause(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+static inline uint32_t rb_arrondi(uint32_t longueur) {
+    return (longueur + BPF_RINGBUF_HDR_SZ + 7) & ~7u;
+}
+
+static inline uint64_t anneau_en_attente(const anneau_t *a) {
+    return __atomic_load_n(a->producteur, __ATOMIC_ACQUIRE)
+         - __atomic_load_n(a->consommateur, __ATOMIC_ACQUIRE);
+}
+
+/* ---------------------------------------------------------------------------
+   Anneau reel : mmap du fd d'une map BPF_MAP_TYPE_RINGBUF
+   --------------------------------------------------------------------------- */
+
+static inline int anneau_ouvrir_bpf(anneau_t *a, int map_fd, size_t taille) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    memset(a, 0, sizeof(*a));
+    void *cons = mmap(NULL, page, PROT_READ | PROT_WRITE, MAP_SHARED, map_fd, 0);
+    if (cons == MAP_FAILED) return -1;
+    /* Le noyau autorise un mapping producteur + 2 x donnees en lecture seule */
+    void *prod = mmap(NULL, page + 2 * taille, PROT_READ, MAP_SHARED, map_fd, (off_t)page);
+    if (prod == MAP_FAILED) {
+        int e = errno;
+        munmap(cons, page);
+        errno = e;
+        return -1;
+    }
+    a->consommateur = cons;
+    a->producteur = prod;
+    a->donnees = (uint8_t *)prod + page;
+    a->masque = taille - 1;
+    a->fd = map_fd;
+    a->carte = cons;
+    a->taille_carte = page;
+    a->carte_prod = prod;
+    a->taille_prod = page + 2 * taille;
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+   Anneau simule : meme disposition, producteur unique en espace utilisateur
+   --------------------------------------------------------------------------- */
+
+static inline int anneau_simule_creer(anneau_t *a, size_t taille) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    memset(a, 0, sizeof(*a));
+    if (taille < page || (taille & (taille - 1))) {
+        errno = EINVAL;
+        return -1;
+    }
+    int mfd = memfd_create("anneau_simule", MFD_CLOEXEC);
+    if (mfd == -1) return -1;
+    size_t fichier = 2 * page + taille;
+    a->taille_carte = fichier + taille;
+    a->carte = MAP_FAILED;
+    if (ftruncate(mfd, (off_t)fichier) == -1) goto echec;
+    a->carte = mmap(NULL, a->taille_carte, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (a->carte == MAP_FAILED) goto echec;
+    uint8_t *base = a->carte;
+    if (mmap(base, fichier, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, mfd, 0) == MAP_FAILED)
+        goto echec;
+    if (mmap(base + fichier, taille, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, mfd,
+             (off_t)(2 * page)) == MAP_FAILED)
+        goto echec;
+    close(mfd);
+    mfd = -1;
+    a->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (a->fd == -1) goto echec;
+    a->consommateur = (uint64_t *)base;
+    a->producteur = (uint64_t *)(base + page);
+    a->donnees = base + 2 * page;
+    a->masque = taille - 1;
+    a->simule = true;
+    return 0;
+echec:;
+    int e = errno;
+    if (a->carte != MAP_FAILED) munmap(a->carte, a->taille_carte);
+    if (mfd != -1) close(mfd);
+    a->carte = NULL;
+    errno = e;
+    return -1;
+}
+
+/* Equivalent de bpf_ringbuf_output() : reserve (BUSY), copie, valide.
+   Reveil comme le noyau : seulement si le consommateur avait tout lu
+   jusqu'a cet enregistrement. Renvoie -1 (et compte une perte) si plein. */
+static inline int anneau_simule_produire(anneau_t *a, const void *d, uint32_t longueur) {
+    uint64_t prod = *a->producteur;
+    uint64_t total = rb_arrondi(longueur);
+    uint64_t cons = __atomic_load_n(a->consommateur, __ATOMIC_SEQ_CST);
+    if (prod + total - cons > a->masque + 1) {
+        a->pertes_simulees++;
+        return -1;
+    }
+    uint32_t *entete = (uint32_t *)(a->donnees + (prod & a->masque));
+    entete[0] = longueur | BPF_RINGBUF_BUSY_BIT;
+    entete[1] = 0;
+    __atomic_store_n(a->producteur, prod + total, __ATOMIC_SEQ_CST);
+    memcpy(entete + 2, d, longueur);
+    __atomic_store_n(&entete[0], longueur, __ATOMIC_RELEASE);
+    if (__atomic_load_n(a->consommateur, __ATOMIC_SEQ_CST) == prod) {
+        uint64_t un = 1;
+        if (write(a->fd, &un, sizeof(un)) < 0) { /* compteur sature : deja signale */ }
+    }
+    return 0;
+}
+
+/* Reveil final (fin de rejeu) pour qu'un consommateur endormi constate l'arret */
+static inline void anneau_simule_signaler(anneau_t *a) {
+    uint64_t un = 1;
+    if (write(a->fd, &un, sizeof(un)) < 0) { /* deja signale */ }
+}
+
+static inline void anneau_fermer(anneau_t *a) {
+    if (a->carte) munmap(a->carte, a->taille_carte);
+    if (a->carte_prod) munmap(a->carte_prod, a->taille_prod);
+    if (a->simule && a->fd != -1) close(a->fd);
+    memset(a, 0, sizeof(*a));
+    a->fd = -1;
+}
+
+/* ---------------------------------------------------------------------------
+   Moteur
+   --------------------------------------------------------------------------- */
+
+static inline int moteur_init(moteur_t *m, anneau_t *a, moteur_mode_t mode,
+                              moteur_rappel_t rappel, void *ctx) {
+    memset(m, 0, sizeof(*m));
+    m->anneau = a;
+    m->mode = mode;
+    m->rappel = rappel;
+    m->ctx = ctx;
+    m->epfd = -1;
+    if (mode == MOTEUR_EPOLL) {
+        m->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (m->epfd == -1) return -1;
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = a };
+        if (epoll_ctl(m->epfd, EPOLL_CTL_ADD, a->fd, &ev) == -1) {
+            int e = errno;
+            close(m->epfd);
+            errno = e;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static inline void moteur_pertes(moteur_t *m, moteur_pertes_t lire, void *ctx) {
+    m->lire_pertes = lire;
+    m->ctx_pertes = ctx;
+}
+
+/* Vide l'anneau : rappel pour chaque enregistrement valide, position
+   consommateur publiee a chaque enregistrement (le producteur en a besoin
+   pour liberer la place et decider du reveil). Relit la position producteur
+   tant que la passe precedente a trouve des donnees. Renvoie le nombre
+   d'evenements, ou -1 si le rappel a demande l'arret. */
+static inline long moteur_consommer(moteur_t *m) {
+    anneau_t *a = m->anneau;
+    uint64_t cons = __atomic_load_n(a->consommateur, __ATOMIC_ACQUIRE);
+    long n = 0;
+    bool nouveau;
+    do {
+        nouveau = false;
+        uint64_t prod = __atomic_load_n(a->producteur, __ATOMIC_SEQ_CST);
+        if (prod - cons > m->stats.retard_max) m->stats.retard_max = prod - cons;
+        if (n == 0) m->stats.retard_cumule += prod - cons;
+        while (cons < prod) {
+            uint32_t *entete = (uint32_t *)(a->donnees + (cons & a->masque));
+            uint32_t longueur = __atomic_load_n(entete, __ATOMIC_ACQUIRE);
+            if (longueur & BPF_RINGBUF_BUSY_BIT) goto fin;     /* encore en ecriture */
+            bool jete = longueur & BPF_RINGBUF_DISCARD_BIT;
+            longueur &= ~(BPF_RINGBUF_BUSY_BIT | BPF_RINGBUF_DISCARD_BIT);
+            const void *donnees = entete + 2;
+            cons += rb_arrondi(longueur);
+            nouveau = true;
+            if (!jete) {
+                n++;
+                m->stats.octets += longueur;
+                if (m->rappel(m->ctx, donnees, longueur) != 0) {
+                    __atomic_store_n(a->consommateur, cons, __ATOMIC_SEQ_CST);
+                    m->stats.evenements += (uint64_t)n;
+                    m->stats.passes++;
+                    return -1;
+                }
+            }
+            __atomic_store_n(a->consommateur, cons, __ATOMIC_SEQ_CST);
+        }
+    } while (nouveau);
+fin:
+    m->stats.evenements += (uint64_t)n;
+    if (n) m->stats.passes++;
+    return n;
+}
+
+/* Attend des donnees au plus delai_ms. Mode epoll : dort sur le fd (la map
+   BPF est prete tant qu'il reste des donnees ; l'eventfd simule est vide a
+   la lecture). Mode actif : sonde la position producteur, cede le processeur
+   entre deux sondes pour ne pas affamer le producteur sur une machine
+   mono-coeur. Renvoie 1 si des donnees sont disponibles, 0 sinon. */
+static inline int moteur_attendre(moteur_t *m, int delai_ms) {
+    anneau_t *a = m->anneau;
+    m->stats.attentes++;
+    if (m->mode == MOTEUR_ACTIF) {
+        for (int i = 0; i < 64; i++) {
+            if (anneau_en_attente(a)) {
+                m->stats.reveils++;
+                return 1;
+            }
+            rb_pause();
+        }
+        sched_yield();
+        return anneau_en_attente(a) != 0;
+    }
+    if (anneau_en_attente(a)) {
+        m->stats.reveils++;
+        return 1;
+    }
+    struct epoll_event ev;
+    int r = epoll_wait(m->epfd, &ev, 1, delai_ms);
+    if (r > 0 && a->simule) {
+        uint64_t v;
+        if (read(a->fd, &v, sizeof(v)) < 0) { /* deja consomme */ }
+    }
+    if (r > 0) m->stats.reveils++;
+    return r > 0;
+}
+
+static inline void moteur_actualiser_pertes(moteur_t *m) {
+    if (m->lire_pertes) m->stats.pertes = m->lire_pertes(m->ctx_pertes);
+}
+
+/* Boucle principale : consomme jusqu'a *arret, appelle cliche() toutes les
+   intervalle secondes (0 : jamais) avec les compteurs a jour. Un dernier
+   passage vide l'anneau apres l'arret. */
+typedef void (*moteur_cliche_t)(void *ctx, const moteur_stats_t *stats);
+
+static inline double moteur_secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static inline int moteur_boucle(moteur_t *m, const volatile sig_atomic_t *arret,
+                                double intervalle, moteur_cliche_t cliche, void *ctx) {
+    double prochain = intervalle > 0 ? moteur_secondes() + intervalle : 0;
+    int delai = intervalle > 0 ? (int)(intervalle * 1000) : 100;
+    while (!*arret) {
+        if (moteur_consommer(m) < 0) return -1;
+        if (prochain > 0 && moteur_secondes() >= prochain) {
+            moteur_actualiser_pertes(m);
+            if (cliche) cliche(ctx, &m->stats);
+            prochain += intervalle;
+        }
+        moteur_attendre(m, delai);
+    }
+    if (moteur_consommer(m) < 0) return -1;
+    moteur_actualiser_pertes(m);
+    return 0;
+}
+
+static inline void moteur_fermer(moteur_t *m) {
+    if (m->epfd != -1) close(m->epfd);
+    m->epfd = -1;
+}
+
+#endif /* MOTEUR_RINGBUF_H */
@@ -0,0 +1,149 @@
+/* ============================================================================
+   Section 21.2.2 : BPF Maps - Monitoring de latence
+   Description : Exploitation des histogrammes log2 de 04_latency_monitor
+                 - fusion des exemplaires par CPU d'une PERCPU_ARRAY
+                 - percentiles par interpolation dans la case log2
+                 - tableau de percentiles et histogramme texte
+   Fichier source : 02.2-bpf-maps.md
+   ============================================================================ */
+#ifndef HISTOGRAMME_H
+#define HISTOGRAMME_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "../04_latency_hist.h"
+
+/* Une lecture de PERCPU_ARRAY renvoie ncpus valeurs, chacune arrondie a 8 */
+#define HIST_PAS_CPU ((sizeof(struct latence_hist) + 7) & ~(size_t)7)
+
+static inline void hist_fusionner(const void *par_cpu, int ncpus, struct latence_hist *total) {
+    memset(total, 0, sizeof(*total));
+    for (int c = 0; c < ncpus; c++) {
+        const struct latence_hist *h =
+            (const struct latence_hist *)((const char *)par_cpu + (size_t)c * HIST_PAS_CPU);
+        for (int s = 0; s < LATENCE_SLOTS; s++) total->slots[s] += h->slots[s];
+        total->count += h->count;
+        total->total_ns += h->total_ns;
+        if (h->max_ns > total->max_ns) total->max_ns = h->max_ns;
+    }
+}
+
+/* Ecart entre deux lectures cumulees (intervalle) ; max reste cumule */
+static inline void hist_soustraire(struct latence_hist *h, const struct latence_hist *avant) {
+    for (int s = 0; s < LATENCE_SLOTS; s++) h->slots[s] -= avant->slots[s];
+    h->count -= avant->count;
+    h->total_ns -= avant->total_ns;
+}
+
+static inline uint64_t hist_borne_basse(int slot) {
+    return slot == 0 ? 0 : 1ULL << slot;
+}
+
+static inline uint64_t hist_borne_haute(int slot) {
+    return slot == LATENCE_SLOTS - 1 ? UINT64_MAX : 2ULL << slot;
+}
+
+/* Percentile p (0..100) : case contenant le rang, puis interpolation
+   lineaire dans [2^s, 2^(s+1)), bornee par max_ns. *case_sortie (si non
+   NULL) recoit la case : le vrai percentile s'y trouve forcement. */
+static inline uint64_t hist_percentile(const struct latence_hist *h, double p, int *case_sortie) {
+    uint64_t n = 0;
+    for (int s = 0; s < LATENCE_SLOTS; s++) n += h->slots[s];
+    if (n == 0) {
+        if (case_sortie) *case_sortie = -1;
+        return 0;
+    }
+    /* rang 1-indexe, methode "nearest rank" */
+    uint64_t rang = (uint64_t)(p / 100.0 * (double)n + 0.999999);
+    if (rang < 1) rang = 1;
+    if (rang > n) rang = n;
+    uint64_t cumul = 0;
+    for (int s = 0; s < LATENCE_SLOTS; s++) {
+        if (cumul + h->slots[s] >= rang) {
+            if (case_sortie) *case_sortie = s;
+            uint64_t bas = hist_borne_basse(s), haut = hist_borne_haute(s);
+            if (h->max_ns && haut > h->max_ns + 1) haut = h->max_ns + 1;
+            if (haut <= bas) return bas;
+            double f = (double)(rang - cumul) / (double)h->slots[s];
+            return bas + (uint64_t)(f * (double)(haut - 1 - bas));
+        }
+        cumul += h->slots[s];
+    }
+    if (case_sortie) *case_sortie = LATENCE_SLOTS - 1;
+    return h->max_ns;
+}
+
+/* Noms x86_64 des appels les plus frequents ; sinon le numero */
+static inline const char *hist_nom_syscall(uint32_t id, char *tampon, size_t taille) {
+    static const struct { uint32_t id; const char *nom; } noms[] = {
+        { 0, "read" }, { 1, "write" }, { 2, "open" }, { 3, "close" }, { 4, "stat" },
+        { 5, "fstat" }, { 7, "poll" }, { 8, "lseek" }, { 9, "mmap" }, { 10, "mprotect" },
+        { 11, "munmap" }, { 12, "brk" }, { 13, "rt_sigaction" }, { 14, "rt_sigprocmask" },
+        { 16, "ioctl" }, { 17, "pread64" }, { 18, "pwrite64" }, { 19, "readv" }, { 20, "writev" },
+        { 23, "select" }, { 24, "sched_yield" }, { 35, "nanosleep" }, { 39, "getpid" },
+        { 41, "socket" }, { 42, "connect" }, { 43, "accept" }, { 44, "sendto" },
+        { 45, "recvfrom" }, { 46, "sendmsg" }, { 47, "recvmsg" }, { 56, "clone" },
+        { 57, "fork" }, { 59, "execve" }, { 61, "wait4" }, { 62, "kill" }, { 72, "fcntl" },
+        { 74, "fsync" }, { 202, "futex" }, { 217, "getdents64" }, { 228, "clock_gettime" },
+        { 230, "clock_nanosleep" }, { 232, "epoll_wait" }, { 257, "openat" },
+        { 262, "newfstatat" }, { 270, "pselect6" }, { 271, "ppoll" }, { 281, "epoll_pwait" },
+        { 288, "accept4" }, { 318, "getrandom" }, { 332, "statx" }, { 425, "io_uring_setup" },
+        { 426, "io_uring_enter" },
+    };
+    for (size_t i = 0; i < sizeof(noms) / sizeof(noms[0]); i++)
+        if (noms[i].id == id) return noms[i].nom;
+    snprintf(tampon, taille, "sys_%u", id);
+    return tampon;
+}
+
+/* Duree lisible sur 8 colonnes : ns, us, ms ou s */
+static inline const char *hist_duree(uint64_t ns, char *tampon, size_t taille) {
+    if (ns < 10000) snprintf(tampon, taille, "%lluns", (unsigned long long)ns);
+    else if (ns < 10000000) snprintf(tampon, taille, "%.1fus", (double)ns / 1e3);
+    else if (ns < 10000000000ULL) snprintf(tampon, taille, "%.1fms", (double)ns / 1e6);
+    else snprintf(tampon, taille, "%.1fs", (double)ns / 1e9);
+    return tampon;
+}
+
+static inline void hist_entete_tableau(FILE *f) {
+    fprintf(f, "%-16s %10s %9s %9s %9s %9s %9s %9s\n", "SYSCALL", "COUNT", "MOYENNE", "P50", "P90",
+            "P99", "P99.9", "MAX");
+}
+
+static inline void hist_ligne_tableau(FILE *f, uint32_t id, const struct latence_hist *h) {
+    char nom[24], t[6][16];
+    static const double p[4] = { 50, 90, 99, 99.9 };
+    if (!h->count) return;
+    fprintf(f, "%-16s %10llu %9s", hist_nom_syscall(id, nom, sizeof(nom)), (unsigned long long)h->count,
+            hist_duree(h->total_ns / h->count, t[0], sizeof(t[0])));
+    for (int i = 0; i < 4; i++)
+        fprintf(f, " %9s", hist_duree(hist_percentile(h, p[i], NULL), t[i + 1], sizeof(t[i + 1])));
+    fprintf(f, " %9s\n", hist_duree(h->max_ns, t[5], sizeof(t[5])));
+}
+
+/* Histogramme texte facon print_log2_hist de BCC */
+static inline void hist_afficher(FILE *f, const struct latence_hist *h) {
+    uint64_t max = 0;
+    int premier = -1, dernier = -1;
+    for (int s = 0; s < LATENCE_SLOTS; s++) {
+        if (!h->slots[s]) continue;
+        if (premier < 0) premier = s;
+        dernier = s;
+        if (h->slots[s] > max) max = h->slots[s];
+    }
+    if (premier < 0) return;
+    fprintf(f, "%24s : %-10s %s\n", "ns", "count", "distribution");
+    for (int s = premier; s <= dernier; s++) {
+        char barre[41];
+        int n = (int)(h->slots[s] * 40 / max);
+        memset(barre, '*', (size_t)n);
+        memset(barre + n, ' ', (size_t)(40 - n));
+        barre[40] = '\0';
+        fprintf(f, "%11llu -> %-10llu : %-10llu |%s|\n", (unsigned long long)hist_borne_basse(s),
+                (unsigned long long)(hist_borne_haute(s) - 1), (unsigned long long)h->slots[s], barre);
+    }
+}
+
+#endif /* HISTOGRAMME_H */
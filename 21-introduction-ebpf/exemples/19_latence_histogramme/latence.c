@@ -0,0 +1,212 @@
+/* ============================================================================
+   Section 21.2.2 : BPF Maps - Loader du monitoring de latence
+   Description : Charge 04_latency_monitor.bpf.o en mode histogramme
+                 - seuil des valeurs aberrantes ecrit dans config_map
+                 - fusion des histogrammes par CPU (hist_map) a chaque
+                   intervalle, tableau de percentiles par syscall
+                 - valeurs aberrantes lues dans le ringbuf, pertes comptees
+                 - mode compat (-c) : ancienne stats_map count/total/min/max
+   Fichier source : 02.2-bpf-maps.md
+   ============================================================================ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/resource.h>
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+#include "histogramme.h"
+
+// Structures identiques au code kernel
+struct event {
+    uint32_t pid;
+    uint32_t syscall_id;
+    uint64_t duration_ns;
+    char comm[16];
+};
+
+struct latency_stats {
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t min_ns;
+    uint64_t max_ns;
+};
+
+typedef struct {
+    uint32_t id;
+    struct latence_hist h;
+} ligne_t;
+
+static volatile sig_atomic_t arret = 0;
+
+static void sig_handler(int sig) {
+    (void)sig;
+    arret = 1;
+}
+
+static int afficher_aberrante(void *ctx, void *data, size_t taille) {
+    const struct event *e = data;
+    char nom[24], d[16];
+    (void)ctx;
+    if (taille < sizeof(*e)) return 0;
+    printf("ABERRANT pid %-7u %-16s %-16s %s\n", e->pid, e->comm,
+           hist_nom_syscall(e->syscall_id, nom, sizeof(nom)), hist_duree(e->duration_ns, d, sizeof(d)));
+    return 0;
+}
+
+static int comparer_lignes(const void *a, const void *b) {
+    const ligne_t *x = a, *y = b;
+    return x->h.count < y->h.count ? 1 : x->h.count > y->h.count ? -1 : 0;
+}
+
+static uint64_t somme_pertes(int fd, int ncpus) {
+    uint64_t valeurs[ncpus], total = 0;
+    uint32_t zero = 0;
+    if (fd < 0 || bpf_map_lookup_elem(fd, &zero, valeurs) != 0) return 0;
+    for (int i = 0; i < ncpus; i++) total += valeurs[i];
+    return total;
+}
+
+/* Lit les 512 cles de hist_map, fusionne les CPU, garde l'ecart avec la
+   lecture precedente (precedent[]) et affiche les n syscalls les plus actifs */
+static void rapport_histogrammes(int fd, int ncpus, struct latence_hist *precedent, int n, int detail) {
+    static ligne_t lignes[LATENCE_SYSCALLS];
+    void *par_cpu = malloc((size_t)ncpus * HIST_PAS_CPU);
+    int k = 0;
+    if (!par_cpu) return;
+    for (uint32_t id = 0; id < LATENCE_SYSCALLS; id++) {
+        struct latence_hist cumul;
+        if (bpf_map_lookup_elem(fd, &id, par_cpu) != 0) continue;
+        hist_fusionner(par_cpu, ncpus, &cumul);
+        if (cumul.count == precedent[id].count) continue;
+        lignes[k].id = id;
+        lignes[k].h = cumul;
+        hist_soustraire(&lignes[k].h, &precedent[id]);
+        precedent[id] = cumul;
+        k++;
+    }
+    free(par_cpu);
+    qsort(lignes, (size_t)k, sizeof(ligne_t), comparer_lignes);
+    hist_entete_tableau(stdout);
+    for (int i = 0; i < k && i < n; i++) hist_ligne_tableau(stdout, lignes[i].id, &lignes[i].h);
+    if (detail && k > 0) {
+        char nom[24];
+        printf("\n%s :\n", hist_nom_syscall(lignes[0].id, nom, sizeof(nom)));
+        hist_afficher(stdout, &lignes[0].h);
+    }
+}
+
+static void rapport_compat(int fd, int n) {
+    int k = 0;
+    printf("%-16s %10s %9s %9s %9s\n", "SYSCALL", "COUNT", "MOYENNE", "MIN", "MAX");
+    for (uint32_t id = 0; id < LATENCE_SYSCALLS && k < n; id++) {
+        struct latency_stats s;
+        char nom[24], t[3][16];
+        if (bpf_map_lookup_elem(fd, &id, &s) != 0 || !s.count) continue;
+        printf("%-16s %10llu %9s %9s %9s\n", hist_nom_syscall(id, nom, sizeof(nom)),
+               (unsigned long long)s.count, hist_duree(s.total_ns / s.count, t[0], sizeof(t[0])),
+               hist_duree(s.min_ns, t[1], sizeof(t[1])), hist_duree(s.max_ns, t[2], sizeof(t[2])));
+        k++;
+    }
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage : %s [-o objet.bpf.o] [-s seuil_us] [-i secondes] [-n lignes] [-H] [-c]\n"
+                    "  -H : histogramme log2 du syscall le plus frequent\n"
+                    "  -c : mode compat (stats_map, sans histogramme)\n", prog);
+}
+
+int main(int argc, char **argv) {
+    const char *objet = "../04_latency_monitor.bpf.o";
+    struct latence_config config = { LATENCE_SEUIL_DEFAUT, 0, 0 };
+    int intervalle = 2, n = 15, detail = 0, opt;
+    while ((opt = getopt(argc, argv, "o:s:i:n:Hch")) != -1) {
+        switch (opt) {
+        case 'o': objet = optarg; break;
+        case 's': config.seuil_ns = (uint64_t)(atof(optarg) * 1e3); break;
+        case 'i': intervalle = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+        case 'n': n = atoi(optarg); break;
+        case 'H': detail = 1; break;
+        case 'c': config.compat = 1; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    struct rlimit rlim = { RLIM_INFINITY, RLIM_INFINITY };
+    setrlimit(RLIMIT_MEMLOCK, &rlim);
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+
+    struct bpf_object *obj = bpf_object__open_file(objet, NULL);
+    if (!obj) {
+        fprintf(stderr, "Failed to open BPF object %s\n", objet);
+        return 1;
+    }
+    struct ring_buffer *rb = NULL;
+    int err = bpf_object__load(obj);
+    if (err) {
+        fprintf(stderr, "Failed to load BPF object: %d\n", err);
+        goto cleanup;
+    }
+
+    // La configuration doit etre en place avant le premier evenement
+    uint32_t zero = 0;
+    err = bpf_map_update_elem(bpf_object__find_map_fd_by_name(obj, "config_map"), &zero, &config, BPF_ANY);
+    if (err) {
+        fprintf(stderr, "Failed to write config_map: %d\n", err);
+        goto cleanup;
+    }
+
+    struct bpf_program *prog;
+    bpf_object__for_each_program(prog, obj) {
+        if (!bpf_program__attach(prog)) {
+            fprintf(stderr, "Failed to attach: %s\n", bpf_program__name(prog));
+            err = -1;
+            goto cleanup;
+        }
+    }
+
+    rb = ring_buffer__new(bpf_object__find_map_fd_by_name(obj, "events"), afficher_aberrante, NULL, NULL);
+    if (!rb) {
+        fprintf(stderr, "Failed to create ring buffer\n");
+        err = -1;
+        goto cleanup;
+    }
+
+    int ncpus = libbpf_num_possible_cpus();
+    int fd_hist = bpf_object__find_map_fd_by_name(obj, "hist_map");
+    int fd_stats = bpf_object__find_map_fd_by_name(obj, "stats_map");
+    int fd_pertes = bpf_object__find_map_fd_by_name(obj, "pertes");
+    static struct latence_hist precedent[LATENCE_SYSCALLS];
+    char seuil[16];
+    printf("Mode %s, %d CPU, valeurs aberrantes > %s. Ctrl-C pour arreter.\n",
+           config.compat ? "compat" : "histogramme", ncpus, hist_duree(config.seuil_ns, seuil, sizeof(seuil)));
+
+    while (!arret) {
+        // Les valeurs aberrantes sont rares : le poll sert surtout de minuterie
+        for (int t = 0; t < intervalle * 10 && !arret; t++) {
+            err = ring_buffer__poll(rb, 100);
+            if (err == -EINTR) break;
+            if (err < 0) {
+                fprintf(stderr, "Error polling ring buffer: %d\n", err);
+                goto cleanup;
+            }
+        }
+        printf("\n--- %d s, pertes ringbuf : %llu\n", intervalle,
+               (unsigned long long)somme_pertes(fd_pertes, ncpus));
+        if (config.compat) rapport_compat(fd_stats, n);
+        else rapport_histogrammes(fd_hist, ncpus, precedent, n, detail);
+        fflush(stdout);
+    }
+    err = 0;
+
+cleanup:
+    ring_buffer__free(rb);
+    bpf_object__close(obj);
+    return err != 0;
+}
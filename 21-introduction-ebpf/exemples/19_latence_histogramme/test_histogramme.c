@@ -0,0 +1,364 @@
+/* ============================================================================
+   Section 21.2.2 : BPF Maps - Banc de test des histogrammes de latence
+   Description : Valide le code de 04_latency_hist.h sans charger de programme
+                 - cases log2 : valeurs limites 2^k-1 / 2^k / 2^k+1, 0, max
+                 - rejeu d'evenements enregistres ("cpu syscall duree_ns"
+                   par ligne) dans des maps PERCPU simulees, avec la meme
+                   fonction de mise a jour que le programme BPF
+                 - fusion par CPU, totaux, valeurs aberrantes comparees au
+                   nombre injecte par le generateur (en-tete "# seuil_ns")
+                 - percentiles : le vrai percentile est dans la case estimee
+   Fichier source : 02.2-bpf-maps.md
+   ============================================================================ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <unistd.h>
+#include "histogramme.h"
+
+#define CPUS_MAX 64
+
+typedef struct {
+    uint32_t cpu;
+    uint32_t syscall;
+    uint64_t duree_ns;
+} evenement_t;
+
+typedef struct {
+    evenement_t *ev;
+    size_t nombre;
+    size_t capacite;
+    bool genere;                        /* injection connue (generateur ou en-tete du fichier) */
+    uint64_t seuil_ns;                  /* seuil vise par le generateur */
+    uint64_t injectees;                 /* evenements places au-dela de seuil_ns */
+} enregistrement_t;
+
+static int ajouter(enregistrement_t *r, uint32_t cpu, uint32_t syscall, uint64_t duree) {
+    if (r->nombre == r->capacite) {
+        size_t c = r->capacite ? r->capacite * 2 : 4096;
+        evenement_t *ev = realloc(r->ev, c * sizeof(*ev));
+        if (!ev) return -1;
+        r->ev = ev;
+        r->capacite = c;
+    }
+    r->ev[r->nombre++] = (evenement_t){ cpu, syscall, duree };
+    return 0;
+}
+
+static int lire_enregistrement(enregistrement_t *r, const char *chemin) {
+    FILE *f = fopen(chemin, "r");
+    if (!f) return -1;
+    char ligne[256];
+    unsigned cpu, syscall;
+    unsigned long long duree;
+    unsigned long long seuil, injectees;
+    while (fgets(ligne, sizeof(ligne), f)) {
+        if (sscanf(ligne, "# seuil_ns %llu aberrantes %llu", &seuil, &injectees) == 2) {
+            r->genere = true;
+            r->seuil_ns = seuil;
+            r->injectees = injectees;
+            continue;
+        }
+        if (ligne[0] == '#' || ligne[0] == '\n') continue;
+        if (sscanf(ligne, "%u %u %llu", &cpu, &syscall, &duree) != 3) {
+            fclose(f);
+            errno = EINVAL;
+            return -1;
+        }
+        if (ajouter(r, cpu, syscall, duree) == -1) {
+            fclose(f);
+            return -1;
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static int ecrire_enregistrement(const enregistrement_t *r, const char *chemin) {
+    FILE *f = fopen(chemin, "w");
+    if (!f) return -1;
+    if (r->genere)
+        fprintf(f, "# seuil_ns %llu aberrantes %llu\n", (unsigned long long)r->seuil_ns,
+                (unsigned long long)r->injectees);
+    fprintf(f, "# cpu syscall duree_ns\n");
+    for (size_t i = 0; i < r->nombre; i++)
+        fprintf(f, "%u %u %llu\n", r->ev[i].cpu, r->ev[i].syscall, (unsigned long long)r->ev[i].duree_ns);
+    return fclose(f);
+}
+
+static uint64_t aleatoire(uint64_t *etat) {
+    uint64_t x = *etat;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *etat = x;
+}
+
+static double uniforme(uint64_t *etat) {
+    return ((double)(aleatoire(etat) >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/* Log-normale de mediane m (ns) et d'ecart-type sigma (en log) */
+static uint64_t lognormale(uint64_t *etat, double m, double sigma) {
+    double z = sqrt(-2.0 * log(uniforme(etat))) * cos(2.0 * M_PI * uniforme(etat));
+    return (uint64_t)(m * exp(sigma * z));
+}
+
+/* Charge type d'un serveur : lectures/ecritures courtes, futex bimodal,
+   attentes longues, et quelques ecritures lentes au-dela du seuil.
+   Seules les ecritures lentes et la queue des ecritures sont placees
+   au-dela du seuil, et comptees a la construction : le reste est borne
+   au seuil, egalite comprise (qui n'est pas une valeur aberrante) */
+static int generer(enregistrement_t *r, size_t n, int cpus, uint64_t seuil) {
+    uint64_t etat = 0x9E3779B97F4A7C15ULL;
+    r->genere = true;
+    r->seuil_ns = seuil;
+    r->injectees = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t cpu = (uint32_t)(aleatoire(&etat) % (uint64_t)cpus);
+        uint64_t tirage = aleatoire(&etat) % 100, d;
+        uint32_t id;
+        bool aberrante = false;
+        if (tirage < 35) { id = 0; d = lognormale(&etat, 1800, 0.6); }
+        else if (tirage < 55) { id = 1; aberrante = uniforme(&etat) < 0.002;
+                                d = aberrante ? lognormale(&etat, 2e6, 0.5) : lognormale(&etat, 2500, 0.7); }
+        else if (tirage < 70) { id = 202; d = uniforme(&etat) < 0.7 ? lognormale(&etat, 400, 0.3)
+                                                                    : lognormale(&etat, 80000, 1.2); }
+        else if (tirage < 80) { id = 232; d = lognormale(&etat, 2e5, 1.5); }
+        else if (tirage < 90) { id = 257; d = lognormale(&etat, 9000, 0.8); }
+        else if (tirage < 95) { id = 228; d = lognormale(&etat, 60, 0.2); }
+        else { id = 230; aberrante = true; d = lognormale(&etat, 1e5, 0.05); }
+        if (aberrante) {
+            d += seuil + 1;
+            r->injectees++;
+        } else if (d > seuil) {
+            d = seuil;
+        }
+        if (ajouter(r, cpu, id, d) == -1) return -1;
+    }
+    return 0;
+}
+
+/* ---------------------------------------------------------------------------
+   Verifications
+   --------------------------------------------------------------------------- */
+
+static int slot_reference(uint64_t v) {
+    int s = 0;
+    while (v > 1) {
+        v >>= 1;
+        s++;
+    }
+    return s < LATENCE_SLOTS ? s : LATENCE_SLOTS - 1;
+}
+
+static bool dans_case(uint64_t v, int s) {
+    return v >= hist_borne_basse(s) && (s == LATENCE_SLOTS - 1 || v < hist_borne_haute(s));
+}
+
+static bool verifier_limites(void) {
+    uint64_t valeurs[3 * 64 + 2];
+    int n = 0;
+    valeurs[n++] = 0;
+    valeurs[n++] = UINT64_MAX;
+    for (int k = 0; k < 64; k++) {
+        uint64_t p = 1ULL << k;
+        valeurs[n++] = p - 1;
+        valeurs[n++] = p;
+        valeurs[n++] = p + 1;
+    }
+    for (int i = 0; i < n; i++) {
+        int s = (int)latence_slot(valeurs[i]);
+        if (s != slot_reference(valeurs[i]) || !dans_case(valeurs[i], s)) {
+            printf("  case de %llu : %d, attendu %d\n", (unsigned long long)valeurs[i], s,
+                   slot_reference(valeurs[i]));
+            return false;
+        }
+    }
+    /* balayage dense des petites valeurs */
+    for (uint64_t v = 0; v < (1u << 20); v++)
+        if ((int)latence_slot(v) != slot_reference(v)) return false;
+    return true;
+}
+
+static int comparer_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+typedef struct {
+    uint32_t id;
+    struct latence_hist h;
+} ligne_t;
+
+static int comparer_lignes(const void *a, const void *b) {
+    const ligne_t *x = a, *y = b;
+    return x->h.count < y->h.count ? 1 : x->h.count > y->h.count ? -1 : 0;
+}
+
+/* Rejoue l'enregistrement comme le ferait trace_exit sur chaque CPU,
+   puis controle la fusion, les percentiles et les valeurs aberrantes */
+static bool rejouer(const enregistrement_t *r, uint64_t seuil, bool afficher) {
+    int cpus = 1;
+    for (size_t i = 0; i < r->nombre; i++)
+        if ((int)r->ev[i].cpu + 1 > cpus) cpus = (int)r->ev[i].cpu + 1;
+    if (cpus > CPUS_MAX) {
+        printf("  cpu %d hors limite\n", cpus - 1);
+        return false;
+    }
+
+    /* Disposition d'une lecture PERCPU_ARRAY : pour chaque cle, ncpus
+       valeurs consecutives de HIST_PAS_CPU octets */
+    char *maps = calloc(LATENCE_SYSCALLS, (size_t)cpus * HIST_PAS_CPU);
+    uint64_t **durees = calloc(LATENCE_SYSCALLS, sizeof(uint64_t *));
+    size_t *nb = calloc(LATENCE_SYSCALLS, sizeof(size_t));
+    if (!maps || !durees || !nb) return false;
+    for (size_t i = 0; i < r->nombre; i++) {
+        uint32_t id = r->ev[i].syscall;
+        if (id >= LATENCE_SYSCALLS) continue;
+        nb[id]++;
+    }
+    for (int id = 0; id < LATENCE_SYSCALLS; id++)
+        if (nb[id]) durees[id] = malloc(nb[id] * sizeof(uint64_t));
+    memset(nb, 0, LATENCE_SYSCALLS * sizeof(size_t));
+
+    uint64_t aberrantes = 0;
+    for (size_t i = 0; i < r->nombre; i++) {
+        const evenement_t *e = &r->ev[i];
+        if (latence_aberrante(e->duree_ns, seuil)) aberrantes++;
+        if (e->syscall >= LATENCE_SYSCALLS) continue;
+        char *cle = maps + (size_t)e->syscall * (size_t)cpus * HIST_PAS_CPU;
+        latence_hist_ajouter((struct latence_hist *)(cle + e->cpu * HIST_PAS_CPU), e->duree_ns);
+        durees[e->syscall][nb[e->syscall]++] = e->duree_ns;
+    }
+
+    static const double percentiles[] = { 50, 90, 99, 99.9 };
+    static ligne_t lignes[LATENCE_SYSCALLS];
+    int k = 0;
+    /* Attendu : ce que le generateur a injecte, si l'enregistrement vient
+       de lui avec le meme seuil ; un enregistrement reel n'a pas de reference */
+    bool ok = !r->genere || r->seuil_ns != seuil || aberrantes == r->injectees;
+    if (!ok) printf("  aberrantes : %llu, injectees %llu\n", (unsigned long long)aberrantes,
+                    (unsigned long long)r->injectees);
+    for (int id = 0; id < LATENCE_SYSCALLS && ok; id++) {
+        struct latence_hist h;
+        hist_fusionner(maps + (size_t)id * (size_t)cpus * HIST_PAS_CPU, cpus, &h);
+        uint64_t total = 0, max = 0, dans_cases = 0;
+        for (size_t j = 0; j < nb[id]; j++) {
+            total += durees[id][j];
+            if (durees[id][j] > max) max = durees[id][j];
+        }
+        for (int s = 0; s < LATENCE_SLOTS; s++) dans_cases += h.slots[s];
+        if (h.count != nb[id] || dans_cases != nb[id] || h.total_ns != total || h.max_ns != max) {
+            printf("  syscall %d : fusion incoherente\n", id);
+            ok = false;
+            break;
+        }
+        if (!nb[id]) continue;
+        qsort(durees[id], nb[id], sizeof(uint64_t), comparer_u64);
+        for (size_t p = 0; p < sizeof(percentiles) / sizeof(percentiles[0]); p++) {
+            int c;
+            uint64_t estime = hist_percentile(&h, percentiles[p], &c);
+            size_t rang = (size_t)ceil(percentiles[p] / 100.0 * (double)nb[id]);
+            if (rang < 1) rang = 1;
+            uint64_t exact = durees[id][rang - 1];
+            if (!dans_case(exact, c) || !dans_case(estime, c) || estime > max) {
+                printf("  syscall %d p%g : exact %llu, estime %llu, case %d\n", id, percentiles[p],
+                       (unsigned long long)exact, (unsigned long long)estime, c);
+                ok = false;
+            }
+        }
+        lignes[k].id = (uint32_t)id;
+        lignes[k].h = h;
+        k++;
+    }
+
+    if (afficher && ok) {
+        char s[16];
+        printf("  %zu evenements, %d CPU, %d syscalls, %llu aberrantes (> %s) -> ringbuf\n\n", r->nombre,
+               cpus, k, (unsigned long long)aberrantes, hist_duree(seuil, s, sizeof(s)));
+        qsort(lignes, (size_t)k, sizeof(ligne_t), comparer_lignes);
+        hist_entete_tableau(stdout);
+        for (int i = 0; i < k && i < 10; i++) hist_ligne_tableau(stdout, lignes[i].id, &lignes[i].h);
+        for (int i = 0; i < k; i++) {
+            if (lignes[i].id != 202) continue;      /* futex : bimodal */
+            printf("\nfutex :\n");
+            hist_afficher(stdout, &lignes[i].h);
+        }
+    }
+
+    for (int id = 0; id < LATENCE_SYSCALLS; id++) free(durees[id]);
+    free(durees);
+    free(nb);
+    free(maps);
+    return ok;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage : %s [-s seuil_us] [enregistrement ...]\n"
+                    "        %s -g enregistrement [-n evenements] [-c cpus]\n", prog, prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *sortie = NULL;
+    size_t n = 500000;
+    int cpus = 8, opt;
+    uint64_t seuil = LATENCE_SEUIL_DEFAUT;
+    while ((opt = getopt(argc, argv, "g:n:c:s:h")) != -1) {
+        switch (opt) {
+        case 'g': sortie = optarg; break;
+        case 'n': n = (size_t)atol(optarg); break;
+        case 'c': cpus = atoi(optarg) > 0 && atoi(optarg) <= CPUS_MAX ? atoi(optarg) : 8; break;
+        case 's': seuil = (uint64_t)(atof(optarg) * 1e3); break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (sortie) {
+        enregistrement_t r = { 0 };
+        if (generer(&r, n, cpus, seuil) == -1 || ecrire_enregistrement(&r, sortie) != 0) {
+            perror(sortie);
+            return 1;
+        }
+        printf("%zu evenements sur %d CPU ecrits dans %s\n", r.nombre, cpus, sortie);
+        free(r.ev);
+        return 0;
+    }
+
+    bool limites = verifier_limites();
+    printf("Cases log2 (valeurs limites, 0..2^20) : %s\n", limites ? "ok" : "ECHEC");
+    bool ok = limites;
+
+    if (optind == argc) {
+        enregistrement_t r = { 0 };
+        if (generer(&r, n, cpus, seuil) == -1) return 1;
+        printf("Enregistrement synthetique :\n");
+        bool b = rejouer(&r, seuil, true);
+        printf("  => %s\n", b ? "ok" : "ECHEC");
+        ok = ok && b;
+        free(r.ev);
+    }
+    for (int i = optind; i < argc; i++) {
+        enregistrement_t r = { 0 };
+        if (lire_enregistrement(&r, argv[i]) == -1) {
+            printf("%s : illisible (%s)\n", argv[i], strerror(errno));
+            ok = false;
+            continue;
+        }
+        printf("%s :\n", argv[i]);
+        bool b = rejouer(&r, seuil, true);
+        printf("  => %s\n", b ? "ok" : "ECHEC");
+        ok = ok && b;
+        free(r.ev);
+    }
+
+    printf("\nVerification : %s\n", ok ? "cases, fusion par CPU, totaux, aberrantes et percentiles coherents"
+                                     : "ECHEC");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,180 @@
+/* ============================================================================
+   Section 27.6 : Optimisations algorithmiques
+   Description : Benchmark qsort vs pdqsort type (comparateur inline) vs
+                 radix LSD vs tri parallele, sur distributions aleatoire,
+                 triee, inversee et avec nombreux doublons
+   Fichier source : 06-optimisations-algorithmiques.md
+   ============================================================================ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sort_lib.h"
+
+#define TAILLE_MIN 10000
+#define TAILLE_DEFAUT 1000000
+
+#define LESS_SCALAIRE(a, b) ((a) < (b))
+
+SORT_DEFINE(tri_i32, int32_t, LESS_SCALAIRE)
+SORT_DEFINE_PARALLEL(tri_i32, int32_t, LESS_SCALAIRE)
+
+static sort_pool_t *pool;
+
+typedef enum { ALEATOIRE, TRIEE, INVERSEE, DOUBLONS, NB_DISTRIBUTIONS } distribution_t;
+
+static const char *noms_distributions[NB_DISTRIBUTIONS] = {
+    "aleatoire", "triee", "inversee", "doublons"
+};
+
+/* Generateur xorshift64 : rapide et reproductible */
+static uint64_t etat_rng = 88172645463325252ull;
+
+static uint32_t rng(void) {
+    etat_rng ^= etat_rng << 13;
+    etat_rng ^= etat_rng >> 7;
+    etat_rng ^= etat_rng << 17;
+    return (uint32_t)(etat_rng >> 32);
+}
+
+static void generer(int32_t *tab, size_t n, distribution_t d) {
+    for (size_t i = 0; i < n; i++) {
+        switch (d) {
+        case ALEATOIRE: tab[i] = (int32_t)rng(); break;
+        case TRIEE:     tab[i] = (int32_t)i; break;
+        case INVERSEE:  tab[i] = (int32_t)(n - i); break;
+        default:        tab[i] = (int32_t)(rng() % 100); break;
+        }
+    }
+}
+
+/* Comparateur classique pour qsort (sans debordement) */
+static int compare_int32(const void *a, const void *b) {
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void tri_qsort(int32_t *tab, size_t n) {
+    qsort(tab, n, sizeof(int32_t), compare_int32);
+}
+
+static void tri_pdq(int32_t *tab, size_t n) {
+    tri_i32_sort(tab, n);
+}
+
+static void tri_radix(int32_t *tab, size_t n) {
+    if (radix_sort_i32(tab, n) != 0) {
+        fprintf(stderr, "Erreur allocation (radix)\n");
+        exit(1);
+    }
+}
+
+static void tri_parallele(int32_t *tab, size_t n) {
+    if (tri_i32_parallel_sort(pool, tab, n) != 0) {
+        fprintf(stderr, "Erreur allocation (parallele)\n");
+        exit(1);
+    }
+}
+
+typedef struct {
+    const char *nom;
+    void (*trier)(int32_t *tab, size_t n);
+} algo_t;
+
+static const algo_t algos[] = {
+    { "qsort",     tri_qsort },
+    { "pdqsort",   tri_pdq },
+    { "radix",     tri_radix },
+    { "parallele", tri_parallele },
+};
+
+#define NB_ALGOS (sizeof(algos) / sizeof(algos[0]))
+
+static double maintenant(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t somme_controle(const int32_t *tab, size_t n) {
+    uint64_t s = 0;
+    for (size_t i = 0; i < n; i++) s += (uint32_t)tab[i];
+    return s;
+}
+
+static int est_trie(const int32_t *tab, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (tab[i] < tab[i - 1]) return 0;
+    }
+    return 1;
+}
+
+static int verifier_flottants(void) {
+    float f[] = { 3.5f, -0.0f, -7.25f, 1e30f, -1e30f, 0.0f, 2.0f, -2.0f };
+    size_t n = sizeof(f) / sizeof(f[0]);
+    if (radix_sort_f32(f, n) != 0) return 0;
+    for (size_t i = 1; i < n; i++) {
+        if (f[i] < f[i - 1]) return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[]) {
+    size_t n_max = argc > 1 ? strtoull(argv[1], NULL, 10) : TAILLE_DEFAUT;
+    int nb_threads = argc > 2 ? atoi(argv[2]) : 0;
+    if (n_max < TAILLE_MIN) n_max = TAILLE_MIN;
+
+    pool = sort_pool_create(nb_threads);
+    int32_t *original = malloc(n_max * sizeof(int32_t));
+    int32_t *travail = malloc(n_max * sizeof(int32_t));
+    if (!pool || !original || !travail) {
+        fprintf(stderr, "Erreur allocation\n");
+        return 1;
+    }
+
+    printf("=== Benchmark de tri (int32, %d threads) ===\n",
+           sort_pool_size(pool));
+    printf("%-12s %-10s %-10s %12s %14s\n",
+           "Taille", "Donnees", "Algo", "Temps (ms)", "Melem/s");
+
+    int erreurs = 0;
+    for (size_t n = TAILLE_MIN;; n *= 10) {
+        if (n > n_max) n = n_max;
+        for (int d = 0; d < NB_DISTRIBUTIONS; d++) {
+            generer(original, n, (distribution_t)d);
+            uint64_t controle = somme_controle(original, n);
+
+            for (size_t a = 0; a < NB_ALGOS; a++) {
+                memcpy(travail, original, n * sizeof(int32_t));
+
+                double debut = maintenant();
+                algos[a].trier(travail, n);
+                double duree = maintenant() - debut;
+
+                int ok = est_trie(travail, n)
+                      && somme_controle(travail, n) == controle;
+                erreurs += !ok;
+
+                printf("%-12zu %-10s %-10s %12.2f %14.1f%s\n",
+                       n, noms_distributions[d], algos[a].nom,
+                       duree * 1000.0, (double)n / duree / 1e6,
+                       ok ? "" : "  ERREUR");
+            }
+        }
+        if (n >= n_max) break;
+    }
+
+    printf("\nRadix flottants (negatifs, -0.0, 1e30) : %s\n",
+           verifier_flottants() ? "OK" : "ERREUR");
+    printf("Verification : %s\n", erreurs == 0 ? "tous les tris sont corrects"
+                                               : "ECHEC");
+
+    free(original);
+    free(travail);
+    sort_pool_destroy(pool);
+    return erreurs == 0 ? 0 : 1;
+}
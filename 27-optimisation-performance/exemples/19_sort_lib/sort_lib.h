@@ -0,0 +1,420 @@
+/* ============================================================================
+   Section 27.6 : Optimisations algorithmiques
+   Description : Bibliotheque de tri typee - pdqsort genere par macro avec
+                 comparateur inline, tri radix LSD (entiers et flottants) et
+                 tri parallele par echantillonnage sur un pool de threads
+   Fichier source : 06-optimisations-algorithmiques.md
+   ============================================================================ */
+
+#ifndef SORT_LIB_H
+#define SORT_LIB_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* --------------------------------------------------------------------------
+   Tri radix LSD (sort_radix.c)
+   Chiffres de 8 bits, une passe de comptage pour tous les chiffres, passes
+   inutiles sautees. Les cles signees et flottantes sont transformees en
+   cles non signees ordonnees a la volee. Retour : 0, ou -1 si malloc echoue.
+   -------------------------------------------------------------------------- */
+
+int radix_sort_u32(uint32_t *tab, size_t n);
+int radix_sort_i32(int32_t *tab, size_t n);
+int radix_sort_f32(float *tab, size_t n);
+int radix_sort_u64(uint64_t *tab, size_t n);
+int radix_sort_i64(int64_t *tab, size_t n);
+int radix_sort_f64(double *tab, size_t n);
+
+/* --------------------------------------------------------------------------
+   Pool de threads fork-join (sort_pool.c)
+   sort_pool_run() execute tache(ctx, i) pour i dans [0, nb_taches) sur les
+   workers et le thread appelant, puis attend la fin de toutes les taches.
+   -------------------------------------------------------------------------- */
+
+typedef struct sort_pool sort_pool_t;
+
+sort_pool_t *sort_pool_create(int nb_threads);   /* 0 = nombre de coeurs */
+void sort_pool_destroy(sort_pool_t *pool);
+int sort_pool_size(const sort_pool_t *pool);
+void sort_pool_run(sort_pool_t *pool, void (*tache)(void *ctx, size_t i),
+                   void *ctx, size_t nb_taches);
+
+/* --------------------------------------------------------------------------
+   SORT_DEFINE(name, T, LESS) : genere name##_sort(T *tab, size_t n)
+
+   pdqsort (pattern-defeating quicksort) : mediane de 3 / ninther, partition
+   sans bornes, detection des tableaux deja partitionnes, partition des
+   doublons a gauche, melange des motifs en cas de partition desequilibree
+   et repli sur heapsort (garantie O(n log n)).
+
+   LESS(a, b) est une macro d'expression : le comparateur est inline, sans
+   appel indirect comme avec qsort().
+   -------------------------------------------------------------------------- */
+
+#define SORT_SEUIL_INSERTION 24
+#define SORT_SEUIL_NINTHER   128
+#define SORT_LIMITE_PARTIEL  8
+
+#define SORT_DEFINE(name, T, LESS)                                            \
+                                                                              \
+static inline void name##_swap(T *a, T *b) {                                  \
+    T tmp = *a;                                                               \
+    *a = *b;                                                                  \
+    *b = tmp;                                                                 \
+}                                                                             \
+                                                                              \
+static inline void name##_sort2(T *a, T *b) {                                 \
+    if (LESS(*b, *a)) name##_swap(a, b);                                      \
+}                                                                             \
+                                                                              \
+static inline void name##_sort3(T *a, T *b, T *c) {                           \
+    name##_sort2(a, b);                                                       \
+    name##_sort2(b, c);                                                       \
+    name##_sort2(a, b);                                                       \
+}                                                                             \
+                                                                              \
+/* Insertion avec borne : utilisee sur la partition la plus a gauche */       \
+static inline void name##_insertion(T *debut, T *fin) {                       \
+    if (debut == fin) return;                                                 \
+    for (T *cur = debut + 1; cur != fin; cur++) {                             \
+        T *sift = cur;                                                        \
+        T *sift_1 = cur - 1;                                                  \
+        if (LESS(*sift, *sift_1)) {                                           \
+            T tmp = *sift;                                                    \
+            do {                                                              \
+                *sift-- = *sift_1;                                            \
+            } while (sift != debut && LESS(tmp, *--sift_1));                  \
+            *sift = tmp;                                                      \
+        }                                                                     \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+/* Insertion sans borne : debut[-1] est <= a tous les elements */            \
+static inline void name##_insertion_nb(T *debut, T *fin) {                    \
+    if (debut == fin) return;                                                 \
+    for (T *cur = debut + 1; cur != fin; cur++) {                             \
+        T *sift = cur;                                                        \
+        T *sift_1 = cur - 1;                                                  \
+        if (LESS(*sift, *sift_1)) {                                           \
+            T tmp = *sift;                                                    \
+            do {                                                              \
+                *sift-- = *sift_1;                                            \
+            } while (LESS(tmp, *--sift_1));                                   \
+            *sift = tmp;                                                      \
+        }                                                                     \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+/* Insertion abandonnee apres SORT_LIMITE_PARTIEL deplacements */            \
+static inline int name##_insertion_partielle(T *debut, T *fin) {              \
+    if (debut == fin) return 1;                                               \
+    size_t limite = 0;                                                        \
+    for (T *cur = debut + 1; cur != fin; cur++) {                             \
+        T *sift = cur;                                                        \
+        T *sift_1 = cur - 1;                                                  \
+        if (LESS(*sift, *sift_1)) {                                           \
+            T tmp = *sift;                                                    \
+            do {                                                              \
+                *sift-- = *sift_1;                                            \
+            } while (sift != debut && LESS(tmp, *--sift_1));                  \
+            *sift = tmp;                                                      \
+            limite += (size_t)(cur - sift);                                   \
+        }                                                                     \
+        if (limite > SORT_LIMITE_PARTIEL) return 0;                           \
+    }                                                                         \
+    return 1;                                                                 \
+}                                                                             \
+                                                                              \
+static void name##_tamiser(T *tab, size_t racine, size_t n) {                 \
+    T val = tab[racine];                                                      \
+    size_t enfant;                                                            \
+    while ((enfant = 2 * racine + 1) < n) {                                   \
+        if (enfant + 1 < n && LESS(tab[enfant], tab[enfant + 1])) enfant++;   \
+        if (!LESS(val, tab[enfant])) break;                                   \
+        tab[racine] = tab[enfant];                                            \
+        racine = enfant;                                                      \
+    }                                                                         \
+    tab[racine] = val;                                                        \
+}                                                                             \
+                                                                              \
+static void name##_heapsort(T *debut, T *fin) {                               \
+    size_t n = (size_t)(fin - debut);                                         \
+    for (size_t i = n / 2; i-- > 0;) name##_tamiser(debut, i, n);            \
+    for (size_t i = n; i-- > 1;) {                                            \
+        name##_swap(&debut[0], &debut[i]);                                    \
+        name##_tamiser(debut, 0, i);                                          \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+/* Elements egaux au pivot envoyes a gauche (pivot = borne inferieure) */    \
+static inline T *name##_partition_gauche(T *debut, T *fin) {                  \
+    T pivot = *debut;                                                         \
+    T *first = debut;                                                         \
+    T *last = fin;                                                            \
+    while (LESS(pivot, *--last)) {}                                           \
+    if (last + 1 == fin) {                                                    \
+        while (first < last && !LESS(pivot, *++first)) {}                     \
+    } else {                                                                  \
+        while (!LESS(pivot, *++first)) {}                                     \
+    }                                                                         \
+    while (first < last) {                                                    \
+        name##_swap(first, last);                                             \
+        while (LESS(pivot, *--last)) {}                                       \
+        while (!LESS(pivot, *++first)) {}                                     \
+    }                                                                         \
+    *debut = *last;                                                           \
+    *last = pivot;                                                            \
+    return last;                                                              \
+}                                                                             \
+                                                                              \
+/* Partition classique ; *deja indique qu'aucun echange n'a ete necessaire */ \
+static inline T *name##_partition_droite(T *debut, T *fin, int *deja) {       \
+    T pivot = *debut;                                                         \
+    T *first = debut;                                                         \
+    T *last = fin;                                                            \
+    while (LESS(*++first, pivot)) {}                                          \
+    if (first - 1 == debut) {                                                 \
+        while (first < last && !LESS(*--last, pivot)) {}                      \
+    } else {                                                                  \
+        while (!LESS(*--last, pivot)) {}                                      \
+    }                                                                         \
+    *deja = first >= last;                                                    \
+    while (first < last) {                                                    \
+        name##_swap(first, last);                                             \
+        while (LESS(*++first, pivot)) {}                                      \
+        while (!LESS(*--last, pivot)) {}                                      \
+    }                                                                         \
+    T *pos = first - 1;                                                       \
+    *debut = *pos;                                                            \
+    *pos = pivot;                                                             \
+    return pos;                                                               \
+}                                                                             \
+                                                                              \
+static void name##_boucle(T *debut, T *fin, int mauvais, int gauche) {        \
+    for (;;) {                                                                \
+        size_t n = (size_t)(fin - debut);                                     \
+        if (n < SORT_SEUIL_INSERTION) {                                       \
+            if (gauche) name##_insertion(debut, fin);                         \
+            else name##_insertion_nb(debut, fin);                             \
+            return;                                                           \
+        }                                                                     \
+                                                                              \
+        /* Choix du pivot : mediane de 3 ou pseudo-mediane de 9 */            \
+        size_t s2 = n / 2;                                                    \
+        if (n > SORT_SEUIL_NINTHER) {                                         \
+            name##_sort3(debut, debut + s2, fin - 1);                         \
+            name##_sort3(debut + 1, debut + (s2 - 1), fin - 2);               \
+            name##_sort3(debut + 2, debut + (s2 + 1), fin - 3);               \
+            name##_sort3(debut + (s2 - 1), debut + s2, debut + (s2 + 1));     \
+            name##_swap(debut, debut + s2);                                   \
+        } else {                                                              \
+            name##_sort3(debut + s2, debut, fin - 1);                         \
+        }                                                                     \
+                                                                              \
+        /* Pivot egal au predecesseur : sequence de doublons */              \
+        if (!gauche && !LESS(*(debut - 1), *debut)) {                         \
+            debut = name##_partition_gauche(debut, fin) + 1;                  \
+            continue;                                                         \
+        }                                                                     \
+                                                                              \
+        int deja;                                                             \
+        T *pos = name##_partition_droite(debut, fin, &deja);                  \
+        size_t n_g = (size_t)(pos - debut);                                   \
+        size_t n_d = (size_t)(fin - (pos + 1));                               \
+                                                                              \
+        if (n_g < n / 8 || n_d < n / 8) {                                     \
+            /* Partition desequilibree : casser le motif */                   \
+            if (--mauvais == 0) {                                             \
+                name##_heapsort(debut, fin);                                  \
+                return;                                                       \
+            }                                                                 \
+            if (n_g >= SORT_SEUIL_INSERTION) {                                \
+                name##_swap(debut, debut + n_g / 4);                          \
+                name##_swap(pos - 1, pos - n_g / 4);                          \
+                if (n_g > SORT_SEUIL_NINTHER) {                               \
+                    name##_swap(debut + 1, debut + (n_g / 4 + 1));            \
+                    name##_swap(debut + 2, debut + (n_g / 4 + 2));            \
+                    name##_swap(pos - 2, pos - (n_g / 4 + 1));                \
+                    name##_swap(pos - 3, pos - (n_g / 4 + 2));                \
+                }                                                             \
+            }                                                                 \
+            if (n_d >= SORT_SEUIL_INSERTION) {                                \
+                name##_swap(pos + 1, pos + (1 + n_d / 4));                    \
+                name##_swap(fin - 1, fin - n_d / 4);                          \
+                if (n_d > SORT_SEUIL_NINTHER) {                               \
+                    name##_swap(pos + 2, pos + (2 + n_d / 4));                \
+                    name##_swap(pos + 3, pos + (3 + n_d / 4));                \
+                    name##_swap(fin - 2, fin - (1 + n_d / 4));                \
+                    name##_swap(fin - 3, fin - (2 + n_d / 4));                \
+                }                                                             \
+            }                                                                 \
+        } else if (deja && name##_insertion_partielle(debut, pos)             \
+                        && name##_insertion_partielle(pos + 1, fin)) {        \
+            /* Deja partitionne et quasiment trie : termine */               \
+            return;                                                           \
+        }                                                                     \
+                                                                              \
+        name##_boucle(debut, pos, mauvais, gauche);                           \
+        debut = pos + 1;                                                      \
+        gauche = 0;                                                           \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static inline void name##_sort(T *tab, size_t n) {                            \
+    if (n < 2) return;                                                        \
+    int log2n = 0;                                                            \
+    for (size_t m = n; m > 1; m >>= 1) log2n++;                               \
+    name##_boucle(tab, tab + n, log2n, 1);                                    \
+}                                                                             \
+                                                                              \
+/* Premier indice i de [0, n) tel que !LESS(tab[i], val) */                  \
+static inline size_t name##_lower_bound(const T *tab, size_t n, T val) {      \
+    const T *base = tab;                                                      \
+    while (n > 1) {                                                           \
+        size_t moitie = n / 2;                                                \
+        base = LESS(base[moitie - 1], val) ? base + moitie : base;            \
+        n -= moitie;                                                          \
+    }                                                                         \
+    return (size_t)(base - tab) + (n == 1 && LESS(*base, val));               \
+}
+
+/* --------------------------------------------------------------------------
+   SORT_DEFINE_PARALLEL(name, T, LESS) : genere
+   int name##_parallel_sort(sort_pool_t *pool, T *tab, size_t n)
+
+   Tri par echantillonnage regulier (PSRS) : chaque worker trie un bloc avec
+   name##_sort, les separateurs sont choisis parmi des echantillons des blocs
+   tries, puis chaque worker fusionne (fusion k-voies par tas) sa tranche de
+   sortie. Necessite SORT_DEFINE(name, T, LESS) au prealable.
+   Retour : 0, ou -1 si l'allocation du tampon echoue.
+   -------------------------------------------------------------------------- */
+
+#define SORT_SEUIL_PARALLELE ((size_t)1 << 16)
+
+#define SORT_DEFINE_PARALLEL(name, T, LESS)                                   \
+                                                                              \
+typedef struct {                                                              \
+    T *tab;                                                                   \
+    T *tmp;                                                                   \
+    size_t p;          /* nombre de blocs = nombre de tranches */            \
+    size_t *bornes;    /* p + 1 bornes de blocs */                           \
+    size_t *coupes;    /* p x (p + 1) : debut de chaque tranche par bloc */  \
+    size_t *sorties;   /* p + 1 : debut de chaque tranche en sortie */       \
+} name##_par_t;                                                               \
+                                                                              \
+static void name##_par_trier(void *arg, size_t i) {                           \
+    name##_par_t *c = arg;                                                    \
+    name##_sort(c->tab + c->bornes[i], c->bornes[i + 1] - c->bornes[i]);      \
+}                                                                             \
+                                                                              \
+static void name##_par_fusionner(void *arg, size_t j) {                       \
+    name##_par_t *c = arg;                                                    \
+    size_t p = c->p;                                                          \
+    size_t tete[p], fin[p], tas[p];                                           \
+    size_t nb = 0;                                                            \
+    T *dst = c->tmp + c->sorties[j];                                          \
+                                                                              \
+    for (size_t i = 0; i < p; i++) {                                          \
+        tete[i] = c->coupes[i * (p + 1) + j];                                 \
+        fin[i] = c->coupes[i * (p + 1) + j + 1];                              \
+        if (tete[i] == fin[i]) continue;                                      \
+        /* Insertion dans le tas min des runs (cle = element de tete) */      \
+        size_t k = nb++;                                                      \
+        while (k > 0 && LESS(c->tab[tete[i]], c->tab[tete[tas[(k - 1) / 2]]])) { \
+            tas[k] = tas[(k - 1) / 2];                                        \
+            k = (k - 1) / 2;                                                  \
+        }                                                                     \
+        tas[k] = i;                                                           \
+    }                                                                         \
+                                                                              \
+    while (nb > 0) {                                                          \
+        size_t r = tas[0];                                                    \
+        *dst++ = c->tab[tete[r]++];                                           \
+        if (tete[r] == fin[r]) r = tas[--nb];                                 \
+        /* Descente de r depuis la racine */                                  \
+        size_t k = 0;                                                         \
+        for (;;) {                                                            \
+            size_t e = 2 * k + 1;                                             \
+            if (e >= nb) break;                                               \
+            if (e + 1 < nb                                                    \
+                && LESS(c->tab[tete[tas[e + 1]]], c->tab[tete[tas[e]]])) e++; \
+            if (!LESS(c->tab[tete[tas[e]]], c->tab[tete[r]])) break;          \
+            tas[k] = tas[e];                                                  \
+            k = e;                                                            \
+        }                                                                     \
+        if (nb > 0) tas[k] = r;                                               \
+    }                                                                         \
+}                                                                             \
+                                                                              \
+static void name##_par_recopier(void *arg, size_t j) {                        \
+    name##_par_t *c = arg;                                                    \
+    memcpy(c->tab + c->sorties[j], c->tmp + c->sorties[j],                    \
+           (c->sorties[j + 1] - c->sorties[j]) * sizeof(T));                  \
+}                                                                             \
+                                                                              \
+static inline int name##_parallel_sort(sort_pool_t *pool, T *tab, size_t n) { \
+    size_t p = (size_t)sort_pool_size(pool);                                  \
+    if (p < 2 || n < SORT_SEUIL_PARALLELE) {                                  \
+        name##_sort(tab, n);                                                  \
+        return 0;                                                             \
+    }                                                                         \
+                                                                              \
+    name##_par_t c = { .tab = tab, .p = p };                                  \
+    c.tmp = malloc(n * sizeof(T));                                            \
+    c.bornes = malloc((p + 1) * sizeof(size_t));                              \
+    c.coupes = malloc(p * (p + 1) * sizeof(size_t));                          \
+    c.sorties = malloc((p + 1) * sizeof(size_t));                             \
+    T *echant = malloc(p * (p - 1) * sizeof(T));                              \
+    if (!c.tmp || !c.bornes || !c.coupes || !c.sorties || !echant) {          \
+        free(c.tmp); free(c.bornes); free(c.coupes);                          \
+        free(c.sorties); free(echant);                                        \
+        return -1;                                                            \
+    }                                                                         \
+                                                                              \
+    /* 1. Tri local de p blocs contigus */                                    \
+    for (size_t i = 0; i <= p; i++) c.bornes[i] = n * i / p;                  \
+    sort_pool_run(pool, name##_par_trier, &c, p);                             \
+                                                                              \
+    /* 2. Echantillonnage regulier puis choix de p - 1 separateurs */        \
+    for (size_t i = 0; i < p; i++) {                                          \
+        size_t taille = c.bornes[i + 1] - c.bornes[i];                        \
+        for (size_t k = 1; k < p; k++) {                                      \
+            echant[i * (p - 1) + (k - 1)] = tab[c.bornes[i] + taille * k / p]; \
+        }                                                                     \
+    }                                                                         \
+    name##_sort(echant, p * (p - 1));                                         \
+                                                                              \
+    /* 3. Decoupe de chaque bloc selon les separateurs */                    \
+    for (size_t i = 0; i < p; i++) {                                          \
+        size_t *ligne = c.coupes + i * (p + 1);                               \
+        size_t taille = c.bornes[i + 1] - c.bornes[i];                        \
+        ligne[0] = c.bornes[i];                                               \
+        ligne[p] = c.bornes[i + 1];                                           \
+        for (size_t k = 1; k < p; k++) {                                      \
+            T sep = echant[k * (p - 1)];                                      \
+            ligne[k] = c.bornes[i]                                            \
+                     + name##_lower_bound(tab + c.bornes[i], taille, sep);    \
+        }                                                                     \
+    }                                                                         \
+    c.sorties[0] = 0;                                                         \
+    for (size_t j = 0; j < p; j++) {                                          \
+        size_t total = 0;                                                     \
+        for (size_t i = 0; i < p; i++) {                                      \
+            total += c.coupes[i * (p + 1) + j + 1] - c.coupes[i * (p + 1) + j]; \
+        }                                                                     \
+        c.sorties[j + 1] = c.sorties[j] + total;                              \
+    }                                                                         \
+                                                                              \
+    /* 4. Fusion k-voies de chaque tranche, puis recopie */                  \
+    sort_pool_run(pool, name##_par_fusionner, &c, p);                         \
+    sort_pool_run(pool, name##_par_recopier, &c, p);                          \
+                                                                              \
+    free(c.tmp); free(c.bornes); free(c.coupes);                              \
+    free(c.sorties); free(echant);                                            \
+    return 0;                                                                 \
+}
+
+#endif /* SORT_LIB_H */
@@ -0,0 +1,146 @@
+/* ============================================================================
+   Section 27.6 : Optimisations algorithmiques
+   Description : Pool de threads persistant fork-join utilise par le tri
+                 parallele - distribution dynamique des taches par compteur
+                 atomique, le thread appelant participe au calcul
+   Fichier source : 06-optimisations-algorithmiques.md
+   ============================================================================ */
+
+#define _DEFAULT_SOURCE
+
+#include "sort_lib.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+struct sort_pool {
+    pthread_t *threads;
+    int nb_threads;             /* workers + thread appelant */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond_travail;
+    pthread_cond_t cond_fin;
+    unsigned long generation;   /* incrementee a chaque sort_pool_run() */
+    int actifs;                 /* workers encore dans le lot courant */
+    int arret;
+
+    void (*tache)(void *ctx, size_t i);
+    void *ctx;
+    size_t nb_taches;
+    atomic_size_t suivante;
+};
+
+/* Consomme les taches du lot courant jusqu'a epuisement */
+static void executer_lot(sort_pool_t *pool) {
+    for (;;) {
+        size_t i = atomic_fetch_add_explicit(&pool->suivante, 1,
+                                             memory_order_relaxed);
+        if (i >= pool->nb_taches) break;
+        pool->tache(pool->ctx, i);
+    }
+}
+
+static void *worker(void *arg) {
+    sort_pool_t *pool = arg;
+    unsigned long vue = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+    for (;;) {
+        while (!pool->arret && pool->generation == vue) {
+            pthread_cond_wait(&pool->cond_travail, &pool->mutex);
+        }
+        if (pool->arret) break;
+        vue = pool->generation;
+        pthread_mutex_unlock(&pool->mutex);
+
+        executer_lot(pool);
+
+        pthread_mutex_lock(&pool->mutex);
+        if (--pool->actifs == 0) {
+            pthread_cond_signal(&pool->cond_fin);
+        }
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+sort_pool_t *sort_pool_create(int nb_threads) {
+    if (nb_threads <= 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        nb_threads = n > 0 ? (int)n : 1;
+    }
+
+    sort_pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+
+    pool->nb_threads = nb_threads;
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond_travail, NULL);
+    pthread_cond_init(&pool->cond_fin, NULL);
+    atomic_init(&pool->suivante, 0);
+
+    pool->threads = malloc((size_t)nb_threads * sizeof(pthread_t));
+    if (!pool->threads) {
+        free(pool);
+        return NULL;
+    }
+
+    /* Le thread appelant compte comme un worker */
+    for (int i = 0; i < nb_threads - 1; i++) {
+        if (pthread_create(&pool->threads[i], NULL, worker, pool) != 0) {
+            pool->nb_threads = i + 1;
+            break;
+        }
+    }
+    return pool;
+}
+
+void sort_pool_destroy(sort_pool_t *pool) {
+    if (!pool) return;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->arret = 1;
+    pthread_cond_broadcast(&pool->cond_travail);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->nb_threads - 1; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+
+    pthread_cond_destroy(&pool->cond_fin);
+    pthread_cond_destroy(&pool->cond_travail);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool->threads);
+    free(pool);
+}
+
+int sort_pool_size(const sort_pool_t *pool) {
+    return pool ? pool->nb_threads : 1;
+}
+
+void sort_pool_run(sort_pool_t *pool, void (*tache)(void *ctx, size_t i),
+                   void *ctx, size_t nb_taches) {
+    if (!pool || pool->nb_threads < 2) {
+        for (size_t i = 0; i < nb_taches; i++) tache(ctx, i);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->tache = tache;
+    pool->ctx = ctx;
+    pool->nb_taches = nb_taches;
+    atomic_store_explicit(&pool->suivante, 0, memory_order_relaxed);
+    pool->actifs = pool->nb_threads - 1;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->cond_travail);
+    pthread_mutex_unlock(&pool->mutex);
+
+    executer_lot(pool);
+
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->actifs > 0) {
+        pthread_cond_wait(&pool->cond_fin, &pool->mutex);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+}
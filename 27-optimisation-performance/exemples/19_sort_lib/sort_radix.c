@@ -0,0 +1,176 @@
+/* ============================================================================
+   Section 27.6 : Optimisations algorithmiques
+   Description : Tri radix LSD 8 bits pour cles entieres et flottantes
+                 (32 et 64 bits) - O(n) par passe, sans comparaison
+   Fichier source : 06-optimisations-algorithmiques.md
+   ============================================================================ */
+
+#include "sort_lib.h"
+
+#define RADIX_BITS     8
+#define RADIX_BUCKETS  (1 << RADIX_BITS)
+
+/* Transformation des bits bruts en cle non signee ordonnee */
+enum { CLE_NON_SIGNEE, CLE_SIGNEE, CLE_FLOTTANTE };
+
+static inline uint32_t cle32(uint32_t bits, int mode) {
+    switch (mode) {
+    case CLE_SIGNEE:
+        return bits ^ 0x80000000u;
+    case CLE_FLOTTANTE:
+        /* Negatif : inverser tous les bits ; positif : inverser le signe */
+        return bits ^ (uint32_t)(-(int32_t)(bits >> 31) | 0x80000000u);
+    default:
+        return bits;
+    }
+}
+
+static inline uint64_t cle64(uint64_t bits, int mode) {
+    switch (mode) {
+    case CLE_SIGNEE:
+        return bits ^ 0x8000000000000000u;
+    case CLE_FLOTTANTE:
+        return bits ^ (uint64_t)(-(int64_t)(bits >> 63) | INT64_MIN);
+    default:
+        return bits;
+    }
+}
+
+/* Acces par memcpy : pas de violation d'aliasing pour float/double */
+static inline uint32_t lire32(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t lire64(const unsigned char *p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* Sautee si tous les elements ont le meme chiffre a cette position */
+static int passe_utile(const size_t *hist, size_t n) {
+    for (int b = 0; b < RADIX_BUCKETS; b++) {
+        if (hist[b] == n) return 0;
+        if (hist[b] != 0) return 1;
+    }
+    return 1;
+}
+
+static inline int radix_lsd32(unsigned char *tab, size_t n, int mode) {
+    if (n < 2) return 0;
+
+    unsigned char *tmp = malloc(n * sizeof(uint32_t));
+    if (!tmp) return -1;
+
+    /* Un seul parcours pour les histogrammes des 4 chiffres */
+    size_t hist[4][RADIX_BUCKETS] = {{0}};
+    for (size_t i = 0; i < n; i++) {
+        uint32_t k = cle32(lire32(tab + i * 4), mode);
+        hist[0][k & 0xFF]++;
+        hist[1][(k >> 8) & 0xFF]++;
+        hist[2][(k >> 16) & 0xFF]++;
+        hist[3][k >> 24]++;
+    }
+
+    unsigned char *src = tab;
+    unsigned char *dst = tmp;
+    for (int d = 0; d < 4; d++) {
+        if (!passe_utile(hist[d], n)) continue;
+
+        size_t pos[RADIX_BUCKETS];
+        size_t somme = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            pos[b] = somme;
+            somme += hist[d][b];
+        }
+
+        int decalage = d * RADIX_BITS;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t brut = lire32(src + i * 4);
+            uint32_t b = (cle32(brut, mode) >> decalage) & 0xFF;
+            memcpy(dst + pos[b]++ * 4, &brut, 4);
+        }
+
+        unsigned char *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != tab) memcpy(tab, src, n * sizeof(uint32_t));
+    free(tmp);
+    return 0;
+}
+
+static inline int radix_lsd64(unsigned char *tab, size_t n, int mode) {
+    if (n < 2) return 0;
+
+    unsigned char *tmp = malloc(n * sizeof(uint64_t));
+    if (!tmp) return -1;
+
+    size_t (*hist)[RADIX_BUCKETS] = calloc(8, sizeof(*hist));
+    if (!hist) {
+        free(tmp);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint64_t k = cle64(lire64(tab + i * 8), mode);
+        for (int d = 0; d < 8; d++) {
+            hist[d][(k >> (d * RADIX_BITS)) & 0xFF]++;
+        }
+    }
+
+    unsigned char *src = tab;
+    unsigned char *dst = tmp;
+    for (int d = 0; d < 8; d++) {
+        if (!passe_utile(hist[d], n)) continue;
+
+        size_t pos[RADIX_BUCKETS];
+        size_t somme = 0;
+        for (int b = 0; b < RADIX_BUCKETS; b++) {
+            pos[b] = somme;
+            somme += hist[d][b];
+        }
+
+        int decalage = d * RADIX_BITS;
+        for (size_t i = 0; i < n; i++) {
+            uint64_t brut = lire64(src + i * 8);
+            uint64_t b = (cle64(brut, mode) >> decalage) & 0xFF;
+            memcpy(dst + pos[b]++ * 8, &brut, 8);
+        }
+
+        unsigned char *t = src;
+        src = dst;
+        dst = t;
+    }
+
+    if (src != tab) memcpy(tab, src, n * sizeof(uint64_t));
+    free(hist);
+    free(tmp);
+    return 0;
+}
+
+int radix_sort_u32(uint32_t *tab, size_t n) {
+    return radix_lsd32((unsigned char *)tab, n, CLE_NON_SIGNEE);
+}
+
+int radix_sort_i32(int32_t *tab, size_t n) {
+    return radix_lsd32((unsigned char *)tab, n, CLE_SIGNEE);
+}
+
+int radix_sort_f32(float *tab, size_t n) {
+    return radix_lsd32((unsigned char *)tab, n, CLE_FLOTTANTE);
+}
+
+int radix_sort_u64(uint64_t *tab, size_t n) {
+    return radix_lsd64((unsigned char *)tab, n, CLE_NON_SIGNEE);
+}
+
+int radix_sort_i64(int64_t *tab, size_t n) {
+    return radix_lsd64((unsigned char *)tab, n, CLE_SIGNEE);
+}
+
+int radix_sort_f64(double *tab, size_t n) {
+    return radix_lsd64((unsigned char *)tab, n, CLE_FLOTTANTE);
+}
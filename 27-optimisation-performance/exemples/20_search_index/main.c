@@ -0,0 +1,169 @@
+/* ============================================================================
+   Section 27.4 : Cache awareness
+   Description : Debit de recherche (requetes/s) de la dichotomie classique
+                 de 08_test_recherche.c vs lower_bound sans branche, Eytzinger
+                 et S+ tree (unitaire et par lots), de 1K a 1G cles
+   Fichier source : 04-cache-awareness.md
+   ============================================================================ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "search_index.h"
+
+#define TAILLE_MIN 1000
+#define TAILLE_DEFAUT 10000000
+#define NB_REQUETES (1 << 20)
+
+/* Recherche dichotomique de 08_test_recherche.c (egalite exacte) */
+static int recherche_dichotomique(const int32_t *tableau, int taille, int32_t cible) {
+    int gauche = 0;
+    int droite = taille - 1;
+
+    while (gauche <= droite) {
+        int milieu = gauche + (droite - gauche) / 2;
+
+        if (tableau[milieu] == cible) {
+            return milieu;
+        }
+
+        if (tableau[milieu] < cible) {
+            gauche = milieu + 1;
+        } else {
+            droite = milieu - 1;
+        }
+    }
+
+    return -1;
+}
+
+static uint64_t etat_rng = 88172645463325252ull;
+
+static uint32_t rng(void) {
+    etat_rng ^= etat_rng << 13;
+    etat_rng ^= etat_rng >> 7;
+    etat_rng ^= etat_rng << 17;
+    return (uint32_t)(etat_rng >> 32);
+}
+
+static double maintenant(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+static uint64_t somme_resultats(const int32_t *res, size_t m) {
+    uint64_t s = 0;
+    for (size_t i = 0; i < m; i++) s = s * 31 + (uint32_t)res[i];
+    return s;
+}
+
+static void afficher(size_t n, const char *nom, double duree, int ok) {
+    printf("%-12zu %-20s %10.1f %12.1f%s\n", n, nom,
+           duree * 1e9 / NB_REQUETES, NB_REQUETES / duree / 1e6,
+           ok ? "" : "  ERREUR");
+}
+
+int main(int argc, char *argv[]) {
+    size_t n_max = argc > 1 ? strtoull(argv[1], NULL, 10) : TAILLE_DEFAUT;
+    if (n_max < TAILLE_MIN) n_max = TAILLE_MIN;
+
+    int32_t *tri = malloc(n_max * sizeof(int32_t));
+    int32_t *req = malloc(NB_REQUETES * sizeof(int32_t));
+    int32_t *res = malloc(NB_REQUETES * sizeof(int32_t));
+    if (!tri || !req || !res) {
+        fprintf(stderr, "Erreur allocation\n");
+        return 1;
+    }
+
+    printf("=== Debit de recherche (%d requetes aleatoires) ===\n", NB_REQUETES);
+    printf("%-12s %-20s %10s %12s\n", "Cles", "Methode", "ns/req", "Mreq/s");
+
+    int erreurs = 0;
+    for (size_t n = TAILLE_MIN;; n *= 10) {
+        if (n > n_max) n = n_max;
+
+        /* Cles triees distinctes, ecarts de 1 ou 2 (tient en int32 pour 1G) */
+        int32_t v = 0;
+        for (size_t i = 0; i < n; i++) {
+            v += 1 + (int32_t)(rng() & 1);
+            tri[i] = v;
+        }
+        for (size_t i = 0; i < NB_REQUETES; i++) {
+            req[i] = (int32_t)(rng() % ((uint32_t)v + 2));
+        }
+
+        search_index_t *idx = search_index_create(tri, n);
+        if (!idx) {
+            fprintf(stderr, "Erreur allocation (index)\n");
+            return 1;
+        }
+
+        double debut = maintenant();
+        long trouves = 0;
+        for (size_t i = 0; i < NB_REQUETES; i++) {
+            trouves += recherche_dichotomique(tri, (int)n, req[i]) >= 0;
+        }
+        afficher(n, "dichotomique (08)", maintenant() - debut, trouves > 0);
+
+        debut = maintenant();
+        for (size_t i = 0; i < NB_REQUETES; i++) {
+            res[i] = si_sorted_lower_bound(tri, n, req[i]);
+        }
+        afficher(n, "sans branche", maintenant() - debut, 1);
+        uint64_t reference = somme_resultats(res, NB_REQUETES);
+
+        debut = maintenant();
+        for (size_t i = 0; i < NB_REQUETES; i++) {
+            res[i] = si_eytzinger_lower_bound(idx, req[i]);
+        }
+        double duree = maintenant() - debut;
+        int ok = somme_resultats(res, NB_REQUETES) == reference;
+        afficher(n, "eytzinger+prefetch", duree, ok);
+        erreurs += !ok;
+
+        debut = maintenant();
+        si_eytzinger_batch(idx, req, NB_REQUETES, res);
+        duree = maintenant() - debut;
+        ok = somme_resultats(res, NB_REQUETES) == reference;
+        afficher(n, "eytzinger lots", duree, ok);
+        erreurs += !ok;
+
+        debut = maintenant();
+        for (size_t i = 0; i < NB_REQUETES; i++) {
+            res[i] = si_stree_lower_bound(idx, req[i]);
+        }
+        duree = maintenant() - debut;
+        ok = somme_resultats(res, NB_REQUETES) == reference;
+#ifdef __AVX2__
+        afficher(n, "s+tree avx2", duree, ok);
+#else
+        afficher(n, "s+tree scalaire", duree, ok);
+#endif
+        erreurs += !ok;
+
+        debut = maintenant();
+        si_stree_batch(idx, req, NB_REQUETES, res);
+        duree = maintenant() - debut;
+        ok = somme_resultats(res, NB_REQUETES) == reference;
+        afficher(n, "s+tree lots", duree, ok);
+        erreurs += !ok;
+
+        printf("%-12s index : %.1f Mo (tableau trie : %.1f Mo)\n", "",
+               (double)search_index_memory(idx) / 1e6,
+               (double)(n * sizeof(int32_t)) / 1e6);
+        search_index_destroy(idx);
+
+        if (n >= n_max) break;
+    }
+
+    printf("\nVerification : %s\n", erreurs == 0 ? "resultats identiques"
+                                               : "ECHEC");
+
+    free(tri);
+    free(req);
+    free(res);
+    return erreurs == 0 ? 0 : 1;
+}
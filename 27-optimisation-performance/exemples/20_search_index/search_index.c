@@ -0,0 +1,249 @@
+/* ============================================================================
+   Section 27.4 : Cache awareness
+   Description : Implementation de l'index de recherche statique
+                 - Eytzinger : tableau en ordre de parcours en largeur, les
+                   descendants a 4 niveaux tiennent dans une ligne de cache
+                 - S+ tree : B-arbre implicite, feuilles = tableau trie,
+                   noeuds internes de 16 cles alignes sur 64 octets
+   Fichier source : 04-cache-awareness.md
+   ============================================================================ */
+
+#include "search_index.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+#define SI_HAUTEUR_MAX 16
+#define SI_ALIGNEMENT 64
+
+struct search_index {
+    size_t n;
+    int32_t *eytz;                     /* n + 1 cles, eytz[0] = SI_AUCUNE */
+    int32_t *btree;
+    size_t btree_taille;
+    int hauteur;
+    size_t offsets[SI_HAUTEUR_MAX + 1]; /* debut de chaque couche (0 = feuilles) */
+};
+
+/* aligned_alloc exige une taille multiple de l'alignement */
+static int32_t *allouer_aligne(size_t nb) {
+    size_t octets = nb * sizeof(int32_t);
+    octets = (octets + SI_ALIGNEMENT - 1) / SI_ALIGNEMENT * SI_ALIGNEMENT;
+    return aligned_alloc(SI_ALIGNEMENT, octets ? octets : SI_ALIGNEMENT);
+}
+
+/* ---------------------------------------------------------------------------
+   Eytzinger
+   --------------------------------------------------------------------------- */
+
+/* Remplissage en ordre infixe : le noeud k a pour enfants 2k et 2k+1 */
+static size_t construire_eytzinger(int32_t *t, size_t n, const int32_t *tri,
+                                   size_t i, size_t k) {
+    if (k <= n) {
+        i = construire_eytzinger(t, n, tri, i, 2 * k);
+        t[k] = tri[i++];
+        i = construire_eytzinger(t, n, tri, i, 2 * k + 1);
+    }
+    return i;
+}
+
+/* Remonte au dernier noeud ou l'on est parti a gauche (cle >= x) */
+static inline size_t eytzinger_resultat(size_t k) {
+    return k >> (__builtin_ctzll(~(unsigned long long)k) + 1);
+}
+
+int32_t si_eytzinger_lower_bound(const search_index_t *idx, int32_t x) {
+    const int32_t *t = idx->eytz;
+    size_t k = 1;
+    while (k <= idx->n) {
+        /* Les 16 descendants a 4 niveaux sont contigus : t[16k .. 16k+15] */
+        __builtin_prefetch(t + k * SI_B);
+        k = 2 * k + (t[k] < x);
+    }
+    return t[eytzinger_resultat(k)];
+}
+
+void si_eytzinger_batch(const search_index_t *idx, const int32_t *req,
+                        size_t m, int32_t *res) {
+    const int32_t *t = idx->eytz;
+    size_t n = idx->n;
+
+    /* Niveaux complets : tous les noeuds 1 .. 2^complets - 1 existent */
+    int complets = 0;
+    while (((size_t)1 << (complets + 1)) - 1 <= n) complets++;
+
+    for (size_t debut = 0; debut < m; debut += SI_LOT) {
+        size_t nb = m - debut < SI_LOT ? m - debut : SI_LOT;
+        size_t k[SI_LOT];
+        for (size_t j = 0; j < nb; j++) k[j] = 1;
+
+        /* Les SI_LOT descentes avancent en parallele : leurs defauts de
+           cache se recouvrent au lieu de s'enchainer */
+        for (int h = 0; h < complets; h++) {
+            for (size_t j = 0; j < nb; j++) {
+                __builtin_prefetch(t + k[j] * SI_B);
+                k[j] = 2 * k[j] + (t[k[j]] < req[debut + j]);
+            }
+        }
+        for (size_t j = 0; j < nb; j++) {
+            if (k[j] <= n) k[j] = 2 * k[j] + (t[k[j]] < req[debut + j]);
+            res[debut + j] = t[eytzinger_resultat(k[j])];
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   S+ tree (B-arbre implicite)
+   --------------------------------------------------------------------------- */
+
+static size_t nb_blocs(size_t n) {
+    return (n + SI_B - 1) / SI_B;
+}
+
+/* Nombre de cles de la couche parente */
+static size_t cles_parent(size_t n) {
+    return (nb_blocs(n) + SI_B) / (SI_B + 1) * SI_B;
+}
+
+/* Nombre de cles < x dans un noeud trie de SI_B cles */
+static inline unsigned rang_noeud(const int32_t *noeud, int32_t x) {
+#ifdef __AVX2__
+    __m256i xv = _mm256_set1_epi32(x);
+    __m256i a = _mm256_load_si256((const __m256i *)noeud);
+    __m256i b = _mm256_load_si256((const __m256i *)(noeud + 8));
+    unsigned masque_a = (unsigned)_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(xv, a)));
+    unsigned masque_b = (unsigned)_mm256_movemask_ps(
+        _mm256_castsi256_ps(_mm256_cmpgt_epi32(xv, b)));
+    return (unsigned)__builtin_popcount(masque_a | (masque_b << 8));
+#else
+    unsigned rang = 0;
+    for (int j = 0; j < SI_B; j++) {
+        rang += noeud[j] < x;
+    }
+    return rang;
+#endif
+}
+
+static int construire_btree(search_index_t *idx, const int32_t *tri) {
+    /* Une cle sentinelle en fin de feuilles : le successeur du dernier
+       bloc existe toujours */
+    size_t n = idx->n + 1;
+
+    idx->hauteur = 1;
+    for (size_t c = n; c > SI_B; c = cles_parent(c)) idx->hauteur++;
+    if (idx->hauteur > SI_HAUTEUR_MAX) return -1;
+
+    size_t c = n;
+    idx->offsets[0] = 0;
+    for (int h = 0; h < idx->hauteur; h++) {
+        idx->offsets[h + 1] = idx->offsets[h] + nb_blocs(c) * SI_B;
+        c = cles_parent(c);
+    }
+    idx->btree_taille = idx->offsets[idx->hauteur];
+
+    int32_t *bt = allouer_aligne(idx->btree_taille);
+    if (!bt) return -1;
+    idx->btree = bt;
+
+    /* Couche 0 : le tableau trie, complete par des sentinelles */
+    memcpy(bt, tri, idx->n * sizeof(int32_t));
+    for (size_t i = idx->n; i < idx->offsets[1]; i++) bt[i] = SI_AUCUNE;
+
+    /* Cle j du noeud k = plus petite cle du sous-arbre droit (j + 1) */
+    for (int h = 1; h < idx->hauteur; h++) {
+        size_t taille = idx->offsets[h + 1] - idx->offsets[h];
+        for (size_t i = 0; i < taille; i++) {
+            size_t k = i / SI_B;
+            size_t j = i - k * SI_B;
+            k = k * (SI_B + 1) + j + 1;
+            for (int l = 1; l < h; l++) k *= SI_B + 1;
+            bt[idx->offsets[h] + i] = k * SI_B < n ? bt[k * SI_B] : SI_AUCUNE;
+        }
+    }
+    return 0;
+}
+
+int32_t si_stree_lower_bound(const search_index_t *idx, int32_t x) {
+    const int32_t *bt = idx->btree;
+    size_t k = 0;
+    for (int h = idx->hauteur - 1; h > 0; h--) {
+        unsigned i = rang_noeud(bt + idx->offsets[h] + k, x);
+        k = k * (SI_B + 1) + (size_t)i * SI_B;
+    }
+    return bt[k + rang_noeud(bt + k, x)];
+}
+
+void si_stree_batch(const search_index_t *idx, const int32_t *req,
+                    size_t m, int32_t *res) {
+    const int32_t *bt = idx->btree;
+
+    for (size_t debut = 0; debut < m; debut += SI_LOT) {
+        size_t nb = m - debut < SI_LOT ? m - debut : SI_LOT;
+        size_t k[SI_LOT] = {0};
+
+        for (int h = idx->hauteur - 1; h > 0; h--) {
+            for (size_t j = 0; j < nb; j++) {
+                unsigned i = rang_noeud(bt + idx->offsets[h] + k[j],
+                                        req[debut + j]);
+                k[j] = k[j] * (SI_B + 1) + (size_t)i * SI_B;
+                __builtin_prefetch(bt + idx->offsets[h - 1] + k[j]);
+            }
+        }
+        for (size_t j = 0; j < nb; j++) {
+            res[debut + j] = bt[k[j] + rang_noeud(bt + k[j], req[debut + j])];
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   Tableau trie
+   --------------------------------------------------------------------------- */
+
+int32_t si_sorted_lower_bound(const int32_t *tri, size_t n, int32_t x) {
+    if (n == 0) return SI_AUCUNE;
+    const int32_t *base = tri;
+    const int32_t *fin = tri + n;
+    while (n > 1) {
+        size_t moitie = n / 2;
+        /* Avance arithmetique : aucun saut a predire */
+        base += (size_t)(base[moitie - 1] < x) * moitie;
+        n -= moitie;
+    }
+    base += *base < x;
+    return base < fin ? *base : SI_AUCUNE;
+}
+
+/* ---------------------------------------------------------------------------
+   Construction / destruction
+   --------------------------------------------------------------------------- */
+
+search_index_t *search_index_create(const int32_t *tri, size_t n) {
+    search_index_t *idx = calloc(1, sizeof(*idx));
+    if (!idx) return NULL;
+    idx->n = n;
+
+    idx->eytz = allouer_aligne(n + 1);
+    if (!idx->eytz || construire_btree(idx, tri) != 0) {
+        search_index_destroy(idx);
+        return NULL;
+    }
+    idx->eytz[0] = SI_AUCUNE;
+    construire_eytzinger(idx->eytz, n, tri, 0, 1);
+    return idx;
+}
+
+void search_index_destroy(search_index_t *idx) {
+    if (!idx) return;
+    free(idx->eytz);
+    free(idx->btree);
+    free(idx);
+}
+
+size_t search_index_memory(const search_index_t *idx) {
+    return (idx->n + 1 + idx->btree_taille) * sizeof(int32_t);
+}
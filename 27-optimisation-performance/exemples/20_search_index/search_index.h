@@ -0,0 +1,47 @@
+/* ============================================================================
+   Section 27.4 : Cache awareness
+   Description : Index de recherche statique - dispositions Eytzinger et
+                 B-arbre implicite (S+ tree) construites depuis un tableau
+                 trie, requetes lower_bound sans branche, avec prefetch,
+                 AVX2 et par lots
+   Fichier source : 04-cache-awareness.md
+   ============================================================================ */
+
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Nombre de cles par noeud du S+ tree : 16 x int32 = une ligne de cache */
+#define SI_B 16
+
+/* Valeur renvoyee quand aucune cle n'est >= x */
+#define SI_AUCUNE INT32_MAX
+
+/* Taille des lots de requetes entrelacees */
+#define SI_LOT 16
+
+typedef struct search_index search_index_t;
+
+/* Construction depuis un tableau trie (copie : le tableau reste a l'appelant) */
+search_index_t *search_index_create(const int32_t *tri, size_t n);
+void search_index_destroy(search_index_t *idx);
+size_t search_index_memory(const search_index_t *idx);
+
+/* Toutes les requetes renvoient la plus petite cle >= x, ou SI_AUCUNE */
+
+/* Recherche dichotomique sans branche sur le tableau trie lui-meme */
+int32_t si_sorted_lower_bound(const int32_t *tri, size_t n, int32_t x);
+
+/* Eytzinger (parcours en largeur) : sans branche + prefetch 4 niveaux */
+int32_t si_eytzinger_lower_bound(const search_index_t *idx, int32_t x);
+void si_eytzinger_batch(const search_index_t *idx, const int32_t *req,
+                        size_t m, int32_t *res);
+
+/* S+ tree : noeuds de SI_B cles, comparaison AVX2 si disponible */
+int32_t si_stree_lower_bound(const search_index_t *idx, int32_t x);
+void si_stree_batch(const search_index_t *idx, const int32_t *req,
+                    size_t m, int32_t *res);
+
+#endif /* SEARCH_INDEX_H */
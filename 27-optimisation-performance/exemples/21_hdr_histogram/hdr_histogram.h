@@ -0,0 +1,266 @@
+/* ============================================================================
+   Section 27.10 : Benchmarking
+   Description : Histogramme de latence log-lineaire facon HdrHistogram
+                 (bibliotheque header-only)
+                 - precision de 1 a 5 chiffres significatifs, memoire fixe
+                   independante du nombre d'echantillons
+                 - enregistrement wait-free : un histogramme par thread,
+                   compteurs atomiques a ecrivain unique (load + store)
+                 - fusion, instantanes par intervalle, percentiles
+   Fichier source : 10-benchmarking.md
+   ============================================================================ */
+
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Decoupage log-lineaire (meme indexation que HdrHistogram) :
+   chaque puissance de 2 (bucket) est divisee en sous_nb_demi sous-buckets
+   lineaires, avec sous_nb = 2^ceil(log2(2 * 10^chiffres)). L'erreur
+   relative de toute valeur enregistree est donc < 10^-chiffres. */
+typedef struct {
+    int64_t plus_petite;            /* plus petite valeur distinguable */
+    int64_t plus_grande;            /* au-dela : valeur ecretee */
+    int chiffres;
+    int unite_magnitude;
+    int sous_demi_magnitude;
+    int32_t sous_nb;
+    int32_t sous_nb_demi;
+    int64_t sous_masque;
+    int32_t nb_buckets;
+    int32_t nb_compteurs;
+    atomic_uint_least64_t *compteurs;
+} hdr_histogram_t;
+
+static inline int hdr_log2_plafond(int64_t v) {
+    int r = 0;
+    while (((int64_t)1 << r) < v) r++;
+    return r;
+}
+
+/* Retour : 0, ou -1 si parametres invalides ou malloc echoue */
+static inline int hdr_init(hdr_histogram_t *h, int64_t plus_petite,
+                           int64_t plus_grande, int chiffres) {
+    if (plus_petite < 1 || chiffres < 1 || chiffres > 5
+        || plus_grande < 2 * plus_petite) {
+        return -1;
+    }
+    memset(h, 0, sizeof(*h));
+    h->plus_petite = plus_petite;
+    h->plus_grande = plus_grande;
+    h->chiffres = chiffres;
+
+    int64_t plus_grande_unitaire = 2;
+    for (int i = 0; i < chiffres; i++) plus_grande_unitaire *= 10;
+
+    /* unite_magnitude = floor(log2(plus_petite)) */
+    while (((int64_t)2 << h->unite_magnitude) <= plus_petite) h->unite_magnitude++;
+    h->sous_demi_magnitude = hdr_log2_plafond(plus_grande_unitaire) - 1;
+    h->sous_nb = (int32_t)1 << (h->sous_demi_magnitude + 1);
+    h->sous_nb_demi = h->sous_nb / 2;
+    h->sous_masque = ((int64_t)h->sous_nb - 1) << h->unite_magnitude;
+
+    /* Nombre de buckets pour couvrir plus_grande */
+    int64_t plus_petite_non_couverte = (int64_t)h->sous_nb << h->unite_magnitude;
+    int32_t nb = 1;
+    while (plus_petite_non_couverte <= plus_grande) {
+        if (plus_petite_non_couverte > INT64_MAX / 2) {
+            nb++;
+            break;
+        }
+        plus_petite_non_couverte <<= 1;
+        nb++;
+    }
+    h->nb_buckets = nb;
+    h->nb_compteurs = (nb + 1) * h->sous_nb_demi;
+
+    h->compteurs = calloc((size_t)h->nb_compteurs, sizeof(*h->compteurs));
+    return h->compteurs ? 0 : -1;
+}
+
+static inline void hdr_liberer(hdr_histogram_t *h) {
+    free(h->compteurs);
+    h->compteurs = NULL;
+}
+
+static inline size_t hdr_memoire(const hdr_histogram_t *h) {
+    return sizeof(*h) + (size_t)h->nb_compteurs * sizeof(*h->compteurs);
+}
+
+static inline int32_t hdr_index(const hdr_histogram_t *h, int64_t v) {
+    if (v < 0) v = 0;
+    if (v > h->plus_grande) v = h->plus_grande;
+    int puissance = 64 - __builtin_clzll((unsigned long long)(v | h->sous_masque));
+    int bucket = puissance - h->unite_magnitude - (h->sous_demi_magnitude + 1);
+    int32_t sous = (int32_t)(v >> (bucket + h->unite_magnitude));
+    return ((bucket + 1) << h->sous_demi_magnitude) + (sous - h->sous_nb_demi);
+}
+
+/* Plus petite valeur representee par le compteur i */
+static inline int64_t hdr_valeur_index(const hdr_histogram_t *h, int32_t i) {
+    int bucket = (i >> h->sous_demi_magnitude) - 1;
+    int32_t sous = (i & (h->sous_nb_demi - 1)) + h->sous_nb_demi;
+    if (bucket < 0) {
+        sous -= h->sous_nb_demi;
+        bucket = 0;
+    }
+    return (int64_t)sous << (bucket + h->unite_magnitude);
+}
+
+/* Plus grande valeur equivalente (meme compteur) a celle du compteur i */
+static inline int64_t hdr_valeur_haute_index(const hdr_histogram_t *h, int32_t i) {
+    int bucket = (i >> h->sous_demi_magnitude) - 1;
+    if (bucket < 0) bucket = 0;
+    return hdr_valeur_index(h, i) + ((int64_t)1 << (bucket + h->unite_magnitude)) - 1;
+}
+
+/* Enregistrement wait-free par l'unique thread proprietaire de h */
+static inline void hdr_enregistrer(hdr_histogram_t *h, int64_t v) {
+    atomic_uint_least64_t *c = &h->compteurs[hdr_index(h, v)];
+    atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
+/* Enregistrement lock-free depuis plusieurs threads (RMW atomique) */
+static inline void hdr_enregistrer_partage(hdr_histogram_t *h, int64_t v) {
+    atomic_fetch_add_explicit(&h->compteurs[hdr_index(h, v)], 1,
+                              memory_order_relaxed);
+}
+
+static inline void hdr_reinitialiser(hdr_histogram_t *h) {
+    for (int32_t i = 0; i < h->nb_compteurs; i++) {
+        atomic_store_explicit(&h->compteurs[i], 0, memory_order_relaxed);
+    }
+}
+
+/* dst += src ; les deux histogrammes doivent avoir la meme configuration */
+static inline void hdr_fusionner(hdr_histogram_t *dst, const hdr_histogram_t *src) {
+    for (int32_t i = 0; i < dst->nb_compteurs; i++) {
+        uint64_t v = atomic_load_explicit(&src->compteurs[i], memory_order_relaxed);
+        if (v) {
+            uint64_t d = atomic_load_explicit(&dst->compteurs[i], memory_order_relaxed);
+            atomic_store_explicit(&dst->compteurs[i], d + v, memory_order_relaxed);
+        }
+    }
+}
+
+static inline uint64_t hdr_total(const hdr_histogram_t *h) {
+    uint64_t total = 0;
+    for (int32_t i = 0; i < h->nb_compteurs; i++) {
+        total += atomic_load_explicit(&h->compteurs[i], memory_order_relaxed);
+    }
+    return total;
+}
+
+/* Valeur au percentile p (0..100) : plus grande valeur equivalente du
+   compteur ou la somme cumulee atteint p % des echantillons */
+static inline int64_t hdr_percentile(const hdr_histogram_t *h, double p) {
+    uint64_t total = hdr_total(h);
+    if (total == 0) return 0;
+    if (p > 100.0) p = 100.0;
+    uint64_t cible = (uint64_t)(p / 100.0 * (double)total + 0.5);
+    if (cible < 1) cible = 1;
+
+    uint64_t cumul = 0;
+    for (int32_t i = 0; i < h->nb_compteurs; i++) {
+        cumul += atomic_load_explicit(&h->compteurs[i], memory_order_relaxed);
+        if (cumul >= cible) return hdr_valeur_haute_index(h, i);
+    }
+    return h->plus_grande;
+}
+
+static inline int64_t hdr_min(const hdr_histogram_t *h) {
+    for (int32_t i = 0; i < h->nb_compteurs; i++) {
+        if (atomic_load_explicit(&h->compteurs[i], memory_order_relaxed)) {
+            return hdr_valeur_index(h, i);
+        }
+    }
+    return 0;
+}
+
+static inline int64_t hdr_max(const hdr_histogram_t *h) {
+    for (int32_t i = h->nb_compteurs; i-- > 0;) {
+        if (atomic_load_explicit(&h->compteurs[i], memory_order_relaxed)) {
+            return hdr_valeur_haute_index(h, i);
+        }
+    }
+    return 0;
+}
+
+/* Ligne de resume : les valeurs sont divisees par 'diviseur' (ex. 1000
+   pour afficher des microsecondes a partir de nanosecondes) */
+static inline void hdr_afficher(const hdr_histogram_t *h, FILE *f,
+                                const char *libelle, const char *unite,
+                                double diviseur) {
+    fprintf(f, "%s n=%llu p50=%.1f%s p99=%.1f%s p99.9=%.1f%s max=%.1f%s\n",
+            libelle, (unsigned long long)hdr_total(h),
+            (double)hdr_percentile(h, 50.0) / diviseur, unite,
+            (double)hdr_percentile(h, 99.0) / diviseur, unite,
+            (double)hdr_percentile(h, 99.9) / diviseur, unite,
+            (double)hdr_max(h) / diviseur, unite);
+}
+
+/* ---------------------------------------------------------------------------
+   Enregistreur multi-threads : un histogramme par thread (ecriture
+   wait-free), fusion a la lecture, instantanes par intervalle calcules
+   par difference avec l'instantane cumule precedent (compteurs monotones,
+   aucun echange de tampon ni verrou cote ecrivain).
+   --------------------------------------------------------------------------- */
+
+typedef struct {
+    int nb_threads;
+    hdr_histogram_t *par_thread;
+    hdr_histogram_t precedent;      /* cumul lors du dernier intervalle */
+} hdr_enregistreur_t;
+
+static inline int hdr_enregistreur_init(hdr_enregistreur_t *r, int nb_threads,
+                                        int64_t plus_petite, int64_t plus_grande,
+                                        int chiffres) {
+    r->nb_threads = nb_threads;
+    r->par_thread = calloc((size_t)nb_threads, sizeof(hdr_histogram_t));
+    if (!r->par_thread) return -1;
+    for (int i = 0; i < nb_threads; i++) {
+        if (hdr_init(&r->par_thread[i], plus_petite, plus_grande, chiffres) != 0) {
+            return -1;
+        }
+    }
+    return hdr_init(&r->precedent, plus_petite, plus_grande, chiffres);
+}
+
+static inline void hdr_enregistreur_liberer(hdr_enregistreur_t *r) {
+    for (int i = 0; i < r->nb_threads; i++) hdr_liberer(&r->par_thread[i]);
+    free(r->par_thread);
+    hdr_liberer(&r->precedent);
+}
+
+/* Histogramme reserve au thread 'id' (a passer a hdr_enregistrer) */
+static inline hdr_histogram_t *hdr_enregistreur_thread(hdr_enregistreur_t *r, int id) {
+    return &r->par_thread[id];
+}
+
+/* dst (meme configuration, remis a zero) = cumul de tous les threads */
+static inline void hdr_enregistreur_cumul(const hdr_enregistreur_t *r,
+                                          hdr_histogram_t *dst) {
+    hdr_reinitialiser(dst);
+    for (int i = 0; i < r->nb_threads; i++) hdr_fusionner(dst, &r->par_thread[i]);
+}
+
+/* dst = echantillons enregistres depuis l'intervalle precedent */
+static inline void hdr_enregistreur_intervalle(hdr_enregistreur_t *r,
+                                               hdr_histogram_t *dst) {
+    hdr_enregistreur_cumul(r, dst);
+    for (int32_t i = 0; i < dst->nb_compteurs; i++) {
+        uint64_t cumul = atomic_load_explicit(&dst->compteurs[i], memory_order_relaxed);
+        uint64_t avant = atomic_load_explicit(&r->precedent.compteurs[i],
+                                              memory_order_relaxed);
+        atomic_store_explicit(&r->precedent.compteurs[i], cumul, memory_order_relaxed);
+        atomic_store_explicit(&dst->compteurs[i], cumul - avant, memory_order_relaxed);
+    }
+}
+
+#endif /* HDR_HISTOGRAM_H */
@@ -0,0 +1,121 @@
+/* ============================================================================
+   Section 27.10 : Benchmarking
+   Description : Demonstration de l'histogramme de latence HDR
+                 - verification de la precision (3 chiffres significatifs)
+                 - 4 threads mesurent une operation malloc/memset/free,
+                   instantanes par intervalle toutes les 200 ms puis
+                   percentiles cumules p50/p99/p99.9
+   Fichier source : 10-benchmarking.md
+   ============================================================================ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include "hdr_histogram.h"
+
+#define NB_THREADS 4
+#define NB_INTERVALLES 5
+#define INTERVALLE_MS 200
+
+/* 1 ns a 60 s, 3 chiffres significatifs */
+#define PLUS_PETITE 1
+#define PLUS_GRANDE 60000000000LL
+#define CHIFFRES 3
+
+static hdr_enregistreur_t enregistreur;
+static atomic_bool arret;
+
+static int64_t maintenant_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *travailleur(void *arg) {
+    int id = (int)(long)arg;
+    hdr_histogram_t *h = hdr_enregistreur_thread(&enregistreur, id);
+    unsigned int seed = (unsigned int)id + 1;
+
+    while (!atomic_load_explicit(&arret, memory_order_relaxed)) {
+        size_t taille = 64 + (size_t)(rand_r(&seed) % 65536);
+
+        int64_t debut = maintenant_ns();
+        char *p = malloc(taille);
+        if (p) {
+            memset(p, id, taille);
+            free(p);
+        }
+        hdr_enregistrer(h, maintenant_ns() - debut);
+    }
+    return NULL;
+}
+
+/* Compare les percentiles a la valeur exacte sur 1..1000000 */
+static int verifier_precision(void) {
+    hdr_histogram_t h;
+    if (hdr_init(&h, PLUS_PETITE, PLUS_GRANDE, CHIFFRES) != 0) return 0;
+    for (int64_t v = 1; v <= 1000000; v++) hdr_enregistrer(&h, v);
+
+    double pires = 0.0;
+    const double ps[] = { 50.0, 90.0, 99.0, 99.9, 99.99 };
+    for (size_t i = 0; i < sizeof(ps) / sizeof(ps[0]); i++) {
+        double exacte = ps[i] / 100.0 * 1000000.0;
+        double erreur = ((double)hdr_percentile(&h, ps[i]) - exacte) / exacte;
+        if (erreur < 0) erreur = -erreur;
+        if (erreur > pires) pires = erreur;
+    }
+    printf("Precision : erreur relative max %.4f%% (limite 0.1%%), memoire %zu octets\n",
+           pires * 100.0, hdr_memoire(&h));
+    hdr_liberer(&h);
+    return pires < 0.001;
+}
+
+int main(void) {
+    int ok = verifier_precision();
+
+    hdr_histogram_t intervalle, cumul;
+    if (hdr_enregistreur_init(&enregistreur, NB_THREADS,
+                              PLUS_PETITE, PLUS_GRANDE, CHIFFRES) != 0
+        || hdr_init(&intervalle, PLUS_PETITE, PLUS_GRANDE, CHIFFRES) != 0
+        || hdr_init(&cumul, PLUS_PETITE, PLUS_GRANDE, CHIFFRES) != 0) {
+        fprintf(stderr, "Erreur allocation\n");
+        return 1;
+    }
+
+    pthread_t threads[NB_THREADS];
+    for (long i = 0; i < NB_THREADS; i++) {
+        pthread_create(&threads[i], NULL, travailleur, (void *)i);
+    }
+
+    printf("\n=== Latence malloc/memset/free (%d threads) ===\n", NB_THREADS);
+    for (int i = 0; i < NB_INTERVALLES; i++) {
+        usleep(INTERVALLE_MS * 1000);
+        char libelle[32];
+        snprintf(libelle, sizeof(libelle), "Intervalle %d :", i + 1);
+        hdr_enregistreur_intervalle(&enregistreur, &intervalle);
+        hdr_afficher(&intervalle, stdout, libelle, "ns", 1.0);
+    }
+
+    atomic_store(&arret, true);
+    for (int i = 0; i < NB_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    hdr_enregistreur_cumul(&enregistreur, &cumul);
+    hdr_afficher(&cumul, stdout, "Cumul        :", "ns", 1.0);
+    printf("Memoire : %zu octets par histogramme, quel que soit n\n",
+           hdr_memoire(&cumul));
+    printf("Verification : %s\n", ok ? "precision respectee" : "ECHEC");
+
+    hdr_liberer(&intervalle);
+    hdr_liberer(&cumul);
+    hdr_enregistreur_liberer(&enregistreur);
+    return ok ? 0 : 1;
+}
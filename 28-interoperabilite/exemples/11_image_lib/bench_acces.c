@@ -0,0 +1,266 @@
+/* ============================================================================
+   Section 28.5 : extern "C" pour C++
+   Description : Banc d'essai des acces aux pixels a travers l'API C
+                 - remplissage et relecture d'une trame 4K : un appel par
+                   pixel, par ligne, par trame, ou tampon emprunte
+                 - import d'une trame existante : copie (image_write_rect)
+                   ou emballage sans copie (image_wrap) d'une zone mmap
+                 - filtres appliques dans la memoire emballee
+   Fichier source : 05-extern-c.md
+   ============================================================================ */
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <sys/mman.h>
+#include "image_lib.h"
+
+#define LARGEUR 3840
+#define HAUTEUR 2160
+#define REPETITIONS 5               /* meilleur temps retenu */
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Motif calcule par l'appelant, different pour chaque pixel */
+static inline uint32_t motif(int x, int y) {
+    return ((uint32_t)x * 0x9E3779B1u) ^ ((uint32_t)y * 0x85EBCA77u);
+}
+
+/* Somme ponderee par la position : detecte une ligne decalee ou permutee */
+static inline uint64_t melanger(uint64_t somme, uint32_t pixel, int x, int y) {
+    return somme + (uint64_t)pixel * (uint32_t)(2 * (x + y * LARGEUR) + 1);
+}
+
+/* ---------------------------------------------------------------------------
+   Remplissage
+   --------------------------------------------------------------------------- */
+
+static void remplir_pixel(Image *img, uint32_t *tampon) {
+    (void)tampon;
+    for (int y = 0; y < HAUTEUR; y++)
+        for (int x = 0; x < LARGEUR; x++) image_set_pixel(img, x, y, motif(x, y));
+}
+
+static void remplir_lignes(Image *img, uint32_t *tampon) {
+    for (int y = 0; y < HAUTEUR; y++) {
+        for (int x = 0; x < LARGEUR; x++) tampon[x] = motif(x, y);
+        image_write_rows(img, y, 1, tampon);
+    }
+}
+
+/* Trame complete preparee cote C, puis un seul appel */
+static void remplir_trame(Image *img, uint32_t *tampon) {
+    for (int y = 0; y < HAUTEUR; y++)
+        for (int x = 0; x < LARGEUR; x++) tampon[(size_t)y * LARGEUR + x] = motif(x, y);
+    image_write_rect(img, 0, 0, LARGEUR, HAUTEUR, tampon, LARGEUR);
+}
+
+static void remplir_emprunt(Image *img, uint32_t *tampon) {
+    (void)tampon;
+    int stride;
+    uint32_t *p = image_borrow_pixels(img, &stride);
+    for (int y = 0; y < HAUTEUR; y++, p += stride)
+        for (int x = 0; x < LARGEUR; x++) p[x] = motif(x, y);
+}
+
+/* ---------------------------------------------------------------------------
+   Relecture
+   --------------------------------------------------------------------------- */
+
+static uint64_t lire_pixel(Image *img, uint32_t *tampon) {
+    (void)tampon;
+    uint64_t s = 0;
+    for (int y = 0; y < HAUTEUR; y++)
+        for (int x = 0; x < LARGEUR; x++) s = melanger(s, image_get_pixel(img, x, y), x, y);
+    return s;
+}
+
+static uint64_t lire_lignes(Image *img, uint32_t *tampon) {
+    uint64_t s = 0;
+    for (int y = 0; y < HAUTEUR; y++) {
+        image_read_rows(img, y, 1, tampon);
+        for (int x = 0; x < LARGEUR; x++) s = melanger(s, tampon[x], x, y);
+    }
+    return s;
+}
+
+static uint64_t lire_trame(Image *img, uint32_t *tampon) {
+    uint64_t s = 0;
+    image_read_rect(img, 0, 0, LARGEUR, HAUTEUR, tampon, LARGEUR);
+    for (int y = 0; y < HAUTEUR; y++)
+        for (int x = 0; x < LARGEUR; x++) s = melanger(s, tampon[(size_t)y * LARGEUR + x], x, y);
+    return s;
+}
+
+static uint64_t lire_emprunt(Image *img, uint32_t *tampon) {
+    (void)tampon;
+    int stride;
+    const uint32_t *p = image_borrow_pixels(img, &stride);
+    uint64_t s = 0;
+    for (int y = 0; y < HAUTEUR; y++, p += stride)
+        for (int x = 0; x < LARGEUR; x++) s = melanger(s, p[x], x, y);
+    return s;
+}
+
+typedef struct {
+    const char *nom;
+    void (*remplir)(Image *, uint32_t *);     /* tampon : une trame */
+    uint64_t (*lire)(Image *, uint32_t *);
+} chemin_t;
+
+static const chemin_t chemins[] = {
+    { "image_set/get_pixel", remplir_pixel, lire_pixel },
+    { "image_write/read_rows (ligne)", remplir_lignes, lire_lignes },
+    { "image_write/read_rect (trame)", remplir_trame, lire_trame },
+    { "image_borrow_pixels", remplir_emprunt, lire_emprunt },
+};
+
+static void afficher(const char *nom, double remplir, double lire, double base_r, double base_l) {
+    double mpix = (double)LARGEUR * HAUTEUR / 1e6;
+    printf("%-32s %10.1f %10.1f %8.1fx %8.1fx\n", nom, mpix / remplir, mpix / lire, base_r / remplir,
+           base_l / lire);
+}
+
+/* ---------------------------------------------------------------------------
+   Memoire emballee
+   --------------------------------------------------------------------------- */
+
+static size_t taille_zone(int stride) {
+    return (size_t)stride * HAUTEUR * sizeof(uint32_t);
+}
+
+static void liberer_zone(uint32_t *pixels, void *user) {
+    munmap(pixels, *(size_t *)user);
+}
+
+/* Trame dans une zone mmap avec lignes rembourrees (stride > largeur) */
+static uint32_t *zone_trame(int stride) {
+    uint32_t *p = mmap(NULL, taille_zone(stride), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+    for (int y = 0; y < HAUTEUR; y++)
+        for (int x = 0; x < stride; x++) p[(size_t)y * stride + x] = x < LARGEUR ? motif(x, y) : 0xDEADBEEFu;
+    return p;
+}
+
+/* Memes filtres sur une image emballee et sur une copie possedee par la
+   bibliotheque : resultats identiques, rembourrage intact */
+static bool filtrer_emballee(uint32_t *zone, int stride, uint32_t *trame) {
+    Image *copie = image_create(LARGEUR, HAUTEUR);
+    Image *img = image_wrap(zone, LARGEUR, HAUTEUR, stride, NULL, NULL);
+    bool ok = copie && img && image_write_rect(copie, 0, 0, LARGEUR, HAUTEUR, zone, stride) == 0;
+    const char *filtres[] = { "invert", "blur", "sharpen" };
+    for (size_t i = 0; i < sizeof(filtres) / sizeof(filtres[0]) && ok; i++) {
+        image_apply_filter(img, filtres[i]);
+        image_apply_filter(copie, filtres[i]);
+    }
+    ok = ok && image_borrow_pixels(img, NULL) == zone && image_read_rows(copie, 0, HAUTEUR, trame) == 0;
+    for (int y = 0; y < HAUTEUR && ok; y++) {
+        const uint32_t *ligne = zone + (size_t)y * stride;
+        ok = memcmp(ligne, trame + (size_t)y * LARGEUR, LARGEUR * sizeof(uint32_t)) == 0;
+        for (int x = LARGEUR; x < stride && ok; x++) ok = ligne[x] == 0xDEADBEEFu;
+    }
+    image_destroy(img);
+    image_destroy(copie);
+    return ok;
+}
+
+int main(void) {
+    size_t n = (size_t)LARGEUR * HAUTEUR;
+    uint32_t *trame = malloc(n * sizeof(uint32_t));
+    Image *img = image_create(LARGEUR, HAUTEUR);
+    if (!trame || !img) {
+        fprintf(stderr, "Erreur: memoire\n");
+        return 1;
+    }
+
+    uint64_t attendu = 0;
+    for (int y = 0; y < HAUTEUR; y++)
+        for (int x = 0; x < LARGEUR; x++) attendu = melanger(attendu, motif(x, y), x, y);
+
+    printf("=== Acces aux pixels, trame %dx%d (%.1f Mpixels) ===\n", LARGEUR, HAUTEUR, (double)n / 1e6);
+    printf("Mpixels/s (meilleur de %d) ; gain par rapport a un appel par pixel\n\n", REPETITIONS);
+    printf("%-32s %10s %10s %9s %9s\n", "Chemin", "remplir", "relire", "gain r.", "gain l.");
+
+    bool ok = true;
+    double base_r = 0, base_l = 0;
+    for (size_t c = 0; c < sizeof(chemins) / sizeof(chemins[0]); c++) {
+        double t_r = 1e9, t_l = 1e9;
+        for (int r = 0; r < REPETITIONS; r++) {
+            memset(image_borrow_pixels(img, NULL), 0, n * sizeof(uint32_t));
+            double debut = secondes();
+            chemins[c].remplir(img, trame);
+            double t = secondes() - debut;
+            if (t < t_r) t_r = t;
+
+            /* Relecture par le chemin de reference : le remplissage est juste */
+            ok = ok && lire_emprunt(img, NULL) == attendu;
+
+            debut = secondes();
+            uint64_t s = chemins[c].lire(img, trame);
+            t = secondes() - debut;
+            if (t < t_l) t_l = t;
+            ok = ok && s == attendu;
+        }
+        if (c == 0) {
+            base_r = t_r;
+            base_l = t_l;
+        }
+        afficher(chemins[c].nom, t_r, t_l, base_r, base_l);
+    }
+
+    /* Import d'une trame deja en memoire (lignes rembourrees) */
+    const int stride = LARGEUR + 64;
+    uint32_t *zone = zone_trame(stride);
+    if (!zone) {
+        fprintf(stderr, "Erreur: mmap\n");
+        return 1;
+    }
+    double t_copie = 1e9, t_wrap = 1e9;
+    for (int r = 0; r < REPETITIONS; r++) {
+        double debut = secondes();
+        ok = ok && image_write_rect(img, 0, 0, LARGEUR, HAUTEUR, zone, stride) == 0;
+        double t = secondes() - debut;
+        if (t < t_copie) t_copie = t;
+        ok = ok && lire_emprunt(img, NULL) == attendu;
+
+        debut = secondes();
+        Image *vue = image_wrap(zone, LARGEUR, HAUTEUR, stride, NULL, NULL);
+        t = secondes() - debut;
+        if (t < t_wrap) t_wrap = t;
+        ok = ok && vue && lire_emprunt(vue, NULL) == attendu;
+        image_destroy(vue);
+    }
+    printf("\nImport d'une trame mmap (stride %d) :\n", stride);
+    printf("  image_write_rect (copie)     %10.3f ms\n", t_copie * 1e3);
+    printf("  image_wrap (sans copie)      %10.3f ms\n", t_wrap * 1e3);
+
+    bool filtres = filtrer_emballee(zone, stride, trame);
+    printf("  filtres sur la zone emballee : %s\n", filtres ? "identiques, rembourrage intact" : "DIFFERENTS");
+    ok = ok && filtres;
+
+    /* La zone est rendue par image_destroy */
+    size_t taille = taille_zone(stride);
+    Image *proprietaire = image_wrap(zone, LARGEUR, HAUTEUR, stride, liberer_zone, &taille);
+    ok = ok && proprietaire;
+    image_destroy(proprietaire);
+
+    /* Rectangles hors limites refuses en un seul controle */
+    bool bornes = image_write_rect(img, LARGEUR - 1, 0, 2, 1, trame, 2) == -1 &&
+                  image_read_rect(img, 0, HAUTEUR, LARGEUR, 1, trame, LARGEUR) == -1 &&
+                  image_read_rows(img, -1, 1, trame) == -1 && image_write_rect(img, 0, 0, 0, 0, trame, 0) == 0;
+    printf("  rectangles hors limites refuses : %s\n", bornes ? "oui" : "NON");
+    ok = ok && bornes;
+
+    image_destroy(img);
+    free(trame);
+    printf("\nVerification : %s\n", ok ? "tous les chemins relisent la trame ecrite" : "ECHEC");
+    return ok ? 0 : 1;
+}
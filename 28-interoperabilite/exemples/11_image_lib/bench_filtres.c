@@ -0,0 +1,400 @@
+/* ============================================================================
+   Section 28.5 : extern "C" pour C++
+   Description : Banc d'essai du pipeline de filtres (Mpixels/s)
+                 - reference : boucles C, une passe complete par filtre
+                   (comme l'ancien applyFilter)
+                 - pipeline : une passe par etape, puis etapes fusionnees
+                   par bande, sur 1 puis N threads
+                 - chaque resultat compare octet par octet a la reference
+   Fichier source : 05-extern-c.md
+   ============================================================================ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "image_lib.h"
+
+#define LARGEUR 3840
+#define HAUTEUR 2160
+#define REPETITIONS 3               /* meilleur temps retenu */
+#define THREADS 4
+
+typedef enum { F_INVERT, F_GRAY, F_LUMINOSITE, F_BOITE, F_GAUSS, F_CONV } genre_t;
+
+typedef struct {
+    genre_t genre;
+    int entier;                 /* luminosite, rayon, taille du noyau */
+    float reel;                 /* contraste, sigma */
+    const float *noyau;
+} filtre_t;
+
+typedef struct {
+    const char *nom;
+    int n;
+    filtre_t f[4];
+} scenario_t;
+
+static const float accentuer[9] = { 0, -1, 0, -1, 5, -1, 0, -1, 0 };
+static const float contours[9] = { -1, -1, -1, -1, 8, -1, -1, -1, -1 };
+
+static const scenario_t scenarios[] = {
+    { "invert", 1, { { F_INVERT, 0, 0, NULL } } },
+    { "grayscale", 1, { { F_GRAY, 0, 0, NULL } } },
+    { "luminosite+gris+invert", 3, { { F_LUMINOSITE, 20, 1.25f, NULL }, { F_GRAY, 0, 0, NULL },
+                                     { F_INVERT, 0, 0, NULL } } },
+    { "flou boite r=3", 1, { { F_BOITE, 3, 0, NULL } } },
+    { "flou gaussien s=2", 1, { { F_GAUSS, 0, 2.0f, NULL } } },
+    { "accentuation 3x3", 1, { { F_CONV, 3, 0, accentuer } } },
+    { "lum.+gauss s=1.5+contours+gris", 4, { { F_LUMINOSITE, -10, 1.5f, NULL }, { F_GAUSS, 0, 1.5f, NULL },
+                                            { F_CONV, 3, 0, contours }, { F_GRAY, 0, 0, NULL } } },
+};
+
+/* Cas limites : noyau 1x1 (rayon nul), sigma maximal, petites tailles
+   impaires (bandes partielles, fins de ligne hors vecteur) */
+static const float unite[1] = { 2.0f };
+
+static const scenario_t limites[] = {
+    { "convolution 1x1", 1, { { F_CONV, 1, 0, unite } } },
+    { "1x1+gris+1x1", 3, { { F_CONV, 1, 0, unite }, { F_GRAY, 0, 0, NULL }, { F_CONV, 1, 0, unite } } },
+    { "gauss sigma max", 1, { { F_GAUSS, 0, 32.0f / 3.0f, NULL } } },
+    { "lum.+1x1+boite r=2+invert", 4, { { F_LUMINOSITE, 30, 0.75f, NULL }, { F_CONV, 1, 0, unite },
+                                       { F_BOITE, 2, 0, NULL }, { F_INVERT, 0, 0, NULL } } },
+    { "contours+1x1+gauss s=0.3+gris", 4, { { F_CONV, 3, 0, contours }, { F_CONV, 1, 0, unite },
+                                           { F_GAUSS, 0, 0.3f, NULL }, { F_GRAY, 0, 0, NULL } } },
+};
+
+static const int tailles[][2] = { { 1, 1 }, { 1, 9 }, { 7, 1 }, { 3, 5 }, { 9, 13 },
+                                  { 17, 3 }, { 31, 29 }, { 65, 41 }, { 129, 7 } };
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* ---------------------------------------------------------------------------
+   Reference : une boucle par filtre sur toute l'image, memes formules en
+   virgule fixe que la bibliotheque
+   --------------------------------------------------------------------------- */
+
+static int borner(int v, int lo, int hi) {
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+static uint32_t octet(int v) {
+    return (uint32_t)borner(v, 0, 255);
+}
+
+static void ref_invert(uint32_t *p, size_t n) {
+    for (size_t i = 0; i < n; i++) p[i] = ~p[i];
+}
+
+static void ref_gris(uint32_t *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint8_t r = (p[i] >> 16) & 0xFF, g = (p[i] >> 8) & 0xFF, b = p[i] & 0xFF;
+        uint32_t gris = (uint32_t)((r + g + b) / 3);
+        p[i] = (gris << 16) | (gris << 8) | gris;
+    }
+}
+
+static void ref_luminosite(uint32_t *p, size_t n, int luminosite, float contraste) {
+    long k = lroundf(contraste * 64.0f);
+    if (k > 255) k = 255;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t out = p[i] & 0xFF000000u;
+        for (int c = 0; c < 24; c += 8) {
+            int v = (((int)((p[i] >> c) & 0xFF) - 128) * (int)k) >> 6;
+            out |= octet(v + 128 + luminosite) << c;
+        }
+        p[i] = out;
+    }
+}
+
+/* Poids Q16 de somme 65536 (quantification de la bibliotheque) */
+static int poids_flou(const filtre_t *f, uint16_t *poids) {
+    double w[65], total = 0;
+    int r;
+    if (f->genre == F_BOITE) {
+        r = f->entier;
+        for (int d = 0; d <= 2 * r; d++) w[d] = 1.0 / (2 * r + 1);
+    } else {
+        float sigma = f->reel;
+        r = (int)ceil(3.0 * sigma);
+        if (r < 1) r = 1;
+        if (r > 32) r = 32;
+        for (int d = -r; d <= r; d++) {
+            w[d + r] = exp(-(d * d) / (2.0 * sigma * sigma));
+            total += w[d + r];
+        }
+        for (int d = 0; d <= 2 * r; d++) w[d] /= total;
+    }
+    long somme = 0;
+    for (int d = 0; d <= 2 * r; d++) {
+        poids[d] = (uint16_t)lround(w[d] * 65536.0);
+        somme += poids[d];
+    }
+    poids[r] = (uint16_t)(poids[r] + (65536 - somme));
+    return r;
+}
+
+static uint32_t flou_fin(const uint32_t acc[4]) {
+    uint32_t out = 0;
+    for (int c = 0; c < 4; c++) out |= ((acc[c] + 128) >> 8) << (8 * c);
+    return out;
+}
+
+/* Passe horizontale puis verticale, chacune sur toute l'image */
+static void ref_flou(uint32_t *p, uint32_t *tmp, int w, int h, const filtre_t *f) {
+    uint16_t poids[65];
+    int r = poids_flou(f, poids);
+    for (int y = 0; y < h; y++) {
+        const uint32_t *ligne = &p[(size_t)y * w];
+        for (int x = 0; x < w; x++) {
+            uint32_t acc[4] = { 0, 0, 0, 0 };
+            for (int d = -r; d <= r; d++) {
+                uint32_t v = ligne[borner(x + d, 0, w - 1)];
+                for (int c = 0; c < 4; c++) acc[c] += ((((v >> (8 * c)) & 0xFF) << 8) * poids[d + r]) >> 16;
+            }
+            tmp[(size_t)y * w + x] = flou_fin(acc);
+        }
+    }
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            uint32_t acc[4] = { 0, 0, 0, 0 };
+            for (int d = -r; d <= r; d++) {
+                uint32_t v = tmp[(size_t)borner(y + d, 0, h - 1) * w + x];
+                for (int c = 0; c < 4; c++) acc[c] += ((((v >> (8 * c)) & 0xFF) << 8) * poids[d + r]) >> 16;
+            }
+            p[(size_t)y * w + x] = flou_fin(acc);
+        }
+    }
+}
+
+static void ref_convolution(uint32_t *p, uint32_t *tmp, int w, int h, const float *noyau, int k) {
+    int q[49], r = k / 2;
+    for (int i = 0; i < k * k; i++) q[i] = (int)lroundf(noyau[i] * 256.0f);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int acc[3] = { 0, 0, 0 };
+            for (int i = 0; i < k; i++) {
+                for (int j = 0; j < k; j++) {
+                    uint32_t v = p[(size_t)borner(y + i - r, 0, h - 1) * w + borner(x + j - r, 0, w - 1)];
+                    for (int c = 0; c < 3; c++) acc[c] += q[i * k + j] * (int)((v >> (8 * c)) & 0xFF);
+                }
+            }
+            tmp[(size_t)y * w + x] = (p[(size_t)y * w + x] & 0xFF000000u) | octet((acc[0] + 128) >> 8)
+                                   | octet((acc[1] + 128) >> 8) << 8 | octet((acc[2] + 128) >> 8) << 16;
+        }
+    }
+    memcpy(p, tmp, (size_t)w * h * sizeof(uint32_t));
+}
+
+static void reference(const scenario_t *s, uint32_t *p, uint32_t *tmp, int w, int h) {
+    size_t n = (size_t)w * h;
+    for (int i = 0; i < s->n; i++) {
+        const filtre_t *f = &s->f[i];
+        switch (f->genre) {
+        case F_INVERT: ref_invert(p, n); break;
+        case F_GRAY: ref_gris(p, n); break;
+        case F_LUMINOSITE: ref_luminosite(p, n, f->entier, f->reel); break;
+        case F_BOITE:
+        case F_GAUSS: ref_flou(p, tmp, w, h, f); break;
+        case F_CONV: ref_convolution(p, tmp, w, h, f->noyau, f->entier); break;
+        }
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   Bibliotheque
+   --------------------------------------------------------------------------- */
+
+static ImagePipeline *construire(const scenario_t *s, int threads, int fusion) {
+    ImagePipeline *p = image_pipeline_create();
+    int r = p ? 0 : -2;
+    for (int i = 0; i < s->n && r == 0; i++) {
+        const filtre_t *f = &s->f[i];
+        switch (f->genre) {
+        case F_INVERT: r = image_pipeline_add_invert(p); break;
+        case F_GRAY: r = image_pipeline_add_grayscale(p); break;
+        case F_LUMINOSITE: r = image_pipeline_add_brightness_contrast(p, f->entier, f->reel); break;
+        case F_BOITE: r = image_pipeline_add_box_blur(p, f->entier); break;
+        case F_GAUSS: r = image_pipeline_add_gaussian_blur(p, f->reel); break;
+        case F_CONV: r = image_pipeline_add_convolution(p, f->noyau, f->entier); break;
+        }
+    }
+    if (r != 0) {
+        image_pipeline_destroy(p);
+        return NULL;
+    }
+    image_pipeline_set_threads(p, threads);
+    image_pipeline_set_fusion(p, fusion);
+    return p;
+}
+
+static void charger(Image *img, const uint32_t *src, int h) {
+    image_write_rows(img, 0, h, src);
+}
+
+/* Comparaison directe dans le tampon emprunte */
+static bool identique(Image *img, const uint32_t *attendu, int w, int h) {
+    int stride;
+    const uint32_t *p = image_borrow_pixels(img, &stride);
+    for (int y = 0; y < h; y++)
+        if (memcmp(p + (size_t)y * stride, attendu + (size_t)y * w, (size_t)w * sizeof(uint32_t)) != 0)
+            return false;
+    return true;
+}
+
+/* Meilleur temps sur REPETITIONS, image rechargee avant chaque essai ;
+   -1 si le pipeline est refuse ou si le resultat differe */
+static double mesurer(const scenario_t *s, Image *img, const uint32_t *source, const uint32_t *attendu,
+                      int threads, int fusion) {
+    ImagePipeline *p = construire(s, threads, fusion);
+    if (!p) return -1;
+    double meilleur = 1e9;
+    bool ok = true;
+    for (int r = 0; r < REPETITIONS && ok; r++) {
+        charger(img, source, HAUTEUR);
+        double debut = secondes();
+        ok = image_pipeline_apply(p, img) == 0;
+        double t = secondes() - debut;
+        if (t < meilleur) meilleur = t;
+        ok = ok && identique(img, attendu, LARGEUR, HAUTEUR);
+    }
+    image_pipeline_destroy(p);
+    return ok ? meilleur : -1;
+}
+
+/* Degrades, bruit et bords francs, graine fixe */
+static void generer(uint32_t *p, int w, int h) {
+    uint64_t x = 0x9E3779B97F4A7C15ULL;
+    for (int y = 0; y < h; y++) {
+        for (int i = 0; i < w; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            uint32_t r = (uint32_t)(i * 255 / w), g = (uint32_t)(y * 255 / h);
+            uint32_t b = ((i / 64 + y / 64) & 1) ? 200 : 40;
+            uint32_t bruit = (uint32_t)(x & 0x0F0F0F);
+            p[(size_t)y * w + i] = (0xFFu << 24 | r << 16 | g << 8 | b) ^ bruit;
+        }
+    }
+}
+
+/* Chaque cas limite, a chaque taille : une passe par etape, fusion sur
+   1 et N threads, toutes identiques a la reference */
+static int verifier_limites(void) {
+    static const int modes[][2] = { { 1, 0 }, { 1, 1 }, { 3, 1 }, { THREADS, 1 } };
+    int echecs = 0;
+    for (size_t t = 0; t < sizeof(tailles) / sizeof(tailles[0]); t++) {
+        int w = tailles[t][0], h = tailles[t][1];
+        size_t n = (size_t)w * h;
+        uint32_t *source = malloc(n * sizeof(uint32_t));
+        uint32_t *attendu = malloc(n * sizeof(uint32_t));
+        uint32_t *tmp = malloc(n * sizeof(uint32_t));
+        Image *img = image_create(w, h);
+        if (!source || !attendu || !tmp || !img) {
+            echecs++;
+        } else {
+            generer(source, w, h);
+            for (size_t i = 0; i < sizeof(limites) / sizeof(limites[0]); i++) {
+                memcpy(attendu, source, n * sizeof(uint32_t));
+                reference(&limites[i], attendu, tmp, w, h);
+                for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+                    ImagePipeline *p = construire(&limites[i], modes[m][0], modes[m][1]);
+                    charger(img, source, h);
+                    bool bon = p && image_pipeline_apply(p, img) == 0 && identique(img, attendu, w, h);
+                    if (!bon) {
+                        printf("  %s, %dx%d, %d thread(s), fusion %d : DIFFERENT\n", limites[i].nom, w, h,
+                               modes[m][0], modes[m][1]);
+                        echecs++;
+                    }
+                    image_pipeline_destroy(p);
+                }
+            }
+        }
+        image_destroy(img);
+        free(source);
+        free(attendu);
+        free(tmp);
+    }
+    return echecs;
+}
+
+static void afficher(double t) {
+    if (t < 0) printf(" %12s", "ECHEC");
+    else printf(" %12.1f", (double)LARGEUR * HAUTEUR / t / 1e6);
+}
+
+int main(void) {
+    size_t n = (size_t)LARGEUR * HAUTEUR;
+    uint32_t *source = malloc(n * sizeof(uint32_t));
+    uint32_t *attendu = malloc(n * sizeof(uint32_t));
+    uint32_t *tmp = malloc(n * sizeof(uint32_t));
+    Image *img = image_create(LARGEUR, HAUTEUR);
+    if (!source || !attendu || !tmp || !img) {
+        fprintf(stderr, "Erreur: memoire\n");
+        return 1;
+    }
+    generer(source, LARGEUR, HAUTEUR);
+
+    printf("=== Filtres sur %dx%d (%.1f Mpixels), noyaux %s ===\n", LARGEUR, HAUTEUR, (double)n / 1e6,
+           image_simd_backend());
+    printf("Mpixels/s (meilleur de %d) ; reference : boucles C, une passe par filtre\n\n", REPETITIONS);
+    printf("%-32s %12s %12s %12s %12s %8s  %s\n", "Filtres", "reference", "1 passe/etape", "fusion", "fusion x4",
+           "gain", "Controle");
+
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+        const scenario_t *s = &scenarios[i];
+        double t_ref = 1e9;
+        for (int r = 0; r < REPETITIONS; r++) {
+            memcpy(attendu, source, n * sizeof(uint32_t));
+            double debut = secondes();
+            reference(s, attendu, tmp, LARGEUR, HAUTEUR);
+            double t = secondes() - debut;
+            if (t < t_ref) t_ref = t;
+        }
+        double t_sep = mesurer(s, img, source, attendu, 1, 0);
+        double t_fus = mesurer(s, img, source, attendu, 1, 1);
+        double t_par = mesurer(s, img, source, attendu, THREADS, 1);
+        bool bon = t_sep >= 0 && t_fus >= 0 && t_par >= 0;
+        ok = ok && bon;
+        printf("%-32s", s->nom);
+        afficher(t_ref);
+        afficher(t_sep);
+        afficher(t_fus);
+        afficher(t_par);
+        if (bon) printf(" %7.1fx", t_ref / (t_fus < t_par ? t_fus : t_par));
+        else printf(" %8s", "-");
+        printf("  %s\n", bon ? "identique" : "DIFFERENT");
+    }
+
+    /* L'ancienne API nommee passe par le meme moteur */
+    charger(img, source, HAUTEUR);
+    image_apply_filter(img, "grayscale");
+    memcpy(attendu, source, n * sizeof(uint32_t));
+    ref_gris(attendu, n);
+    bool nomme = identique(img, attendu, LARGEUR, HAUTEUR);
+    printf("\nimage_apply_filter(\"grayscale\") : %s\n", nomme ? "identique" : "DIFFERENT");
+    ok = ok && nomme;
+
+    int echecs = verifier_limites();
+    printf("Cas limites (%zu chaines x %zu tailles, separe/fusionne/threads) : %s\n",
+           sizeof(limites) / sizeof(limites[0]), sizeof(tailles) / sizeof(tailles[0]),
+           echecs == 0 ? "identiques" : "DIFFERENTS");
+    ok = ok && echecs == 0;
+
+    image_destroy(img);
+    free(source);
+    free(attendu);
+    free(tmp);
+    printf("\nVerification : %s\n", ok ? "pipeline (separe, fusionne, multi-thread) identique aux boucles de reference"
+                                     : "ECHEC");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,483 @@
+/* ============================================================================
+   Section 28.5 : extern "C" pour C++
+   Description : Moteur de filtres interne : noyaux et execution par bandes
+                 - point a point : inversion, gris, luminosite/contraste
+                 - voisinage : flou separable (boite, gaussien) en deux
+                   passes, convolution k x k generique
+                 - arithmetique entiere en virgule fixe, identique entre
+                   AVX2 et scalaire
+   Fichier source : 05-extern-c.md
+   ============================================================================ */
+
+#include "image_filters.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+namespace image_filters {
+
+namespace {
+
+constexpr int kMaxRadius = 32;
+constexpr int kMaxKernel = 7;
+constexpr std::size_t kTileBytes = 2u << 20;   /* budget de cache d'un thread */
+
+inline uint32_t clampByte(int v) {
+    return static_cast<uint32_t>(v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+inline uint32_t channel(uint32_t p, int c) {
+    return (p >> (8 * c)) & 0xFF;
+}
+
+/* ---------------------------------------------------------------------------
+   Etapes point a point
+   --------------------------------------------------------------------------- */
+
+/* s / 3 par multiplication : exact pour s <= 765 */
+inline uint32_t grayPixel(uint32_t p) {
+    uint32_t s = channel(p, 0) + channel(p, 1) + channel(p, 2);
+    uint32_t g = (s * 43691u) >> 17;
+    return (g << 16) | (g << 8) | g;
+}
+
+inline uint32_t brightnessPixel(uint32_t p, int contrast, int offset) {
+    uint32_t out = p & 0xFF000000u;
+    for (int c = 0; c < 3; c++) {
+        int v = ((static_cast<int>(channel(p, c)) - 128) * contrast) >> 6;
+        out |= clampByte(v + offset) << (8 * c);
+    }
+    return out;
+}
+
+void pointRow(const Stage &s, const uint32_t *in, uint32_t *out, int w) {
+    int x = 0;
+    const int offset = 128 + s.brightness;
+#ifdef __AVX2__
+    switch (s.kind) {
+    case StageKind::Invert: {
+        const __m256i ones = _mm256_set1_epi32(-1);
+        for (; x + 8 <= w; x += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + x));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), _mm256_xor_si256(v, ones));
+        }
+        break;
+    }
+    case StageKind::Grayscale: {
+        const __m256i octet = _mm256_set1_epi32(0xFF);
+        const __m256i tiers = _mm256_set1_epi32(43691);
+        for (; x + 8 <= w; x += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + x));
+            __m256i s3 = _mm256_add_epi32(_mm256_and_si256(v, octet),
+                         _mm256_add_epi32(_mm256_and_si256(_mm256_srli_epi32(v, 8), octet),
+                                          _mm256_and_si256(_mm256_srli_epi32(v, 16), octet)));
+            /* moities hautes nulles : mulhi_epu16 donne (s * 43691) >> 16 */
+            __m256i g = _mm256_srli_epi32(_mm256_mulhi_epu16(s3, tiers), 1);
+            g = _mm256_or_si256(g, _mm256_or_si256(_mm256_slli_epi32(g, 8), _mm256_slli_epi32(g, 16)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), g);
+        }
+        break;
+    }
+    case StageKind::BrightnessContrast: {
+        const __m256i k = _mm256_set1_epi16(static_cast<short>(s.contrast));
+        const __m256i off = _mm256_set1_epi16(static_cast<short>(offset));
+        const __m256i milieu = _mm256_set1_epi16(128);
+        const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000u));
+        for (; x + 8 <= w; x += 8) {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + x));
+            __m256i lo = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v));
+            __m256i hi = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1));
+            lo = _mm256_add_epi16(_mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(lo, milieu), k), 6), off);
+            hi = _mm256_add_epi16(_mm256_srai_epi16(_mm256_mullo_epi16(_mm256_sub_epi16(hi, milieu), k), 6), off);
+            /* packus travaille par moitie de 128 bits : remettre les
+               quadruplets dans l'ordre */
+            __m256i r = _mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xD8);
+            r = _mm256_blendv_epi8(r, v, alpha);
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + x), r);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+#endif
+    switch (s.kind) {
+    case StageKind::Invert:
+        for (; x < w; x++) out[x] = ~in[x];
+        break;
+    case StageKind::Grayscale:
+        for (; x < w; x++) out[x] = grayPixel(in[x]);
+        break;
+    case StageKind::BrightnessContrast:
+        for (; x < w; x++) out[x] = brightnessPixel(in[x], s.contrast, offset);
+        break;
+    default:
+        break;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   Flou separable : poids Q16 (somme 65536), chaque terme tronque comme
+   _mm256_mulhi_epu16((v << 8), w), accumulateur 16 bits sans debordement
+   (somme <= 255 * 256)
+   --------------------------------------------------------------------------- */
+
+inline uint32_t blurTerm(uint32_t v, uint16_t w) {
+    return ((v << 8) * w) >> 16;
+}
+
+inline uint32_t blurFinish(const uint32_t acc[4]) {
+    return ((acc[0] + 128) >> 8) | ((acc[1] + 128) >> 8) << 8 | ((acc[2] + 128) >> 8) << 16
+         | ((acc[3] + 128) >> 8) << 24;
+}
+
+#ifdef __AVX2__
+/* 8 pixels : unpack(0, v) place chaque octet dans le poids fort d'un mot
+   de 16 bits (v << 8) ; packus des deux moities restitue l'ordre */
+struct Blur8 {
+    __m256i lo, hi;
+};
+
+inline void blurAccumulate(Blur8 &a, const uint32_t *p, __m256i w) {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    const __m256i zero = _mm256_setzero_si256();
+    a.lo = _mm256_add_epi16(a.lo, _mm256_mulhi_epu16(_mm256_unpacklo_epi8(zero, v), w));
+    a.hi = _mm256_add_epi16(a.hi, _mm256_mulhi_epu16(_mm256_unpackhi_epi8(zero, v), w));
+}
+
+inline void blurStore(uint32_t *out, const Blur8 &a) {
+    const __m256i arrondi = _mm256_set1_epi16(128);
+    __m256i lo = _mm256_srli_epi16(_mm256_add_epi16(a.lo, arrondi), 8);
+    __m256i hi = _mm256_srli_epi16(_mm256_add_epi16(a.hi, arrondi), 8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out), _mm256_packus_epi16(lo, hi));
+}
+#endif
+
+void blurRowH(const uint32_t *in, uint32_t *out, int w, const uint16_t *taps, int r) {
+    auto scalar = [&](int x) {
+        uint32_t acc[4] = { 0, 0, 0, 0 };
+        for (int d = -r; d <= r; d++) {
+            uint32_t p = in[std::clamp(x + d, 0, w - 1)];
+            for (int c = 0; c < 4; c++) acc[c] += blurTerm(channel(p, c), taps[d + r]);
+        }
+        out[x] = blurFinish(acc);
+    };
+    int x = 0;
+    for (; x < std::min(r, w); x++) scalar(x);
+#ifdef __AVX2__
+    __m256i wv[2 * kMaxRadius + 1];
+    for (int d = 0; d <= 2 * r; d++) wv[d] = _mm256_set1_epi16(static_cast<short>(taps[d]));
+    for (; x + 8 + r <= w; x += 8) {
+        const uint32_t *p = in + x - r;
+        Blur8 a{ _mm256_setzero_si256(), _mm256_setzero_si256() };
+        for (int d = 0; d <= 2 * r; d++) blurAccumulate(a, p + d, wv[d]);
+        blurStore(out + x, a);
+    }
+#endif
+    for (; x < w; x++) scalar(x);
+}
+
+void blurRowV(const uint32_t *const *rows, uint32_t *out, int w, const uint16_t *taps, int r) {
+    int x = 0;
+#ifdef __AVX2__
+    __m256i wv[2 * kMaxRadius + 1];
+    for (int d = 0; d <= 2 * r; d++) wv[d] = _mm256_set1_epi16(static_cast<short>(taps[d]));
+    for (; x + 8 <= w; x += 8) {
+        Blur8 a{ _mm256_setzero_si256(), _mm256_setzero_si256() };
+        for (int d = 0; d <= 2 * r; d++) blurAccumulate(a, rows[d] + x, wv[d]);
+        blurStore(out + x, a);
+    }
+#endif
+    for (; x < w; x++) {
+        uint32_t acc[4] = { 0, 0, 0, 0 };
+        for (int d = 0; d <= 2 * r; d++)
+            for (int c = 0; c < 4; c++) acc[c] += blurTerm(channel(rows[d][x], c), taps[d]);
+        out[x] = blurFinish(acc);
+    }
+}
+
+/* ---------------------------------------------------------------------------
+   Convolution k x k : poids Q8 signes, accumulateur 32 bits, RVB seulement
+   --------------------------------------------------------------------------- */
+
+void convRow(const uint32_t *const *rows, uint32_t *out, int w, const int16_t *kernel, int k) {
+    const int r = k / 2;
+    auto scalar = [&](int x) {
+        int acc[3] = { 0, 0, 0 };
+        for (int i = 0; i < k; i++) {
+            for (int j = 0; j < k; j++) {
+                uint32_t p = rows[i][std::clamp(x + j - r, 0, w - 1)];
+                for (int c = 0; c < 3; c++) acc[c] += kernel[i * k + j] * static_cast<int>(channel(p, c));
+            }
+        }
+        out[x] = (rows[r][x] & 0xFF000000u) | clampByte((acc[0] + 128) >> 8)
+               | clampByte((acc[1] + 128) >> 8) << 8 | clampByte((acc[2] + 128) >> 8) << 16;
+    };
+    int x = 0;
+    for (; x < std::min(r, w); x++) scalar(x);
+#ifdef __AVX2__
+    /* Deux prises par madd : (v_a, v_b) entrelaces x (w_a, w_b) */
+    const int n = k * k;
+    __m256i paires[(kMaxKernel * kMaxKernel + 1) / 2];
+    for (int t = 0; t < n; t += 2) {
+        uint32_t wa = static_cast<uint16_t>(kernel[t]);
+        uint32_t wb = t + 1 < n ? static_cast<uint16_t>(kernel[t + 1]) : 0;
+        paires[t / 2] = _mm256_set1_epi32(static_cast<int>(wa | wb << 16));
+    }
+    const __m256i arrondi = _mm256_set1_epi32(128);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+    for (; x + 4 + r <= w; x += 4) {
+        __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+        for (int t = 0; t < n; t += 2) {
+            const uint32_t *pa = rows[t / k] + x + t % k - r;
+            __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pa)));
+            __m256i vb = _mm256_setzero_si256();
+            if (t + 1 < n) {
+                const uint32_t *pb = rows[(t + 1) / k] + x + (t + 1) % k - r;
+                vb = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pb)));
+            }
+            lo = _mm256_add_epi32(lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(va, vb), paires[t / 2]));
+            hi = _mm256_add_epi32(hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(va, vb), paires[t / 2]));
+        }
+        lo = _mm256_srai_epi32(_mm256_add_epi32(lo, arrondi), 8);
+        hi = _mm256_srai_epi32(_mm256_add_epi32(hi, arrondi), 8);
+        /* packs restitue l'ordre defait par unpacklo/unpackhi */
+        __m256i v16 = _mm256_packs_epi32(lo, hi);
+        __m128i res = _mm_packus_epi16(_mm256_castsi256_si128(v16), _mm256_extracti128_si256(v16, 1));
+        __m128i centre = _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[r] + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + x), _mm_blendv_epi8(res, centre, alpha));
+    }
+#endif
+    for (; x < w; x++) scalar(x);
+}
+
+/* Lignes d'une vue ou d'un tampon local dont la premiere ligne est origin */
+struct Rows {
+    uint32_t *base;
+    std::ptrdiff_t stride;
+    int origin;
+
+    uint32_t *row(int y) const { return base + static_cast<std::ptrdiff_t>(y - origin) * stride; }
+};
+
+}  /* namespace */
+
+/* ---------------------------------------------------------------------------
+   Construction des etapes
+   --------------------------------------------------------------------------- */
+
+Stage Stage::invert() {
+    return Stage(StageKind::Invert);
+}
+
+Stage Stage::grayscale() {
+    return Stage(StageKind::Grayscale);
+}
+
+Stage Stage::brightnessContrast(int brightness, float contrast) {
+    if (brightness < -255 || brightness > 255 || !(contrast >= 0.0f && contrast < 4.0f))
+        throw std::invalid_argument("luminosite -255..255, contraste 0..4");
+    Stage s(StageKind::BrightnessContrast);
+    s.brightness = brightness;
+    s.contrast = std::min(255, static_cast<int>(std::lround(contrast * 64.0f)));
+    return s;
+}
+
+namespace {
+
+/* Quantifie des poids reels de somme 1 en Q16 de somme exacte 65536 */
+std::vector<uint16_t> quantizeTaps(const std::vector<double> &w) {
+    std::vector<uint16_t> taps(w.size());
+    long total = 0;
+    for (std::size_t i = 0; i < w.size(); i++) {
+        taps[i] = static_cast<uint16_t>(std::lround(w[i] * 65536.0));
+        total += taps[i];
+    }
+    taps[w.size() / 2] = static_cast<uint16_t>(taps[w.size() / 2] + (65536 - total));
+    return taps;
+}
+
+}  /* namespace */
+
+Stage Stage::boxBlur(int radius) {
+    if (radius < 1 || radius > kMaxRadius) throw std::invalid_argument("rayon 1..32");
+    Stage s(StageKind::SeparableBlur);
+    s.radius = radius;
+    s.taps = quantizeTaps(std::vector<double>(2 * radius + 1, 1.0 / (2 * radius + 1)));
+    return s;
+}
+
+Stage Stage::gaussianBlur(float sigma) {
+    if (!(sigma >= 0.3f && sigma <= kMaxRadius / 3.0f)) throw std::invalid_argument("sigma 0.3..10.6");
+    Stage s(StageKind::SeparableBlur);
+    /* ceil(3 * sigma) en double peut depasser kMaxRadius a la borne */
+    s.radius = std::clamp(static_cast<int>(std::ceil(3.0 * sigma)), 1, kMaxRadius);
+    std::vector<double> w(2 * s.radius + 1);
+    double total = 0;
+    for (int d = -s.radius; d <= s.radius; d++) {
+        w[d + s.radius] = std::exp(-(d * d) / (2.0 * sigma * sigma));
+        total += w[d + s.radius];
+    }
+    for (double &v : w) v /= total;
+    s.taps = quantizeTaps(w);
+    return s;
+}
+
+Stage Stage::convolution(const float *weights, int size) {
+    if (!weights || size < 1 || size > kMaxKernel || size % 2 == 0)
+        throw std::invalid_argument("noyau impair 1..7");
+    Stage s(StageKind::Convolution);
+    s.radius = size / 2;
+    s.kernel.resize(static_cast<std::size_t>(size * size));
+    for (int i = 0; i < size * size; i++) {
+        if (!(std::fabs(weights[i]) <= 127.0f)) throw std::invalid_argument("poids -127..127");
+        s.kernel[i] = static_cast<int16_t>(std::lround(weights[i] * 256.0f));
+    }
+    return s;
+}
+
+/* ---------------------------------------------------------------------------
+   Execution
+   --------------------------------------------------------------------------- */
+
+const char *FilterPipeline::simdName() {
+#ifdef __AVX2__
+    return "avx2";
+#else
+    return "scalaire";
+#endif
+}
+
+bool FilterPipeline::needsScratch(std::size_t first, std::size_t last) const {
+    for (std::size_t k = first; k < last; k++)
+        if (!stages[k].isPoint()) return true;
+    return false;
+}
+
+/* Une bande [y0, y1) : l'etape k produit les lignes dont les etapes
+   suivantes ont besoin (halo[k + 1] de part et d'autre), dans des tampons
+   locaux qui restent dans le cache ; la derniere ecrit dans dst. Les bords
+   de l'image sont traites par repetition, comme une passe sur toute
+   l'image : le resultat ne depend pas du decoupage. */
+void FilterPipeline::runTile(const PixelView &src, const PixelView &dst, int y0, int y1, std::size_t first,
+                             std::size_t last, const std::vector<int> &halo, uint32_t *work, int workRows) const {
+    const int h = src.height, w = src.width;
+    const int origin = y0 - halo[first];
+    auto local = [&](int i) {
+        return Rows{ work + static_cast<std::ptrdiff_t>(i) * workRows * w, w, origin };
+    };
+    auto libre = [](int a, int b) {
+        for (int i = 0;; i++)
+            if (i != a && i != b) return i;
+    };
+    const Rows final{ dst.data, dst.stride, 0 };
+    Rows in{ src.data, src.stride, 0 };
+    int inBuf = -1;
+    const uint32_t *rows[2 * kMaxRadius + 1];
+
+    std::size_t k = first;
+    while (k < last) {
+        if (stages[k].isPoint()) {
+            /* Etapes point a point consecutives : la ligne est reprise
+               tant qu'elle est dans le cache L1 */
+            std::size_t k2 = k;
+            while (k2 < last && stages[k2].isPoint()) k2++;
+            const int a = std::max(0, y0 - halo[k2]), b = std::min(h, y1 + halo[k2]);
+            const int outBuf = k2 == last ? -1 : inBuf >= 0 ? inBuf : 0;
+            const Rows out = outBuf < 0 ? final : local(outBuf);
+            for (int y = a; y < b; y++) {
+                uint32_t *o = out.row(y);
+                pointRow(stages[k], in.row(y), o, w);
+                for (std::size_t j = k + 1; j < k2; j++) pointRow(stages[j], o, o, w);
+            }
+            in = out;
+            inBuf = outBuf;
+            k = k2;
+            continue;
+        }
+
+        const Stage &s = stages[k];
+        const int r = s.radius;
+        const int a = std::max(0, y0 - halo[k + 1]), b = std::min(h, y1 + halo[k + 1]);
+        const int outBuf = k + 1 == last ? -1 : libre(inBuf, -1);
+        const Rows out = outBuf < 0 ? final : local(outBuf);
+        if (s.kind == StageKind::SeparableBlur) {
+            const Rows tmp = local(libre(inBuf, outBuf));
+            for (int y = std::max(0, a - r); y < std::min(h, b + r); y++)
+                blurRowH(in.row(y), tmp.row(y), w, s.taps.data(), r);
+            for (int y = a; y < b; y++) {
+                for (int d = -r; d <= r; d++) rows[d + r] = tmp.row(std::clamp(y + d, 0, h - 1));
+                blurRowV(rows, out.row(y), w, s.taps.data(), r);
+            }
+        } else {
+            for (int y = a; y < b; y++) {
+                for (int d = -r; d <= r; d++) rows[d + r] = in.row(std::clamp(y + d, 0, h - 1));
+                convRow(rows, out.row(y), w, s.kernel.data(), 2 * r + 1);
+            }
+        }
+        in = out;
+        inBuf = outBuf;
+        k++;
+    }
+}
+
+void FilterPipeline::run(const PixelView &src, const PixelView &dst, std::size_t first, std::size_t last) const {
+    const int h = src.height, w = src.width;
+    if (w <= 0 || h <= 0) return;
+    if (first >= last) {
+        if (src.data != dst.data)
+            for (int y = 0; y < h; y++) std::memcpy(dst.row(y), src.row(y), static_cast<std::size_t>(w) * 4);
+        return;
+    }
+
+    std::vector<int> halo(last + 1, 0);
+    for (std::size_t k = last; k-- > first;) halo[k] = halo[k + 1] + stages[k].radius;
+
+    int nthreads = threads > 0 ? threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    /* Bandes : trois tampons locaux tiennent dans le budget de cache, au
+       moins quatre fois le halo (voisinage recalcule < 50 %), et assez de
+       bandes pour occuper chaque thread deux fois */
+    const std::size_t rowBytes = static_cast<std::size_t>(w) * 4;
+    int tileRows = std::max({ 8, static_cast<int>(kTileBytes / (3 * rowBytes)), 4 * halo[first] });
+    if (nthreads > 1) tileRows = std::min(tileRows, std::max(8, (h + 2 * nthreads - 1) / (2 * nthreads)));
+    tileRows = std::min(tileRows, h);
+    const int ntiles = (h + tileRows - 1) / tileRows;
+    nthreads = std::min(nthreads, ntiles);
+    const int workRows = tileRows + 2 * halo[first];
+
+    if (workspaces.size() < static_cast<std::size_t>(nthreads)) workspaces.resize(nthreads);
+    if (needsScratch(first, last)) {
+        const std::size_t need = 3 * static_cast<std::size_t>(workRows) * static_cast<std::size_t>(w);
+        for (int t = 0; t < nthreads; t++)
+            if (workspaces[t].size() < need) workspaces[t].resize(need);
+    }
+
+    std::atomic<int> next{ 0 };
+    auto worker = [&](int t) {
+        uint32_t *work = workspaces[t].data();
+        for (int i; (i = next.fetch_add(1, std::memory_order_relaxed)) < ntiles;)
+            runTile(src, dst, i * tileRows, std::min(h, (i + 1) * tileRows), first, last, halo, work, workRows);
+    };
+    std::vector<std::thread> pool;
+    pool.reserve(static_cast<std::size_t>(nthreads - 1));
+    for (int t = 1; t < nthreads; t++) {
+        /* Sans nouveau thread, les bandes restantes vont aux autres */
+        try {
+            pool.emplace_back(worker, t);
+        } catch (const std::system_error &) {
+            break;
+        }
+    }
+    worker(0);
+    for (std::thread &th : pool) th.join();
+}
+
+}  /* namespace image_filters */
@@ -0,0 +1,89 @@
+/* ============================================================================
+   Section 28.5 : extern "C" pour C++
+   Description : Moteur de filtres interne (C++, invisible depuis C)
+                 - etapes resolues une fois a la construction du pipeline
+                 - bandes de lignes reparties entre threads
+                 - etapes enchainees fusionnees : une seule passe memoire
+                   par bande, voisinage recalcule dans la bande
+                 - noyaux AVX2 (-mavx2) et repli scalaire au resultat
+                   identique a l'octet pres
+   Fichier source : 05-extern-c.md
+   ============================================================================ */
+
+#ifndef IMAGE_FILTERS_HPP
+#define IMAGE_FILTERS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace image_filters {
+
+/* Pixels 0xAARRGGBB ; stride en pixels entre deux lignes */
+struct PixelView {
+    uint32_t *data;
+    int width;
+    int height;
+    std::ptrdiff_t stride;
+
+    uint32_t *row(int y) const { return data + y * stride; }
+};
+
+enum class StageKind {
+    Invert,                 /* ~pixel, alpha compris */
+    Grayscale,              /* (r + g + b) / 3, alpha a zero */
+    BrightnessContrast,     /* RVB, alpha conserve */
+    SeparableBlur,          /* boite ou gaussien, 4 canaux */
+    Convolution             /* noyau k x k, RVB, alpha conserve */
+};
+
+struct Stage {
+    StageKind kind;
+    int radius = 0;                 /* voisinage vertical (lignes), 0 en 1x1 */
+    int brightness = 0;             /* -255..255 */
+    int contrast = 64;              /* contraste en virgule fixe Q6 (0..255) */
+    std::vector<uint16_t> taps;     /* flou : 2r+1 poids, somme 65536 */
+    std::vector<int16_t> kernel;    /* convolution : k*k poids Q8 */
+
+    explicit Stage(StageKind k) : kind(k) {}
+
+    /* Selon le genre, pas le rayon : une convolution 1x1 a un rayon nul
+       mais passe par convRow */
+    bool isPoint() const { return kind != StageKind::SeparableBlur && kind != StageKind::Convolution; }
+
+    static Stage invert();
+    static Stage grayscale();
+    static Stage brightnessContrast(int brightness, float contrast);
+    static Stage boxBlur(int radius);
+    static Stage gaussianBlur(float sigma);
+    static Stage convolution(const float *weights, int size);
+};
+
+class FilterPipeline {
+public:
+    std::vector<Stage> stages;
+    int threads = 1;
+    bool fuse = true;
+
+    /* true si une des etapes [first, last) lit ses voisines : la sortie
+       ne peut pas ecraser l'entree */
+    bool needsScratch(std::size_t first, std::size_t last) const;
+
+    /* Applique les etapes [first, last) de src vers dst (memes
+       dimensions), en une passe par bande ; dst peut etre src si
+       needsScratch() est faux. Non reentrant (tampons partages). */
+    void run(const PixelView &src, const PixelView &dst, std::size_t first, std::size_t last) const;
+
+    static const char *simdName();
+
+private:
+    /* Tampons de travail par thread, conserves d'un appel a l'autre */
+    mutable std::vector<std::vector<uint32_t>> workspaces;
+
+    void runTile(const PixelView &src, const PixelView &dst, int y0, int y1, std::size_t first,
+                 std::size_t last, const std::vector<int> &halo, uint32_t *work, int workRows) const;
+};
+
+}  /* namespace image_filters */
+
+#endif
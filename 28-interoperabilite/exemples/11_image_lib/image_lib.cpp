@@ -2,77 +2,301 @@
    Section 28.5 : extern "C" pour C++
    Description : Implementation C++ de la bibliotheque d'images avec
                  classes internes (vector, string) cachees derriere API C
+                 - pipeline de filtres (image_filters.hpp) expose par un
+                   second pointeur opaque
+                 - acces en bloc (lignes, rectangles) et emprunt du tampon :
+                   une verification de bornes par appel, plus par pixel
+                 - memoire externe (malloc, mmap) emballee sans copie
+                 - aucune exception ne traverse la frontiere C
    Fichier source : 05-extern-c.md
    ============================================================================ */
 
 #include "image_lib.h"
+#include "image_filters.hpp"
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+using image_filters::FilterPipeline;
+using image_filters::PixelView;
+using image_filters::Stage;
 
 /* Classe C++ interne (pas visible depuis C) */
 class ImageImpl {
 public:
     int width, height;
-    std::vector<uint32_t> pixels;
+    uint32_t *data;                     /* pixel (0,0) */
+    std::ptrdiff_t stride;              /* en pixels entre deux lignes */
+    std::vector<uint32_t> owned;        /* vide si la memoire est emballee */
+    image_release_fn release = nullptr;
+    void *releaseUser = nullptr;
+    std::vector<uint32_t> scratch;      /* sortie des filtres a voisinage */
+
+    ImageImpl(int w, int h)
+        : width(w), height(h), owned(static_cast<size_t>(w) * static_cast<size_t>(h), 0) {
+        data = owned.data();
+        stride = w;
+    }
+
+    /* Memoire fournie par l'appelant : aucune copie */
+    ImageImpl(uint32_t *pixels, int w, int h, int s, image_release_fn fn, void *user)
+        : width(w), height(h), data(pixels), stride(s), release(fn), releaseUser(user) {}
+
+    ~ImageImpl() {
+        if (release) release(data, releaseUser);
+    }
+
+    ImageImpl(const ImageImpl &) = delete;
+    ImageImpl &operator=(const ImageImpl &) = delete;
+
+    bool contains(int x, int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height;
+    }
+
+    /* Rectangle entierement dans l'image (verifie une fois par appel) */
+    bool containsRect(int x, int y, int w, int h) const {
+        return x >= 0 && y >= 0 && w >= 0 && h >= 0 && w <= width - x && h <= height - y;
+    }
 
-    ImageImpl(int w, int h) : width(w), height(h) {
-        pixels.resize(static_cast<size_t>(w * h), 0);
+    uint32_t *row(int y) const {
+        return data + y * stride;
     }
 
     void setPixel(int x, int y, uint32_t color) {
-        if (x >= 0 && x < width && y >= 0 && y < height) {
-            pixels[static_cast<size_t>(y * width + x)] = color;
+        if (contains(x, y)) {
+            row(y)[x] = color;
         }
     }
 
     uint32_t getPixel(int x, int y) const {
-        if (x >= 0 && x < width && y >= 0 && y < height) {
-            return pixels[static_cast<size_t>(y * width + x)];
+        if (contains(x, y)) {
+            return row(y)[x];
         }
         return 0;
     }
 
+    /* Copie d'un rectangle, ligne par ligne (memcpy) */
+    void writeRect(int x, int y, int w, int h, const uint32_t *src, std::ptrdiff_t srcStride) {
+        for (int i = 0; i < h; i++) {
+            std::memcpy(row(y + i) + x, src + i * srcStride, static_cast<size_t>(w) * sizeof(uint32_t));
+        }
+    }
+
+    void readRect(int x, int y, int w, int h, uint32_t *dst, std::ptrdiff_t dstStride) const {
+        for (int i = 0; i < h; i++) {
+            std::memcpy(dst + i * dstStride, row(y + i) + x, static_cast<size_t>(w) * sizeof(uint32_t));
+        }
+    }
+
+    PixelView view() const {
+        return PixelView{ data, width, height, stride };
+    }
+
+    /* Etapes [first, last) en une passe ; un filtre a voisinage ecrit dans
+       scratch, qui devient l'image si la bibliotheque possede un tampon
+       contigu, sinon est recopie dans la memoire de l'appelant */
+    void run(const FilterPipeline &p, size_t first, size_t last) {
+        if (!p.needsScratch(first, last)) {
+            p.run(view(), view(), first, last);
+            return;
+        }
+        scratch.resize(static_cast<size_t>(width) * static_cast<size_t>(height));
+        const PixelView out{ scratch.data(), width, height, width };
+        p.run(view(), out, first, last);
+        if (!owned.empty() && data == owned.data() && stride == width) {
+            owned.swap(scratch);
+            data = owned.data();
+        } else {
+            writeRect(0, 0, width, height, out.data, out.stride);
+        }
+    }
+
+    void applyPipeline(const FilterPipeline &p) {
+        if (p.fuse) {
+            run(p, 0, p.stages.size());
+        } else {
+            for (size_t k = 0; k < p.stages.size(); k++) run(p, k, k + 1);
+        }
+    }
+
+    /* Le nom est resolu une fois par appel, plus une fois par pixel */
     void applyFilter(const std::string &name) {
+        static const float accentuer[9] = { 0, -1, 0, -1, 5, -1, 0, -1, 0 };
+        FilterPipeline p;
         if (name == "invert") {
-            for (auto &pixel : pixels) {
-                pixel = ~pixel;
-            }
+            p.stages.push_back(Stage::invert());
         } else if (name == "grayscale") {
-            for (auto &pixel : pixels) {
-                uint8_t r = (pixel >> 16) & 0xFF;
-                uint8_t g = (pixel >> 8) & 0xFF;
-                uint8_t b = pixel & 0xFF;
-                uint8_t gray = static_cast<uint8_t>((r + g + b) / 3);
-                pixel = (static_cast<uint32_t>(gray) << 16)
-                      | (static_cast<uint32_t>(gray) << 8)
-                      | gray;
-            }
+            p.stages.push_back(Stage::grayscale());
+        } else if (name == "blur") {
+            p.stages.push_back(Stage::gaussianBlur(1.0f));
+        } else if (name == "sharpen") {
+            p.stages.push_back(Stage::convolution(accentuer, 3));
+        } else {
+            return;
         }
+        applyPipeline(p);
     }
 };
 
+/* Outils (hors extern "C" : ni gabarit ni surcharge n'ont la liaison C) */
+
+static ImageImpl *impl(Image *img) {
+    return reinterpret_cast<ImageImpl *>(img);
+}
+
+static const ImageImpl *impl(const Image *img) {
+    return reinterpret_cast<const ImageImpl *>(img);
+}
+
+static FilterPipeline *pipeline(ImagePipeline *p) {
+    return reinterpret_cast<FilterPipeline *>(p);
+}
+
+/* Ajoute l'etape construite par fabrique() ; 0, -1 (parametre) ou -2
+   (memoire) */
+template <typename F>
+static int add_stage(ImagePipeline *p, F fabrique) {
+    if (!p) return -1;
+    try {
+        pipeline(p)->stages.push_back(fabrique());
+        return 0;
+    } catch (const std::invalid_argument &) {
+        return -1;
+    } catch (...) {
+        return -2;
+    }
+}
+
 /* Implementation des fonctions C */
 extern "C" {
 
 Image *image_create(int width, int height) {
-    return reinterpret_cast<Image *>(new ImageImpl(width, height));
+    if (width < 0 || height < 0) return nullptr;
+    try {
+        return reinterpret_cast<Image *>(new ImageImpl(width, height));
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+Image *image_wrap(uint32_t *pixels, int width, int height, int stride, image_release_fn release, void *user) {
+    if (!pixels || width < 0 || height < 0 || stride < width) return nullptr;
+    return reinterpret_cast<Image *>(new (std::nothrow) ImageImpl(pixels, width, height, stride, release, user));
 }
 
 void image_destroy(Image *img) {
-    delete reinterpret_cast<ImageImpl *>(img);
+    delete impl(img);
 }
 
 void image_set_pixel(Image *img, int x, int y, uint32_t color) {
-    reinterpret_cast<ImageImpl *>(img)->setPixel(x, y, color);
+    impl(img)->setPixel(x, y, color);
 }
 
 uint32_t image_get_pixel(Image *img, int x, int y) {
-    return reinterpret_cast<ImageImpl *>(img)->getPixel(x, y);
+    return impl(img)->getPixel(x, y);
+}
+
+/* --- Acces en bloc --- */
+
+int image_width(const Image *img) {
+    return impl(img)->width;
+}
+
+int image_height(const Image *img) {
+    return impl(img)->height;
+}
+
+int image_write_rect(Image *img, int x, int y, int w, int h, const uint32_t *src, int src_stride) {
+    if (!img || !src || src_stride < w || !impl(img)->containsRect(x, y, w, h)) return -1;
+    impl(img)->writeRect(x, y, w, h, src, src_stride);
+    return 0;
+}
+
+int image_read_rect(const Image *img, int x, int y, int w, int h, uint32_t *dst, int dst_stride) {
+    if (!img || !dst || dst_stride < w || !impl(img)->containsRect(x, y, w, h)) return -1;
+    impl(img)->readRect(x, y, w, h, dst, dst_stride);
+    return 0;
+}
+
+int image_write_rows(Image *img, int y, int count, const uint32_t *src) {
+    return img ? image_write_rect(img, 0, y, impl(img)->width, count, src, impl(img)->width) : -1;
+}
+
+int image_read_rows(const Image *img, int y, int count, uint32_t *dst) {
+    return img ? image_read_rect(img, 0, y, impl(img)->width, count, dst, impl(img)->width) : -1;
+}
+
+uint32_t *image_borrow_pixels(Image *img, int *stride) {
+    if (!img) return nullptr;
+    if (stride) *stride = static_cast<int>(impl(img)->stride);
+    return impl(img)->data;
 }
 
 void image_apply_filter(Image *img, const char *filter_name) {
-    reinterpret_cast<ImageImpl *>(img)->applyFilter(filter_name);
+    try {
+        impl(img)->applyFilter(filter_name);
+    } catch (...) {
+        /* API sans code d'erreur : l'image reste inchangee */
+    }
+}
+
+/* --- Pipeline de filtres --- */
+
+ImagePipeline *image_pipeline_create(void) {
+    return reinterpret_cast<ImagePipeline *>(new (std::nothrow) FilterPipeline());
+}
+
+void image_pipeline_destroy(ImagePipeline *p) {
+    delete pipeline(p);
+}
+
+int image_pipeline_add_invert(ImagePipeline *p) {
+    return add_stage(p, [] { return Stage::invert(); });
+}
+
+int image_pipeline_add_grayscale(ImagePipeline *p) {
+    return add_stage(p, [] { return Stage::grayscale(); });
+}
+
+int image_pipeline_add_brightness_contrast(ImagePipeline *p, int brightness, float contrast) {
+    return add_stage(p, [=] { return Stage::brightnessContrast(brightness, contrast); });
+}
+
+int image_pipeline_add_box_blur(ImagePipeline *p, int radius) {
+    return add_stage(p, [=] { return Stage::boxBlur(radius); });
+}
+
+int image_pipeline_add_gaussian_blur(ImagePipeline *p, float sigma) {
+    return add_stage(p, [=] { return Stage::gaussianBlur(sigma); });
+}
+
+int image_pipeline_add_convolution(ImagePipeline *p, const float *kernel, int size) {
+    return add_stage(p, [=] { return Stage::convolution(kernel, size); });
+}
+
+void image_pipeline_set_threads(ImagePipeline *p, int threads) {
+    if (p) pipeline(p)->threads = threads < 0 ? 1 : threads;
+}
+
+void image_pipeline_set_fusion(ImagePipeline *p, int enabled) {
+    if (p) pipeline(p)->fuse = enabled != 0;
+}
+
+int image_pipeline_apply(ImagePipeline *p, Image *img) {
+    if (!p || !img) return -1;
+    try {
+        impl(img)->applyPipeline(*pipeline(p));
+        return 0;
+    } catch (...) {
+        return -2;
+    }
+}
+
+const char *image_simd_backend(void) {
+    return FilterPipeline::simdName();
 }
 
 }  /* extern "C" */
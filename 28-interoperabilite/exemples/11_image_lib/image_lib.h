@@ -16,12 +16,72 @@ extern "C" {
 /* Pointeur opaque (cache l'implementation C++) */
 typedef struct Image Image;
 
+/* NULL si les dimensions sont negatives ou la memoire insuffisante */
 Image *image_create(int width, int height);
 void image_destroy(Image *img);
 void image_set_pixel(Image *img, int x, int y, uint32_t color);
 uint32_t image_get_pixel(Image *img, int x, int y);
+
+/* Memoire externe (malloc, mmap, tampon d'une autre bibliotheque)
+   emballee sans copie : pixels 0xAARRGGBB, stride en pixels (>= width).
+   release(pixels, user) est appele par image_destroy (NULL : l'appelant
+   reste proprietaire). En cas d'echec (NULL), release n'est pas appele.
+   Les filtres ecrivent leur resultat dans cette memoire. */
+typedef void (*image_release_fn)(uint32_t *pixels, void *user);
+Image *image_wrap(uint32_t *pixels, int width, int height, int stride,
+                  image_release_fn release, void *user);
+
+int image_width(const Image *img);
+int image_height(const Image *img);
+
+/* Acces en bloc : un appel et une verification de bornes par rectangle.
+   Le rectangle doit etre entierement dans l'image ; stride du tampon C
+   en pixels (>= w). Renvoient 0 ou -1 (hors limites, parametre). */
+int image_write_rect(Image *img, int x, int y, int w, int h,
+                     const uint32_t *src, int src_stride);
+int image_read_rect(const Image *img, int x, int y, int w, int h,
+                    uint32_t *dst, int dst_stride);
+/* count lignes completes a partir de y, tampon contigu (stride = width) */
+int image_write_rows(Image *img, int y, int count, const uint32_t *src);
+int image_read_rows(const Image *img, int y, int count, uint32_t *dst);
+
+/* Emprunt du tampon : pixel (0,0), *stride en pixels entre deux lignes.
+   Valide jusqu'a image_destroy, ou jusqu'au prochain filtre a voisinage
+   (flou, convolution) pour une image creee par image_create : le
+   resultat y remplace le tampon. Une image emballee garde sa memoire. */
+uint32_t *image_borrow_pixels(Image *img, int *stride);
+/* "invert", "grayscale", "blur" (gaussien sigma 1), "sharpen" (3x3) ;
+   nom inconnu : image inchangee */
 void image_apply_filter(Image *img, const char *filter_name);
 
+/* Pipeline de filtres : etapes enchainees, appliquees en une passe par
+   bande de lignes (fusion), bandes reparties entre threads. Pixels
+   0xAARRGGBB, bords traites par repetition. Les fonctions add renvoient
+   0, -1 (parametre invalide) ou -2 (memoire). Un pipeline ne s'applique
+   qu'a une image a la fois. */
+typedef struct ImagePipeline ImagePipeline;
+
+ImagePipeline *image_pipeline_create(void);
+void image_pipeline_destroy(ImagePipeline *p);
+
+int image_pipeline_add_invert(ImagePipeline *p);                  /* alpha compris */
+int image_pipeline_add_grayscale(ImagePipeline *p);               /* (r+g+b)/3, alpha a 0 */
+int image_pipeline_add_brightness_contrast(ImagePipeline *p,      /* RVB, alpha conserve */
+                                           int brightness,        /* -255..255 */
+                                           float contrast);       /* 0..4 (1 : inchange) */
+int image_pipeline_add_box_blur(ImagePipeline *p, int radius);    /* 1..32 */
+int image_pipeline_add_gaussian_blur(ImagePipeline *p, float sigma);  /* 0.3..10.6 */
+int image_pipeline_add_convolution(ImagePipeline *p,              /* RVB, alpha conserve */
+                                   const float *kernel,           /* size*size, ligne par ligne */
+                                   int size);                     /* 1, 3, 5 ou 7 */
+
+void image_pipeline_set_threads(ImagePipeline *p, int threads);   /* 0 : un par coeur */
+void image_pipeline_set_fusion(ImagePipeline *p, int enabled);    /* 0 : une passe par etape */
+int image_pipeline_apply(ImagePipeline *p, Image *img);           /* 0, -1 ou -2 */
+
+/* "avx2" ou "scalaire" selon la compilation (-mavx2) */
+const char *image_simd_backend(void);
+
 #ifdef __cplusplus
 }
 #endif
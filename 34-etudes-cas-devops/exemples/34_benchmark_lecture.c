@@ -0,0 +1,457 @@
+/* ============================================================================
+   Section 34.2.1 : Lecture efficace de gros fichiers
+   Description : Suite de benchmarks du chemin de lecture, corrigeant
+                 25_benchmark_read.c et 19/20_benchmark.c
+                 - cache froid par defaut : posix_fadvise(DONTNEED) avant
+                   chaque passe, residence verifiee avec mincore()
+                 - chaque octet est consomme (empreinte ponderee par la
+                   position, identique pour toutes les methodes)
+                 - read() de 4 Ko a 16 Mo, pread() multi-threads,
+                   mmap (simple, MADV_SEQUENTIAL, MADV_WILLNEED,
+                   MADV_HUGEPAGE, MAP_POPULATE), io_uring (es_async.h)
+                 - repetitions entrelacees, mediane / min / max / ecart-type
+   Fichier source : 02.1-lecture-gros-fichiers.md
+   ============================================================================ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "es_async.h"
+
+#define MAX_METHODES 24
+#define MAX_REPETITIONS 50
+#define MAX_THREADS 64
+#define BLOC_PREAD (1024 * 1024)
+#define URING_PROFONDEUR 8
+#define URING_BLOC (1024 * 1024)
+
+typedef struct {
+    uint64_t somme;
+    uint64_t ponderee;                  /* detecte un desordre ou un trou */
+} empreinte_t;
+
+/* Consommation reelle : chaque octet entre dans l'empreinte */
+static void consommer(const unsigned char *p, size_t n, uint64_t position, empreinte_t *e) {
+    uint64_t s = 0, w = 0;
+    for (size_t i = 0; i < n; i++) {
+        s += p[i];
+        w += p[i] * (position + i);
+    }
+    e->somme += s;
+    e->ponderee += w;
+}
+
+static double secondes(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+typedef struct {
+    const char *chemin;
+    size_t taille;
+} fichier_t;
+
+/* ---------------------------------------------------------------------------
+   Methodes
+   --------------------------------------------------------------------------- */
+
+static int lire_read(const fichier_t *f, size_t tampon, empreinte_t *e) {
+    int fd = open(f->chemin, O_RDONLY);
+    if (fd == -1) return -1;
+    unsigned char *buf = malloc(tampon);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+    uint64_t pos = 0;
+    ssize_t n;
+    while ((n = read(fd, buf, tampon)) > 0) {
+        consommer(buf, (size_t)n, pos, e);
+        pos += (uint64_t)n;
+    }
+    free(buf);
+    close(fd);
+    return n < 0 || pos != f->taille ? -1 : 0;
+}
+
+typedef struct {
+    int fd;
+    size_t taille;
+    int id, nb;
+    empreinte_t e;
+    int erreur;
+} lecteur_t;
+
+/* Blocs de 1 Mo distribues en tourniquet : les threads avancent ensemble
+   et le readahead du noyau voit encore un flux presque sequentiel */
+static void *lecteur_pread(void *arg) {
+    lecteur_t *l = arg;
+    unsigned char *buf = malloc(BLOC_PREAD);
+    if (!buf) {
+        l->erreur = 1;
+        return NULL;
+    }
+    for (size_t off = (size_t)l->id * BLOC_PREAD; off < l->taille; off += (size_t)l->nb * BLOC_PREAD) {
+        size_t voulu = l->taille - off < BLOC_PREAD ? l->taille - off : BLOC_PREAD;
+        ssize_t n = pread(l->fd, buf, voulu, (off_t)off);
+        if (n != (ssize_t)voulu) {
+            l->erreur = 1;
+            break;
+        }
+        consommer(buf, (size_t)n, off, &l->e);
+    }
+    free(buf);
+    return NULL;
+}
+
+static int lire_pread(const fichier_t *f, int nb_threads, empreinte_t *e) {
+    int fd = open(f->chemin, O_RDONLY);
+    if (fd == -1) return -1;
+    pthread_t threads[MAX_THREADS];
+    lecteur_t lecteurs[MAX_THREADS];
+    int ret = 0, lances = 0;
+    for (; lances < nb_threads; lances++) {
+        lecteurs[lances] = (lecteur_t){ .fd = fd, .taille = f->taille, .id = lances, .nb = nb_threads };
+        int rc = pthread_create(&threads[lances], NULL, lecteur_pread, &lecteurs[lances]);
+        if (rc != 0) {
+            /* Tranches manquantes : la lecture est incomplete */
+            errno = rc;
+            ret = -1;
+            break;
+        }
+    }
+    for (int i = 0; i < lances; i++) {
+        pthread_join(threads[i], NULL);
+        e->somme += lecteurs[i].e.somme;
+        e->ponderee += lecteurs[i].e.ponderee;
+        if (lecteurs[i].erreur) ret = -1;
+    }
+    close(fd);
+    return ret;
+}
+
+static int lire_mmap(const fichier_t *f, int conseil, int drapeaux, empreinte_t *e) {
+    int fd = open(f->chemin, O_RDONLY);
+    if (fd == -1) return -1;
+    unsigned char *p = mmap(NULL, f->taille, PROT_READ, MAP_PRIVATE | drapeaux, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    if (conseil >= 0) madvise(p, f->taille, conseil);   /* echec = sans effet, mesure quand meme */
+    /* Par tranches : la boucle interne reste identique a celle de read() */
+    for (size_t off = 0; off < f->taille; off += BLOC_PREAD) {
+        size_t n = f->taille - off < BLOC_PREAD ? f->taille - off : BLOC_PREAD;
+        consommer(p + off, n, off, e);
+    }
+    munmap(p, f->taille);
+    return 0;
+}
+
+/* io_uring : URING_PROFONDEUR blocs en vol, chaque bloc consomme a sa
+   terminaison puis relance plus loin ; l'empreinte ne depend pas de
+   l'ordre des terminaisons */
+static int lire_uring(const fichier_t *f, empreinte_t *e) {
+    int fd = open(f->chemin, O_RDONLY);
+    if (fd == -1) return -1;
+    es_async_t a;
+    if (es_init(&a, URING_PROFONDEUR, 0) == -1) {
+        close(fd);
+        return -1;
+    }
+    unsigned char *tampons = aligned_alloc(4096, (size_t)URING_PROFONDEUR * URING_BLOC);
+    es_requete_t reqs[URING_PROFONDEUR], *finies[URING_PROFONDEUR];
+    int ret = -1;
+    if (!tampons || es_enregistrer_fichiers(&a, &fd, 1) == -1) goto fin;
+    struct iovec iov = { tampons, (size_t)URING_PROFONDEUR * URING_BLOC };
+    es_enregistrer_tampons(&a, &iov, 1);
+
+    size_t prochain = 0;
+    for (int i = 0; i < URING_PROFONDEUR && prochain < f->taille; i++) {
+        size_t n = f->taille - prochain < URING_BLOC ? f->taille - prochain : URING_BLOC;
+        reqs[i] = (es_requete_t){ .op = ES_LIRE, .fichier = 0, .tampon = 0,
+                                  .buf = tampons + (size_t)i * URING_BLOC, .len = n,
+                                  .off = (off_t)prochain };
+        prochain += n;
+        if (es_soumettre(&a, &reqs[i]) == -1) goto fin;
+    }
+    while (a.en_vol > 0) {
+        int n = es_recolter(&a, finies, URING_PROFONDEUR, 1);
+        if (n < 0) goto fin;
+        for (int k = 0; k < n; k++) {
+            es_requete_t *r = finies[k];
+            if (r->resultat != (ssize_t)r->len) goto fin;
+            consommer(r->buf, r->len, (uint64_t)r->off, e);
+            if (prochain < f->taille) {
+                r->len = f->taille - prochain < URING_BLOC ? f->taille - prochain : URING_BLOC;
+                r->off = (off_t)prochain;
+                prochain += r->len;
+                if (es_soumettre(&a, r) == -1) goto fin;
+            }
+        }
+    }
+    ret = 0;
+fin:
+    /* Vider les requetes en vol avant de liberer les tampons */
+    while (a.en_vol > 0 && es_recolter(&a, finies, URING_PROFONDEUR, 1) > 0) {}
+    es_detruire(&a);
+    free(tampons);
+    close(fd);
+    return ret;
+}
+
+/* ---------------------------------------------------------------------------
+   Cache de page
+   --------------------------------------------------------------------------- */
+
+static void vider_cache(const fichier_t *f) {
+    int fd = open(f->chemin, O_RDONLY);
+    if (fd == -1) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+/* Fraction des pages du fichier presentes en cache (mincore) */
+static double residence(const fichier_t *f) {
+    int fd = open(f->chemin, O_RDONLY);
+    if (fd == -1) return -1;
+    void *p = mmap(NULL, f->taille, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    long page = sysconf(_SC_PAGESIZE);
+    size_t nb_pages = (f->taille + (size_t)page - 1) / (size_t)page;
+    unsigned char *vec = malloc(nb_pages);
+    double r = -1;
+    if (vec && mincore(p, f->taille, vec) == 0) {
+        size_t presentes = 0;
+        for (size_t i = 0; i < nb_pages; i++) presentes += vec[i] & 1;
+        r = (double)presentes / (double)nb_pages;
+    }
+    free(vec);
+    munmap(p, f->taille);
+    return r;
+}
+
+/* ---------------------------------------------------------------------------
+   Suite
+   --------------------------------------------------------------------------- */
+
+typedef enum { M_READ, M_PREAD, M_MMAP, M_URING } famille_t;
+
+typedef struct {
+    char nom[40];
+    famille_t famille;
+    size_t tampon;                      /* read */
+    int threads;                        /* pread */
+    int conseil, drapeaux;              /* mmap */
+    double debits[MAX_REPETITIONS];     /* Mo/s */
+    int nb_mesures;
+    bool echec;
+} methode_t;
+
+static int executer(const methode_t *m, const fichier_t *f, empreinte_t *e) {
+    switch (m->famille) {
+    case M_READ:  return lire_read(f, m->tampon, e);
+    case M_PREAD: return lire_pread(f, m->threads, e);
+    case M_MMAP:  return lire_mmap(f, m->conseil, m->drapeaux, e);
+    default:      return lire_uring(f, e);
+    }
+}
+
+static int comparer_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static int creer_fichier(const char *chemin, long taille_mo) {
+    int fd = open(chemin, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) return -1;
+    char *buf = malloc(1 << 20);
+    if (!buf) {
+        close(fd);
+        return -1;
+    }
+    /* Texte pseudo-aleatoire en lignes, comme un journal */
+    uint64_t x = 88172645463325252ULL;
+    int ret = 0;
+    for (long i = 0; i < taille_mo && ret == 0; i++) {
+        for (size_t k = 0; k < (1 << 20); k++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+            buf[k] = (x & 63) == 0 ? '\n' : (char)(' ' + x % 95);
+        }
+        if (write(fd, buf, 1 << 20) != 1 << 20) ret = -1;
+    }
+    free(buf);
+    if (fsync(fd) == -1) ret = -1;
+    close(fd);
+    return ret;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-f fichier | -t taille_mo] [-r repetitions] [-j threads] "
+                    "[-d repertoire] [-w]\n"
+                    "  -f  fichier existant a lire (sinon un fichier temporaire est cree)\n"
+                    "  -t  taille du fichier temporaire en Mo (defaut : 256)\n"
+                    "  -r  repetitions par methode (defaut : 5)\n"
+                    "  -j  threads maximum pour pread (defaut : 4)\n"
+                    "  -d  repertoire du fichier temporaire (defaut : /tmp)\n"
+                    "  -w  cache chaud : ne pas vider le cache entre les passes\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    const char *chemin_fourni = NULL, *rep = "/tmp";
+    long taille_mo = 256;
+    int repetitions = 5, max_threads = 4;
+    bool chaud = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "f:t:r:j:d:wh")) != -1) {
+        switch (opt) {
+        case 'f': chemin_fourni = optarg; break;
+        case 't': taille_mo = atol(optarg); break;
+        case 'r': repetitions = atoi(optarg); break;
+        case 'j': max_threads = atoi(optarg); break;
+        case 'd': rep = optarg; break;
+        case 'w': chaud = true; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (repetitions < 1) repetitions = 1;
+    if (repetitions > MAX_REPETITIONS) repetitions = MAX_REPETITIONS;
+    if (max_threads < 1) max_threads = 1;
+    if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+
+    char chemin[4096];
+    if (chemin_fourni) {
+        snprintf(chemin, sizeof(chemin), "%s", chemin_fourni);
+    } else {
+        snprintf(chemin, sizeof(chemin), "%s/benchmark_lecture_%d.dat", rep, (int)getpid());
+        if (taille_mo < 1 || creer_fichier(chemin, taille_mo) == -1) {
+            perror("creation du fichier");
+            unlink(chemin);
+            return 1;
+        }
+    }
+    struct stat st;
+    if (stat(chemin, &st) == -1 || st.st_size == 0) {
+        perror(chemin);
+        return 1;
+    }
+    fichier_t f = { chemin, (size_t)st.st_size };
+
+    /* Catalogue des methodes */
+    methode_t methodes[MAX_METHODES];
+    int nb = 0;
+    size_t tampons[] = { 4096, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+    for (int i = 0; i < 4; i++) {
+        methodes[nb] = (methode_t){ .famille = M_READ, .tampon = tampons[i] };
+        if (tampons[i] < 1024 * 1024) snprintf(methodes[nb].nom, 40, "read %zu Ko", tampons[i] / 1024);
+        else snprintf(methodes[nb].nom, 40, "read %zu Mo", tampons[i] / (1024 * 1024));
+        nb++;
+    }
+    /* 1, 2, 4... puis max_threads s'il n'est pas une puissance de 2 ;
+       6 places restent pour mmap et io_uring */
+    for (int t = 1; nb < MAX_METHODES - 6; t = t < max_threads && t * 2 > max_threads ? max_threads : t * 2) {
+        methodes[nb] = (methode_t){ .famille = M_PREAD, .threads = t };
+        snprintf(methodes[nb++].nom, 40, "pread 1 Mo x %d thread%s", t, t > 1 ? "s" : "");
+        if (t >= max_threads) break;
+    }
+    struct { const char *nom; int conseil, drapeaux; } variantes[] = {
+        { "mmap", -1, 0 },
+        { "mmap MADV_SEQUENTIAL", MADV_SEQUENTIAL, 0 },
+        { "mmap MADV_WILLNEED", MADV_WILLNEED, 0 },
+        { "mmap MADV_HUGEPAGE", MADV_HUGEPAGE, 0 },
+        { "mmap MAP_POPULATE", -1, MAP_POPULATE },
+    };
+    for (size_t i = 0; i < sizeof(variantes) / sizeof(variantes[0]); i++) {
+        methodes[nb] = (methode_t){ .famille = M_MMAP, .conseil = variantes[i].conseil,
+                                    .drapeaux = variantes[i].drapeaux };
+        snprintf(methodes[nb++].nom, 40, "%s", variantes[i].nom);
+    }
+    es_async_t essai;
+    bool uring = es_init(&essai, 1, 0) == 0 && essai.backend == ES_BACKEND_URING;
+    es_detruire(&essai);
+    methodes[nb] = (methode_t){ .famille = M_URING };
+    snprintf(methodes[nb++].nom, 40, "%s QD %d x 1 Mo", uring ? "io_uring" : "threads", URING_PROFONDEUR);
+
+    printf("=== Chemin de lecture : %s (%.0f Mo) ===\n", chemin, (double)f.taille / (1 << 20));
+    printf("Cache %s, %d repetitions entrelacees par methode\n\n",
+           chaud ? "chaud (passe de chauffe)" : "froid (POSIX_FADV_DONTNEED avant chaque passe)",
+           repetitions);
+
+    /* Reference d'empreinte, et chauffe en mode chaud */
+    empreinte_t reference = { 0, 0 };
+    if (lire_read(&f, 1024 * 1024, &reference) == -1) {
+        perror("lecture de reference");
+        return 1;
+    }
+
+    bool ok = true;
+    double residence_max = 0;
+    for (int r = 0; r < repetitions; r++) {
+        for (int i = 0; i < nb; i++) {
+            methode_t *m = &methodes[i];
+            if (m->echec) continue;
+            if (!chaud) {
+                vider_cache(&f);
+                double res = residence(&f);
+                if (res > residence_max) residence_max = res;
+            }
+            empreinte_t e = { 0, 0 };
+            double debut = secondes();
+            int ret = executer(m, &f, &e);
+            double duree = secondes() - debut;
+            if (ret == -1 || e.somme != reference.somme || e.ponderee != reference.ponderee) {
+                m->echec = true;
+                ok = false;
+                continue;
+            }
+            m->debits[m->nb_mesures++] = (double)f.taille / (1 << 20) / duree;
+        }
+    }
+
+    printf("%-26s %9s %9s %9s %9s %7s\n", "Methode", "Mediane", "Min", "Max", "Ecart", "CV");
+    printf("%-26s %9s %9s %9s %9s %7s\n", "", "(Mo/s)", "", "", "type", "");
+    for (int i = 0; i < nb; i++) {
+        methode_t *m = &methodes[i];
+        if (m->echec) {
+            printf("%-26s %9s\n", m->nom, "ECHEC");
+            continue;
+        }
+        double tri[MAX_REPETITIONS], moyenne = 0, variance = 0;
+        memcpy(tri, m->debits, (size_t)m->nb_mesures * sizeof(double));
+        qsort(tri, (size_t)m->nb_mesures, sizeof(double), comparer_double);
+        for (int k = 0; k < m->nb_mesures; k++) moyenne += tri[k];
+        moyenne /= m->nb_mesures;
+        for (int k = 0; k < m->nb_mesures; k++) variance += (tri[k] - moyenne) * (tri[k] - moyenne);
+        double ecart = m->nb_mesures > 1 ? sqrt(variance / (m->nb_mesures - 1)) : 0;
+        double mediane = m->nb_mesures % 2 ? tri[m->nb_mesures / 2]
+                       : (tri[m->nb_mesures / 2 - 1] + tri[m->nb_mesures / 2]) / 2;
+        printf("%-26s %9.0f %9.0f %9.0f %9.0f %6.1f%%\n", m->nom, mediane, tri[0],
+               tri[m->nb_mesures - 1], ecart, 100 * ecart / moyenne);
+    }
+
+    if (!chaud) {
+        printf("\nCache residuel apres DONTNEED : %.1f %% au pire%s\n", 100 * residence_max,
+               residence_max > 0.05 ? " (pages epinglees par un autre processus ?)" : "");
+    }
+    if (!chemin_fourni) unlink(chemin);
+
+    printf("\nVerification : %s\n", ok ? "empreinte identique pour toutes les methodes et passes"
+                                       : "ECHEC (empreinte differente ou erreur de lecture)");
+    return ok ? 0 : 1;
+}